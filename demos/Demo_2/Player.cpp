@@ -48,7 +48,7 @@ bool Player::load(const ROData& inData, Handle objID, const mat4f* orient /* = N
 	//-- loop idle animation.
 	if (success)
 	{
-		Engine::instance().animationEngine().playAnim(m_animCtrl, "player/idle", true);
+		Engine::instance().animationEngine().playAnim(animCtrl(), "player/idle", true);
 		m_walking = false;
 	}
 
@@ -73,7 +73,7 @@ void Player::beginUpdate(float dt)
 	moveByKey(dt);
 
 	//-- update player transform.
-	mat4f& world = m_transform.m_worldMat;
+	mat4f& world = transform().m_worldMat;
 	{
 		world.preRotateY(-m_yawDiff);
 		world.postTranslation(m_posDiff);
@@ -113,8 +113,8 @@ void Player::beginUpdate(float dt)
 	{
 		if (!m_walking)
 		{
-			Engine::instance().animationEngine().stopAnim(m_animCtrl);
-			Engine::instance().animationEngine().playAnim(m_animCtrl, "player/walk", true);
+			Engine::instance().animationEngine().stopAnim(animCtrl());
+			Engine::instance().animationEngine().playAnim(animCtrl(), "player/walk", true);
 			m_walking = true;
 		}
 	}
@@ -122,8 +122,8 @@ void Player::beginUpdate(float dt)
 	{
 		if (m_walking)
 		{
-			Engine::instance().animationEngine().stopAnim(m_animCtrl);
-			Engine::instance().animationEngine().playAnim(m_animCtrl, "player/idle", true);
+			Engine::instance().animationEngine().stopAnim(animCtrl());
+			Engine::instance().animationEngine().playAnim(animCtrl(), "player/idle", true);
 			m_walking = false;
 		}
 	}
@@ -142,8 +142,8 @@ bool Player::handleMouseButtonEvent(const SDL_MouseButtonEvent& e)
 		auto& gameWorld = Engine::instance().gameWorld();
 
 		//-- prepare collision ray.
-		vec3f dir   = m_transform.m_worldMat.applyToUnitAxis(mat4f::X_AXIS).getNormalized();
-		vec3f start = m_transform.m_worldMat.applyToOrigin() + vec3f(0.0f, 0.25f, 0.0f) + dir.scale(1.0f);
+		vec3f dir   = transform().m_worldMat.applyToUnitAxis(mat4f::X_AXIS).getNormalized();
+		vec3f start = transform().m_worldMat.applyToOrigin() + vec3f(0.0f, 0.25f, 0.0f) + dir.scale(1.0f);
 		vec3f end   = start + dir.scale(50.0f);
 
 		PhysicsWorld::CollisionCallback cc;
@@ -222,11 +222,11 @@ void Player::moveByKey(float dt)
 //--------------------------------------------------------------------------------------------------
 void Player::move(float value)
 {
-	m_posDiff += m_transform.m_worldMat.applyToUnitAxis(mat4f::X_AXIS).scale(value);
+	m_posDiff += transform().m_worldMat.applyToUnitAxis(mat4f::X_AXIS).scale(value);
 }
 
 //--------------------------------------------------------------------------------------------------
 void Player::strafe(float value)
 {
-	m_posDiff += m_transform.m_worldMat.applyToUnitAxis(mat4f::Z_AXIS).scale(value);	
+	m_posDiff += transform().m_worldMat.applyToUnitAxis(mat4f::Z_AXIS).scale(value);	
 }
\ No newline at end of file
@@ -49,11 +49,11 @@ bool Zombie::load(const ROData& inData, Handle objID, const mat4f* orient)
 	//-- loop idle animation.
 	if (success)
 	{
-		Engine::instance().animationEngine().playAnim(m_animCtrl, "zfat/idle", true);
+		Engine::instance().animationEngine().playAnim(animCtrl(), "zfat/idle", true);
 		m_state = STATE_IDLE;
 	}
 
-	m_originMat = m_transform.m_worldMat;
+	m_originMat = transform().m_worldMat;
 	m_accumPos.setZero();
 	m_accumYaw  = 0.0f;
 
@@ -79,15 +79,15 @@ void Zombie::receiveEvent(const GameEvent& event)
 		if (m_health <= 0.0f)
 		{
 			//-- play death animation.
-			Engine::instance().animationEngine().stopAnim(m_animCtrl);
-			Engine::instance().animationEngine().playAnim(m_animCtrl, "zfat/death", false);
+			Engine::instance().animationEngine().stopAnim(animCtrl());
+			Engine::instance().animationEngine().playAnim(animCtrl(), "zfat/death", false);
 			m_state = STATE_DEAD;
 		}
 		else
 		{
 			//-- play hit pain.
-			Engine::instance().animationEngine().stopAnim(m_animCtrl);
-			Engine::instance().animationEngine().playAnim(m_animCtrl, "zfat/pain", true);
+			Engine::instance().animationEngine().stopAnim(animCtrl());
+			Engine::instance().animationEngine().playAnim(animCtrl(), "zfat/pain", true);
 			m_hitTimeout = 0.5f;
 
 			m_state = STATE_COOLDOWN;
@@ -108,7 +108,7 @@ float signAngle(const vec3f& v1, const vec3f& v2)
 //--------------------------------------------------------------------------------------------------
 void Zombie::beginUpdate(float dt)
 {
-	DebugDrawer::instance().drawCoordAxis(m_transform.m_worldMat, 0.2f);
+	DebugDrawer::instance().drawCoordAxis(transform().m_worldMat, 0.2f);
 
 	//-- zombie is dead.
 	if (m_state == STATE_DEAD)
@@ -119,7 +119,7 @@ void Zombie::beginUpdate(float dt)
 
 	//-- calculate direction vector.
 	vec3f selfDir = m_originMat.applyToUnitAxis(mat4f::X_AXIS).getNormalized();
-	vec3f dir     = playerMat.applyToOrigin() - m_transform.m_worldMat.applyToOrigin();
+	vec3f dir     = playerMat.applyToOrigin() - transform().m_worldMat.applyToOrigin();
 	float dist    = dir.length();
 	dir.normalize();
 
@@ -132,7 +132,7 @@ void Zombie::beginUpdate(float dt)
 		//float yaw3 = signAngle(dir, selfDir);
 
 		//if (!almostZero(yaw3, 0.01f))
-		//	m_transform.m_worldMat.preRotateZ(yaw3);
+		//	transform().m_worldMat.preRotateZ(yaw3);
 		m_accumYaw = yaw1;
 
 		//INFO_MSG("angle %f %f %f", yaw1, yaw2, yaw3);
@@ -142,14 +142,14 @@ void Zombie::beginUpdate(float dt)
 		{
 			m_accumPos += dir.scale(m_speed * dt);
 			//vec3f move = dir.scale(m_speed * dt);
-			//m_transform.m_worldMat.postTranslation(move);
+			//transform().m_worldMat.postTranslation(move);
 
 			if (m_state != STATE_WALK)
 			{
 				const char* walkAnims[] = {"zfat/walk1", "zfat/walk2", "zfat/walk3", "zfat/walk4"};
 
-				Engine::instance().animationEngine().stopAnim(m_animCtrl);
-				Engine::instance().animationEngine().playAnim(m_animCtrl, walkAnims[random(3)], true);
+				Engine::instance().animationEngine().stopAnim(animCtrl());
+				Engine::instance().animationEngine().playAnim(animCtrl(), walkAnims[random(3)], true);
 				m_state = STATE_WALK;
 			}
 		}
@@ -164,8 +164,8 @@ void Zombie::beginUpdate(float dt)
 				//-- play attack animation.
 				if (m_state != STATE_ATTACK)
 				{
-					Engine::instance().animationEngine().stopAnim(m_animCtrl);
-					Engine::instance().animationEngine().playAnim(m_animCtrl, "zfat/attack", true);
+					Engine::instance().animationEngine().stopAnim(animCtrl());
+					Engine::instance().animationEngine().playAnim(animCtrl(), "zfat/attack", true);
 					m_state = STATE_ATTACK;
 				}
 
@@ -187,7 +187,7 @@ void Zombie::beginUpdate(float dt)
 	}
 	
 	//-- reconstruct world pos.
-	m_transform.m_worldMat = m_originMat;
-	m_transform.m_worldMat.preRotateY(m_accumYaw);
-	m_transform.m_worldMat.postTranslation(m_accumPos);
+	transform().m_worldMat = m_originMat;
+	transform().m_worldMat.preRotateY(m_accumYaw);
+	transform().m_worldMat.postTranslation(m_accumPos);
 }
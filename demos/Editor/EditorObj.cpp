@@ -39,7 +39,7 @@ bool EditorGameObj::load(const ROData& inData, Handle objID, const mat4f* orient
 
 		if (getFileExt(meshName) == "md5mesh")
 		{
-			Engine::instance().animationEngine().playAnim(m_animCtrl, "death1_pose", true);
+			Engine::instance().animationEngine().playAnim(animCtrl(), "death1_pose", true);
 		}
 	}
 
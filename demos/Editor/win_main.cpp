@@ -9,14 +9,14 @@
 //#include <crtdbg.h>
 using namespace brUGE;
 
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int)
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR cmdLine, int)
 {	
 	//_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 
 	Engine engine;
 	try
 	{
-		engine.init(hInstance, new Editor());
+		engine.init(hInstance, new Editor(), cmdLine);
 		engine.run();
 	}
 	catch(Exception& e)
@@ -12,14 +12,6 @@ struct vs_out
 
 #ifdef _VERTEX_SHADER_
 
-#ifdef PIN_INSTANCED
-	//-- instancing auto variable.
-	tbuffer tb_auto_Instancing
-	{
-		float4x4 g_instances[128];
-	};
-#endif
-
 //--------------------------------------------------------------------------------------------------
 struct vs_in
 {                                           
@@ -37,7 +29,7 @@ vs_out main(vs_in i)
 	vs_out o;
 
 #ifdef PIN_INSTANCED
-	float4 wPos = mul(float4(i.pos, 1), g_instances[i.instID]);
+	float4 wPos = mul(float4(i.pos, 1), loadInstance(i.instID).m_worldMat);
 	o.pos		= mul(wPos, g_viewProjMat); 
 #else
 	o.pos = mul(float4(i.pos, 1), g_MVPMat);
@@ -0,0 +1,239 @@
+#include "common.hlsl"
+
+//--------------------------------------------------------------------------------------------------
+struct PointLight
+{
+	float4 m_pos;
+	float4 m_inoutRadius;
+	float4 m_color;
+};
+
+//--------------------------------------------------------------------------------------------------
+struct SpotLight
+{
+	float4 m_pos;
+	float4 m_dir;
+	float4 m_fading; //-- inner cos, outer cos, start fading, end fading.
+	float4 m_color;
+};
+
+//--------------------------------------------------------------------------------------------------
+cbuffer cb_clusterGrid
+{
+	float4 g_clusterGrid;	//-- tiles x, tiles y, slices, slices / log(far / near).
+	float4 g_clusterParams; //-- near, far.
+};
+
+//-- cluster is (offset, points count | spots count << 16). Two clusters per texel.
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_lightClusters
+{
+	uint4 g_clusters[1536];
+};
+
+//-- 16 bit light indices. Eight indices per texel.
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_lightIndices
+{
+	uint4 g_lightIndices[4096];
+};
+
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_pointLights
+{
+	PointLight g_pointLights[1024];
+};
+
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_spotLights
+{
+	SpotLight g_spotLights[1024];
+};
+
+//-- shadow of the one face of the local light. See ShadowManager::GPULocalShadow.
+//--------------------------------------------------------------------------------------------------
+struct LocalShadow
+{
+	float4x4 m_viewProj;
+	float4	 m_tileRect; //-- atlas uv offset (xy) and scale (zw). Empty if the face has no shadow.
+};
+
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_localShadows
+{
+	LocalShadow g_localShadows[192];
+};
+
+//-- index of the first local shadow of the light or -1. Point lights go first, then spot lights.
+//-- Four indices per texel.
+//--------------------------------------------------------------------------------------------------
+tbuffer tb_lightShadows
+{
+	int4 g_lightShadows[512];
+};
+
+//-- vertex 2 fragment.
+//--------------------------------------------------------------------------------------------------
+struct vs_out
+{
+	float4 pos	: SV_POSITION;
+	float3 vDir	: TEXCOORD0;
+};
+
+#ifdef _VERTEX_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+struct vs_in
+{
+	float3 pos		: POSITION;
+	float2 texCoord	: TEXCOORD0;
+};
+
+//--------------------------------------------------------------------------------------------------
+vs_out main(in vs_in i)
+{
+	vs_out o;
+	o.pos = float4(i.pos, 1.0f);
+
+	//-- calculate world space camera to vertex direction.
+	float4 wPos = mul(float4(i.pos.xy, g_farNearPlane.x, 1.0f), g_invViewProjMat);
+	wPos.xyz /= wPos.w;
+
+	o.vDir = (wPos.xyz - g_cameraPos);
+
+	return o;
+}
+
+#endif
+
+#ifdef _FRAGMENT_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+texture2D(float4, t_auto_depthMap);
+texture2D(float,  g_shadowAtlas);
+
+//--------------------------------------------------------------------------------------------------
+uint lightIndex(uint i)
+{
+	uint4 texel  = g_lightIndices[i >> 3];
+	uint  packed = texel[(i >> 1) & 3];
+	return (i & 1) ? (packed >> 16) : (packed & 0xffff);
+}
+
+//--------------------------------------------------------------------------------------------------
+int lightShadow(uint i)
+{
+	return g_lightShadows[i >> 2][i & 3];
+}
+
+//-- faces of the point light are ordered as +x, -x, +y, -y, +z, -z.
+//--------------------------------------------------------------------------------------------------
+uint cubeFace(float3 dir)
+{
+	float3 a = abs(dir);
+
+	if (a.x >= a.y && a.x >= a.z)	return (dir.x > 0.0f) ? 0 : 1;
+	else if (a.y >= a.z)			return (dir.y > 0.0f) ? 2 : 3;
+	else							return (dir.z > 0.0f) ? 4 : 5;
+}
+
+//-- returns 1 if the pixel is in shadow of the face of the local light. Note: use explicit LOD
+//-- because of the dynamic branching.
+//--------------------------------------------------------------------------------------------------
+float localShadow(int face, float3 wPos)
+{
+	LocalShadow shadow = g_localShadows[face];
+
+	if (shadow.m_tileRect.z == 0.0f)
+		return 0.0f;
+
+	float4 lPos = mul(float4(wPos, 1.0f), shadow.m_viewProj);
+	lPos.xyz /= lPos.w;
+
+	//-- clamp to the tile to not pick up the neighbours.
+	float2 uv = shadow.m_tileRect.xy + saturate(CS2TS(lPos.xy)) * shadow.m_tileRect.zw;
+
+	return lPos.z > g_shadowAtlas_tex.SampleLevel(g_shadowAtlas_sml, uv, 0).x;
+}
+
+//-- the same lighting model as the direction lights use.
+//--------------------------------------------------------------------------------------------------
+float4 calcLighting(float3 l, float3 v, float3 n, float3 color, float atten)
+{
+	float3 h	= normalize(l + v);
+	float  diff = max(0.0f, dot(l, n));
+	float  spec = luminance(color) * pow(max(0.0f, dot(h, n)), 20.0f);
+
+	return atten * float4(diff * color, spec);
+}
+
+//-------------------------------------------------------------------------------------------------
+float4 main(vs_out i) : SV_TARGET
+{
+	float2 tc = i.pos.xy * g_screenRes.zw;
+	float4 nz = sample2D(t_auto_depthMap, tc);
+
+	float3 vDir	 = normalize(i.vDir);
+	float3 wPos	 = g_cameraPos.xyz + vDir * nz.w;
+	float3 n	 = nz.xyz;
+	float3 v	 = -vDir;
+	float  viewZ = mul(float4(wPos, 1.0f), g_viewMat).z;
+
+	//-- find out the cluster of the pixel.
+	uint3 cluster;
+	cluster.xy = min(uint2(tc * g_clusterGrid.xy), uint2(g_clusterGrid.xy) - 1);
+	cluster.z  = (uint)clamp(log(max(viewZ, g_clusterParams.x) / g_clusterParams.x) * g_clusterGrid.w, 0, g_clusterGrid.z - 1);
+
+	uint  clusterIdx = (cluster.z * g_clusterGrid.y + cluster.y) * g_clusterGrid.x + cluster.x;
+	uint4 texel		 = g_clusters[clusterIdx >> 1];
+	uint2 record	 = (clusterIdx & 1) ? texel.zw : texel.xy;
+	uint  offset	 = record.x;
+	uint  points	 = record.y & 0xffff;
+	uint  spots		 = record.y >> 16;
+
+	float4 result = 0;
+
+	[loop]
+	for (uint p = 0; p < points; ++p)
+	{
+		uint	   slot	 = lightIndex(offset + p);
+		PointLight light = g_pointLights[slot];
+
+		float3 l	 = light.m_pos.xyz - wPos;
+		float  dist	 = length(l);
+		float  atten = 1.0f - smoothstep(light.m_inoutRadius.x, light.m_inoutRadius.y, dist);
+
+		int shadow = lightShadow(slot);
+		if (shadow >= 0)
+		{
+			atten *= 1.0f - localShadow(shadow + cubeFace(-l), wPos);
+		}
+
+		result += calcLighting(l / dist, v, n, light.m_color.rgb, atten);
+	}
+
+	[loop]
+	for (uint s = 0; s < spots; ++s)
+	{
+		uint	  slot	= lightIndex(offset + points + s);
+		SpotLight light = g_spotLights[slot];
+
+		float3 l	 = light.m_pos.xyz - wPos;
+		float  dist	 = length(l);
+		float3 ln	 = l / dist;
+		float  cone  = smoothstep(light.m_fading.y, light.m_fading.x, dot(-ln, light.m_dir.xyz));
+		float  atten = cone * (1.0f - smoothstep(light.m_fading.z, light.m_fading.w, dist));
+
+		int shadow = lightShadow(1024 + slot);
+		if (shadow >= 0)
+		{
+			atten *= 1.0f - localShadow(shadow, wPos);
+		}
+
+		result += calcLighting(ln, v, n, light.m_color.rgb, atten);
+	}
+
+	return result;
+}
+
+#endif
@@ -54,16 +54,66 @@ cbuffer cb_auto_PerFrame
 	float4x4 g_envTransform;
 };
 
-//-- per instance auto variables.
+//-- per instance auto variables. Constants of the all draw calls of the pass are packed into the
+//-- tb_auto_PerInstance by chunks, the cb_auto_PerInstance only selects the record of the current
+//-- draw call inside the chunk.
+struct PerInstance
+{
+	float4x4 m_worldMat;
+	float4x4 m_MVPMat;
+	float4x4 m_MVMat;
+	uint4	 m_params; //-- x - offset of the matrix palette, y - offset of the instances batch.
+};
+
 cbuffer cb_auto_PerInstance
 {
-	float4x4 g_worldMat;
-	float4x4 g_MVPMat;
-	float4x4 g_MVMat;
+	uint     g_instance;
 	float    g_alphaRef;
-	float	 g_padding[3];
+	float2	 g_padding;
+};
+
+tbuffer tb_auto_PerInstance
+{
+	PerInstance g_perInstance[256];
+};
+
+#define g_worldMat	g_perInstance[g_instance].m_worldMat
+#define g_MVPMat	g_perInstance[g_instance].m_MVPMat
+#define g_MVMat		g_perInstance[g_instance].m_MVMat
+#define g_paletteOffset	g_perInstance[g_instance].m_params.x
+#define g_instanceOffset	g_perInstance[g_instance].m_params.y
+#define g_lodFade			asfloat(g_perInstance[g_instance].m_params.z)
+
+//-- matrix palettes of the all skinned instances of the frame.
+tbuffer tb_auto_MatrixPalette
+{
+	float4x4 g_bones[16384];
+};
+
+#ifdef PIN_INSTANCED
+
+//-- payload of the one instance in the per-pass instance stream. Every instanced draw call reads
+//-- its own batch starting at the g_instanceOffset.
+struct Instance
+{
+	float4x4 m_worldMat;
+	float4	 m_tint;
+	float4	 m_params; //-- x - LOD fade, y - offset of the matrix palette.
 };
 
+tbuffer tb_auto_Instancing
+{
+	Instance g_instances[4096];
+};
+
+//--------------------------------------------------------------------------------------------------
+Instance loadInstance(uint instanceID)
+{
+	return g_instances[g_instanceOffset + instanceID];
+}
+
+#endif
+
 #ifdef _VERTEX_SHADER_
 
 
@@ -84,6 +134,15 @@ float3 restoreWorldPos(in float3 vDir, in float2 tc)
 {
 }
 
+//-- screen-door transparency used for the LOD cross-fading. Fully visible when fade is 1. Negative
+//-- fade selects the complementary pattern, so the fading out LOD fills exactly the discarded pixels.
+//--------------------------------------------------------------------------------------------------
+void clipLodFade(in float fade, in float2 pixelPos)
+{
+	float dither = frac(52.9829189f * frac(dot(pixelPos, float2(0.06711056f, 0.00583715f))));
+	clip((fade >= 0.0f) ? (fade - dither) : (dither - (1.0f + fade)));
+}
+
 //-- converts clip space position to texture space. I.e. from XY[-1, +1] -> UV[0, 1]
 //--------------------------------------------------------------------------------------------------
 float2 CS2TS(in float2 cs)
@@ -5,18 +5,13 @@ struct vs_out
 {
 	float4 pos		: SV_POSITION;	
 	float2 tc		: TEXCOORD0;
+#ifdef PIN_INSTANCED
+	nointerpolation float3 tint : TEXCOORD1;
+#endif
 };
 
 #ifdef _VERTEX_SHADER_
 
-#ifdef PIN_INSTANCED
-	//-- instancing auto variable.
-	tbuffer tb_auto_Instancing
-	{
-		float4x4 g_instances[128];
-	};
-#endif
-
 //--------------------------------------------------------------------------------------------------
 struct vs_in
 {
@@ -34,7 +29,9 @@ vs_out main(vs_in i)
 	vs_out o;
 
 #ifdef PIN_INSTANCED
-	float4x4 worldMat = g_instances[i.instID];
+	Instance inst	  = loadInstance(i.instID);
+	float4x4 worldMat = inst.m_worldMat;
+	o.tint			  = inst.m_tint.rgb;
 #else
 	float4x4 worldMat = g_worldMat;
 #endif
@@ -71,6 +68,10 @@ float4 main(vs_out i) : SV_TARGET
 	//-- calculate decals factor.
 	float3 colorRGB = lerp(srcColor.xyz, decalColor.xyz, decalColor.w);
 
+#ifdef PIN_INSTANCED
+	colorRGB *= i.tint;
+#endif
+
 	//-- calculate lighting factor.
 	float3 chrom = lightsMask.rgb / (G_EPS + luminance(lightsMask.rgb));
 	float3 spec  = chrom * lightsMask.a;
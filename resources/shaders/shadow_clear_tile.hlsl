@@ -0,0 +1,39 @@
+#include "common.hlsl"
+
+//-- Clears the shadow atlas tile covered by the current view port by writing the farthest depth.
+//-- Note: D3D11 can't clear the part of the depth texture, so we do it by drawing full-screen
+//--	   quad with disabled depth test.
+
+//--------------------------------------------------------------------------------------------------
+struct vs_out
+{
+	float4 pos : SV_POSITION;
+};
+
+#ifdef _VERTEX_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+struct vs_in
+{
+	float3 pos	: POSITION;
+	float2 tc	: TEXCOORD0;
+};
+
+//--------------------------------------------------------------------------------------------------
+vs_out main(in vs_in i)
+{
+	vs_out o;
+	o.pos = float4(i.pos.xy, 1.0f, 1.0f);
+	return o;
+}
+
+#endif
+
+#ifdef _FRAGMENT_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+void main(vs_out i)
+{
+}
+	
+#endif
@@ -0,0 +1,44 @@
+#include "common.hlsl"
+
+//-- Copies the tile of the static shadow atlas covered by the current view port into the same tile
+//-- of the shadow atlas. Both atlases have the same layout, so the pixel position is the same.
+//-- Note: D3D11 can't copy the part of the depth texture, so we do it by drawing full-screen
+//--	   quad writing depth with disabled depth test.
+
+//--------------------------------------------------------------------------------------------------
+struct vs_out
+{
+	float4 pos : SV_POSITION;
+};
+
+#ifdef _VERTEX_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+struct vs_in
+{
+	float3 pos	: POSITION;
+	float2 tc	: TEXCOORD0;
+};
+
+//--------------------------------------------------------------------------------------------------
+vs_out main(in vs_in i)
+{
+	vs_out o;
+	o.pos = float4(i.pos.xy, 1.0f, 1.0f);
+	return o;
+}
+
+#endif
+
+#ifdef _FRAGMENT_SHADER_
+
+//--------------------------------------------------------------------------------------------------
+texture2D(float, g_staticAtlas);
+
+//--------------------------------------------------------------------------------------------------
+float main(vs_out i) : SV_DEPTH
+{
+	return g_staticAtlas_tex.Load(int3(i.pos.xy, 0)).x;
+}
+
+#endif
@@ -49,9 +49,22 @@ vs_out main(in vs_in i)
 
 //--------------------------------------------------------------------------------------------------
 texture2D(float4, t_auto_depthMap);
-texture2D(float,  g_shadowMap);
+texture2D(float,  g_shadowMap0);
+texture2D(float,  g_shadowMap1);
+texture2D(float,  g_shadowMap2);
+texture2D(float,  g_shadowMap3);
 texture2D(float4, g_noiseMap);
 
+//-- every split has its own shadow map. Note: use explicit LOD because of the dynamic branching.
+//-------------------------------------------------------------------------------------------------
+float sampleShadowMap(int split, float2 shadowUV)
+{
+	if		(split == 0)	return g_shadowMap0_tex.SampleLevel(g_shadowMap0_sml, shadowUV, 0).x;
+	else if (split == 1)	return g_shadowMap1_tex.SampleLevel(g_shadowMap1_sml, shadowUV, 0).x;
+	else if (split == 2)	return g_shadowMap2_tex.SampleLevel(g_shadowMap2_sml, shadowUV, 0).x;
+	else					return g_shadowMap3_tex.SampleLevel(g_shadowMap3_sml, shadowUV, 0).x;
+}
+
 static uint PCF_NUM_SAMPLES = 16;
 
 static float2 poissonDisk[] =
@@ -76,27 +89,27 @@ static float2 poissonDisk[] =
 
 //-- do PCF filter based on poisson disk with 16 samples.
 //-------------------------------------------------------------------------------------------------
-float PCF_filter(float2 shadowUV, float zReceiver, float filterRadiusUV) 
+float PCF_filter(int split, float2 shadowUV, float zReceiver, float filterRadiusUV) 
 { 
     float  sum	  = 0.0f; 
-	float2 adjust = g_invShadowMapRes.xy * filterRadiusUV * float2(0.25f, 1.0f);
+	float2 adjust = g_invShadowMapRes.xy * filterRadiusUV;
 
 	[unroll]
     for (int i = 0; i < PCF_NUM_SAMPLES; ++i) 
     { 
-		sum += (zReceiver > sample2D(g_shadowMap, shadowUV + poissonDisk[i] * adjust).x);
+		sum += (zReceiver > sampleShadowMap(split, shadowUV + poissonDisk[i] * adjust));
     } 
     return sum / PCF_NUM_SAMPLES; 
 }
 
 //-------------------------------------------------------------------------------------------------
-float customFilter(in float2 shadowUV, in float2 screenUV, in float zReceiver, in float filterRadiusUV)
+float customFilter(in int split, in float2 shadowUV, in float2 screenUV, in float zReceiver, in float filterRadiusUV)
 {
 	//-- get noise from texture.
 	float2 noiseUV = screenUV * (g_screenRes.xy / float2(256,256));
 	float2 noise   = 2.0 * sample2D(g_noiseMap, noiseUV).xy - float2(1,1);
 
-	float2 adjust =  g_invShadowMapRes.xy * filterRadiusUV * float2(0.25f, 1.0f);
+	float2 adjust =  g_invShadowMapRes.xy * filterRadiusUV;
 
 	float2 dx	  = float2(noise.x, 0.0f);
 	float2 dy	  = float2(0.0f, noise.y);
@@ -104,14 +117,14 @@ float customFilter(in float2 shadowUV, in float2 screenUV, in float zReceiver, i
 	float2 dxdy_n = (dx - dy);
 
 	float result =
-		(zReceiver > sample2D(g_shadowMap, shadowUV + dx * adjust).x) + 
-		(zReceiver > sample2D(g_shadowMap, shadowUV - dx * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV + dy * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV - dy * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV + dxdy_p * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV - dxdy_p * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV + dxdy_n * adjust).x) +
-		(zReceiver > sample2D(g_shadowMap, shadowUV - dxdy_n * adjust).x);
+		(zReceiver > sampleShadowMap(split, shadowUV + dx * adjust)) + 
+		(zReceiver > sampleShadowMap(split, shadowUV - dx * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV + dy * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV - dy * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV + dxdy_p * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV - dxdy_p * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV + dxdy_n * adjust)) +
+		(zReceiver > sampleShadowMap(split, shadowUV - dxdy_n * adjust));
 
 	return result * 0.125f;
 }
@@ -138,12 +151,12 @@ float4 main(vs_out i) : SV_TARGET
 	pixelLightSpace.xyz /= pixelLightSpace.w;
 
 	//-- calculate shadow space texture coordinates and pixel's depth.
-	float2 shadowTC = CS2TS(pixelLightSpace.xy) * float2(0.25f, 1.0f) + float2(0.25f, 0.0f) * split;
+	float2 shadowTC = CS2TS(pixelLightSpace.xy);
 	float  shadowD  = pixelLightSpace.z;
 
 	//-- lets compare our calculated depth with the depth saved in the shadow map.
 #if 0
-	float isInShadow = (shadowD > sample2D(g_shadowMap, shadowTC).x);
+	float isInShadow = (shadowD > sampleShadowMap(split, shadowTC));
 #endif
 
 	//-- calculate PCF filter width based on the distance to the camera and distance in light space
@@ -152,12 +165,12 @@ float4 main(vs_out i) : SV_TARGET
 	float filterFadeSpeed = 1.5f;
 	float filterWidth = 3.0f * abs(g_farNearPlane.y - filterFadeSpeed * zDist) / g_farNearPlane.y;
 
-	float isInShadow = PCF_filter(shadowTC, shadowD, filterWidth);
+	float isInShadow = PCF_filter(split, shadowTC, shadowD, filterWidth);
 #endif
 
 	//-- custom filter with helps of noise texture.
 #if 0
-	float isInShadow = customFilter(shadowTC, i.tc, shadowD, 2.0f);
+	float isInShadow = customFilter(split, shadowTC, i.tc, shadowD, 2.0f);
 #endif
 
 	return float4(isInShadow, 0, 0, 0);
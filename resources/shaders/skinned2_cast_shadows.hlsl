@@ -7,12 +7,6 @@ struct vs_out
 	float4 pos	: SV_POSITION;
 };
 
-//--------------------------------------------------------------------------------------------------
-tbuffer tb_auto_MatrixPalette
-{
-	float4x4 g_bones[100];
-};
-
 #ifdef _VERTEX_SHADER_
 
 //-------------------------------------------------------------------------------------------------
@@ -23,19 +17,28 @@ struct vs_in
 	float2 tc		: TEXCOORD0;
 	uint3  joints	: TEXCOORD1;
 	float3 weights	: TEXCOORD2;
+#ifdef PIN_INSTANCED
+	uint   instID	: SV_InstanceID;
+#endif
 };
 
 //-------------------------------------------------------------------------------------------------
 vs_out main(vs_in i)
 {
     vs_out o;
+
+#ifdef PIN_INSTANCED
+	uint paletteOffset = (uint)loadInstance(i.instID).m_params.y;
+#else
+	uint paletteOffset = g_paletteOffset;
+#endif
     
     float3 worldPos = float3(0,0,0);
 
 	[unroll]
     for (uint j = 0; j < 3; ++j)
     {
-		float4x4 bone   = g_bones[i.joints[j]];
+		float4x4 bone   = g_bones[paletteOffset + i.joints[j]];
 		float    weight = i.weights[j];
 
 		if (weight == 0.0f) continue;
@@ -13,12 +13,7 @@ struct vs_out
 	float3 tangent  : TEXCOORD3;
 	float3 binormal : TEXCOORD4;
 #endif
-};
-
-//--------------------------------------------------------------------------------------------------
-tbuffer tb_auto_MatrixPalette
-{
-	float4x4 g_bones[100];
+	nointerpolation float lodFade : TEXCOORD5;
 };
 
 #ifdef _VERTEX_SHADER_
@@ -31,6 +26,9 @@ struct vs_in
 	float2 tc		: TEXCOORD0;
 	uint3  joints	: TEXCOORD1;
 	float3 weights	: TEXCOORD2;
+#ifdef PIN_INSTANCED
+	uint   instID	: SV_InstanceID;
+#endif
 #ifdef PIN_BUMP_MAP
 	float3 tangent  : TANGENT;
 	float3 binormal : BINORMAL;
@@ -41,6 +39,15 @@ struct vs_in
 vs_out main(vs_in i)
 {
     vs_out o;
+
+#ifdef PIN_INSTANCED
+	Instance inst	   = loadInstance(i.instID);
+	uint paletteOffset = (uint)inst.m_params.y;
+	o.lodFade		   = inst.m_params.x;
+#else
+	uint paletteOffset = g_paletteOffset;
+	o.lodFade		   = g_lodFade;
+#endif
     
 	float3 worldPos	     = float3(0,0,0);
 	float3 worldNormal   = float3(0,0,0);
@@ -53,7 +60,7 @@ vs_out main(vs_in i)
 	[unroll]
 	for (uint j = 0; j < 3; ++j)
 	{
-		float4x4 bone   = g_bones[i.joints[j]];
+		float4x4 bone   = g_bones[paletteOffset + i.joints[j]];
 		float    weight = i.weights[j];
 
 		if (weight == 0.0f) continue;
@@ -102,6 +109,8 @@ float4 main(vs_out i) : SV_TARGET
 		discard;
 #endif
 
+	clipLodFade(i.lodFade, i.pos.xy);
+
 	float  dist = length(i.wPos - g_cameraPos.xyz);
 
 #ifdef PIN_BUMP_MAP
@@ -20,18 +20,12 @@ tbuffer tb_auto_Weights
 	Weight g_weights[2048];
 };
 
-//-- 64 byte aligned.
-tbuffer tb_auto_MatrixPalette
-{
-	float4x4 g_bones[256];
-};
-
 #ifdef _VERTEX_SHADER_
 
 //--------------------------------------------------------------------------------------------------
 float3 boneTransf(in uint idx, in float3 pos)
 {
-	float4x4 bone = g_bones[idx];
+	float4x4 bone = g_bones[g_paletteOffset + idx];
     return mul(float4(pos, 1.0f), bone).xyz;
 }
 
@@ -11,18 +11,11 @@ struct vs_out
 	float3 tangent  : TEXCOORD2;
 	float3 binormal : TEXCOORD3;
 #endif
+	nointerpolation float lodFade : TEXCOORD4;
 };
 
 #ifdef _VERTEX_SHADER_
 
-#ifdef PIN_INSTANCED
-	//-- instancing auto variable.
-	tbuffer tb_auto_Instancing
-	{
-		float4x4 g_instances[128];
-	};
-#endif
-
 //--------------------------------------------------------------------------------------------------
 struct vs_in
 {                                           
@@ -44,9 +37,12 @@ vs_out main(vs_in i)
 	vs_out o;
 
 #ifdef PIN_INSTANCED
-	float4x4 worldMat = g_instances[i.instID];
+	Instance inst	  = loadInstance(i.instID);
+	float4x4 worldMat = inst.m_worldMat;
+	o.lodFade		  = inst.m_params.x;
 #else
 	float4x4 worldMat = g_worldMat;
+	o.lodFade		  = g_lodFade;
 #endif
 
 	float4 wPos = mul(float4(i.pos, 1), worldMat);
@@ -87,6 +83,8 @@ float4 main(vs_out i) : SV_TARGET
 		discard;
 #endif
 
+	clipLodFade(i.lodFade, i.pos.xy);
+
 	float  dist = length(i.wPos - g_cameraPos.xyz);
 
 #ifdef PIN_BUMP_MAP
@@ -0,0 +1,160 @@
+#include "Console.h"
+#include "utils/string_utils.h"
+#include "utils/LogManager.h"
+
+#include <stdexcept>
+
+using namespace brUGE::utils;
+
+namespace brUGE
+{
+	DEFINE_SINGLETON(Console)
+
+	//---------------------------------------------------------------------------------------------
+	Console::Console()
+	{
+
+	}
+
+	//---------------------------------------------------------------------------------------------
+	Console::~Console()
+	{
+
+	}
+
+	//---------------------------------------------------------------------------------------------
+	void Console::parseCommandLine(const char* cmdLine)
+	{
+		if (!cmdLine)
+			return;
+
+		std::string	 token;
+		StrTokenizer tokenizer(cmdLine);
+		while (tokenizer.hasMoreTokens())
+		{
+			tokenizer.nextToken(token);
+
+			if (token[0] == '+' && token.size() > 1)
+			{
+				m_pending.push_back(ParamList(1, token.substr(1)));
+			}
+			else if (!m_pending.empty())
+			{
+				m_pending.back().push_back(token);
+			}
+			else
+			{
+				WARNING_MSG("Console: unexpected token '%s' in the command line.", token.c_str());
+			}
+		}
+
+		//-- the values registered by the constructors are already here.
+		for (auto iter = m_pending.begin(); iter != m_pending.end();)
+		{
+			if (m_values.find(iter->front()) != m_values.end())
+			{
+				execute(*iter);
+				iter = m_pending.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------------------------------
+	void Console::executePending()
+	{
+		std::vector<ParamList> pending;
+		pending.swap(m_pending);
+
+		for (const auto& tokens : pending)
+		{
+			execute(tokens);
+		}
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool Console::execute(const std::string& line)
+	{
+		ParamList	 tokens;
+		std::string	 token;
+		StrTokenizer tokenizer(line);
+		while (tokenizer.hasMoreTokens())
+		{
+			tokenizer.nextToken(token);
+			tokens.push_back(token);
+		}
+
+		if (tokens.empty())
+			return false;
+
+		return execute(tokens);
+	}
+
+	//---------------------------------------------------------------------------------------------
+	bool Console::execute(const ParamList& tokens)
+	{
+		const std::string& name = tokens.front();
+		ParamList		   args(tokens.begin() + 1, tokens.end());
+
+		try
+		{
+			auto value = m_values.find(name);
+			if (value != m_values.end())
+			{
+				if (args.size() != 1)
+					throw std::runtime_error("1 arg is expected.");
+
+				value->second->set(args[0]);
+				INFO_MSG("Console: %s = %s.", name.c_str(), value->second->get().c_str());
+				return true;
+			}
+
+			auto command = m_commands.find(name);
+			if (command != m_commands.end())
+			{
+				INFO_MSG("Console: executing %s.", name.c_str());
+				(*command->second)(args);
+				return true;
+			}
+		}
+		catch (const std::exception& e)
+		{
+			ERROR_MSG("Console: %s - %s", name.c_str(), e.what());
+			return false;
+		}
+
+		WARNING_MSG("Console: unknown value or command '%s'.", name.c_str());
+		return false;
+	}
+
+	//-- Note: the latest registration wins, e.g. for the values of the recreated objects.
+	//---------------------------------------------------------------------------------------------
+	void Console::registerValue(const std::string& name, IWatcher* value)
+	{
+		m_values[name].reset(value);
+
+		//-- apply the value given in the command line.
+		for (auto iter = m_pending.begin(); iter != m_pending.end();)
+		{
+			if (iter->front() == name)
+			{
+				execute(*iter);
+				iter = m_pending.erase(iter);
+			}
+			else
+			{
+				++iter;
+			}
+		}
+	}
+
+	//---------------------------------------------------------------------------------------------
+	void Console::registerCommand(const std::string& name, Functor* command)
+	{
+		m_commands[name].reset(command);
+	}
+
+} // brUGE
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "utils/Singleton.h"
+#include "console/Functors.h"
+#include "console/WatchersPanel.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace brUGE
+{
+
+	//-- Registry of the console values and commands.
+	//-- The command line of the application is a sequence of the console lines, each one starts
+	//-- with '+', e.g. "+jobs_threads 4 +jobs_scaling_benchmark 4000000 +exit". Values given in the
+	//-- command line are applied at the moment of theirs registration, so the subsystems see them
+	//-- already in init(). Commands are executed by executePending() after the engine has been
+	//-- initialized.
+	//----------------------------------------------------------------------------------------------
+	class Console : public utils::Singleton<Console>, public NonCopyable
+	{
+	public:
+		Console();
+		~Console();
+
+		void parseCommandLine(const char* cmdLine);
+		void executePending();
+
+		//-- execute the console line "name arg1 arg2 ...". Setting of the value takes one argument.
+		bool execute(const std::string& line);
+
+		void registerValue(const std::string& name, IWatcher* value);
+		void registerCommand(const std::string& name, Functor* command);
+
+	private:
+		bool execute(const ParamList& tokens);
+
+	private:
+		std::map<std::string, std::unique_ptr<IWatcher>>	m_values;
+		std::map<std::string, std::unique_ptr<Functor>>		m_commands;
+		std::vector<ParamList>								m_pending; //-- name followed by the args.
+	};
+
+} // brUGE
+
+#define REGISTER_CONSOLE_VALUE(m_name, type, value) \
+	brUGE::Console::instance().registerValue(m_name, new brUGE::RawWatcher<type>(&value));
+#define REGISTER_CONSOLE_MEMBER_VALUE(m_name, type, value, className) \
+	brUGE::Console::instance().registerValue(m_name, new brUGE::RawObjWatcher<type, className>(this, &className::value));
+#define REGISTER_CONSOLE_FUNC(m_name, func) \
+	brUGE::Console::instance().registerCommand(m_name, new brUGE::FunctorFunc(&func));
+#define REGISTER_CONSOLE_METHOD(m_name, func, className) \
+	brUGE::Console::instance().registerCommand(m_name, new brUGE::FunctorMethod<className>(this, &className::func));
@@ -4,6 +4,7 @@
 #include "utils/ArgParser.h"
 #include <string>
 #include <vector>
+#include <stdexcept>
 #include <cassert>
 
 namespace brUGE
@@ -12,6 +12,9 @@ namespace
 {
 	const float g_updateInterval = 0.2f;
 
+	//-- nodes are never reallocated, because the other threads may access them without locking.
+	const uint	g_maxNodes		 = 1024;
+
 	//---------------------------------------------------------------------------------------------
 	inline void formatStr(std::string& out, float timeInPercent, float time)
 	{
@@ -32,17 +35,22 @@ namespace brUGE
 
 	DEFINE_SINGLETON(TimingPanel)
 
+	thread_local TimingPanel::MeasureNodeID TimingPanel::m_curNode = 0;
+
 	//---------------------------------------------------------------------------------------------
 	TimingPanel::TimingPanel()
 		:	m_isVisible(false), m_updateTime(0.0f), m_needForceUpdate(true), m_totalFrameTime(1.0f),
-			m_measuresPerUpdate(1), m_root(-1), m_curNode(-1), m_rootMeasurer(1), //-- ToDo:
+			m_measuresPerUpdate(1), m_root(-1), m_rootMeasurer(1), //-- ToDo:
 			m_scroll(0)
 	{
+		m_nodes.reserve(g_maxNodes);
+
 		//-- insert this node as the first node in list to eliminate unnecessary run-time checking.
 		_insertNode(MeasureNode("parent of root", -1));
 
 		m_root    = _insertNode(MeasureNode("frame time", 0));
 		m_curNode = m_root;
+		_getNode(0).childs.push_back(m_root);
 	}
 
 	//---------------------------------------------------------------------------------------------
@@ -86,7 +94,11 @@ namespace brUGE
 
 		ImGui::Text("Stats: %.3f us (%.2f fps).", m_totalFrameTime * 1000.0f, 1.0f / m_totalFrameTime);
 
-		_recursiveVisualize(m_root);
+		//-- the frame tree goes first, then the trees of the other threads.
+		for (MeasureNodeID nodeID : _getNode(0).childs)
+		{
+			_recursiveVisualize(nodeID);
+		}
 
 		ImGui::End();
 	}
@@ -103,7 +115,10 @@ namespace brUGE
 		{
 			m_totalFrameTime = static_cast<float>(_getNode(m_root).time / m_measuresPerUpdate);
 
-			_recursiveUpdate(m_root, 0);
+			for (MeasureNodeID nodeID : _getNode(0).childs)
+			{
+				_recursiveUpdate(nodeID, 0);
+			}
 
 			//-- reset counters.	
 			m_updateTime = 0.0f;
@@ -115,6 +130,9 @@ namespace brUGE
 	//---------------------------------------------------------------------------------------------
 	TimingPanel::MeasureNodeID TimingPanel::create(const std::string& name)
 	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		assert(m_nodes.size() < g_maxNodes && "Too many time measurement nodes.");
+
 		MeasureNodeID nodeID = _insertNode(MeasureNode(name, m_curNode));
 		_getNode(m_curNode).childs.push_back(nodeID);
 		return nodeID;
@@ -5,6 +5,7 @@
 #include "SDL/SDL_timer.h"
 #include <string>
 #include <vector>
+#include <mutex>
 
 namespace brUGE
 {
@@ -85,7 +86,8 @@ namespace brUGE
 			inline ~ScopeTimeMeasurer() { stop(); }
 		};
 		
-		//-- create new node with desired name.
+		//-- create new node with desired name. The node becomes a child of the current node of the
+		//-- calling thread. It's thread safe.
 		MeasureNodeID create(const std::string& name);
 
 	public:
@@ -124,8 +126,12 @@ namespace brUGE
 		TimeMeasurer		m_rootMeasurer;
 		float				m_updateTime;
 		MeasureNodeID		m_root;
-		MeasureNodeID		m_curNode;
 		MeasureNodes		m_nodes;
+		std::mutex			m_mutex;
+
+		//-- the current node is tracked per thread. Threads which never call start(), i.e. the render
+		//-- thread, put their nodes under the "parent of root" node, so they are shown as separate trees.
+		static thread_local MeasureNodeID m_curNode;
 
 		//-- visual
 		int					m_scroll;
@@ -16,7 +16,7 @@ namespace brUGE
 	class IWatcher
 	{
 	public:
-		~IWatcher() { }
+		virtual ~IWatcher() { }
 
 		virtual std::string	get() const			 = 0;				
 		virtual void set(const std::string& str) = 0;
@@ -0,0 +1,500 @@
+#include "asset_cooker.hpp"
+#include "SDL/SDL_timer.h"
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+
+#include <windows.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+using namespace brUGE;
+using namespace brUGE::utils;
+
+namespace brUGE
+{
+	//--------------------------------------------------------------------------------------------------
+	void assimp2staticmesh(const aiScene& scene, uint lodsCount, bool optimize, WOData& oData);
+	//void assimp2skinnedmesh(const aiScene& scene, WOData& oData);
+	//void assimp2animation(const aiScene& scene, WOData& oData);
+}
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- should be incremented whenever converter changes its output, so the whole cache becomes
+	//-- invalid.
+	const uint32 g_converterVersion = 1;
+
+	const char* g_cacheFile	 = "cook_cache.txt";
+	const char* g_reportFile = "cook_report.txt";
+
+	//-- serializes the console output of the worker threads.
+	std::mutex g_outputMutex;
+
+	//-- 64 bit FNV-1a.
+	//----------------------------------------------------------------------------------------------
+	uint64 hashBytes(const void* data, size_t size, uint64 hash = 14695981039346656037ULL)
+	{
+		const uint8* bytes = static_cast<const uint8*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool hashFile(const std::string& file, uint64& oHash)
+	{
+		std::ifstream iFile(file.c_str(), std::ios_base::binary | std::ios_base::in);
+		if (!iFile.is_open())
+			return false;
+
+		char buffer[64 * 1024];
+		while (iFile)
+		{
+			iFile.read(buffer, sizeof(buffer));
+			oHash = hashBytes(buffer, static_cast<size_t>(iFile.gcount()), oHash);
+		}
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool fileExists(const std::string& file)
+	{
+		DWORD attributes = GetFileAttributesA(file.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+	}
+
+	//-- create all the missing directories of the file path.
+	//----------------------------------------------------------------------------------------------
+	void createPath(const std::string& file)
+	{
+		for (size_t pos = file.find_first_of("/\\"); pos != std::string::npos; pos = file.find_first_of("/\\", pos + 1))
+		{
+			if (pos > 0)
+				CreateDirectoryA(file.substr(0, pos).c_str(), nullptr);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	std::string removeExt(const std::string& file)
+	{
+		size_t dot	 = file.find_last_of('.');
+		size_t slash = file.find_last_of("/\\");
+
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return file;
+
+		return file.substr(0, dot);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	const char* outputExt(EConvertingType type)
+	{
+		switch (type)
+		{
+		case CONVERTING_TYPE_SKINNED:	return ".skinnedmesh";
+		case CONVERTING_TYPE_ANIMATION:	return ".animation";
+		default:						return ".mesh";
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void gatherTextures(const aiScene& scene, std::vector<std::string>& oDependencies)
+	{
+		for (uint m = 0; m < scene.mNumMaterials; ++m)
+		{
+			const auto& material = *scene.mMaterials[m];
+
+			for (int t = aiTextureType_DIFFUSE; t <= aiTextureType_UNKNOWN; ++t)
+			{
+				aiTextureType type = static_cast<aiTextureType>(t);
+
+				for (uint i = 0; i < material.GetTextureCount(type); ++i)
+				{
+					aiString path;
+					if (material.GetTexture(type, i, &path) != AI_SUCCESS)
+						continue;
+
+					std::string texture = path.C_Str();
+					if (std::find(oDependencies.begin(), oDependencies.end(), texture) == oDependencies.end())
+					{
+						oDependencies.push_back(texture);
+					}
+				}
+			}
+		}
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	bool convertAsset(
+		const std::string& iFile, EConvertingType type, const ConvertOptions& options,
+		WOData& oData, std::vector<std::string>& oDependencies, std::string& oError)
+	{
+		try
+		{
+			Assimp::Importer importer;
+			auto const* scene = importer.ReadFile(
+				iFile, aiProcess_CalcTangentSpace | aiProcess_ConvertToLeftHanded | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality
+			);
+
+			//-- Note: error string is owned by the importer.
+			if (!scene)
+			{
+				oError = importer.GetErrorString();
+				return false;
+			}
+
+			switch (type)
+			{
+			case CONVERTING_TYPE_STATIC:	{	assimp2staticmesh	(*scene, options.m_lodsCount, options.m_optimize, oData); break;		}
+			//case CONVERTING_TYPE_SKINNED:	{	assimp2skinnedmesh	(*scene, oData); break;		}
+			//case CONVERTING_TYPE_ANIMATION:	{	assimp2animation	(*scene, oData); break;		}
+			default:
+				throw "Conversion type isn't supported yet.";
+			}
+
+			gatherTextures(*scene, oDependencies);
+			return true;
+		}
+		catch (const char* e)
+		{
+			oError = e;
+		}
+		catch (...)
+		{
+			oError = "Unspecified error.";
+		}
+		return false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool writeFile(const std::string& file, const WOData& data)
+	{
+		std::ofstream oFile;
+		oFile.open(file.c_str(), std::ios_base::trunc | std::ios_base::binary | std::ios_base::out);
+		if (!oFile.is_open())
+			return false;
+
+		oFile.write((const char*)data.ptr(0), data.length());
+		return oFile.good();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	AssetCooker::AssetCooker(const std::string& outDir, const ConvertOptions& options, uint numThreads)
+		: m_outDir(outDir), m_options(options), m_numThreads(numThreads)
+	{
+		if (m_numThreads == 0)
+		{
+			m_numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	AssetCooker::~AssetCooker()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool AssetCooker::gather(const std::string& source)
+	{
+		DWORD attributes = GetFileAttributesA(source.c_str());
+		if (attributes == INVALID_FILE_ATTRIBUTES)
+		{
+			std::cout << "Can't find '" << source << "'.\n";
+			return false;
+		}
+
+		//-- 1. the whole directory.
+		if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			m_rootDir = source;
+			gatherDir("");
+			return true;
+		}
+
+		//-- 2. manifest file. Inputs are relative to the manifest's directory.
+		size_t slash = source.find_last_of("/\\");
+		m_rootDir = (slash != std::string::npos) ? source.substr(0, slash) : ".";
+
+		std::ifstream manifest(source.c_str());
+		std::string line;
+		for (uint lineNo = 1; std::getline(manifest, line); ++lineNo)
+		{
+			std::istringstream entry(line);
+			std::string input, type;
+
+			entry >> input >> type;
+			if (input.empty() || input[0] == '#')
+				continue;
+
+			if		(type.empty() || type == "static")	addAsset(input, CONVERTING_TYPE_STATIC);
+			else if (type == "skinned")					addAsset(input, CONVERTING_TYPE_SKINNED);
+			else if (type == "animation")				addAsset(input, CONVERTING_TYPE_ANIMATION);
+			else
+			{
+				std::cout << source << "(" << lineNo << "): unknown conversion type '" << type << "'.\n";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::gatherDir(const std::string& dir)
+	{
+		Assimp::Importer importer;
+		WIN32_FIND_DATAA data;
+
+		std::string prefix = dir.empty() ? "" : dir + "/";
+		HANDLE handle = FindFirstFileA((m_rootDir + "/" + prefix + "*").c_str(), &data);
+		if (handle == INVALID_HANDLE_VALUE)
+			return;
+
+		do
+		{
+			std::string name = data.cFileName;
+			if (name == "." || name == "..")
+				continue;
+
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+			{
+				gatherDir(prefix + name);
+			}
+			else
+			{
+				size_t dot = name.find_last_of('.');
+				if (dot != std::string::npos && importer.IsExtensionSupported(name.substr(dot).c_str()))
+				{
+					addAsset(prefix + name, CONVERTING_TYPE_STATIC);
+				}
+			}
+		}
+		while (FindNextFileA(handle, &data));
+
+		FindClose(handle);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::addAsset(const std::string& input, EConvertingType type)
+	{
+		Asset asset;
+		asset.m_input  = input;
+		asset.m_output = removeExt(input) + outputExt(type);
+		asset.m_type   = type;
+		asset.m_hash   = 0;
+		asset.m_status = Asset::STATUS_PENDING;
+		asset.m_time   = 0.0;
+
+		m_assets.push_back(asset);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool AssetCooker::cook()
+	{
+		uint64 startTime = SDL_GetPerformanceCounter();
+
+		loadCache();
+
+		//-- assets are taken one by one by the all workers, so the long ones don't stall the others.
+		std::atomic<uint> next(0);
+		auto worker = [this, &next]()
+		{
+			for (uint i = next++; i < m_assets.size(); i = next++)
+			{
+				cookAsset(m_assets[i]);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (uint i = 1; i < std::min<uint>(m_numThreads, m_assets.size()); ++i)
+		{
+			threads.push_back(std::thread(worker));
+		}
+		worker();
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		//-- update the cache. Failed assets are removed from it to be cooked again on the next run.
+		uint counts[4] = { 0, 0, 0, 0 };
+		for (const auto& asset : m_assets)
+		{
+			if (asset.m_status == Asset::STATUS_FAILED)
+				m_cache.erase(asset.m_output);
+			else
+				m_cache[asset.m_output] = CacheEntry{ asset.m_hash, asset.m_dependencies };
+
+			++counts[asset.m_status];
+		}
+
+		saveCache();
+		writeReport();
+
+		uint64 endTime = SDL_GetPerformanceCounter();
+		double elapsedTime = static_cast<double>(endTime - startTime) / SDL_GetPerformanceFrequency();
+
+		std::cout << m_assets.size() << " assets processed on " << m_numThreads << " threads for " << elapsedTime << " seconds: "
+			<< counts[Asset::STATUS_COOKED] << " cooked, " << counts[Asset::STATUS_UP_TO_DATE] << " up-to-date, "
+			<< counts[Asset::STATUS_FAILED] << " failed.\n";
+
+		return counts[Asset::STATUS_FAILED] == 0;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::cookAsset(Asset& asset) const
+	{
+		uint64 startTime = SDL_GetPerformanceCounter();
+
+		std::string iFile = m_rootDir + "/" + asset.m_input;
+		std::string oFile = m_outDir + "/" + asset.m_output;
+
+		//-- 1. cache key is built from the input data and the everything affecting the output.
+		uint64 hash = hashBytes(&g_converterVersion, sizeof(g_converterVersion));
+		hash = hashBytes(&asset.m_type, sizeof(asset.m_type), hash);
+		hash = hashBytes(&m_options.m_lodsCount, sizeof(m_options.m_lodsCount), hash);
+		hash = hashBytes(&m_options.m_optimize, sizeof(m_options.m_optimize), hash);
+
+		if (!hashFile(iFile, hash))
+		{
+			asset.m_status = Asset::STATUS_FAILED;
+			asset.m_error  = "Can't read input file.";
+		}
+		else
+		{
+			asset.m_hash = hash;
+
+			//-- 2. skip unchanged asset if its output is still there.
+			auto cached = m_cache.find(asset.m_output);
+			if (cached != m_cache.end() && cached->second.m_hash == hash && fileExists(oFile))
+			{
+				asset.m_status		 = Asset::STATUS_UP_TO_DATE;
+				asset.m_dependencies = cached->second.m_dependencies;
+			}
+			else
+			{
+				WOData oData;
+				if (convertAsset(iFile, asset.m_type, m_options, oData, asset.m_dependencies, asset.m_error))
+				{
+					createPath(oFile);
+					if (writeFile(oFile, oData))
+					{
+						asset.m_status = Asset::STATUS_COOKED;
+					}
+					else
+					{
+						asset.m_status = Asset::STATUS_FAILED;
+						asset.m_error  = "Can't write output file.";
+					}
+				}
+				else
+				{
+					asset.m_status = Asset::STATUS_FAILED;
+				}
+			}
+		}
+
+		uint64 endTime = SDL_GetPerformanceCounter();
+		asset.m_time = static_cast<double>(endTime - startTime) / SDL_GetPerformanceFrequency();
+
+		if (asset.m_status != Asset::STATUS_UP_TO_DATE)
+		{
+			std::lock_guard<std::mutex> lock(g_outputMutex);
+
+			if (asset.m_status == Asset::STATUS_COOKED)
+				std::cout << "'" << asset.m_input << "' has been cooked for " << asset.m_time << " seconds.\n";
+			else
+				std::cout << "'" << asset.m_input << "' failed: " << asset.m_error << "\n";
+		}
+	}
+
+	//-- one line per asset: "<hash>\t<output>[\t<dependency>...]".
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::loadCache()
+	{
+		std::ifstream iFile((m_outDir + "/" + g_cacheFile).c_str());
+
+		std::string line;
+		while (std::getline(iFile, line))
+		{
+			std::vector<std::string> fields;
+			std::istringstream stream(line);
+			for (std::string field; std::getline(stream, field, '\t'); )
+			{
+				fields.push_back(field);
+			}
+
+			if (fields.size() < 2)
+				continue;
+
+			auto& entry = m_cache[fields[1]];
+			entry.m_hash = std::strtoull(fields[0].c_str(), nullptr, 16);
+			entry.m_dependencies.assign(fields.begin() + 2, fields.end());
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::saveCache() const
+	{
+		std::string file = m_outDir + "/" + g_cacheFile;
+		createPath(file);
+
+		std::ofstream oFile(file.c_str(), std::ios_base::trunc | std::ios_base::out);
+		for (const auto& entry : m_cache)
+		{
+			oFile << std::hex << entry.second.m_hash << std::dec << "\t" << entry.first;
+			for (const auto& dependency : entry.second.m_dependencies)
+			{
+				oFile << "\t" << dependency;
+			}
+			oFile << "\n";
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void AssetCooker::writeReport() const
+	{
+		const char* statuses[] = { "pending", "up-to-date", "cooked", "failed" };
+
+		std::string file = m_outDir + "/" + g_reportFile;
+		createPath(file);
+
+		std::ofstream oFile(file.c_str(), std::ios_base::trunc | std::ios_base::out);
+		for (const auto& asset : m_assets)
+		{
+			oFile << asset.m_input << " -> " << asset.m_output << " [" << statuses[asset.m_status];
+			if (asset.m_status == Asset::STATUS_COOKED)
+				oFile << ", " << asset.m_time << " s";
+			oFile << "]\n";
+
+			if (asset.m_status == Asset::STATUS_FAILED)
+				oFile << "\terror: " << asset.m_error << "\n";
+
+			for (const auto& dependency : asset.m_dependencies)
+			{
+				oFile << "\tdepends on: " << dependency << "\n";
+			}
+		}
+	}
+
+} //-- brUGE
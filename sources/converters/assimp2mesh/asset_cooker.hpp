@@ -0,0 +1,99 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "utils/Data.hpp"
+#include <string>
+#include <vector>
+#include <map>
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	enum EConvertingType
+	{
+		CONVERTING_TYPE_STATIC,
+		CONVERTING_TYPE_SKINNED,
+		CONVERTING_TYPE_ANIMATION
+	};
+
+	//-- options affecting the converted data. They are a part of the asset's cache key.
+	//----------------------------------------------------------------------------------------------
+	struct ConvertOptions
+	{
+		ConvertOptions() : m_lodsCount(3), m_optimize(true) { }
+
+		uint m_lodsCount;
+		bool m_optimize;
+	};
+
+	//-- import and convert one asset. On success oDependencies contains the files referenced by the
+	//-- asset, i.e. textures of its materials.
+	bool convertAsset(
+		const std::string& iFile, EConvertingType type, const ConvertOptions& options,
+		utils::WOData& oData, std::vector<std::string>& oDependencies, std::string& oError
+		);
+
+	bool writeFile(const std::string& file, const utils::WOData& data);
+
+	//-- Batch converter of the whole asset library. Assets are taken from a directory (recursively,
+	//-- every file supported by the importer is cooked as a static mesh) or from a manifest file with
+	//-- one "<input file> [static|skinned|animation]" entry per line. Assets are processed in parallel
+	//-- on the all available cores. The cache file in the output directory keeps hash of the every
+	//-- asset's input data and options, so unchanged assets are skipped on the next run. At the end
+	//-- the report with the dependencies and the status of the every asset is written next to it.
+	//----------------------------------------------------------------------------------------------
+	class AssetCooker
+	{
+	public:
+		AssetCooker(const std::string& outDir, const ConvertOptions& options, uint numThreads);
+		~AssetCooker();
+
+		bool gather(const std::string& source);
+		bool cook();
+
+	private:
+		struct Asset
+		{
+			enum EStatus
+			{
+				STATUS_PENDING,
+				STATUS_UP_TO_DATE,
+				STATUS_COOKED,
+				STATUS_FAILED
+			};
+
+			std::string					m_input;
+			std::string					m_output;
+			EConvertingType				m_type;
+			uint64						m_hash;
+			EStatus						m_status;
+			double						m_time;
+			std::string					m_error;
+			std::vector<std::string>	m_dependencies;
+		};
+
+		//-- result of the previous run.
+		struct CacheEntry
+		{
+			uint64						m_hash;
+			std::vector<std::string>	m_dependencies;
+		};
+
+		void gatherDir(const std::string& dir);
+		void addAsset(const std::string& input, EConvertingType type);
+		void cookAsset(Asset& asset) const;
+		void loadCache();
+		void saveCache() const;
+		void writeReport() const;
+
+	private:
+		std::string						m_outDir;
+		std::string						m_rootDir; //-- inputs are relative to this directory.
+		ConvertOptions					m_options;
+		uint							m_numThreads;
+		std::vector<Asset>				m_assets;
+		std::map<std::string, CacheEntry>	m_cache; //-- output file -> entry.
+	};
+
+} //-- brUGE
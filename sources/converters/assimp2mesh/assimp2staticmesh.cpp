@@ -4,6 +4,10 @@
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 #include "render/mesh_formats.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include <iostream>
+#include <sstream>
 
 namespace brUGE
 {
@@ -32,16 +36,43 @@ namespace brUGE
 
 #pragma pack(pop)
 
+	//-- fraction of the LOD 0 triangles and the screen size at which the LOD is selected.
+	//----------------------------------------------------------------------------------------------
+	struct LodSetup
+	{
+		float m_reduction;
+		float m_screenSize;
+	};
+
+	const LodSetup g_lodSetups[] =
+	{
+		{ 0.5f,   0.25f },
+		{ 0.25f,  0.1f  },
+		{ 0.125f, 0.04f }
+	};
+
+	//-- allowed ACMR growth of the overdraw optimisation.
+	const float g_overdrawThreshold = 1.05f;
+
 	//----------------------------------------------------------------------------------------------
 	struct Mesh
 	{
 		std::string						m_name;
-		std::vector<uint16>				m_indices;
+		std::vector<uint32>				m_indices;
 		std::vector<Vertex::Common>		m_common;
 		std::vector<Vertex::Tangent>	m_tangent;
 	};
 	typedef std::vector<Mesh> Meshes;
 
+	//-- index-only LOD level of the all sub-meshes.
+	//----------------------------------------------------------------------------------------------
+	struct Lod
+	{
+		float								m_screenSize;
+		std::vector<std::vector<uint32>>	m_indices; //-- per sub-mesh.
+	};
+	typedef std::vector<Lod> Lods;
+
 	//--------------------------------------------------------------------------------------------------
 	void gatherMeshes(const aiScene& scene, Meshes& oMeshes, AABB& oAABB)
 	{
@@ -62,7 +93,7 @@ namespace brUGE
 			{
 				for (uint j = 0; j < 3; ++j)
 				{
-					oMesh.m_indices[i * 3 + j] = static_cast<uint16>(iMesh.mFaces[i].mIndices[j]);
+					oMesh.m_indices[i * 3 + j] = iMesh.mFaces[i].mIndices[j];
 				}
 			}
 
@@ -91,15 +122,114 @@ namespace brUGE
 		}
 	}
 
+	//-- reorder triangles of the every sub-mesh for the post-transform vertex cache and overdraw and
+	//-- then vertices in order of their use by the index buffer to improve pre-transform cache.
+	//----------------------------------------------------------------------------------------------
+	void optimizeMeshes(Meshes& meshes)
+	{
+		std::vector<vec3f>	positions;
+		std::vector<uint32> remap;
+
+		for (auto& mesh : meshes)
+		{
+			uint numVertices = mesh.m_common.size();
+			auto before		 = analyzeVertexCache(mesh.m_indices, numVertices);
+
+			positions.resize(numVertices);
+			for (uint i = 0; i < numVertices; ++i)
+			{
+				positions[i] = mesh.m_common[i].m_pos;
+			}
+
+			optimizeVertexCache(mesh.m_indices, numVertices);
+			optimizeOverdraw(mesh.m_indices, positions, g_overdrawThreshold);
+
+			uint newCount = optimizeVertexFetch(mesh.m_indices, numVertices, remap);
+			remapVertices(mesh.m_common, remap, newCount);
+			remapVertices(mesh.m_tangent, remap, newCount);
+
+			auto after = analyzeVertexCache(mesh.m_indices, newCount);
+
+			//-- Note: whole line is printed at once, because several meshes may be converted in parallel.
+			std::ostringstream line;
+			line << "Sub-mesh '" << mesh.m_name << "': ACMR " << before.m_acmr << " -> " << after.m_acmr
+				<< ", ATVR " << before.m_atvr << " -> " << after.m_atvr << ".\n";
+			std::cout << line.str();
+		}
+	}
+
+	//-- generate LOD chain. Generation stops as soon as the simplifier can't reach the target, because
+	//-- the next levels wouldn't be any better.
+	//----------------------------------------------------------------------------------------------
+	void generateLods(const Meshes& iMeshes, uint lodsCount, Lods& oLods)
+	{
+		std::vector<vec3f> positions;
+
+		for (uint l = 0; l < lodsCount && l < sizeof(g_lodSetups) / sizeof(g_lodSetups[0]); ++l)
+		{
+			Lod	 lod;
+			bool success = true;
+
+			lod.m_screenSize = g_lodSetups[l].m_screenSize;
+			lod.m_indices.resize(iMeshes.size());
+
+			for (uint m = 0; m < iMeshes.size(); ++m)
+			{
+				const Mesh& mesh = iMeshes[m];
+
+				positions.resize(mesh.m_common.size());
+				for (uint i = 0; i < mesh.m_common.size(); ++i)
+				{
+					positions[i] = mesh.m_common[i].m_pos;
+				}
+
+				uint target = static_cast<uint>(mesh.m_indices.size() / 3 * g_lodSetups[l].m_reduction);
+				success &= simplifyMesh(positions, mesh.m_indices, target, lod.m_indices[m]);
+
+				//-- simplification breaks the triangles order, so restore it.
+				optimizeVertexCache(lod.m_indices[m], mesh.m_common.size());
+			}
+
+			if (!success)
+				break;
+
+			oLods.push_back(lod);
+		}
+	}
+
+	//-- 16 bit indices are used whenever they can address the all vertices of the sub-mesh.
 	//----------------------------------------------------------------------------------------------
-	void saveMeshes(const Meshes& iMeshes, const AABB& aabb, WOData& oData)
+	uint indexSize(const Mesh& mesh)
+	{
+		return (mesh.m_common.size() > 0x10000) ? sizeof(uint32) : sizeof(uint16);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void writeIndices(const std::vector<uint32>& indices, uint indexSize, WOData& oData)
+	{
+		if (indices.empty())
+			return;
+
+		if (indexSize == sizeof(uint32))
+		{
+			oData.writeBytes(&indices[0], sizeof(uint32) * indices.size());
+		}
+		else
+		{
+			std::vector<uint16> narrowed(indices.begin(), indices.end());
+			oData.writeBytes(&narrowed[0], sizeof(uint16) * narrowed.size());
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void saveMeshes(const Meshes& iMeshes, const Lods& iLods, const AABB& aabb, WOData& oData)
 	{
 		//-- 1. write header
 		{
 			StaticMeshFormat::Header header;
 
 			header.m_format  = { "static_mesh" };
-			header.m_version = 1;
+			header.m_version = StaticMeshFormat::VERSION;
 
 			oData.write(header);
 		}
@@ -130,7 +260,8 @@ namespace brUGE
 
 					subInfo.m_numIndices		= mesh.m_indices.size();
 					subInfo.m_numVertices		= mesh.m_common.size();
-					subInfo.m_numVertexStreams = 2;
+					subInfo.m_numVertexStreams	= 2;
+					subInfo.m_indexSize			= indexSize(mesh);
 
 					oData.write(subInfo);
 				}
@@ -156,19 +287,50 @@ namespace brUGE
 				}
 
 				//-- 3.3. write indices.
-				oData.writeBytes(&mesh.m_indices[0], sizeof(uint16) * mesh.m_indices.size());
+				writeIndices(mesh.m_indices, indexSize(mesh), oData);
+			}
+		}
+
+		//-- 4. write LOD levels.
+		{
+			StaticMeshFormat::LodInfo lodInfo;
+			lodInfo.m_numLods = iLods.size();
+			oData.write(lodInfo);
+
+			for (const auto& lod : iLods)
+			{
+				StaticMeshFormat::Lod oLod;
+				oLod.m_screenSize = lod.m_screenSize;
+				oData.write(oLod);
+
+				for (uint m = 0; m < iMeshes.size(); ++m)
+				{
+					const auto& indices = lod.m_indices[m];
+
+					StaticMeshFormat::LodSubInfo lodSubInfo;
+					lodSubInfo.m_numIndices = indices.size();
+					oData.write(lodSubInfo);
+
+					writeIndices(indices, indexSize(iMeshes[m]), oData);
+				}
 			}
 		}
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void assimp2staticmesh(const aiScene& scene, WOData& oData)
+	void assimp2staticmesh(const aiScene& scene, uint lodsCount, bool optimize, WOData& oData)
 	{
 		Meshes meshes;
+		Lods lods;
 		AABB aabb;
 		gatherMeshes(scene, meshes, aabb);
+
+		if (optimize)
+			optimizeMeshes(meshes);
+
+		generateLods(meshes, lodsCount, lods);
 	
-		saveMeshes(meshes, aabb, oData);
+		saveMeshes(meshes, lods, aabb, oData);
 	}
 
 } //-- brUGE
\ No newline at end of file
@@ -1,56 +1,34 @@
 #include "prerequisites.hpp"
 #include "utils/Data.hpp"
 #include "SDL/SDL_timer.h"
-#include "assimp/Importer.hpp"
-#include "assimp/scene.h"
-#include "assimp/postprocess.h"
+#include "asset_cooker.hpp"
 #include <iostream>
-#include <fstream>
+#include <cstdlib>
 
 using namespace std;
 using namespace brUGE;
 using namespace brUGE::math;
 using namespace brUGE::utils;
 
-namespace brUGE
-{
-	//--------------------------------------------------------------------------------------------------
-	void assimp2staticmesh(const aiScene& scene, WOData& oData);
-	//void assimp2skinnedmesh(const aiScene& scene, WOData& oData);
-	//void assimp2animation(const aiScene& scene, WOData& oData);
-}
-
 //--------------------------------------------------------------------------------------------------
 void showUsage()
 {
 	cout << "Usage: \n";
 	cout << "    " << "[-i] - input file name. \n";
-	cout << "    " << "[-o] - output file name. \n";
+	cout << "    " << "[-o] - output file name, or output directory in the batch mode. \n";
 	cout << "    " << "[-t] - type of the conversion static/skinned/animation. \n";
+	cout << "    " << "[-lods] - count of the generated LOD levels besides the LOD 0 (0-3, default 3). \n";
+	cout << "    " << "[-nooptimize] - don't reorder triangles and vertices for the GPU caches. \n";
+	cout << "    " << "[-batch] - directory or manifest file to cook in the batch mode instead of [-i]. \n";
+	cout << "    " << "[-j] - count of the threads in the batch mode (default is count of the cores). \n";
 }
 
-//--------------------------------------------------------------------------------------------------
-void writeFile(const std::string& file, const WOData& data)
-{
-	ofstream oFile;
-	oFile.open(file.c_str(), ios_base::trunc | ios_base::binary | ios_base::out);
-	if (oFile.is_open())
-		oFile.write((const char*)data.ptr(0), data.length());
-	oFile.close();
-}
-
-//--------------------------------------------------------------------------------------------------
-enum EConvertingType
-{
-	CONVERTING_TYPE_STATIC,
-	CONVERTING_TYPE_SKINNED,
-	CONVERTING_TYPE_ANIMATION
-};
-
 //--------------------------------------------------------------------------------------------------
 int main(int argc, char* argv[])
 {
 	EConvertingType type = CONVERTING_TYPE_STATIC;
+	ConvertOptions options;
+	uint numThreads = 0;
 
 	//-- check initial arguments.
 	if (argc < 4)
@@ -60,7 +38,7 @@ int main(int argc, char* argv[])
 	}
 
 	//-- parse parameters.
-	std::string iFile, oFile;
+	std::string iFile, oFile, batch;
 	for (int i = 0; i < argc; ++i)
 	{
 		if (string("-i") == argv[i])
@@ -71,6 +49,22 @@ int main(int argc, char* argv[])
 		{
 			oFile = argv[++i];
 		}
+		else if (string("-lods") == argv[i])
+		{
+			options.m_lodsCount = atoi(argv[++i]);
+		}
+		else if (string("-nooptimize") == argv[i])
+		{
+			options.m_optimize = false;
+		}
+		else if (string("-batch") == argv[i])
+		{
+			batch = argv[++i];
+		}
+		else if (string("-j") == argv[i])
+		{
+			numThreads = atoi(argv[++i]);
+		}
 		else if (string("-t") == argv[i])
 		{
 			++i;
@@ -94,53 +88,41 @@ int main(int argc, char* argv[])
 		}
 	}
 
-	if (iFile.empty() || oFile.empty())
+	if ((iFile.empty() && batch.empty()) || oFile.empty())
 	{
 		showUsage();
 		return 1;
 	}
+
+	//-- batch mode.
+	if (!batch.empty())
+	{
+		AssetCooker cooker(oFile, options, numThreads);
+		return (cooker.gather(batch) && cooker.cook()) ? 0 : 1;
+	}
 	
 	//-- try to convert imported file
-	try
-	{
-		// calculate engine tick time.
-		uint64 startTime = SDL_GetPerformanceCounter();
+	uint64 startTime = SDL_GetPerformanceCounter();
 
-		Assimp::Importer importer;
-		auto const* scene = importer.ReadFile(
-			iFile, aiProcess_CalcTangentSpace | aiProcess_ConvertToLeftHanded | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality
-		);
-
-		if (!scene)
-			throw importer.GetErrorString();
-
-		WOData oData;
-		 
-		switch (type)
-		{
-		case CONVERTING_TYPE_STATIC:	{	assimp2staticmesh	(*scene, oData); break;		}
-		//case CONVERTING_TYPE_SKINNED:	{	assimp2skinnedmesh	(*scene, oData); break;		}
-		//case CONVERTING_TYPE_ANIMATION:	{	assimp2animation	(*scene, oData); break;		}
-		default:
-			return 1;
-		}
+	WOData oData;
+	std::vector<std::string> dependencies;
+	std::string error;
 
-		writeFile(oFile, oData);
-
-		uint64 endTime = SDL_GetPerformanceCounter();
-		double elapsedTime = static_cast<double>(endTime - startTime) / SDL_GetPerformanceFrequency();
-
-		cout << "Input file '" << iFile << "' has been successfully converted for " << elapsedTime << " seconds. \n";
-	}
-	catch(const char* e)
+	if (!convertAsset(iFile, type, options, oData, dependencies, error))
 	{
-		cout << "Converting failed: " << e << "\n";
+		cout << "Converting failed: " << error << "\n";
+		return 1;
 	}
-	catch(...)
+
+	if (!writeFile(oFile, oData))
 	{
-		cout << "Converting failed: Unspecified error.\n";
+		cout << "Converting failed: can't write output file '" << oFile << "'.\n";
+		return 1;
 	}
 
-	return 1;
-}
+	uint64 endTime = SDL_GetPerformanceCounter();
+	double elapsedTime = static_cast<double>(endTime - startTime) / SDL_GetPerformanceFrequency();
 
+	cout << "Input file '" << iFile << "' has been successfully converted for " << elapsedTime << " seconds. \n";
+	return 0;
+}
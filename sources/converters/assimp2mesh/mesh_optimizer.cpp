@@ -0,0 +1,363 @@
+#include "mesh_optimizer.hpp"
+#include <algorithm>
+#include <cmath>
+
+using namespace brUGE;
+using namespace brUGE::math;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- parameters of the Forsyth's scoring function.
+	const uint	g_cacheSize			= 32;
+	const float g_cacheDecayPower	= 1.5f;
+	const float g_lastTriScore		= 0.75f;
+	const float g_valenceBoostScale = 2.0f;
+	const float g_valenceBoostPower = 0.5f;
+
+	//----------------------------------------------------------------------------------------------
+	float vertexScore(int cachePos, uint remainingTris)
+	{
+		//-- vertex isn't used anymore.
+		if (remainingTris == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePos >= 0)
+		{
+			//-- vertices of the last triangle get fixed score to avoid using them straight away.
+			if (cachePos < 3)
+			{
+				score = g_lastTriScore;
+			}
+			else
+			{
+				float scaler = 1.0f / (g_cacheSize - 3);
+				score = std::pow(1.0f - (cachePos - 3) * scaler, g_cacheDecayPower);
+			}
+		}
+
+		//-- boost vertices with the few remaining triangles to get rid of them quickly.
+		score += g_valenceBoostScale * std::pow(static_cast<float>(remainingTris), -g_valenceBoostPower);
+
+		return score;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	vec3f triNormal(const vec3f& a, const vec3f& b, const vec3f& c)
+	{
+		vec3f e1 = b - a;
+		vec3f e2 = c - a;
+
+		return vec3f(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	VertexCacheStats analyzeVertexCache(const std::vector<uint32>& indices, uint numVertices, uint cacheSize)
+	{
+		VertexCacheStats stats = { 0.0f, 0.0f };
+
+		if (indices.empty())
+			return stats;
+
+		std::vector<uint> cache;
+		std::vector<bool> used(numVertices, false);
+		uint misses = 0;
+		uint usedCount = 0;
+
+		for (uint32 index : indices)
+		{
+			if (!used[index])
+			{
+				used[index] = true;
+				++usedCount;
+			}
+
+			if (std::find(cache.begin(), cache.end(), index) != cache.end())
+				continue;
+
+			++misses;
+			cache.push_back(index);
+			if (cache.size() > cacheSize)
+			{
+				cache.erase(cache.begin());
+			}
+		}
+
+		stats.m_acmr = static_cast<float>(misses) / (indices.size() / 3);
+		stats.m_atvr = static_cast<float>(misses) / usedCount;
+
+		return stats;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void optimizeVertexCache(std::vector<uint32>& indices, uint numVertices)
+	{
+		const uint numTris = indices.size() / 3;
+		if (numTris == 0)
+			return;
+
+		//-- 1. build vertex to triangles adjacency.
+		std::vector<uint> remaining(numVertices, 0);
+		for (uint32 index : indices)
+		{
+			++remaining[index];
+		}
+
+		std::vector<uint> offsets(numVertices + 1, 0);
+		for (uint v = 0; v < numVertices; ++v)
+		{
+			offsets[v + 1] = offsets[v] + remaining[v];
+		}
+
+		std::vector<uint> adjacency(indices.size());
+		{
+			std::vector<uint> fill(offsets.begin(), offsets.end() - 1);
+			for (uint i = 0; i < indices.size(); ++i)
+			{
+				adjacency[fill[indices[i]]++] = i / 3;
+			}
+		}
+
+		//-- 2. initial scores.
+		std::vector<int>   cachePos(numVertices, -1);
+		std::vector<float> vScores(numVertices);
+		for (uint v = 0; v < numVertices; ++v)
+		{
+			vScores[v] = vertexScore(-1, remaining[v]);
+		}
+
+		std::vector<float> tScores(numTris);
+		std::vector<bool>  emitted(numTris, false);
+		for (uint t = 0; t < numTris; ++t)
+		{
+			tScores[t] = vScores[indices[t * 3 + 0]] + vScores[indices[t * 3 + 1]] + vScores[indices[t * 3 + 2]];
+		}
+
+		//-- 3. greedy emit the best scored triangle from the vertices in the cache.
+		std::vector<uint32> result;
+		result.reserve(indices.size());
+
+		std::vector<uint32> cache, newCache;
+		uint cursor	 = 0;
+		int	 bestTri = -1;
+
+		for (uint n = 0; n < numTris; ++n)
+		{
+			//-- 3.1. nothing in the cache neighbourhood, so take the next not emitted triangle.
+			if (bestTri < 0)
+			{
+				while (emitted[cursor]) ++cursor;
+				bestTri = cursor;
+			}
+
+			const uint32* tri = &indices[bestTri * 3];
+			emitted[bestTri] = true;
+			result.insert(result.end(), tri, tri + 3);
+
+			//-- 3.2. remove triangle from the adjacency of its vertices.
+			for (uint k = 0; k < 3; ++k)
+			{
+				uint  v	   = tri[k];
+				uint* adj  = &adjacency[offsets[v]];
+				uint  size = remaining[v];
+
+				for (uint i = 0; i < size; ++i)
+				{
+					if (adj[i] == static_cast<uint>(bestTri))
+					{
+						adj[i] = adj[size - 1];
+						break;
+					}
+				}
+				--remaining[v];
+			}
+
+			//-- 3.3. move triangle vertices to the front of the LRU cache.
+			newCache.assign(tri, tri + 3);
+			for (uint32 v : cache)
+			{
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					newCache.push_back(v);
+			}
+			cache.swap(newCache);
+
+			//-- 3.4. update scores of the vertices in the cache and the ones just pushed out of it.
+			for (uint i = 0; i < cache.size(); ++i)
+			{
+				uint v = cache[i];
+				cachePos[v] = (i < g_cacheSize) ? i : -1;
+				vScores[v]  = vertexScore(cachePos[v], remaining[v]);
+			}
+
+			//-- 3.5. find the best triangle touching the cache.
+			bestTri = -1;
+			float bestScore = -1.0f;
+			for (uint i = 0; i < cache.size(); ++i)
+			{
+				uint v = cache[i];
+				for (uint a = 0; a < remaining[v]; ++a)
+				{
+					uint t = adjacency[offsets[v] + a];
+					tScores[t] = vScores[indices[t * 3 + 0]] + vScores[indices[t * 3 + 1]] + vScores[indices[t * 3 + 2]];
+
+					if (tScores[t] > bestScore)
+					{
+						bestScore = tScores[t];
+						bestTri	  = t;
+					}
+				}
+			}
+
+			if (cache.size() > g_cacheSize)
+			{
+				cache.resize(g_cacheSize);
+			}
+		}
+
+		indices.swap(result);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void optimizeOverdraw(std::vector<uint32>& indices, const std::vector<vec3f>& positions, float threshold)
+	{
+		const uint numTris = indices.size() / 3;
+		if (numTris == 0)
+			return;
+
+		//-- 1. split into clusters on the hard boundaries, i.e. where all the triangle vertices miss
+		//--	the cache. Reordering of such clusters doesn't hurt the cache efficiency.
+		const uint cacheSize = 16;
+		std::vector<uint> clusters;
+		{
+			std::vector<uint32> cache;
+			for (uint t = 0; t < numTris; ++t)
+			{
+				uint misses = 0;
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint32 v = indices[t * 3 + k];
+					if (std::find(cache.begin(), cache.end(), v) == cache.end())
+					{
+						++misses;
+						cache.push_back(v);
+						if (cache.size() > cacheSize)
+							cache.erase(cache.begin());
+					}
+				}
+
+				if (misses == 3)
+					clusters.push_back(t);
+			}
+
+			if (clusters.empty() || clusters[0] != 0)
+				clusters.insert(clusters.begin(), 0);
+		}
+
+		if (clusters.size() < 2)
+			return;
+
+		//-- 2. mesh centroid.
+		vec3f meshCenter(0, 0, 0);
+		float meshArea = 0.0f;
+		for (uint t = 0; t < numTris; ++t)
+		{
+			const vec3f& a = positions[indices[t * 3 + 0]];
+			const vec3f& b = positions[indices[t * 3 + 1]];
+			const vec3f& c = positions[indices[t * 3 + 2]];
+
+			float area = triNormal(a, b, c).length();
+			meshCenter += (a + b + c).scale(area / 3.0f);
+			meshArea   += area;
+		}
+		if (meshArea > 0.0f)
+			meshCenter *= 1.0f / meshArea;
+
+		//-- 3. occlusion potential of every cluster. Outer clusters looking away from the center
+		//--	occlude the others more likely.
+		struct Cluster
+		{
+			uint  m_first;
+			uint  m_count;
+			float m_sortKey;
+		};
+
+		std::vector<Cluster> sorted(clusters.size());
+		for (uint i = 0; i < clusters.size(); ++i)
+		{
+			Cluster& cluster = sorted[i];
+			cluster.m_first	 = clusters[i];
+			cluster.m_count	 = ((i + 1 < clusters.size()) ? clusters[i + 1] : numTris) - clusters[i];
+
+			vec3f center(0, 0, 0);
+			vec3f normal(0, 0, 0);
+			float area = 0.0f;
+
+			for (uint t = cluster.m_first; t < cluster.m_first + cluster.m_count; ++t)
+			{
+				const vec3f& a = positions[indices[t * 3 + 0]];
+				const vec3f& b = positions[indices[t * 3 + 1]];
+				const vec3f& c = positions[indices[t * 3 + 2]];
+
+				vec3f n = triNormal(a, b, c);
+				float s = n.length();
+
+				center += (a + b + c).scale(s / 3.0f);
+				normal += n;
+				area   += s;
+			}
+
+			if (area > 0.0f)
+				center *= 1.0f / area;
+
+			float len = normal.length();
+			cluster.m_sortKey = (len > 0.0f) ? (center - meshCenter).dot(normal) / len : 0.0f;
+		}
+
+		std::stable_sort(sorted.begin(), sorted.end(),
+			[](const Cluster& l, const Cluster& r) { return l.m_sortKey > r.m_sortKey; }
+			);
+
+		//-- 4. build new index buffer and check that cache efficiency is still acceptable.
+		std::vector<uint32> result;
+		result.reserve(indices.size());
+		for (const auto& cluster : sorted)
+		{
+			result.insert(result.end(), &indices[cluster.m_first * 3], &indices[(cluster.m_first + cluster.m_count) * 3]);
+		}
+
+		float before = analyzeVertexCache(indices, positions.size(), cacheSize).m_acmr;
+		float after	 = analyzeVertexCache(result, positions.size(), cacheSize).m_acmr;
+
+		if (after <= before * threshold)
+		{
+			indices.swap(result);
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint optimizeVertexFetch(std::vector<uint32>& indices, uint numVertices, std::vector<uint32>& oRemap)
+	{
+		oRemap.assign(numVertices, uint32(-1));
+
+		uint next = 0;
+		for (uint32& index : indices)
+		{
+			if (oRemap[index] == uint32(-1))
+			{
+				oRemap[index] = next++;
+			}
+			index = oRemap[index];
+		}
+
+		return next;
+	}
+
+} //-- brUGE
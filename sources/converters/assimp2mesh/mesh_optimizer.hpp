@@ -0,0 +1,47 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "math/math_all.hpp"
+#include <vector>
+
+namespace brUGE
+{
+
+	//-- statistics of the post-transform vertex cache simulated as FIFO.
+	//----------------------------------------------------------------------------------------------
+	struct VertexCacheStats
+	{
+		float m_acmr; //-- average cache miss ratio, i.e. transformed vertices per triangle.
+		float m_atvr; //-- average transformed to referenced vertices ratio. 1 is the ideal.
+	};
+
+	VertexCacheStats analyzeVertexCache(const std::vector<uint32>& indices, uint numVertices, uint cacheSize = 16);
+
+	//-- reorder triangles for the post-transform vertex cache. Uses Tom Forsyth's linear-speed
+	//-- vertex cache optimisation algorithm.
+	void optimizeVertexCache(std::vector<uint32>& indices, uint numVertices);
+
+	//-- reorder clusters of the cache optimized triangles, so the triangles which likely occlude the
+	//-- others are drawn first. The result is accepted only if ACMR doesn't grow more than threshold
+	//-- times, otherwise indices stay untouched.
+	void optimizeOverdraw(std::vector<uint32>& indices, const std::vector<vec3f>& positions, float threshold);
+
+	//-- reorder vertices in order of their first use in the index buffer. Unused vertices are dropped.
+	//-- Returns new vertices count, oRemap[oldVertex] is the new index or -1 for the dropped one.
+	uint optimizeVertexFetch(std::vector<uint32>& indices, uint numVertices, std::vector<uint32>& oRemap);
+
+	//-- apply vertex remap table to the vertex stream.
+	//----------------------------------------------------------------------------------------------
+	template<typename Vertex>
+	void remapVertices(std::vector<Vertex>& vertices, const std::vector<uint32>& remap, uint newCount)
+	{
+		std::vector<Vertex> result(newCount);
+		for (uint i = 0; i < vertices.size(); ++i)
+		{
+			if (remap[i] != uint32(-1))
+				result[remap[i]] = vertices[i];
+		}
+		vertices.swap(result);
+	}
+
+} //-- brUGE
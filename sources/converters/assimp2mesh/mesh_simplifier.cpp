@@ -0,0 +1,406 @@
+#include "mesh_simplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include <tuple>
+
+using namespace brUGE;
+using namespace brUGE::math;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- symmetric 4x4 matrix of the quadric error metric.
+	//----------------------------------------------------------------------------------------------
+	struct Quadric
+	{
+		Quadric() { for (auto& v : m_data) v = 0.0; }
+
+		//------------------------------------------------------------------------------------------
+		void addPlane(double a, double b, double c, double d, double weight)
+		{
+			m_data[0] += weight * a * a; m_data[1] += weight * a * b; m_data[2] += weight * a * c; m_data[3] += weight * a * d;
+			m_data[4] += weight * b * b; m_data[5] += weight * b * c; m_data[6] += weight * b * d;
+			m_data[7] += weight * c * c; m_data[8] += weight * c * d;
+			m_data[9] += weight * d * d;
+		}
+
+		//------------------------------------------------------------------------------------------
+		void add(const Quadric& q)
+		{
+			for (uint i = 0; i < 10; ++i)
+				m_data[i] += q.m_data[i];
+		}
+
+		//------------------------------------------------------------------------------------------
+		double error(const vec3f& p) const
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			const double* q = m_data;
+
+			return	  q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+					+ q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+					+ q[7] * z * z + 2 * q[8] * z
+					+ q[9];
+		}
+
+		double m_data[10];
+	};
+
+	//-- candidate collapse of the vertex m_from onto the vertex m_to.
+	//----------------------------------------------------------------------------------------------
+	struct Collapse
+	{
+		double	m_error;
+		uint	m_from;
+		uint	m_to;
+		uint	m_fromVersion;
+		uint	m_toVersion;
+
+		bool operator < (const Collapse& rt) const { return m_error > rt.m_error; }
+	};
+
+	//----------------------------------------------------------------------------------------------
+	vec3f triNormal(const vec3f& a, const vec3f& b, const vec3f& c)
+	{
+		vec3f e1 = b - a;
+		vec3f e2 = c - a;
+
+		return vec3f(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	float dot3(const vec3f& a, const vec3f& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	//-- working state of the simplifier. Topology is built over the welded vertices, i.e. all the
+	//-- vertices with the same position are represented by the one welded vertex.
+	//----------------------------------------------------------------------------------------------
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<vec3f>& positions, const std::vector<uint32>& indices)
+			: m_positions(positions), m_liveTriangles(0)
+		{
+			weld(indices);
+			buildQuadrics();
+			lockBorders();
+		}
+
+		//------------------------------------------------------------------------------------------
+		uint run(uint targetTriangles)
+		{
+			for (uint v = 0; v < m_welded.size(); ++v)
+				pushCollapses(v);
+
+			while (m_liveTriangles > targetTriangles && !m_queue.empty())
+			{
+				Collapse c = m_queue.top();
+				m_queue.pop();
+
+				//-- skip outdated candidates.
+				if (!m_alive[c.m_from] || !m_alive[c.m_to] || c.m_fromVersion != m_versions[c.m_from] || c.m_toVersion != m_versions[c.m_to])
+					continue;
+
+				if (isFlipped(c.m_from, c.m_to))
+					continue;
+
+				collapse(c.m_from, c.m_to);
+			}
+
+			return m_liveTriangles;
+		}
+
+		//------------------------------------------------------------------------------------------
+		void output(std::vector<uint32>& oIndices) const
+		{
+			oIndices.clear();
+			oIndices.reserve(m_liveTriangles * 3);
+
+			for (uint t = 0; t < m_triangles.size(); ++t)
+			{
+				if (!m_triAlive[t])
+					continue;
+
+				for (uint k = 0; k < 3; ++k)
+					oIndices.push_back(m_corners[t * 3 + k]);
+			}
+		}
+
+	private:
+
+		//------------------------------------------------------------------------------------------
+		void weld(const std::vector<uint32>& indices)
+		{
+			std::map<std::tuple<float, float, float>, uint> unique;
+			std::vector<uint> remap(m_positions.size());
+
+			for (uint i = 0; i < m_positions.size(); ++i)
+			{
+				const vec3f& p = m_positions[i];
+				auto result = unique.insert(std::make_pair(std::make_tuple(p.x, p.y, p.z), m_welded.size()));
+
+				if (result.second)
+				{
+					m_welded.push_back(p);
+					m_original.push_back(i);
+					m_locked.push_back(false);
+					m_seam.push_back(false);
+				}
+				else
+				{
+					//-- attribute seam.
+					m_locked[result.first->second] = true;
+					m_seam[result.first->second]   = true;
+				}
+
+				remap[i] = result.first->second;
+			}
+
+			m_alive.resize(m_welded.size(), true);
+			m_versions.resize(m_welded.size(), 0);
+			m_vertexTris.resize(m_welded.size());
+
+			for (uint i = 0; i + 2 < indices.size(); i += 3)
+			{
+				uint a = remap[indices[i + 0]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+
+				//-- degenerate triangles are dropped.
+				if (a == b || b == c || a == c)
+					continue;
+
+				uint t = m_triangles.size();
+				m_triangles.push_back(vec3ui(a, b, c));
+				m_triAlive.push_back(true);
+				m_corners.push_back(indices[i + 0]);
+				m_corners.push_back(indices[i + 1]);
+				m_corners.push_back(indices[i + 2]);
+
+				m_vertexTris[a].push_back(t);
+				m_vertexTris[b].push_back(t);
+				m_vertexTris[c].push_back(t);
+				++m_liveTriangles;
+			}
+		}
+
+		//------------------------------------------------------------------------------------------
+		void buildQuadrics()
+		{
+			m_quadrics.resize(m_welded.size());
+
+			for (const auto& tri : m_triangles)
+			{
+				const vec3f& a = m_welded[tri.x];
+				vec3f n = triNormal(a, m_welded[tri.y], m_welded[tri.z]);
+
+				double len = std::sqrt(dot3(n, n));
+				if (len <= 0.0)
+					continue;
+
+				//-- area weighted plane.
+				double nx = n.x / len, ny = n.y / len, nz = n.z / len;
+				double d  = -(nx * a.x + ny * a.y + nz * a.z);
+
+				Quadric q;
+				q.addPlane(nx, ny, nz, d, len * 0.5);
+
+				m_quadrics[tri.x].add(q);
+				m_quadrics[tri.y].add(q);
+				m_quadrics[tri.z].add(q);
+			}
+		}
+
+		//-- edge used by only one triangle is the border edge.
+		//------------------------------------------------------------------------------------------
+		void lockBorders()
+		{
+			std::map<std::pair<uint, uint>, uint> edges;
+
+			for (const auto& tri : m_triangles)
+			{
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint a = tri[k], b = tri[(k + 1) % 3];
+					++edges[std::make_pair(std::min(a, b), std::max(a, b))];
+				}
+			}
+
+			for (const auto& edge : edges)
+			{
+				if (edge.second == 1)
+				{
+					m_locked[edge.first.first]  = true;
+					m_locked[edge.first.second] = true;
+				}
+			}
+		}
+
+		//------------------------------------------------------------------------------------------
+		void neighbours(uint v, std::vector<uint>& oNeighbours) const
+		{
+			oNeighbours.clear();
+
+			for (uint t : m_vertexTris[v])
+			{
+				if (!m_triAlive[t])
+					continue;
+
+				for (uint k = 0; k < 3; ++k)
+				{
+					uint n = m_triangles[t][k];
+					if (n != v && std::find(oNeighbours.begin(), oNeighbours.end(), n) == oNeighbours.end())
+						oNeighbours.push_back(n);
+				}
+			}
+		}
+
+		//-- only the free vertex may be moved and only onto the vertex without attribute seam,
+		//-- because the moved corners have to refer to the one well defined original vertex.
+		//------------------------------------------------------------------------------------------
+		void pushCollapse(uint from, uint to)
+		{
+			if (m_locked[from] || m_seam[to])
+				return;
+
+			Quadric q = m_quadrics[from];
+			q.add(m_quadrics[to]);
+
+			Collapse c = { q.error(m_welded[to]), from, to, m_versions[from], m_versions[to] };
+			m_queue.push(c);
+		}
+
+		//------------------------------------------------------------------------------------------
+		void pushCollapses(uint v)
+		{
+			neighbours(v, m_scratch);
+
+			for (uint n : m_scratch)
+			{
+				pushCollapse(v, n);
+				pushCollapse(n, v);
+			}
+		}
+
+		//-- the collapse mustn't turn over any of the remaining triangles.
+		//------------------------------------------------------------------------------------------
+		bool isFlipped(uint from, uint to) const
+		{
+			for (uint t : m_vertexTris[from])
+			{
+				if (!m_triAlive[t])
+					continue;
+
+				const vec3ui& tri = m_triangles[t];
+				if (tri.x == to || tri.y == to || tri.z == to)
+					continue;
+
+				vec3f p[3], q[3];
+				for (uint k = 0; k < 3; ++k)
+				{
+					p[k] = m_welded[tri[k]];
+					q[k] = (tri[k] == from) ? m_welded[to] : p[k];
+				}
+
+				vec3f n0 = triNormal(p[0], p[1], p[2]);
+				vec3f n1 = triNormal(q[0], q[1], q[2]);
+
+				float d = dot3(n0, n1);
+				if (d <= 0.0f || d * d < 0.04f * dot3(n0, n0) * dot3(n1, n1))
+					return true;
+			}
+
+			return false;
+		}
+
+		//------------------------------------------------------------------------------------------
+		void collapse(uint from, uint to)
+		{
+			for (uint t : m_vertexTris[from])
+			{
+				if (!m_triAlive[t])
+					continue;
+
+				vec3ui& tri = m_triangles[t];
+				if (tri.x == to || tri.y == to || tri.z == to)
+				{
+					m_triAlive[t] = false;
+					--m_liveTriangles;
+					continue;
+				}
+
+				for (uint k = 0; k < 3; ++k)
+				{
+					if (tri[k] == from)
+					{
+						tri[k]				 = to;
+						m_corners[t * 3 + k] = m_original[to];
+					}
+				}
+				m_vertexTris[to].push_back(t);
+			}
+
+			m_alive[from] = false;
+			m_vertexTris[from].clear();
+			m_quadrics[to].add(m_quadrics[from]);
+
+			//-- every candidate touching the neighbourhood of the target vertex is outdated now.
+			std::vector<uint> ring;
+			neighbours(to, ring);
+			ring.push_back(to);
+
+			for (uint v : ring)
+				++m_versions[v];
+
+			for (uint v : ring)
+				pushCollapses(v);
+		}
+
+	private:
+		const std::vector<vec3f>&		m_positions;
+
+		//-- welded vertices.
+		std::vector<vec3f>				m_welded;
+		std::vector<uint>				m_original;
+		std::vector<bool>				m_locked; //-- border or seam vertex.
+		std::vector<bool>				m_seam;
+		std::vector<bool>				m_alive;
+		std::vector<uint>				m_versions;
+		std::vector<Quadric>			m_quadrics;
+		std::vector<std::vector<uint>>	m_vertexTris;
+
+		//-- triangles over the welded vertices and their corners in terms of the original vertices.
+		std::vector<vec3ui>				m_triangles;
+		std::vector<bool>				m_triAlive;
+		std::vector<uint32>				m_corners;
+		uint							m_liveTriangles;
+
+		std::priority_queue<Collapse>	m_queue;
+		std::vector<uint>				m_scratch;
+	};
+
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	bool simplifyMesh(
+		const std::vector<vec3f>& positions, const std::vector<uint32>& indices, uint targetTriangles,
+		std::vector<uint32>& oIndices)
+	{
+		Simplifier simplifier(positions, indices);
+
+		uint trianglesCount = simplifier.run(targetTriangles);
+		simplifier.output(oIndices);
+
+		//-- the most part of the mesh is locked, so the LOD isn't worth of storing.
+		return trianglesCount <= targetTriangles + targetTriangles / 2;
+	}
+
+} //-- brUGE
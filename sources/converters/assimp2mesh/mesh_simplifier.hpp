@@ -0,0 +1,21 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "math/math_all.hpp"
+#include <vector>
+
+namespace brUGE
+{
+
+	//-- Reduces the triangles count of the indexed triangle list with the quadric error metric.
+	//-- Every edge collapse moves one vertex onto its neighbour, so the result refers to the same
+	//-- vertices as the input and may share vertex buffers with it. Vertices on the mesh borders and
+	//-- on the attribute seams (several vertices with the same position) are never moved.
+	//-- Returns false if the target can't be reached even approximately.
+	//----------------------------------------------------------------------------------------------
+	bool simplifyMesh(
+		const std::vector<vec3f>& positions, const std::vector<uint32>& indices, uint targetTriangles,
+		std::vector<uint32>& oIndices
+		);
+
+} //-- brUGE
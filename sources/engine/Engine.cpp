@@ -1,11 +1,14 @@
 #include "Engine.h"
 #include "IDemo.h"
+#include "job_system.hpp"
+#include "frame_memory.hpp"
 #include "Exception.h"
 #include "render/IRenderDevice.h"
 #include "gui/ui_system.hpp"
 
 #include "render/render_system.hpp"
 #include "render/render_world.hpp"
+#include "render/render_thread.hpp"
 #include "render/animation_engine.hpp"
 #include "scene/game_world.hpp"
 #include "physics/physic_world.hpp"
@@ -40,7 +43,10 @@ namespace brUGE
 		m_gameWorld(new GameWorld()),
 		m_animEngine(new AnimationEngine()),
 		m_renderWorld(new RenderWorld()),
+		m_renderThread(new RenderThread()),
 		m_resManager(new ResourcesManager()),
+		m_jobSystem(new JobSystem()),
+		m_frameMemory(new FrameMemory()),
 		m_physicWorld(new PhysicsWorld()),
 		m_uiSystem(new ui::System())
 	{
@@ -56,8 +62,10 @@ namespace brUGE
 	}
 
 	//--------------------------------------------------------------------------------------------------
-	void Engine::init(HINSTANCE, IDemo* demo)
+	void Engine::init(HINSTANCE, IDemo* demo, const char* cmdLine)
 	{
+		m_console.parseCommandLine(cmdLine);
+
 		SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS | SDL_INIT_TIMER);
 
 		//-- ToDo: load this values from config
@@ -96,6 +104,12 @@ namespace brUGE
 		}
 		INFO_MSG("Init render system ... completed.");
 
+		if (!m_renderThread->init())
+		{
+			BR_EXCEPT("Can't init render thread.");
+		}
+		INFO_MSG("Init render thread ... completed.");
+
 		if (!m_uiSystem->init(m_videoMode))
 		{
 			BR_EXCEPT("Can't init ui system.");
@@ -116,6 +130,18 @@ namespace brUGE
 		}
 		INFO_MSG("Init watchers panel ... completed.");
 
+		if (!m_jobSystem->init())
+		{
+			BR_EXCEPT("Can't init job system.");
+		}
+		INFO_MSG("Init job system ... completed.");
+
+		if (!m_frameMemory->init())
+		{
+			BR_EXCEPT("Can't init frame memory.");
+		}
+		INFO_MSG("Init frame memory ... completed.");
+
 		if (!m_physicWorld->init())
 		{
 			BR_EXCEPT("Can't init physic world.");
@@ -144,12 +170,21 @@ namespace brUGE
 		}
 		INFO_MSG("Init demo ... completed.");
 
+		//-- commands given in the command line, e.g. benchmarks.
+		m_console.executePending();
+
 		INFO_MSG("Starting Message Loop...");
 	}
 
 	//--------------------------------------------------------------------------------------------------
 	void Engine::shutdown()
 	{
+		//-- stop the render thread first, because it may still draw the last frame.
+		if (m_renderThread.get())
+		{
+			m_renderThread->shutdown();
+		}
+
 		//-- release demo first, because it may contain render resources.
 		if (m_demo.get())
 		{
@@ -164,6 +199,10 @@ namespace brUGE
 		m_animEngine.reset();
 		m_renderWorld.reset();
 		m_physicWorld.reset();
+		m_jobSystem.reset();
+
+		//-- render data may still refer to the frame arenas, so they go last.
+		m_frameMemory.reset();
 		m_resManager.reset();
 
 		m_renderSys.shutDown();
@@ -230,18 +269,26 @@ namespace brUGE
 
 			m_timingPanel->start();
 			{
-				//-- do tick.
+				//-- do tick. The render thread draws the previous frame meanwhile.
 				{
 					SCOPED_TIME_MEASURER_EX("update")
 
-					//-- update timing panel.
-					m_timingPanel->update(dt);
-
 					//-- update demo module first
 					m_demo->update(dt);
 
 					m_gameWorld->beginUpdate(dt);
 
+					//-- kick physics. It runs on the worker threads up to post-animation.
+					{
+						SCOPED_TIME_MEASURER_EX("physic kick")
+
+						if (auto* camera = m_renderWorld->camera())
+						{
+							m_physicWorld->setObserver(camera->renderCam().m_invView.applyToOrigin());
+						}
+						m_physicWorld->beginSimulate(dt);
+					}
+
 					//-- do pre-animation.
 					{
 						SCOPED_TIME_MEASURER_EX("pre-animation")
@@ -253,10 +300,10 @@ namespace brUGE
 						m_animEngine->animate();
 					}
 
-					//-- simulate physics.
+					//-- wait for physics results.
 					{
-						SCOPED_TIME_MEASURER_EX("physic")
-						m_physicWorld->simulate(dt);
+						SCOPED_TIME_MEASURER_EX("physic fetch")
+						m_physicWorld->endSimulate();
 					}
 
 					{
@@ -264,22 +311,37 @@ namespace brUGE
 						m_animEngine->postAnimate();
 					}
 
-					m_renderWorld->update(dt);
 					m_watchersPanel->update(dt);
 					m_gameWorld->endUpdate();
 				}
 
-				//-- do draw.
+				//-- sync point. Wait for the previous frame and take the render snapshot of this one.
+				//-- Everything what touches the render device or imgui is done here.
+				{
+					SCOPED_TIME_MEASURER_EX("render sync")
+
+					m_renderThread->sync();
+					m_frameMemory->nextFrame();
+					m_demo->render(dt);
+					m_renderWorld->update(dt);
+
+					m_timingPanel->update(dt);
+					m_timingPanel->visualize();
+					m_watchersPanel->visualize();
+					displayStatistics(dt);
+					m_uiSystem->prepare();
+				}
+
+				//-- kick drawing of the snapshot on the render thread.
+				m_renderThread->kick([this]()
 				{
 					SCOPED_TIME_MEASURER_EX("draw")
 
 					m_renderSys.beginFrame();
 					m_renderWorld->draw();
-					m_demo->render(dt);
-					displayStatistics(dt);
 					m_uiSystem->draw();
 					m_renderSys.endFrame();
-				}
+				});
 			}
 			m_timingPanel->stop();
 		}
@@ -2,6 +2,7 @@
 
 #include "prerequisites.hpp"
 #include "utils/Singleton.h"
+#include "console/Console.h"
 #include "console/WatchersPanel.h"
 #include "console/TimingPanel.h"
 #include "loader/ResourcesManager.h"
@@ -13,6 +14,8 @@ namespace brUGE
 {
 	class IDemo;
 	class GameWorld;
+	class JobSystem;
+	class FrameMemory;
 
 	namespace ui
 	{
@@ -23,6 +26,7 @@ namespace brUGE
 	{
 		class AnimationEngine;
 		class RenderWorld;
+		class RenderThread;
 	}
 
 	namespace physics
@@ -38,7 +42,8 @@ namespace brUGE
 		Engine();
 		~Engine();
 		
-		void						init(HINSTANCE hInstance, IDemo* demo);
+		//-- cmdLine is the sequence of the console lines, see Console.
+		void						init(HINSTANCE hInstance, IDemo* demo, const char* cmdLine = nullptr);
 		void						shutdown();
 		
 		//-- entry point of engine.
@@ -49,8 +54,11 @@ namespace brUGE
 		void						setVideoMode(const render::VideoMode& mode) { m_videoMode = mode; }
 
 		GameWorld&					gameWorld()			{ return *m_gameWorld.get();	}
+		JobSystem&					jobSystem()			{ return *m_jobSystem.get();	}
+		FrameMemory&				frameMemory()		{ return *m_frameMemory.get();	}
 		render::RenderWorld&		renderWorld()		{ return *m_renderWorld.get();	}
 		render::RenderSystem&		renderSystem()		{ return m_renderSys;			}
+		render::RenderThread&		renderThread()		{ return *m_renderThread.get();	}
 		physics::PhysicsWorld&		physicsWorld()		{ return *m_physicWorld.get();	}
 		render::AnimationEngine&	animationEngine()	{ return *m_animEngine.get();	}
 
@@ -69,6 +77,7 @@ namespace brUGE
 	private:
 		os::FileSystem		 						m_fileSystem;
 		utils::LogManager	 						m_logManager; 
+		Console										m_console; //-- has to exist before any other subsystem.
 
 		std::string			 						m_title;
 		HWND				 						m_hWnd;
@@ -79,8 +88,11 @@ namespace brUGE
 		std::unique_ptr<ui::System>					m_uiSystem;
 		render::VideoMode	 						m_videoMode;
 		render::RenderSystem 						m_renderSys;
+		std::unique_ptr<render::RenderThread>		m_renderThread;
 	
 		std::unique_ptr<ResourcesManager>			m_resManager;
+		std::unique_ptr<JobSystem>					m_jobSystem;
+		std::unique_ptr<FrameMemory>				m_frameMemory;
 		std::unique_ptr<GameWorld>					m_gameWorld;
 		std::unique_ptr<render::RenderWorld>		m_renderWorld;
 		std::unique_ptr<physics::PhysicsWorld>		m_physicWorld;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "console/Console.h"
 #include "SDL/SDL_events.h"
 #include <string>
 
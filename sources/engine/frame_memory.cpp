@@ -0,0 +1,121 @@
+#include "frame_memory.hpp"
+#include "console/WatchersPanel.h"
+#include "console/Console.h"
+#include <cstdlib>
+#include <new>
+
+using namespace brUGE;
+using namespace brUGE::utils;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- console variables. Take effect after restart.
+	uint g_frameArenaSize	= 8; //-- in MB, the size of every of the two frame arenas.
+	uint g_scratchArenaSize	= 1; //-- in MB, per-thread.
+
+	//-- watchers.
+	float g_frameArenaUsed		= 0.0f; //-- in KB.
+	uint  g_frameArenaOverflows	= 0;
+	uint  g_mainHeapAllocs		= 0; //-- general heap allocations of the main thread per frame.
+
+	thread_local std::unique_ptr<LinearAllocator>	g_scratchArena;
+	thread_local uint64								g_threadHeapAllocs = 0; //-- always 0 if not counted.
+	uint64											g_lastMainHeapAllocs = 0;
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+#if defined(_DEBUG) || USE_FORCE_HEAP_ALLOCS_COUNTING
+
+//-- Replacement of the global allocation functions. The only difference is the counting of the
+//-- general heap allocations, which proves that the steady-state frame doesn't use the heap.
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+	++g_threadHeapAllocs;
+
+	if (void* ptr = malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+
+#endif
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	FrameMemory::FrameMemory() : m_frame(0)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	FrameMemory::~FrameMemory()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool FrameMemory::init()
+	{
+		REGISTER_CONSOLE_VALUE("frame_arena_size_mb", uint, g_frameArenaSize);
+		REGISTER_CONSOLE_VALUE("scratch_arena_size_mb", uint, g_scratchArenaSize);
+		REGISTER_RO_WATCHER("frame arena used KB", float, g_frameArenaUsed);
+		REGISTER_RO_WATCHER("frame arena overflows", uint, g_frameArenaOverflows);
+#if defined(_DEBUG) || USE_FORCE_HEAP_ALLOCS_COUNTING
+		REGISTER_RO_WATCHER("main heap allocs", uint, g_mainHeapAllocs);
+#endif
+
+		for (auto& arena : m_arenas)
+		{
+			arena.init(g_frameArenaSize * 1024 * 1024);
+		}
+
+		g_lastMainHeapAllocs = g_threadHeapAllocs;
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void FrameMemory::nextFrame()
+	{
+		const LinearAllocator& last = frameArena();
+
+		g_frameArenaUsed	  = last.used() / 1024.0f;
+		g_frameArenaOverflows = m_arenas[0].overflows() + m_arenas[1].overflows();
+		g_mainHeapAllocs	  = g_threadHeapAllocs - g_lastMainHeapAllocs;
+		g_lastMainHeapAllocs  = g_threadHeapAllocs;
+
+		//-- the data of the last frame stays alive until the next sync point, the arena being
+		//-- reset now was used by the frame before and nobody refers to it anymore.
+		++m_frame;
+		frameArena().reset();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	LinearAllocator& FrameMemory::scratchArena()
+	{
+		if (!g_scratchArena)
+		{
+			g_scratchArena.reset(new LinearAllocator());
+			g_scratchArena->init(g_scratchArenaSize * 1024 * 1024);
+		}
+		return *g_scratchArena;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint64 FrameMemory::threadHeapAllocs()
+	{
+		return g_threadHeapAllocs;
+	}
+
+} //-- brUGE
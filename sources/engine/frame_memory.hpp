@@ -0,0 +1,67 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "utils/linear_allocator.hpp"
+
+//-- compile-time configurations flags.
+//-- Counting of the general heap allocations replaces the global operator new, so by default it's
+//-- compiled only into the debug build.
+#define USE_FORCE_HEAP_ALLOCS_COUNTING 0
+
+namespace brUGE
+{
+
+	//-- Memory for the transient per-frame data.
+	//-- Frame arena is double-buffered. Everything allocated during the frame, either by the main
+	//-- thread during the update or by the render thread during the submission, stays alive until
+	//-- the render thread has finished this frame. Arena is reset in nextFrame() at the sync point,
+	//-- when nobody refers to its data anymore, so there is no need to free anything.
+	//-- Scratch arenas are per-thread and intended for the temporary data of the single function.
+	//-- They are released by ScratchScope.
+	//----------------------------------------------------------------------------------------------
+	class FrameMemory : public NonCopyable
+	{
+	public:
+		FrameMemory();
+		~FrameMemory();
+
+		bool init();
+
+		//-- must be called by the main thread at the sync point, i.e. when the render thread has
+		//-- finished the previous frame.
+		void nextFrame();
+
+		utils::LinearAllocator& frameArena() { return m_arenas[m_frame & 1]; }
+
+		template<typename T>
+		utils::ArenaAllocator<T> frameAllocator() { return utils::ArenaAllocator<T>(frameArena()); }
+
+		//-- arena of the calling thread. It's created on the first usage.
+		static utils::LinearAllocator& scratchArena();
+
+		template<typename T>
+		static utils::ArenaAllocator<T> scratchAllocator() { return utils::ArenaAllocator<T>(scratchArena()); }
+
+		//-- count of the general heap allocations made by the calling thread so far. Always 0 if
+		//-- the counting isn't compiled in.
+		static uint64 threadHeapAllocs();
+
+	private:
+		utils::LinearAllocator	m_arenas[2];
+		uint					m_frame;
+	};
+
+
+	//-- Releases everything allocated from the scratch arena of the calling thread in its scope.
+	//----------------------------------------------------------------------------------------------
+	class ScratchScope : public NonCopyable
+	{
+	public:
+		ScratchScope() : m_marker(FrameMemory::scratchArena().marker()) { }
+		~ScratchScope() { FrameMemory::scratchArena().rewind(m_marker); }
+
+	private:
+		size_t m_marker;
+	};
+
+} //-- brUGE
@@ -0,0 +1,411 @@
+#include "job_system.hpp"
+#include "math/math_all.hpp"
+#include "utils/LogManager.h"
+#include "SDL/SDL_timer.h"
+#include "console/Console.h"
+#include <cmath>
+
+using namespace brUGE::math;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- count of the worker threads. One hardware thread is left for the main thread and one more
+	//-- for the render thread. Read once in init(), so it's set in the command line, e.g.
+	//-- "+jobs_threads 4".
+	uint g_jobThreads = max<uint>(2, std::thread::hardware_concurrency()) - 2;
+
+	//-- ranges per thread in parallelFor. Few of them give stealing a chance to balance uneven work.
+	const uint g_rangesPerThread = 4;
+
+	//-- index of the calling thread in its job system.
+	thread_local uint g_threadIndex = brUGE::JobSystem::INVALID_THREAD;
+
+	//----------------------------------------------------------------------------------------------
+	inline float elapsedMs(uint64 startTime)
+	{
+		return ((SDL_GetPerformanceCounter() - startTime) * 1000.0f) / SDL_GetPerformanceFrequency();
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::JobSystem() : m_queuedJobs(0), m_quit(false)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	JobSystem::~JobSystem()
+	{
+		shutdown();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool JobSystem::init()
+	{
+		REGISTER_CONSOLE_VALUE("jobs_threads", uint, g_jobThreads);
+		REGISTER_CONSOLE_METHOD("jobs_overhead_benchmark", _overheadBenchmark, JobSystem);
+		REGISTER_CONSOLE_METHOD("jobs_scaling_benchmark", _scalingBenchmark, JobSystem);
+
+		start(g_jobThreads);
+
+		INFO_MSG("Job system: %d worker threads.", m_workers.size());
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::start(uint workersCount)
+	{
+		g_threadIndex = 0;
+
+		for (uint i = 0; i < workersCount + 1; ++i)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+
+		for (uint i = 1; i < workersCount + 1; ++i)
+		{
+			m_workers.push_back(std::thread([this, i]() { workerLoop(i); }));
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::shutdown()
+	{
+		m_quit = true;
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_sleepCondition.notify_all();
+
+		for (auto& worker : m_workers)
+		{
+			worker.join();
+		}
+
+		assert(m_queuedJobs == 0 && "Not all jobs have been executed.");
+
+		m_workers.clear();
+		m_queues.clear();
+		m_quit = false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint JobSystem::threadIndex()
+	{
+		return g_threadIndex;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::run(const Function& func, JobCounter* counter, JobCounter* dependency)
+	{
+		if (counter)
+		{
+			++counter->m_count;
+		}
+
+		Job job = { func, counter };
+
+		//-- postpone the job until the dependency is done. The lock guarantees that the dependency
+		//-- can't be finished between the check and the insertion.
+		if (dependency)
+		{
+			std::lock_guard<std::mutex> lock(dependency->m_mutex);
+			if (!dependency->done())
+			{
+				dependency->m_dependants.push_back(std::move(job));
+				return;
+			}
+		}
+
+		push(std::move(job));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::wait(JobCounter& counter)
+	{
+		const uint thread = (g_threadIndex < m_queues.size()) ? g_threadIndex : INVALID_THREAD;
+
+		Job job;
+		while (!counter.done())
+		{
+			if (thread != INVALID_THREAD && pop(thread, job))
+			{
+				execute(job);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		//-- the last job releases the lock right after the counter reached zero.
+		std::lock_guard<std::mutex> lock(counter.m_mutex);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::parallelFor(uint count, uint grainSize, const RangeFunction& func)
+	{
+		if (count == 0)
+			return;
+
+		const uint maxRanges = max<uint>(1, threadsCount() * g_rangesPerThread);
+		const uint ranges	 = clamp<uint>(1, count / max<uint>(grainSize, 1), maxRanges);
+
+		//-- nothing to split or nobody to help.
+		if (ranges == 1 || m_workers.empty())
+		{
+			func(0, count);
+			return;
+		}
+
+		const uint size = (count + ranges - 1) / ranges;
+
+		//-- the first range is executed by the calling thread.
+		JobCounter counter;
+		for (uint first = size; first < count; first += size)
+		{
+			const uint last = min(count, first + size);
+			run([&func, first, last]() { func(first, last); }, &counter);
+		}
+
+		func(0, size);
+		wait(counter);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::push(Job&& job)
+	{
+		const uint thread = (g_threadIndex < m_queues.size()) ? g_threadIndex : 0;
+		{
+			Queue& queue = *m_queues[thread];
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			queue.m_jobs.push_back(std::move(job));
+		}
+		++m_queuedJobs;
+
+		//-- the sleeping mutex prevents losing the notification between the check of the predicate
+		//-- and the sleeping in the worker.
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_sleepCondition.notify_one();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool JobSystem::pop(uint thread, Job& job)
+	{
+		if (m_queuedJobs == 0)
+			return false;
+
+		const uint count = m_queues.size();
+		for (uint i = 0; i < count; ++i)
+		{
+			const uint victim = (thread + i) % count;
+			Queue&	   queue  = *m_queues[victim];
+
+			std::lock_guard<std::mutex> lock(queue.m_mutex);
+			if (queue.m_head == queue.m_jobs.size())
+				continue;
+
+			//-- own jobs are taken from the back, the stolen ones from the front.
+			if (victim == thread)
+			{
+				job = std::move(queue.m_jobs.back());
+				queue.m_jobs.pop_back();
+			}
+			else
+			{
+				job = std::move(queue.m_jobs[queue.m_head++]);
+			}
+
+			//-- the queue is drained, so start over from the beginning of the same memory.
+			if (queue.m_head == queue.m_jobs.size())
+			{
+				queue.m_jobs.clear();
+				queue.m_head = 0;
+			}
+
+			--m_queuedJobs;
+			return true;
+		}
+
+		return false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::execute(Job& job)
+	{
+		job.m_func();
+		job.m_func = nullptr;
+
+		finish(job.m_counter);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::finish(JobCounter* counter)
+	{
+		if (!counter)
+			return;
+
+		std::vector<Job> dependants;
+		{
+			std::lock_guard<std::mutex> lock(counter->m_mutex);
+			if (--counter->m_count != 0)
+				return;
+
+			dependants.swap(counter->m_dependants);
+		}
+
+		for (auto& job : dependants)
+		{
+			push(std::move(job));
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void JobSystem::workerLoop(uint thread)
+	{
+		g_threadIndex = thread;
+
+		Job job;
+		while (!m_quit)
+		{
+			if (pop(thread, job))
+			{
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_sleepCondition.wait(lock, [this]() { return m_queuedJobs > 0 || m_quit; });
+		}
+	}
+
+	//-- Measures scheduling overhead of the job system: spawning of the empty jobs, the chain of
+	//-- the dependent jobs and parallelFor over the trivial body with the smallest ranges.
+	//-- Usage: +jobs_overhead_benchmark 100000 in the command line.
+	//----------------------------------------------------------------------------------------------
+	int JobSystem::_overheadBenchmark(int jobsCount)
+	{
+		const uint count = clamp(1, jobsCount, 1000000);
+
+		//-- 1. independent empty jobs.
+		{
+			std::atomic<uint> executed(0);
+			JobCounter counter;
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < count; ++i)
+			{
+				run([&executed]() { ++executed; }, &counter);
+			}
+			wait(counter);
+			float time = elapsedMs(startTime);
+
+			INFO_MSG("Jobs overhead: %d empty jobs, %d threads, %.3f ms, %.3f us per job.",
+				executed.load(), threadsCount(), time, time * 1000.0f / count
+				);
+		}
+
+		//-- 2. chain of the jobs, every one depends on the previous one.
+		{
+			std::unique_ptr<JobCounter[]> counters(new JobCounter[count]);
+			std::atomic<uint> executed(0);
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			run([&executed]() { ++executed; }, &counters[0]);
+			for (uint i = 1; i < count; ++i)
+			{
+				run([&executed]() { ++executed; }, &counters[i], &counters[i - 1]);
+			}
+			wait(counters[count - 1]);
+			float time = elapsedMs(startTime);
+
+			INFO_MSG("Jobs overhead: chain of %d dependent jobs, %.3f ms, %.3f us per job.",
+				executed.load(), time, time * 1000.0f / count
+				);
+		}
+
+		//-- 3. parallelFor with one element per range.
+		{
+			std::atomic<uint> executed(0);
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < count; i += 1024)
+			{
+				parallelFor(min<uint>(1024, count - i), 1, [&executed](uint first, uint last) { executed += last - first; });
+			}
+			float time = elapsedMs(startTime);
+
+			INFO_MSG("Jobs overhead: parallelFor over %d elements, %.3f ms, %.3f us per element.",
+				executed.load(), time, time * 1000.0f / count
+				);
+		}
+
+		return 0;
+	}
+
+	//-- Measures scaling of parallelFor over the math heavy loop with 1, 2, 4, 8 and 16 threads.
+	//-- Every configuration runs in its own temporary job system. Configurations exceeding the
+	//-- hardware threads count are skipped.
+	//-- Usage: +jobs_scaling_benchmark 4000000 in the command line.
+	//----------------------------------------------------------------------------------------------
+	int JobSystem::_scalingBenchmark(int elemsCount)
+	{
+		const uint iterations = 8;
+		const uint count	  = clamp(1024, elemsCount, 64 * 1024 * 1024);
+		const uint hwThreads  = max<uint>(1, std::thread::hardware_concurrency());
+		const uint threads[]  = { 1, 2, 4, 8, 16 };
+
+		std::vector<float> data(count);
+		auto work = [&data](uint first, uint last)
+		{
+			for (uint i = first; i < last; ++i)
+			{
+				float x = static_cast<float>(i);
+				data[i] = std::sqrt(x) * std::sin(x) + std::cos(x * 0.5f);
+			}
+		};
+
+		float baseTime = 0.0f;
+		for (uint t : threads)
+		{
+			if (t > hwThreads)
+			{
+				INFO_MSG("Jobs scaling: %d threads skipped, only %d hardware threads.", t, hwThreads);
+				continue;
+			}
+
+			JobSystem system;
+			system.start(t - 1);
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < iterations; ++i)
+			{
+				system.parallelFor(count, 1024, work);
+			}
+			float time = elapsedMs(startTime) / iterations;
+
+			system.shutdown();
+
+			if (t == 1)
+			{
+				baseTime = time;
+			}
+
+			INFO_MSG("Jobs scaling: %d elements, %d threads, %.3f ms, speedup %.2f.",
+				count, t, time, baseTime / time
+				);
+		}
+
+		return 0;
+	}
+
+} //-- brUGE
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace brUGE
+{
+	class JobCounter;
+
+	//----------------------------------------------------------------------------------------------
+	struct Job
+	{
+		std::function<void()>	m_func;
+		JobCounter*				m_counter; //-- decremented when the job has been finished.
+	};
+
+
+	//-- Counter of the unfinished jobs. Jobs may depend on the counter, such jobs are started only
+	//-- after it has reached zero. The counter has to be waited by JobSystem::wait() before its
+	//-- destruction, because the last job may still access it right after done() became true.
+	//----------------------------------------------------------------------------------------------
+	class JobCounter : public NonCopyable
+	{
+	public:
+		JobCounter() : m_count(0) { }
+
+		bool done() const { return m_count.load() == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<uint>	m_count;
+		std::mutex			m_mutex;
+		std::vector<Job>	m_dependants; //-- jobs waiting for this counter.
+	};
+
+
+	//-- Engine-wide job system. The main thread and every worker thread own a deque of jobs. The
+	//-- owner pushes and pops jobs at the back of its deque, so the recently added jobs are executed
+	//-- first while theirs data are still in the cache. Idle threads steal the oldest jobs from the
+	//-- front of the others deques. Waiting for a counter executes the pending jobs instead of
+	//-- blocking, so the main thread helps the workers while waiting.
+	//-- Jobs may be added from any thread, but only the threads of the system execute them.
+	//----------------------------------------------------------------------------------------------
+	class JobSystem : public NonCopyable
+	{
+	public:
+		typedef std::function<void()>			Function;
+		typedef std::function<void(uint, uint)>	RangeFunction;
+
+		static const uint INVALID_THREAD = uint(-1);
+
+	public:
+		JobSystem();
+		~JobSystem();
+
+		//-- the calling thread becomes the main thread of the system.
+		bool	init();
+		void	shutdown();
+
+		//-- add the job. The counter is incremented right now and decremented after the job has
+		//-- been finished. If the dependency is given the job is started only after it reaches zero.
+		void	run(const Function& func, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+		//-- wait until the counter reaches zero. The calling thread executes the pending jobs
+		//-- meanwhile. Threads not belonging to the system just yield.
+		void	wait(JobCounter& counter);
+
+		//-- split range [0, count) into the sub-ranges of at least grainSize elements and execute
+		//-- them in parallel as func(first, last). Returns after all of them have been finished.
+		//-- It may be called from any thread, e.g. from the render thread. A thread not belonging to
+		//-- the system executes only the first sub-range itself.
+		void	parallelFor(uint count, uint grainSize, const RangeFunction& func);
+
+		//-- count of the threads executing jobs including the main thread.
+		uint	threadsCount() const { return m_queues.size(); }
+
+		//-- index of the calling thread in range [0, threadsCount()), the main thread has index 0.
+		//-- It may be used to access per-thread data from the jobs. Threads not belonging to any
+		//-- job system get INVALID_THREAD.
+		static uint threadIndex();
+
+		//-- console functions.
+		int		_overheadBenchmark(int jobsCount);
+		int		_scalingBenchmark(int elemsCount);
+
+	private:
+		//-- the owner works at the back, thieves take jobs at m_head. The vector keeps its memory
+		//-- between the frames, so adding of the jobs doesn't touch the general heap.
+		struct Queue
+		{
+			Queue() : m_head(0) { }
+
+			std::mutex			m_mutex;
+			std::vector<Job>	m_jobs;
+			uint				m_head;
+		};
+
+		void	start(uint workersCount);
+		void	push(Job&& job);
+		bool	pop(uint thread, Job& job);
+		void	execute(Job& job);
+		void	finish(JobCounter* counter);
+		void	workerLoop(uint thread);
+
+	private:
+		std::vector<std::unique_ptr<Queue>>	m_queues;
+		std::vector<std::thread>			m_workers;
+		std::atomic<uint>					m_queuedJobs;
+		std::atomic<bool>					m_quit;
+		std::mutex							m_sleepMutex;
+		std::condition_variable				m_sleepCondition;
+	};
+
+} //-- brUGE
@@ -94,8 +94,10 @@ namespace ui
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void System::draw()
+	void System::prepare()
 	{
+		m_cmds.clear();
+
 		//--
 		ImGui::Render();
 		auto* drawData = ImGui::GetDrawData();
@@ -111,8 +113,7 @@ namespace ui
         float B = ImGui::GetIO().DisplaySize.y;
         float T = 0.0f;
 
-		mat4f orthoMat;
-		orthoMat.setOrthoOffCenterProj(L, R, B, T, 0.0f, 1.0f);
+		m_orthoMat.setOrthoOffCenterProj(L, R, B, T, 0.0f, 1.0f);
 
 		void* vb = m_vb->map<void>(IBuffer::ACCESS_WRITE_DISCARD);
 		void* ib = m_ib->map<void>(IBuffer::ACCESS_WRITE_DISCARD);
@@ -136,18 +137,9 @@ namespace ui
 			m_ib->unmap();
 		}
 
-		rd()->setDepthStencilState(m_stateDS, 0);
-		rd()->setRasterizerState(m_stateR);
-		rd()->setBlendState(m_stateB, nullptr, 0xffffffff);
-
-		rd()->setVertexLayout(m_vl);
-		rd()->setVertexBuffer(0, m_vb.get());
-		rd()->setIndexBuffer(m_ib.get());
-		rd()->setShader(m_shader.get());
-
-		// Render command lists
-		int vtxOffset = 0;
-		int idxOffset = 0;
+		//-- copy command lists. User callbacks are executed right here, because they access imgui.
+		uint vtxOffset = 0;
+		uint idxOffset = 0;
 		for (int i = 0; i < drawData->CmdListsCount; ++i)
 		{
 		    const ImDrawList* cmdList = drawData->CmdLists[i];
@@ -160,14 +152,14 @@ namespace ui
 		        }
 		        else
 		        {
-					rd()->setScissorRect(
-						cmd->ClipRect.x, cmd->ClipRect.y, cmd->ClipRect.z - cmd->ClipRect.x, cmd->ClipRect.w - cmd->ClipRect.y);
-
-					m_shader->setTexture("g_texture", static_cast<ITexture*>(cmd->TextureId), m_stateS);
-					m_shader->setMat4f("g_transform", orthoMat);
-					m_shader->setBool("g_useTexture", cmd->TextureId);
-
-					rd()->drawIndexed(PRIM_TOPOLOGY_TRIANGLE_LIST, idxOffset, vtxOffset, cmd->ElemCount);
+					DrawCmd drawCmd;
+					drawCmd.m_clipRect	= vec4f(cmd->ClipRect.x, cmd->ClipRect.y, cmd->ClipRect.z, cmd->ClipRect.w);
+					drawCmd.m_texture	= static_cast<ITexture*>(cmd->TextureId);
+					drawCmd.m_elemCount = cmd->ElemCount;
+					drawCmd.m_idxOffset = idxOffset;
+					drawCmd.m_vtxOffset = vtxOffset;
+
+					m_cmds.push_back(drawCmd);
 		        }
 		        idxOffset += cmd->ElemCount;
 		    }
@@ -175,6 +167,34 @@ namespace ui
 		}
 	}
 
+	//----------------------------------------------------------------------------------------------
+	void System::draw()
+	{
+		if (m_cmds.empty())
+			return;
+
+		rd()->setDepthStencilState(m_stateDS, 0);
+		rd()->setRasterizerState(m_stateR);
+		rd()->setBlendState(m_stateB, nullptr, 0xffffffff);
+
+		rd()->setVertexLayout(m_vl);
+		rd()->setVertexBuffer(0, m_vb.get());
+		rd()->setIndexBuffer(m_ib.get());
+		rd()->setShader(m_shader.get());
+
+		for (const auto& cmd : m_cmds)
+		{
+			rd()->setScissorRect(
+				cmd.m_clipRect.x, cmd.m_clipRect.y, cmd.m_clipRect.z - cmd.m_clipRect.x, cmd.m_clipRect.w - cmd.m_clipRect.y);
+
+			m_shader->setTexture("g_texture", cmd.m_texture, m_stateS);
+			m_shader->setMat4f("g_transform", m_orthoMat);
+			m_shader->setBool("g_useTexture", cmd.m_texture != nullptr);
+
+			rd()->drawIndexed(PRIM_TOPOLOGY_TRIANGLE_LIST, cmd.m_idxOffset, cmd.m_vtxOffset, cmd.m_elemCount);
+		}
+	}
+
 	//----------------------------------------------------------------------------------------------
 	bool System::handleMouseButtonEvent(const SDL_MouseButtonEvent& e)
 	{
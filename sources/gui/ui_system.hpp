@@ -4,6 +4,7 @@
 #include "imgui/imgui.h"
 #include "render/render_common.h"
 #include "SDL/SDL_events.h"
+#include <vector>
 
 namespace brUGE
 {
@@ -20,6 +21,12 @@ namespace ui
 
 		bool	init(const render::VideoMode& videoMode);
 		void	tick(float dt);
+
+		//-- finish the imgui frame and upload its geometry. It's called on the main thread at the
+		//-- frame sync point, because imgui isn't thread safe and starts the next frame meanwhile.
+		void	prepare();
+
+		//-- draw the prepared geometry. It may be executed on the render thread.
 		void	draw();
 
 		bool	handleMouseButtonEvent(const SDL_MouseButtonEvent& e);
@@ -32,6 +39,19 @@ namespace ui
 		void	setupRender();
 
 	private:
+		//-- copy of the imgui draw command.
+		struct DrawCmd
+		{
+			vec4f				m_clipRect;
+			render::ITexture*	m_texture;
+			uint				m_elemCount;
+			uint				m_idxOffset;
+			uint				m_vtxOffset;
+		};
+
+		std::vector<DrawCmd>				m_cmds;
+		mat4f								m_orthoMat;
+
 		std::shared_ptr<render::ITexture>	m_texture;
 		std::shared_ptr<render::IBuffer>	m_vb;
 		std::shared_ptr<render::IBuffer>	m_ib;
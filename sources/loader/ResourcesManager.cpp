@@ -5,11 +5,91 @@
 #include "render/IRenderDevice.h"
 #include "os/FileSystem.h"
 #include "utils/string_utils.h"
+#include "render/animation_engine.hpp"
+#include "SDL/SDL_timer.h"
+#include "console/Console.h"
+#include <cstdlib>
 
 using namespace brUGE::render;
 using namespace brUGE::os;
 using namespace brUGE::utils;
 
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- one binary file of the model library.
+	//----------------------------------------------------------------------------------------------
+	struct LibraryFile
+	{
+		enum EType
+		{
+			TYPE_MESH,
+			TYPE_SKINNED_MESH,
+			TYPE_ANIMATION
+		};
+
+		std::string			m_name; //-- without extension.
+		brUGE::RODataPtr	m_data;
+		EType				m_type;
+	};
+
+	//-- read the all meshes and animations of the model library, i.e. <models>/<model>/*.
+	//----------------------------------------------------------------------------------------------
+	uint64 readModelLibrary(const std::string& resPath, std::vector<LibraryFile>& oFiles)
+	{
+		const char* exts[] = { "mesh", "skinnedmesh", "animation" };
+
+		FileSystem& fs = FileSystem::instance();
+		uint64 totalBytes = 0;
+
+		std::string modelsDir;
+		std::vector<std::string> models;
+		if (!fs.getFileFullPath(resPath + "models", modelsDir) || !FileSystem::getFilesInDir(modelsDir, models))
+			return 0;
+
+		for (const auto& model : models)
+		{
+			for (uint type = 0; type < 3; ++type)
+			{
+				std::vector<std::string> files;
+				FileSystem::getFilesInDir(modelsDir + "\\" + model, files, exts[type], true);
+
+				for (const auto& file : files)
+				{
+					LibraryFile f;
+					f.m_name = "models/" + model + "/" + file;
+					f.m_data = fs.readFile(resPath + f.m_name + "." + exts[type]);
+					f.m_type = static_cast<LibraryFile::EType>(type);
+
+					if (f.m_data)
+					{
+						totalBytes += f.m_data->length();
+						oFiles.push_back(f);
+					}
+				}
+			}
+		}
+
+		return totalBytes;
+	}
+
+	//-- load file with the appropriate loader. Loaded resource is thrown away.
+	//----------------------------------------------------------------------------------------------
+	bool loadLibraryFile(const LibraryFile& file, const ROData& data)
+	{
+		switch (file.m_type)
+		{
+		case LibraryFile::TYPE_MESH:			return std::make_shared<Mesh>()->load(data, file.m_name);
+		case LibraryFile::TYPE_SKINNED_MESH:	return std::make_shared<SkinnedMesh>()->load(data, file.m_name);
+		case LibraryFile::TYPE_ANIMATION:		return std::make_shared<Animation>()->load(data);
+		default:								return false;
+		}
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
 namespace brUGE
 {	
 	DEFINE_SINGLETON(ResourcesManager);
@@ -35,6 +115,9 @@ namespace brUGE
 		bool success = true;
 		success &= m_texLoader.init();
 
+		REGISTER_CONSOLE_METHOD("res_meshes_benchmark", _meshesBenchmark, ResourcesManager);
+		REGISTER_CONSOLE_METHOD("res_meshes_fuzz", _meshesFuzz, ResourcesManager);
+
 		return success;
 	}
 
@@ -134,10 +217,14 @@ namespace brUGE
 			}
 
 			result = std::make_shared<SkinnedMesh>();
-			if (!result->load(*data, meshName))
+			if (result->load(*data, meshName))
 			{
 				m_skinnedMeshesCache.add(meshName.c_str(), result);
 			}
+			else
+			{
+				result.reset();
+			}
 		}
 		return result;
 	}
@@ -230,4 +317,93 @@ namespace brUGE
 		return result;
 	}
 
+	//-- measures load throughput of the all meshes and animations of the model library. Files are
+	//-- read up front and loaded bypassing the cache, so the time covers parsing, uploading of the
+	//-- geometry and creation of the materials, but not the disk reads.
+	//-- Usage: res_meshes_benchmark 10
+	//----------------------------------------------------------------------------------------------
+	int ResourcesManager::_meshesBenchmark(int iterations)
+	{
+		std::vector<LibraryFile> files;
+		uint64 totalBytes = readModelLibrary(m_resPath, files);
+
+		if (files.empty() || iterations <= 0)
+			return 0;
+
+		//-- measure.
+		uint failed = 0;
+		uint64 startTime = SDL_GetPerformanceCounter();
+
+		for (int i = 0; i < iterations; ++i)
+		{
+			for (const auto& f : files)
+			{
+				f.m_data->seekAbs(0);
+				failed += loadLibraryFile(f, *f.m_data) ? 0 : 1;
+			}
+		}
+
+		float time = ((SDL_GetPerformanceCounter() - startTime) * 1000.0f) / (SDL_GetPerformanceFrequency() * iterations);
+
+		INFO_MSG("Meshes load: %d files, %.2f MB, %.3f ms per iteration, %.1f MB/s, %d failed.",
+			static_cast<uint>(files.size()), totalBytes / (1024.0f * 1024.0f), time,
+			(totalBytes / (1024.0f * 1024.0f)) / (time * 0.001f), failed / iterations
+			);
+
+		return 0;
+	}
+
+	//-- stress test of the binary loaders with the corrupted data. The every file of the model
+	//-- library is loaded many times either truncated at the random position or with a few random
+	//-- bytes damaged. Loaders have to reject or survive such data, a crash here is a bug.
+	//-- Usage: res_meshes_fuzz 100
+	//----------------------------------------------------------------------------------------------
+	int ResourcesManager::_meshesFuzz(int iterations)
+	{
+		std::vector<LibraryFile> files;
+		readModelLibrary(m_resPath, files);
+
+		uint loaded = 0;
+		uint rejected = 0;
+		std::vector<byte> bytes;
+
+		srand(0);
+		for (const auto& f : files)
+		{
+			const byte* src = static_cast<const byte*>(f.m_data->ptr(0));
+			uint		len = f.m_data->length();
+
+			for (int i = 0; i < iterations; ++i)
+			{
+				bytes.assign(src, src + len);
+
+				//-- even iterations truncate the file, odd ones damage up to 8 random bytes.
+				uint size = len;
+				if (i % 2 == 0)
+				{
+					size = 1 + rand() % len;
+				}
+				else
+				{
+					for (uint j = 0, count = 1 + rand() % 8; j < count; ++j)
+					{
+						bytes[(rand() * (RAND_MAX + 1u) + rand()) % len] = static_cast<byte>(rand());
+					}
+				}
+
+				ROData data(&bytes[0], size, false);
+				if (loadLibraryFile(f, data))
+					++loaded;
+				else
+					++rejected;
+			}
+		}
+
+		INFO_MSG("Meshes fuzz: %d files, %d loads, %d loaded, %d rejected.",
+			static_cast<uint>(files.size()), loaded + rejected, loaded, rejected
+			);
+
+		return 0;
+	}
+
 } // brUGE
\ No newline at end of file
@@ -40,6 +40,10 @@ namespace brUGE
 
 		bool makeSharedShaderConstants(const char* name, const std::shared_ptr<render::IBuffer>& newBuffer);
 
+	private:
+		int _meshesBenchmark(int iterations);
+		int _meshesFuzz(int iterations);
+
 	private:
 
 		template<typename RES>
@@ -1,5 +1,7 @@
 #include "physic_world.hpp"
 #include "scene/game_world.hpp"
+#include "engine/Engine.h"
+#include "engine/job_system.hpp"
 #include "math/Matrix4x4.hpp"
 #include "pugixml/pugixml.hpp"
 #include "utils/Data.hpp"
@@ -8,7 +10,12 @@
 #include "render/DebugDrawer.h"
 #include "render/Color.h"
 #include "render/Mesh.hpp"
+#include "console/WatchersPanel.h"
+#include "console/Console.h"
+#include "console/TimingPanel.h"
+#include "SDL/SDL_timer.h"
 #include <algorithm>
+#include <thread>
 
 using namespace physx;
 using namespace brUGE;
@@ -41,8 +48,142 @@ namespace
 	inline mat4f		physx2bruge(const PxMat44& m)		{ return mat4f(m.front()); }
 	inline mat4f		physx2bruge(const PxTransform& t)	{ return mat4f(PxMat44(t).front()); }
 
+	//-- normalized linear interpolation. Good enough for the close rotations of two neighbour steps.
+	//----------------------------------------------------------------------------------------------
+	inline PxTransform lerp(const PxTransform& from, const PxTransform& to, float t)
+	{
+		PxQuat q = (from.q.dot(to.q) < 0.0f) ? -to.q : to.q;
+
+		return PxTransform(from.p + (to.p - from.p) * t, (from.q * (1.0f - t) + q * t).getNormalized());
+	}
+
 	//--
 	bool g_debugDrawEnabled = false;
+
+	//-- count of the PhysX worker threads. Zero runs the simulation on the calling thread.
+	uint g_physicsThreads = max<uint>(1, std::thread::hardware_concurrency() / 2);
+
+	//-- watchers. Overlap is the time the simulation runs in parallel with the main thread and wait
+	//-- is the time the main thread is blocked on its results.
+	float g_physicsOverlapTime = 0.0f;
+	float g_physicsWaitTime	   = 0.0f;
+
+	//-- count of the threads executing batched scene queries and minimum count of the queries per
+	//-- thread. Smaller batches aren't worth of the scheduling overhead.
+	uint g_queryThreads			= max<uint>(1, std::thread::hardware_concurrency());
+
+	//-- simulation LOD. Distances are scaled by g_lodDistScale, promotion to the more detailed level
+	//-- happens g_lodHysteresis closer than demotion to avoid flickering on the border.
+	bool		g_lodEnabled	= true;
+	float		g_lodDistScale	= 1.0f;
+	const float g_lodHysteresis = 0.9f;
+	uint		g_lodReducedCount = 0;
+	uint		g_lodSleepCount	  = 0;
+
+	//-- fixed step of the simulation and maximum count of steps per frame. The time exceeding the
+	//-- budget is dropped, so the long frames slow down the simulation instead of making it unstable.
+	float g_fixedStep	 = 1.0f / 60.0f;
+	uint  g_maxSubsteps	 = 4;
+	float g_stepTime	 = 0.0f;
+	uint  g_substeps	 = 0;
+	float g_droppedTime	 = 0.0f;
+
+	//-- terrain tiles are created around the objects expanded by g_terrainMargin meters and released
+	//-- after being unused for g_terrainReleaseFrames frames.
+	float g_terrainMargin		 = 16.0f;
+	uint  g_terrainReleaseFrames = 300;
+	uint  g_terrainTiles		 = 0;
+	float g_terrainTilesKB		 = 0.0f; //-- samples of the live tiles.
+	float g_terrainMonolithicKB	 = 0.0f; //-- samples of the whole terrain as one height field.
+
+	//-- solver iterations of the fully simulated body. Defaults of the PhysX.
+	const uint g_fullPosIterations = 4;
+	const uint g_fullVelIterations = 1;
+	const uint g_minQueriesPerThread = 64;
+
+	//----------------------------------------------------------------------------------------------
+	inline float randomFloat(float minVal, float maxVal)
+	{
+		return minVal + (maxVal - minVal) * (rand() / static_cast<float>(RAND_MAX));
+	}
+
+	//----------------------------------------------------------------------------------------------
+	PxQueryFilterData queryFilter(uint groupMask, PxQueryFlags flags = PxQueryFlag::eDYNAMIC | PxQueryFlag::eSTATIC)
+	{
+		return PxQueryFilterData(PxFilterData(groupMask, 0, 0, 0), flags);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<typename HitType>
+	void fillHit(physics::SceneQueryBatch::Hit& hit, const HitType& pxHit)
+	{
+		auto body = static_cast<physics::PhysicsObjectType::RigidBody*>(pxHit.actor->userData);
+
+		hit.m_hit = true;
+		if (body)
+		{
+			hit.m_node	  = body->m_node;
+			hit.m_gameObj = body->m_owner->m_gameObj;
+			hit.m_physObj = body->m_owner->m_physObj;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void executeQuery(const PxScene& scene, const physics::SceneQueryBatch::Query& query, physics::SceneQueryBatch::Hit& hit)
+	{
+		typedef physics::SceneQueryBatch Batch;
+
+		hit = Batch::Hit();
+
+		PxVec3 start(query.m_start.x, query.m_start.y, query.m_start.z);
+		PxVec3 dir(query.m_dir.x, query.m_dir.y, query.m_dir.z);
+
+		switch (query.m_type)
+		{
+		case Batch::QUERY_RAYCAST:
+		case Batch::QUERY_SWEEP:
+			{
+				PxLocationHit* block = nullptr;
+				PxRaycastBuffer rayHit;
+				PxSweepBuffer	sweepHit;
+
+				if (query.m_type == Batch::QUERY_RAYCAST)
+				{
+					if (scene.raycast(start, dir, query.m_distance, rayHit, PxHitFlags(PxHitFlag::eDEFAULT), queryFilter(query.m_groupMask)))
+						block = &rayHit.block;
+				}
+				else
+				{
+					if (scene.sweep(PxSphereGeometry(query.m_radius), PxTransform(start), dir, query.m_distance, sweepHit,
+						PxHitFlags(PxHitFlag::eDEFAULT), queryFilter(query.m_groupMask)))
+						block = &sweepHit.block;
+				}
+
+				if (block)
+				{
+					fillHit(hit, *block);
+					hit.m_wPos	   = vec3f(&block->position[0]);
+					hit.m_wNormal  = vec3f(&block->normal[0]);
+					hit.m_distance = block->distance;
+				}
+				break;
+			}
+		case Batch::QUERY_OVERLAP:
+			{
+				PxOverlapBuffer overlapHit;
+				auto filter = queryFilter(query.m_groupMask, PxQueryFlag::eDYNAMIC | PxQueryFlag::eSTATIC | PxQueryFlag::eANY_HIT);
+
+				if (scene.overlap(PxSphereGeometry(query.m_radius), PxTransform(start), overlapHit, filter))
+				{
+					fillHit(hit, overlapHit.block);
+					hit.m_wPos = query.m_start;
+				}
+				break;
+			}
+		default:
+			assert(!"Invalid query type.");
+		}
+	}
 }
 
 
@@ -52,16 +193,44 @@ namespace physics
 {
 
 	//----------------------------------------------------------------------------------------------
-	PhysicsWorld::PhysicsWorld() : m_foundation(nullptr), m_physics(nullptr), m_scene(nullptr), m_dispatcher(nullptr), m_debuggerConnection(nullptr)
+	PhysicsWorld::PhysicsWorld()
+		:	m_foundation(nullptr), m_physics(nullptr), m_scene(nullptr), m_dispatcher(nullptr), m_debuggerConnection(nullptr),
+			m_isSimulating(false), m_kickTime(0), m_observer(0, 0, 0), m_accumulator(0.0f), m_stepIndex(0), m_stepTime(0)
 	{
 		//-- register console funcs.
-		REGISTER_CONSOLE_METHOD("phys_drawWire", _drawWire, PhysicsWorld);
-		REGISTER_CONSOLE_METHOD("phys_drawAABB", _drawAABB, PhysicsWorld);
+		REGISTER_CONSOLE_VALUE("phys_threads", uint, g_physicsThreads);
+		REGISTER_CONSOLE_METHOD("phys_sync_benchmark", _syncBenchmark, PhysicsWorld);
+		REGISTER_CONSOLE_METHOD("phys_query_benchmark", _queryBenchmark, PhysicsWorld);
+		REGISTER_CONSOLE_VALUE("phys_query_threads", uint, g_queryThreads);
+
+		REGISTER_CONSOLE_VALUE("phys_fixed_step", float, g_fixedStep);
+		REGISTER_CONSOLE_VALUE("phys_max_substeps", uint, g_maxSubsteps);
+		REGISTER_CONSOLE_VALUE("phys_terrain_margin", float, g_terrainMargin);
+		REGISTER_CONSOLE_VALUE("phys_terrain_release_frames", uint, g_terrainReleaseFrames);
+		REGISTER_CONSOLE_METHOD("phys_terrain_benchmark", _terrainBenchmark, PhysicsWorld);
+		REGISTER_CONSOLE_VALUE("phys_lod_enabled", bool, g_lodEnabled);
+		REGISTER_CONSOLE_VALUE("phys_lod_dist_scale", float, g_lodDistScale);
+
+		REGISTER_RO_WATCHER("physics lod reduced", uint, g_lodReducedCount);
+		REGISTER_RO_WATCHER("physics lod sleep", uint, g_lodSleepCount);
+		REGISTER_RO_WATCHER("physics terrain tiles", uint, g_terrainTiles);
+		REGISTER_RO_WATCHER("physics terrain KB", float, g_terrainTilesKB);
+		REGISTER_RO_WATCHER("physics terrain monolithic KB", float, g_terrainMonolithicKB);
+		REGISTER_RO_WATCHER("physics step ms", float, g_stepTime);
+		REGISTER_RO_WATCHER("physics substeps", uint, g_substeps);
+		REGISTER_RO_WATCHER("physics dropped ms", float, g_droppedTime);
+		REGISTER_RO_WATCHER("physics overlap ms", float, g_physicsOverlapTime);
+		REGISTER_RO_WATCHER("physics wait ms", float, g_physicsWaitTime);
 	}
 
 	//----------------------------------------------------------------------------------------------
 	PhysicsWorld::~PhysicsWorld()
 	{
+		//-- it also waits for the running simulation, so the scene may be released.
+		removeTerrainPhysicsObject();
+
+		m_kinematicBodies.clear();
+		m_movingBodies.clear();
 		m_physObjs.clear();
 		m_physObjTypes.clear();
 		
@@ -96,8 +265,7 @@ namespace physics
 		}
 
 		{
-			//-- ToDo: for now we don't create any worker threads
-			m_dispatcher = PxDefaultCpuDispatcherCreate(0);
+			m_dispatcher = PxDefaultCpuDispatcherCreate(g_physicsThreads);
 
 			PxSceneDesc sceneDesc(m_physics->getTolerancesScale());
 			sceneDesc.gravity		= PxVec3(0.0f, -9.81f, 0.0f);
@@ -114,6 +282,9 @@ namespace physics
 	//----------------------------------------------------------------------------------------------
 	Handle PhysicsWorld::createPhysicsObject(const char* desc, Transform* transform, Handle gameObj)
 	{
+		//-- the scene can't be modified while it's simulating.
+		assert(!m_isSimulating);
+
 		PhysicsObjectType* factory = nullptr;
 
 		auto result = m_physObjTypes.find(desc);
@@ -141,6 +312,13 @@ namespace physics
 		{
 			instance->m_physObj = m_physObjs.size();
 			instance->enterScene(m_scene);
+
+			for (const auto& body : instance->m_bodies)
+			{
+				if (body->m_actor->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
+					addKinematicBody(body.get());
+			}
+
 			m_physObjs.push_back(std::move(instance));
 			return m_physObjs.size() - 1;
 		}
@@ -151,21 +329,99 @@ namespace physics
 	//----------------------------------------------------------------------------------------------
 	void PhysicsWorld::removePhysicsObject(Handle physObj)		
 	{
+		assert(!m_isSimulating);
 		assert(static_cast<uint32>(physObj) < m_physObjs.size() && m_physObjs[physObj]);
 
+		for (const auto& body : m_physObjs[physObj]->m_bodies)
+		{
+			removeKinematicBody(body.get());
+			removeMovingBody(body.get());
+		}
+
 		m_physObjs[physObj]->leaveScene(m_scene);
 		m_physObjs[physObj].reset();
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void PhysicsWorld::simulate(float dt)
+	void PhysicsWorld::beginSimulate(float dt)
 	{
+		assert(!m_isSimulating);
+
+		const float step = max(g_fixedStep, 0.001f);
+
+		//-- 1. count the fixed steps fitting into the accumulated time and drop the exceeding time.
+		m_accumulator += dt;
+
+		uint steps = static_cast<uint>(m_accumulator / step);
+		if (steps > g_maxSubsteps)
+		{
+			float dropped = m_accumulator - g_maxSubsteps * step;
+
+			g_droppedTime += dropped * 1000.0f;
+			m_accumulator -= dropped;
+			steps		   = g_maxSubsteps;
+		}
+		m_accumulator -= steps * step;
+
+		g_substeps = steps;
+		m_stepTime = 0;
+
+		if (steps == 0)
+			return;
+
+		{
+			SCOPED_TIME_MEASURER_EX("physic lod")
+			updateLods();
+		}
+
+		{
+			SCOPED_TIME_MEASURER_EX("physic terrain")
+			updateTerrainTiles();
+		}
+
+		//-- PhysX consumes the kinematic target in the next step, so every step gets its own part
+		//-- of the frame's motion. Otherwise the first step would move the kinematic bodies through
+		//-- the whole motion and push the dynamic ones with the multiplied velocity.
 		updatePhysicsTransforms();
 
-		m_scene->simulate(dt);
-		m_scene->fetchResults(true);
+		//-- 2. do all the steps except the last one in place.
+		for (uint i = 0; i + 1 < steps; ++i)
+		{
+			uint64 startTime = SDL_GetPerformanceCounter();
+			setKinematicTargets(static_cast<float>(i + 1) / steps);
+			stepSimulation(step);
+			m_stepTime += SDL_GetPerformanceCounter() - startTime;
+		}
+
+		//-- 3. kick the last one.
+		setKinematicTargets(1.0f);
+		m_scene->simulate(step);
+		m_isSimulating = true;
+		m_kickTime	   = SDL_GetPerformanceCounter();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::endSimulate()
+	{
+		if (m_isSimulating)
+		{
+			uint64 fetchTime = SDL_GetPerformanceCounter();
+			m_scene->fetchResults(true);
+			m_isSimulating = false;
 
-		updateGraphicsTransforms();
+			uint64 endTime = SDL_GetPerformanceCounter();
+			g_physicsOverlapTime = ((fetchTime - m_kickTime) * 1000.0f) / SDL_GetPerformanceFrequency();
+			g_physicsWaitTime	 = ((endTime - fetchTime) * 1000.0f) / SDL_GetPerformanceFrequency();
+
+			++m_stepIndex;
+			gatherActivePoses(*m_scene, m_movingBodies);
+
+			m_stepTime += endTime - fetchTime;
+			g_stepTime	= (m_stepTime * 1000.0f) / SDL_GetPerformanceFrequency();
+		}
+
+		//-- interpolate even if there wasn't any step this frame.
+		updateGraphicsTransforms(m_movingBodies, m_accumulator / max(g_fixedStep, 0.001f));
 
 		//-- debug draw
 		if (g_debugDrawEnabled)
@@ -175,75 +431,278 @@ namespace physics
 	}
 
 	//----------------------------------------------------------------------------------------------
-	bool PhysicsWorld::createTerrainPhysicsObject(uint, float, float*, float, float, float)
+	bool PhysicsWorld::createTerrainPhysicsObject(
+		uint gridSize, uint tileSize, float unitsPerCell, const float* heights, const vec2f& origin,
+		float minHeight, float maxHeight)
 	{
-#if 0
-		//-- create heightfield shape.
-		m_terrain.m_shape = new btHeightfieldTerrainShape(
-			gridSize, gridSize, heights, heightScale, minHeight, maxHeight,	1, PHY_FLOAT, false
-			);
+		removeTerrainPhysicsObject();
+
+		if (!heights || gridSize < 2 || tileSize == 0)
+			return false;
+
+		//-- heights are quantized to 16 bits with the same scale for all the tiles, so they match each
+		//-- other on the borders.
+		float maxAbsHeight = max(fabsf(minHeight), fabsf(maxHeight));
 
-		assert(m_terrain.m_shape && "null terrain heightfield shape.");
+		m_terrain.m_heights		 = heights;
+		m_terrain.m_gridSize	 = gridSize;
+		m_terrain.m_tileSize	 = tileSize;
+		m_terrain.m_tilesCount	 = (gridSize - 1 + tileSize - 1) / tileSize;
+		m_terrain.m_unitsPerCell = unitsPerCell;
+		m_terrain.m_heightScale	 = (maxAbsHeight > 0.0f) ? maxAbsHeight / 32767.0f : 1.0f;
+		m_terrain.m_origin		 = origin;
+		m_terrain.m_material	 = m_physics->createMaterial(0.5f, 0.5f, 0.5f);
+		m_terrain.m_frame		 = 0;
 
-		//-- scale the shape.
-		btVector3 localScaling(unitsPerCell, 1, unitsPerCell);
-		m_terrain.m_shape->setLocalScaling(localScaling);
+		m_terrain.m_tiles.resize(m_terrain.m_tilesCount * m_terrain.m_tilesCount);
 
-		//-- set origin to middle of heightfield.
-		btTransform tr;
-		tr.setIdentity();
+		return m_terrain.m_material != nullptr;
+	}
 
-		float middleY = (maxHeight - minHeight) * 0.5f;
-		float offsetY = maxHeight - middleY;
+	//----------------------------------------------------------------------------------------------
+	bool PhysicsWorld::removeTerrainPhysicsObject()
+	{
+		//-- the scene can't be modified while it's simulating.
+		if (m_isSimulating)
+		{
+			m_scene->fetchResults(true);
+			m_isSimulating = false;
+		}
+
+		for (auto& tile : m_terrain.m_tiles)
+		{
+			if (tile.m_actor)
+			{
+				m_scene->removeActor(*tile.m_actor);
+				tile.m_actor->release();
+				tile.m_heightField->release();
+			}
+		}
 
-		btMatrix3x3 mat3x3;
-		mat3x3.setEulerZYX(0, degToRad(180), 0);
-		tr.setBasis(mat3x3);
-		tr.setOrigin(btVector3(0, offsetY, 0));
+		if (m_terrain.m_material)
+			m_terrain.m_material->release();
 
-		m_terrain.m_rigidBody = new btRigidBody(
-			0, 0, m_terrain.m_shape, btVector3(0,0,0)
-			);	
+		m_terrain = Terrain();
 
-		m_terrain.m_rigidBody->setWorldTransform(tr);
-		m_terrain.m_rigidBody->setContactProcessingThreshold(0.0f);
-		m_dynamicsWorld->addRigidBody(m_terrain.m_rigidBody);
-#endif
+		g_terrainTiles		  = 0;
+		g_terrainTilesKB	  = 0.0f;
+		g_terrainMonolithicKB = 0.0f;
 
 		return true;
 	}
 
+	//-- Marks the tiles needed this frame and creates the missing ones. The tiles unused for the
+	//-- g_terrainReleaseFrames frames are released.
 	//----------------------------------------------------------------------------------------------
-	bool PhysicsWorld::removeTerrainPhysicsObject()
+	void PhysicsWorld::updateTerrainTiles()
 	{
-#if 0
-		if (!m_terrain.m_shape || !m_terrain.m_rigidBody)
-			return true;
+		if (m_terrain.m_tiles.empty())
+			return;
 
-		//-- remove terrain from physics world.
-		m_dynamicsWorld->removeRigidBody(m_terrain.m_rigidBody);
+		++m_terrain.m_frame;
 
-		//-- delete.
-		delete m_terrain.m_rigidBody;
-		delete m_terrain.m_shape;
-#endif
-		return true;
+		const vec3f margin(g_terrainMargin, 0.0f, g_terrainMargin);
+
+		//-- 1. tiles around the observer and the physics objects.
+		useTerrainTiles(m_observer - margin, m_observer + margin);
+
+		for (const auto& instance : m_physObjs)
+		{
+			if (!instance)
+				continue;
+
+			const AABB& bounds = instance->m_transform->m_worldBounds;
+			useTerrainTiles(bounds.m_min - margin, bounds.m_max + margin);
+		}
+
+		//-- 2. release unused tiles.
+		uint bytes = 0;
+		g_terrainTiles = 0;
+		for (auto& tile : m_terrain.m_tiles)
+		{
+			if (!tile.m_actor)
+				continue;
+
+			if (m_terrain.m_frame - tile.m_lastUsed > g_terrainReleaseFrames)
+			{
+				m_scene->removeActor(*tile.m_actor);
+				tile.m_actor->release();
+				tile.m_heightField->release();
+				tile = TerrainTile();
+			}
+			else
+			{
+				const auto& hf = *tile.m_heightField;
+
+				++g_terrainTiles;
+				bytes += hf.getNbRows() * hf.getNbColumns() * hf.getSampleStride();
+			}
+		}
+
+		g_terrainTilesKB	  = bytes / 1024.0f;
+		g_terrainMonolithicKB = m_terrain.m_gridSize * m_terrain.m_gridSize * sizeof(PxHeightFieldSample) / 1024.0f;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::useTerrainTiles(const vec3f& minPos, const vec3f& maxPos)
+	{
+		const float tileUnits = m_terrain.m_tileSize * m_terrain.m_unitsPerCell;
+		const int	lastTile  = m_terrain.m_tilesCount - 1;
+
+		int minX = static_cast<int>(floorf((minPos.x - m_terrain.m_origin.x) / tileUnits));
+		int minZ = static_cast<int>(floorf((minPos.z - m_terrain.m_origin.y) / tileUnits));
+		int maxX = static_cast<int>(floorf((maxPos.x - m_terrain.m_origin.x) / tileUnits));
+		int maxZ = static_cast<int>(floorf((maxPos.z - m_terrain.m_origin.y) / tileUnits));
+
+		//-- completely outside of the terrain.
+		if (maxX < 0 || maxZ < 0 || minX > lastTile || minZ > lastTile)
+			return;
+
+		minX = max(minX, 0);		minZ = max(minZ, 0);
+		maxX = min(maxX, lastTile); maxZ = min(maxZ, lastTile);
+
+		for (int z = minZ; z <= maxZ; ++z)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				auto& tile = m_terrain.m_tiles[z * m_terrain.m_tilesCount + x];
+				tile.m_lastUsed = m_terrain.m_frame;
+
+				if (tile.m_actor)
+					continue;
+
+				tile.m_heightField = createTerrainHeightField(x * m_terrain.m_tileSize, z * m_terrain.m_tileSize);
+				if (!tile.m_heightField)
+				{
+					ERROR_MSG("Can't create terrain physics tile (%d, %d).", x, z);
+					continue;
+				}
+
+				PxHeightFieldGeometry geometry(
+					tile.m_heightField, PxMeshGeometryFlags(), m_terrain.m_heightScale,
+					m_terrain.m_unitsPerCell, m_terrain.m_unitsPerCell
+					);
+
+				PxTransform pose(PxVec3(
+					m_terrain.m_origin.x + x * tileUnits, 0.0f, m_terrain.m_origin.y + z * tileUnits
+					));
+
+				tile.m_actor = m_physics->createRigidStatic(pose);
+
+				auto* shape = tile.m_actor->createShape(geometry, *m_terrain.m_material);
+				shape->setQueryFilterData(PxFilterData(1 << SceneQueryBatch::TERRAIN_GROUP, 0, 0, 0));
+
+				m_scene->addActor(*tile.m_actor);
+			}
+		}
+	}
+
+	//-- PhysX height field rows go along the X axis and columns along the Z axis, while the height
+	//-- table is stored row by row along the X axis.
+	//----------------------------------------------------------------------------------------------
+	PxHeightField* PhysicsWorld::createTerrainHeightField(uint firstX, uint firstZ) const
+	{
+		const uint	 rows	  = min(m_terrain.m_tileSize + 1, m_terrain.m_gridSize - firstX);
+		const uint	 columns  = min(m_terrain.m_tileSize + 1, m_terrain.m_gridSize - firstZ);
+		const float	 invScale = 1.0f / m_terrain.m_heightScale;
+
+		std::vector<PxHeightFieldSample> samples(rows * columns);
+		for (uint r = 0; r < rows; ++r)
+		{
+			const float* heights = m_terrain.m_heights + firstZ * m_terrain.m_gridSize + firstX + r;
+
+			for (uint c = 0; c < columns; ++c)
+			{
+				float height = clamp(-32767.0f, heights[c * m_terrain.m_gridSize] * invScale, 32767.0f);
+				samples[r * columns + c].height = static_cast<PxI16>(floorf(height + 0.5f));
+			}
+		}
+
+		PxHeightFieldDesc desc;
+		desc.format			= PxHeightFieldFormat::eS16_TM;
+		desc.nbRows			= rows;
+		desc.nbColumns		= columns;
+		desc.samples.data	= samples.data();
+		desc.samples.stride = sizeof(PxHeightFieldSample);
+
+		return m_physics->createHeightField(desc);
+	}
+
+	//-- Measures time of the height field creation for all the tiles one by one and for the whole
+	//-- terrain as one monolithic height field. Terrain has to be already loaded by the demo.
+	//-- Usage: +phys_terrain_benchmark in the command line.
+	//----------------------------------------------------------------------------------------------
+	int PhysicsWorld::_terrainBenchmark()
+	{
+		if (m_terrain.m_tiles.empty())
+			return 0;
+
+		const float freq = SDL_GetPerformanceFrequency() / 1000.0f;
+
+		//-- 1. tiles.
+		float total	  = 0.0f;
+		float maxTime = 0.0f;
+		for (uint z = 0; z < m_terrain.m_tilesCount; ++z)
+		{
+			for (uint x = 0; x < m_terrain.m_tilesCount; ++x)
+			{
+				uint64 startTime = SDL_GetPerformanceCounter();
+
+				if (auto* hf = createTerrainHeightField(x * m_terrain.m_tileSize, z * m_terrain.m_tileSize))
+					hf->release();
+
+				float time = (SDL_GetPerformanceCounter() - startTime) / freq;
+				total  += time;
+				maxTime = max(maxTime, time);
+			}
+		}
+
+		//-- 2. the whole terrain.
+		uint tileSize = m_terrain.m_tileSize;
+		m_terrain.m_tileSize = m_terrain.m_gridSize - 1;
+
+		uint64 startTime = SDL_GetPerformanceCounter();
+		if (auto* hf = createTerrainHeightField(0, 0))
+			hf->release();
+		float fullTime = (SDL_GetPerformanceCounter() - startTime) / freq;
+
+		m_terrain.m_tileSize = tileSize;
+
+		uint count = m_terrain.m_tiles.size();
+		INFO_MSG("Terrain physics: %d tiles, %.3f ms total, %.3f ms avg, %.3f ms max, monolithic %.3f ms.",
+			count, total, total / count, maxTime, fullTime
+			);
+
+		return 0;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void PhysicsWorld::makeKinematic(Handle physObj, bool flag)
 	{
+		assert(!m_isSimulating);
+
 		const auto& instance = m_physObjs[physObj];
 
 		for (auto& body : instance->m_bodies)
 		{
 			body->m_actor->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, flag);
+
+			//-- interpolation starts from the current pose, i.e. the one given by the animation or
+			//-- by the simulation.
+			body->m_prevPose = body->m_currPose = body->m_actor->getGlobalPose();
+
+			if (flag)
+				addKinematicBody(body.get());
+			else
+				removeKinematicBody(body.get());
 		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void PhysicsWorld::addImpulse(Handle physObj, const vec3f& impulse, const vec3f& wPos)
 	{
+		assert(!m_isSimulating);
+
 		const auto& instance = m_physObjs[physObj];
 		auto&		body	 = *instance->m_bodies[0]->m_actor;
 
@@ -256,40 +715,175 @@ namespace physics
 	}
 
 	//----------------------------------------------------------------------------------------------
-	bool PhysicsWorld::collide(CollisionCallback& cc, const vec3f& start, const vec3f& end) const
+	bool PhysicsWorld::collide(CollisionCallback& cc, const vec3f& start, const vec3f& end, uint groupMask) const
 	{
-		PxVec3 pxStart(start.x, start.y, start.z);
-		PxVec3 pxEnd(end.x, end.y, end.z);
-		PxVec3 pxUnitDir = (pxEnd - pxStart); 
-		PxReal pxMaxDistance = pxUnitDir.normalize(); 
-		PxRaycastBuffer pxHit;
+		SceneQueryBatch::Query query;
+		SceneQueryBatch::Hit   hit;
 
-		bool status = m_scene->raycast(pxStart, pxUnitDir, pxMaxDistance, pxHit);
+		query.m_type	  = SceneQueryBatch::QUERY_RAYCAST;
+		query.m_start	  = start;
+		query.m_dir		  = end - start;
+		query.m_distance  = query.m_dir.length();
+		query.m_radius	  = 0.0f;
+		query.m_groupMask = groupMask;
+
+		if (query.m_distance <= 0.0f)
+			return false;
 
-		if (status)
+		query.m_dir.normalize();
+		executeQuery(*m_scene, query, hit);
+
+		if (hit.m_hit)
 		{
-			auto& block = pxHit.block;
-			auto body	= static_cast<PhysicsObjectType::RigidBody*>(block.actor->userData);
+			cc.m_wPos		= hit.m_wPos;
+			cc.m_wNormal	= hit.m_wNormal;
+			cc.m_distance	= hit.m_distance;
+			cc.m_node		= hit.m_node;
+			cc.m_gameObj	= hit.m_gameObj;
+			cc.m_physObj	= hit.m_physObj;
+
+			return true;
+		}
 
-			cc.m_wPos		= vec3f(&block.position[0]);
-			cc.m_wNormal	= vec3f(&block.normal[0]);
-			cc.m_distance	= block.distance;
+		return false;
+	}
 
-			if (body)
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::executeQueries(SceneQueryBatch& batch) const
+	{
+		const uint count = batch.m_queries.size();
+		const auto*	queries = batch.m_queries.data();
+		auto*		hits	= batch.m_hits.data();
+		const PxScene& scene = *m_scene;
+
+		auto execute = [&scene, queries, hits](uint first, uint last)
+		{
+			for (uint i = first; i < last; ++i)
 			{
-				cc.m_node	 = body->m_node;
-				cc.m_gameObj = body->m_owner->m_gameObj;
-				cc.m_physObj = body->m_owner->m_physObj;
+				executeQuery(scene, queries[i], hits[i]);
 			}
+		};
 
-			return true;
+		//-- the queries are split into not more than g_queryThreads ranges executed by the job system.
+		uint numThreads = clamp<uint>(1, count / g_minQueriesPerThread, max<uint>(g_queryThreads, 1));
+		if (numThreads == 1)
+		{
+			execute(0, count);
+			return;
 		}
 
-		return false;
+		Engine::instance().jobSystem().parallelFor(count, (count + numThreads - 1) / numThreads, execute);
+	}
+
+	//-- Measures throughput of the batched scene queries against the current scene. Queries are
+	//-- randomly distributed inside the 200 meters area around the origin.
+	//-- Usage: +phys_query_benchmark 10000 in the command line.
+	//----------------------------------------------------------------------------------------------
+	int PhysicsWorld::_queryBenchmark(int queriesCount)
+	{
+		const uint	iterations = 16;
+		const float extent	   = 100.0f;
+		const uint	count	   = clamp(1, queriesCount, 1000000);
+
+		SceneQueryBatch batch(count);
+
+		srand(0);
+		for (uint i = 0; i < count; ++i)
+		{
+			vec3f start(randomFloat(-extent, extent), randomFloat(0.0f, 10.0f), randomFloat(-extent, extent));
+			vec3f end(randomFloat(-extent, extent), randomFloat(0.0f, 10.0f), randomFloat(-extent, extent));
+
+			switch (i % 3)
+			{
+			case 0: batch.raycast(start, end);		 break;
+			case 1: batch.sweep(start, end, 0.5f);	 break;
+			case 2: batch.overlap(start, 2.0f);		 break;
+			}
+		}
+
+		uint queryThreads = g_queryThreads;
+		uint threads[2]	  = { 1, max<uint>(queryThreads, 1) };
+		for (uint t = 0; t < 2; ++t)
+		{
+			g_queryThreads = threads[t];
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < iterations; ++i)
+			{
+				executeQueries(batch);
+			}
+			float time = ((SDL_GetPerformanceCounter() - startTime) * 1000.0f) / (SDL_GetPerformanceFrequency() * iterations);
+
+			uint hitsCount = 0;
+			for (uint i = 0; i < batch.count(); ++i)
+			{
+				hitsCount += batch.hit(i).m_hit;
+			}
+
+			INFO_MSG("Physics queries: %d queries, %d threads, %d hits, %.3f ms, %.2f queries/us.",
+				count, threads[t], hitsCount, time, count / (time * 1000.0f)
+				);
+		}
+		g_queryThreads = queryThreads;
+
+		return 0;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	SceneQueryBatch::SceneQueryBatch(uint capacity) : m_capacity(capacity)
+	{
+		m_queries.reserve(capacity);
+		m_hits.resize(capacity);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	SceneQueryBatch::~SceneQueryBatch()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool SceneQueryBatch::raycast(const vec3f& start, const vec3f& end, uint groupMask)
+	{
+		return add(QUERY_RAYCAST, start, end, 0.0f, groupMask);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool SceneQueryBatch::sweep(const vec3f& start, const vec3f& end, float radius, uint groupMask)
+	{
+		return add(QUERY_SWEEP, start, end, radius, groupMask);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool SceneQueryBatch::overlap(const vec3f& center, float radius, uint groupMask)
+	{
+		return add(QUERY_OVERLAP, center, center, radius, groupMask);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool SceneQueryBatch::add(EQueryType type, const vec3f& start, const vec3f& end, float radius, uint groupMask)
+	{
+		if (m_queries.size() >= m_capacity)
+			return false;
+
+		Query query;
+		query.m_type	  = type;
+		query.m_start	  = start;
+		query.m_dir		  = end - start;
+		query.m_distance  = query.m_dir.length();
+		query.m_radius	  = radius;
+		query.m_groupMask = groupMask;
+
+		//-- PhysX requires the valid unit direction even for the zero distance.
+		if (query.m_distance > 0.0f)	query.m_dir.normalize();
+		else							query.m_dir = vec3f(0.0f, -1.0f, 0.0f);
+
+		m_queries.push_back(query);
+		return true;
 	}
 
 	//----------------------------------------------------------------------------------------------
-	PhysicsObjectType::PhysicsObjectType()
+	PhysicsObjectType::PhysicsObjectType() : m_group(0)
 	{
 
 	}
@@ -317,6 +911,21 @@ namespace physics
 		//-- check root element.
 		auto root = doc.document_element();
 
+		m_group = root.attribute("group").as_uint(0);
+		if (m_group >= 32)
+		{
+			ERROR_MSG("Invalid query group %d of the physics object.", m_group);
+			return false;
+		}
+
+		//-- read <lod> section.
+		if (auto lod = root.child("lod"))
+		{
+			m_lodDesc.m_reducedDist		  = lod.attribute("reducedDistance").as_float();
+			m_lodDesc.m_sleepDist		  = lod.attribute("sleepDistance").as_float();
+			m_lodDesc.m_reducedIterations = lod.attribute("reducedIterations").as_uint(1);
+		}
+
 		//-- ToDo: default material
 		m_materials.emplace_back(PxGetPhysics().createMaterial(0.5f, 0.5f, 0.5f));
 
@@ -380,6 +989,7 @@ namespace physics
 					}
 
 					pxShape->setLocalPose(localTransform);
+					pxShape->setQueryFilterData(PxFilterData(1 << m_group, 0, 0, 0));
 
 					//-- add new shape to cache.
 					m_shapes.push_back(pxShape);
@@ -422,6 +1032,7 @@ namespace physics
 		//-- 1. set transform.
 		instance->m_gameObj   = gameObj;
 		instance->m_transform = transform;
+		instance->m_lodDesc	  = &m_lodDesc;
 			
 		//-- 2. create all rigid bodies.
 		for (const auto& desc : m_rigidBodyDescs)
@@ -436,6 +1047,8 @@ namespace physics
 			body->m_actor->userData = body.get();
 			body->m_actor->attachShape(*m_shapes[desc.m_shapeIdx]);
 			body->m_actor->setRigidBodyFlag(PxRigidBodyFlag::eKINEMATIC, desc.m_isKinematic);
+			body->m_actor->setSolverIterationCounts(g_fullPosIterations, g_fullVelIterations);
+			body->m_prevPose = body->m_currPose = body->m_actor->getGlobalPose();
 
 			PxRigidBodyExt::updateMassAndInertia(*body->m_actor, 10.0f);
 
@@ -522,7 +1135,8 @@ namespace physics
 
 	//----------------------------------------------------------------------------------------------
 	PhysicsObjectType::RigidBody::RigidBody()
-		: m_name(nullptr), m_node(nullptr), m_owner(nullptr), m_actor(nullptr)
+		:	m_name(nullptr), m_node(nullptr), m_owner(nullptr), m_actor(nullptr),
+			m_prevPose(PxIdentity), m_currPose(PxIdentity), m_lastStep(0), m_isMoving(false)
 	{
 
 	}
@@ -550,50 +1164,306 @@ namespace physics
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void PhysicsWorld::updateGraphicsTransforms()
+	void PhysicsWorld::stepSimulation(float dt)
+	{
+		m_scene->simulate(dt);
+		m_scene->fetchResults(true);
+
+		++m_stepIndex;
+		gatherActivePoses(*m_scene, m_movingBodies);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint PhysicsWorld::gatherActivePoses(PxScene& scene, std::vector<PhysicsObjectType::RigidBody*>& moving)
 	{
-		// retrieve array of actors that moved
+		//-- retrieve array of actors that moved. Sleeping actors aren't reported, so the cost is
+		//-- proportional to the count of the active ones. The array is owned by the scene.
 		PxU32 nbActiveTransforms = 0;
-		auto* activeTransforms = m_scene->getActiveTransforms(nbActiveTransforms);
+		auto* activeTransforms = scene.getActiveTransforms(nbActiveTransforms);
 
-		// update each render object with the new transform
 		for (PxU32 i = 0; i < nbActiveTransforms; ++i)
 		{
 			auto& entry = activeTransforms[i];
 			auto* body  = static_cast<PhysicsObjectType::RigidBody*>(entry.userData);
-			body->m_node->matrix(physx2bruge(entry.actor2World));
+
+			//-- kinematic bodies follow the animation, which already owns theirs nodes (e.g. bones
+			//-- of the ragdoll alias the world palette of the mesh instance), so writing the pose
+			//-- back would only overwrite the current animation with the one of the last step.
+			if (body->m_actor->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
+				continue;
+
+			body->m_prevPose = body->m_currPose;
+			body->m_currPose = entry.actor2World;
+			body->m_lastStep = m_stepIndex;
+
+			if (!body->m_isMoving)
+			{
+				body->m_isMoving = true;
+				moving.push_back(body);
+			}
+		}
+
+		return nbActiveTransforms;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::updateGraphicsTransforms(std::vector<PhysicsObjectType::RigidBody*>& moving, float alpha)
+	{
+		alpha = clamp(0.0f, alpha, 1.0f);
+
+		for (uint i = 0; i < moving.size(); )
+		{
+			auto* body = moving[i];
+
+			const auto& aabb   = body->m_actor->getWorldBounds();
+			AABB		bounds = AABB(physx2bruge(aabb.minimum), physx2bruge(aabb.maximum));
+
+			//-- body came to rest during the last step, so put it exactly to its final pose.
+			if (body->m_lastStep != m_stepIndex)
+			{
+				body->m_node->matrix(physx2bruge(body->m_currPose));
+				body->m_isMoving = false;
+
+				moving[i] = moving.back();
+				moving.pop_back();
+			}
+			else
+			{
+				PxTransform pose = lerp(body->m_prevPose, body->m_currPose, alpha);
+				body->m_node->matrix(physx2bruge(pose));
+
+				//-- bounds of the actor are the ones of the last step, so move them to the drawn pose.
+				//-- With the rotation it's a bit bigger than the exact one, but it never lags behind.
+				bounds = bounds.getTranformed(physx2bruge(pose * body->m_currPose.getInverse()));
+				++i;
+			}
 
 			//-- update AABB.
 			//-- ToDo: optimize.
+			body->m_owner->m_transform->m_worldBounds = bounds;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::removeMovingBody(PhysicsObjectType::RigidBody* body)
+	{
+		if (!body->m_isMoving)
+			return;
+
+		auto iter = std::find(m_movingBodies.begin(), m_movingBodies.end(), body);
+		if (iter != m_movingBodies.end())
+		{
+			*iter = m_movingBodies.back();
+			m_movingBodies.pop_back();
+		}
+		body->m_isMoving = false;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::updatePhysicsTransforms()
+	{
+		for (auto* body : m_kinematicBodies)
+		{
+			body->m_prevPose = body->m_currPose;
+			body->m_currPose = bruge2physx(body->m_node->matrix());
+		}
+	}
+
+	//-- t is the part of the frame's motion of the kinematic bodies done by the end of the step.
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::setKinematicTargets(float t)
+	{
+		for (auto* body : m_kinematicBodies)
+		{
+			body->m_actor->setKinematicTarget(lerp(body->m_prevPose, body->m_currPose, t));
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::updateLods()
+	{
+		g_lodReducedCount = 0;
+		g_lodSleepCount	  = 0;
+
+		for (const auto& instance : m_physObjs)
+		{
+			if (!instance)
+				continue;
+
+			const auto& desc = *instance->m_lodDesc;
+
+			//-- 1. select the new LOD. Promotion happens a bit closer than demotion.
+			PhysicsObjectType::ELod lod = PhysicsObjectType::LOD_FULL;
+			if (g_lodEnabled)
 			{
-				const auto& aabb = entry.actor->getWorldBounds();
-				body->m_owner->m_transform->m_worldBounds = AABB(physx2bruge(aabb.minimum), physx2bruge(aabb.maximum));
+				float dist	 = (instance->m_transform->m_worldBounds.getCenter() - m_observer).length();
+				float sleep	 = desc.m_sleepDist   * g_lodDistScale;
+				float reduce = desc.m_reducedDist * g_lodDistScale;
+
+				if (sleep > 0.0f && dist > sleep * (instance->m_lod == PhysicsObjectType::LOD_SLEEP ? g_lodHysteresis : 1.0f))
+					lod = PhysicsObjectType::LOD_SLEEP;
+				else if (reduce > 0.0f && dist > reduce * (instance->m_lod != PhysicsObjectType::LOD_FULL ? g_lodHysteresis : 1.0f))
+					lod = PhysicsObjectType::LOD_REDUCED;
 			}
+
+			g_lodReducedCount += (lod == PhysicsObjectType::LOD_REDUCED);
+			g_lodSleepCount	  += (lod == PhysicsObjectType::LOD_SLEEP);
+
+			if (lod == instance->m_lod)
+				continue;
+
+			//-- 2. apply it to the dynamic bodies. Kinematic ones are driven by the animation.
+			for (const auto& body : instance->m_bodies)
+			{
+				auto* actor = body->m_actor;
+				if (actor->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
+					continue;
+
+				if (lod == PhysicsObjectType::LOD_FULL)
+					actor->setSolverIterationCounts(g_fullPosIterations, g_fullVelIterations);
+				else
+					actor->setSolverIterationCounts(max<uint>(desc.m_reducedIterations, 1), 1);
+
+				if (lod == PhysicsObjectType::LOD_SLEEP)
+					actor->putToSleep();
+				else if (instance->m_lod == PhysicsObjectType::LOD_SLEEP)
+					actor->wakeUp();
+			}
+
+			instance->m_lod = lod;
 		}
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void PhysicsWorld::updatePhysicsTransforms()
+	void PhysicsWorld::addKinematicBody(PhysicsObjectType::RigidBody* body)
 	{
-		PxU32 nbActors = m_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC);
-		if (nbActors)
+		if (std::find(m_kinematicBodies.begin(), m_kinematicBodies.end(), body) == m_kinematicBodies.end())
 		{
-			std::vector<PxRigidActor*> actors(nbActors);
-			m_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, (PxActor**)&actors[0], nbActors);
+			m_kinematicBodies.push_back(body);
+		}
 
-			for (const auto& actor : actors)
+		//-- kinematic bodies are never written back to the graphics.
+		removeMovingBody(body);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void PhysicsWorld::removeKinematicBody(PhysicsObjectType::RigidBody* body)
+	{
+		auto iter = std::find(m_kinematicBodies.begin(), m_kinematicBodies.end(), body);
+		if (iter != m_kinematicBodies.end())
+		{
+			*iter = m_kinematicBodies.back();
+			m_kinematicBodies.pop_back();
+		}
+	}
+
+	//-- Measures cost of the physics to graphics synchronization on the separate scene with the
+	//-- given count of bodies while only the part of them is awake.
+	//-- Usage: +phys_sync_benchmark 10000 in the command line.
+	//----------------------------------------------------------------------------------------------
+	int PhysicsWorld::_syncBenchmark(int bodiesCount)
+	{
+		const uint	iterations	 = 16;
+		const float dt			 = 1.0f / 60.0f;
+		const float ratios[]	 = { 0.0f, 0.01f, 0.1f, 1.0f };
+		const uint	count		 = clamp(1, bodiesCount, 100000);
+		const uint	side		 = static_cast<uint>(ceilf(sqrtf(static_cast<float>(count))));
+
+		//-- zero gravity keeps the sleeping bodies asleep and the awaken ones moving.
+		PxSceneDesc sceneDesc(m_physics->getTolerancesScale());
+		sceneDesc.gravity		= PxVec3(0.0f, 0.0f, 0.0f);
+		sceneDesc.cpuDispatcher = m_dispatcher;
+		sceneDesc.filterShader	= PxDefaultSimulationFilterShader;
+		sceneDesc.flags			= PxSceneFlag::eENABLE_ACTIVETRANSFORMS;
+
+		PxScene*	scene	 = m_physics->createScene(sceneDesc);
+		PxMaterial* material = m_physics->createMaterial(0.5f, 0.5f, 0.5f);
+		PxShape*	shape	 = m_physics->createShape(PxSphereGeometry(0.5f), *material);
+
+		shape->setQueryFilterData(PxFilterData(1, 0, 0, 0));
+
+		//-- bodies on the grid, so they don't touch each other.
+		std::vector<mat4f>					matrices(count);
+		Transform							transform;
+		PhysicsObjectType::Instance			instance;
+
+		//-- the bodies are interpolated separately from the world's ones.
+		std::vector<PhysicsObjectType::RigidBody*> moving;
+		uint stepIndex = m_stepIndex;
+
+		instance.m_transform = &transform;
+		for (uint i = 0; i < count; ++i)
+		{
+			matrices[i].setTranslation(2.0f * (i % side), 0.0f, 2.0f * (i / side));
+			transform.m_nodes.push_back(std::make_unique<Node>("body", matrices[i]));
+
+			auto body = std::make_unique<PhysicsObjectType::RigidBody>();
+			body->m_name	= "body";
+			body->m_node	= transform.m_nodes.back().get();
+			body->m_owner	= &instance;
+			body->m_actor	= m_physics->createRigidDynamic(PxTransform(bruge2physx(matrices[i])));
+
+			body->m_actor->userData = body.get();
+			body->m_actor->attachShape(*shape);
+			PxRigidBodyExt::updateMassAndInertia(*body->m_actor, 10.0f);
+
+			instance.m_bodies.push_back(std::move(body));
+		}
+		instance.enterScene(scene);
+
+		//-- measure.
+		for (float ratio : ratios)
+		{
+			uint awake = static_cast<uint>(count * ratio);
+			for (uint i = 0; i < count; ++i)
 			{
-				if (auto* rigidDynamic = actor->isRigidDynamic())
+				auto* actor = instance.m_bodies[i]->m_actor;
+				if (i < awake)
 				{
-					if (rigidDynamic->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC)
-					{
-						auto* body    = static_cast<PhysicsObjectType::RigidBody*>(actor->userData);
-
-						rigidDynamic->setKinematicTarget(bruge2physx(body->m_node->matrix()));
-					}
+					actor->setLinearVelocity(PxVec3(0.0f, 1.0f, 0.0f));
+					actor->wakeUp();
 				}
+				else
+				{
+					actor->putToSleep();
+				}
+			}
+
+			//-- the first step reports all the bodies which changed their state.
+			scene->simulate(dt);
+			scene->fetchResults(true);
+			++m_stepIndex;
+			gatherActivePoses(*scene, moving);
+			updateGraphicsTransforms(moving, 0.5f);
+
+			uint64 time	  = 0;
+			uint   synced = 0;
+			for (uint i = 0; i < iterations; ++i)
+			{
+				scene->simulate(dt);
+				scene->fetchResults(true);
+				++m_stepIndex;
+
+				uint64 startTime = SDL_GetPerformanceCounter();
+				synced += gatherActivePoses(*scene, moving);
+				updateGraphicsTransforms(moving, 0.5f);
+				time   += SDL_GetPerformanceCounter() - startTime;
 			}
+
+			INFO_MSG("Physics sync: %d bodies, %d awake, %d synced per step, %.3f ms.",
+				count, awake, synced / iterations, (time * 1000.0f) / (SDL_GetPerformanceFrequency() * iterations)
+				);
 		}
+
+		m_stepIndex = stepIndex;
+
+		instance.leaveScene(scene);
+		instance.m_bodies.clear();
+		shape->release();
+		material->release();
+		scene->release();
+
+		return 0;
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 #include "prerequisites.hpp"
 #include "utils/Data.hpp"
+#include "math/Vector2.hpp"
 #include "math/Vector3.hpp"
 
 #include "PhysX/PxPhysicsAPI.h"
@@ -25,6 +26,28 @@ namespace physics
 
 		struct Instance;
 
+		//-- Level of detail of the simulation. Dynamic bodies farther than m_reducedDist from the
+		//-- observer are solved with the reduced count of iterations and farther than m_sleepDist are
+		//-- put to sleep. PhysX wakes sleeping bodies up on contact with the awake ones, bodies put to
+		//-- sleep by LOD are also woken up when the observer comes closer. Zero distance disables
+		//-- the corresponding level. Read from the <lod> element of *.phys file.
+		//------------------------------------------------------------------------------------------
+		struct LodDesc
+		{
+			LodDesc() : m_reducedDist(0.0f), m_sleepDist(0.0f), m_reducedIterations(1) { }
+
+			float m_reducedDist;
+			float m_sleepDist;
+			uint  m_reducedIterations;
+		};
+
+		enum ELod
+		{
+			LOD_FULL,
+			LOD_REDUCED,
+			LOD_SLEEP
+		};
+
 		//------------------------------------------------------------------------------------------
 		class RigidBody
 		{
@@ -61,6 +84,14 @@ namespace physics
 			Node*					m_node;
 			Instance*				m_owner;
 			physx::PxRigidDynamic*	m_actor;
+
+			//-- poses at the end of the two last fixed steps the body moved in. Used to interpolate
+			//-- the graphics transform between them. Kinematic bodies keep here the animation poses
+			//-- of the two last simulated frames, theirs targets are interpolated between them.
+			physx::PxTransform		m_prevPose;
+			physx::PxTransform		m_currPose;
+			uint					m_lastStep;
+			bool					m_isMoving;
 		};
 
 		//------------------------------------------------------------------------------------------
@@ -88,7 +119,7 @@ namespace physics
 		//------------------------------------------------------------------------------------------
 		struct Instance
 		{
-			Instance() : m_gameObj(CONST_INVALID_HANDLE), m_physObj(CONST_INVALID_HANDLE), m_transform(nullptr) { }
+			Instance() : m_gameObj(CONST_INVALID_HANDLE), m_physObj(CONST_INVALID_HANDLE), m_transform(nullptr), m_lodDesc(nullptr), m_lod(LOD_FULL) { }
 			~Instance() { }
 
 			void		enterScene(physx::PxScene* scene);
@@ -99,6 +130,8 @@ namespace physics
 			Handle									m_physObj;
 			Handle									m_gameObj;
 			Transform*								m_transform;
+			const LodDesc*							m_lodDesc;
+			ELod									m_lod;
 			std::vector<std::unique_ptr<RigidBody>>	m_bodies;
 			std::vector<std::unique_ptr<Joint>>		m_joints;
 		};
@@ -110,7 +143,12 @@ namespace physics
 		bool						load(const utils::ROData& desc);
 		std::unique_ptr<Instance>	createInstance(Transform* transform, Handle gameObj);
 
+		//-- query group of the type set by the "group" attribute of the root element. [0, 31].
+		uint						group() const { return m_group; }
+
 	private:
+		uint									m_group;
+		LodDesc									m_lodDesc;
 		std::vector<RigidBody::Desc>			m_rigidBodyDescs;
 		std::vector<Joint::Desc>				m_jointDescs;
 		std::vector<physx::PxShape*>			m_shapes;
@@ -118,6 +156,72 @@ namespace physics
 	};
 
 
+	//-- Batch of the scene queries. Queries are written into the buffer preallocated for the given
+	//-- capacity and executed all at once by PhysicsWorld::executeQueries(). Hits are stored into the
+	//-- contiguous array in order of submission. Group mask selects the physics object types by their
+	//-- group, i.e. the type is tested if (groupMask & (1 << type.group())) != 0.
+	//----------------------------------------------------------------------------------------------
+	class SceneQueryBatch : public NonCopyable
+	{
+	public:
+		static const uint ALL_GROUPS	= 0xffffffff;
+		static const uint TERRAIN_GROUP = 31;
+
+		enum EQueryType
+		{
+			QUERY_RAYCAST,
+			QUERY_SWEEP,	//-- sphere sweep.
+			QUERY_OVERLAP	//-- sphere overlap. Reports any of the overlapped objects.
+		};
+
+		struct Query
+		{
+			EQueryType	m_type;
+			vec3f		m_start;
+			vec3f		m_dir;
+			float		m_distance;
+			float		m_radius;
+			uint		m_groupMask;
+		};
+
+		struct Hit
+		{
+			Hit() : m_hit(false), m_distance(0.0f), m_gameObj(CONST_INVALID_HANDLE), m_physObj(CONST_INVALID_HANDLE), m_node(nullptr) { }
+
+			bool	m_hit;
+			vec3f	m_wPos;
+			vec3f	m_wNormal;
+			float	m_distance;
+			Handle	m_gameObj;
+			Handle	m_physObj;
+			Node*	m_node;
+		};
+
+	public:
+		SceneQueryBatch(uint capacity);
+		~SceneQueryBatch();
+
+		//-- return false if the batch is full.
+		bool				raycast(const vec3f& start, const vec3f& end, uint groupMask = ALL_GROUPS);
+		bool				sweep(const vec3f& start, const vec3f& end, float radius, uint groupMask = ALL_GROUPS);
+		bool				overlap(const vec3f& center, float radius, uint groupMask = ALL_GROUPS);
+
+		void				clear()					{ m_queries.clear(); }
+		uint				count() const			{ return m_queries.size(); }
+		const Hit&			hit(uint idx) const		{ return m_hits[idx]; }
+		const Hit*			hits() const			{ return m_hits.data(); }
+
+	private:
+		bool				add(EQueryType type, const vec3f& start, const vec3f& end, float radius, uint groupMask);
+
+		friend class PhysicsWorld;
+
+		uint				m_capacity;
+		std::vector<Query>	m_queries;
+		std::vector<Hit>	m_hits;
+	};
+
+
 	//--
 	//----------------------------------------------------------------------------------------------
 	class PhysicsWorld : public NonCopyable
@@ -141,15 +245,35 @@ namespace physics
 
 		bool		init();
 
-		//-- simulate rigid body dynamics.
-		void		simulate(float dt);
+		//-- simulate rigid body dynamics. The step is split in two parts, so the simulation runs on
+		//-- the worker threads while the main thread does the work independent from its results.
+		//-- Kinematic targets are taken from the previous frame's animation and spread over the
+		//-- fixed steps of the frame. The frame time is accumulated and simulated with the fixed
+		//-- steps. Only the last of them runs in parallel, the others are done in place. Graphics
+		//-- transforms are interpolated between the two last steps by the time remaining in the
+		//-- accumulator.
+		void		beginSimulate(float dt);
+		void		endSimulate();
+		void		simulate(float dt) { beginSimulate(dt); endSimulate(); }
+
+		//-- position the simulation LOD is calculated against, usually the camera position.
+		void		setObserver(const vec3f& pos) { m_observer = pos; }
+
+		//-- Note: the functions writing to the scene or its actors below may be called only out of
+		//-- the beginSimulate()/endSimulate() window, e.g. not during the animation.
 
 		//-- add new object to the collision world.
 		Handle		createPhysicsObject(const char* desc, Transform* transform, Handle gameObj);
 		void		removePhysicsObject(Handle physObj);
 
-		//-- add terrain mesh to the physics world.
-		bool		createTerrainPhysicsObject(uint gridSize, float unitsPerCell, float* heights, float heightScale, float minHeight, float maxHeight);
+		//-- add terrain to the physics world. Heights are the row-major table of gridSize x gridSize
+		//-- samples and origin is the world XZ position of the first one. The table has to be alive
+		//-- until the terrain is removed. Terrain is split into the tiles of tileSize cells, which are
+		//-- created on demand around the physics objects and the observer and released when unused.
+		bool		createTerrainPhysicsObject(
+						uint gridSize, uint tileSize, float unitsPerCell, const float* heights, const vec2f& origin,
+						float minHeight, float maxHeight
+						);
 		bool		removeTerrainPhysicsObject();
 
 		//-- ToDo: for testing only
@@ -157,14 +281,64 @@ namespace physics
 
 		void		addImpulse(Handle physObj, const vec3f& impulse, const vec3f& worldPos);
 
-		bool		collide(CollisionCallback& cc, const vec3f& start, const vec3f& end) const;
+		bool		collide(CollisionCallback& cc, const vec3f& start, const vec3f& end, uint groupMask = SceneQueryBatch::ALL_GROUPS) const;
+
+		//-- execute all the queries of the batch splitting them across the worker threads. While the
+		//-- scene is simulating queries see its state before the current step.
+		void		executeQueries(SceneQueryBatch& batch) const;
+
+		//-- console functions.
+		int			_syncBenchmark(int bodiesCount);
+		int			_queryBenchmark(int queriesCount);
+		int			_terrainBenchmark();
 
 	private:
-		void		updateGraphicsTransforms();
+		//-- store poses of the bodies moved during the last step and add them to the moving list.
+		//-- Returns count of the moved bodies.
+		uint		gatherActivePoses(physx::PxScene& scene, std::vector<PhysicsObjectType::RigidBody*>& moving);
+		void		updateGraphicsTransforms(std::vector<PhysicsObjectType::RigidBody*>& moving, float alpha);
+		void		stepSimulation(float dt);
 		void		updatePhysicsTransforms();
+		void		setKinematicTargets(float t);
+		void		updateLods();
 		void		debugDraw();
 
+		void		addKinematicBody(PhysicsObjectType::RigidBody* body);
+		void		removeKinematicBody(PhysicsObjectType::RigidBody* body);
+		void		removeMovingBody(PhysicsObjectType::RigidBody* body);
+
+		void					updateTerrainTiles();
+		void					useTerrainTiles(const vec3f& minPos, const vec3f& maxPos);
+		physx::PxHeightField*	createTerrainHeightField(uint firstX, uint firstZ) const;
+
 	private:
+		struct TerrainTile
+		{
+			TerrainTile() : m_actor(nullptr), m_heightField(nullptr), m_lastUsed(0) { }
+
+			physx::PxRigidStatic*	m_actor;
+			physx::PxHeightField*	m_heightField;
+			uint					m_lastUsed; //-- frame index of the last use.
+		};
+
+		struct Terrain
+		{
+			Terrain()
+				:	m_heights(nullptr), m_gridSize(0), m_tileSize(0), m_tilesCount(0), m_unitsPerCell(1.0f),
+					m_heightScale(1.0f), m_origin(0, 0), m_material(nullptr), m_frame(0) { }
+
+			const float*				m_heights;
+			uint						m_gridSize;
+			uint						m_tileSize;
+			uint						m_tilesCount; //-- per side.
+			float						m_unitsPerCell;
+			float						m_heightScale;
+			vec2f						m_origin;
+			physx::PxMaterial*			m_material;
+			std::vector<TerrainTile>	m_tiles;
+			uint						m_frame;
+		};
+
 		physx::PxFoundation*					m_foundation;
 		physx::PxPhysics*						m_physics;
 		physx::PxScene*							m_scene;
@@ -172,8 +346,17 @@ namespace physics
 		physx::PxDefaultAllocator				m_allocator;
 		physx::PxDefaultErrorCallback			m_errorCallback;
 		physx::PxVisualDebuggerConnection*		m_debuggerConnection;
+		bool									m_isSimulating;
+		uint64									m_kickTime;
+		vec3f									m_observer;
+		float									m_accumulator;
+		uint									m_stepIndex;
+		uint64									m_stepTime;
+		Terrain									m_terrain;
 
 		std::vector<std::unique_ptr<PhysicsObjectType::Instance>>			m_physObjs;
+		std::vector<PhysicsObjectType::RigidBody*>							m_kinematicBodies;
+		std::vector<PhysicsObjectType::RigidBody*>							m_movingBodies;
 		std::unordered_map<std::string, std::unique_ptr<PhysicsObjectType>>	m_physObjTypes;
 	};
 
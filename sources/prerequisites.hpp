@@ -55,7 +55,4 @@ const Handle CONST_INVALID_HANDLE = -1;
 #define ConWarning
 #define ConError
 
-#define REGISTER_CONSOLE_VALUE(m_name, type, value)
-#define REGISTER_CONSOLE_MEMBER_VALUE(m_name, type, value, className)
-#define REGISTER_CONSOLE_FUNC(m_name, func)
-#define REGISTER_CONSOLE_METHOD(m_name, func, className)
+//-- Note: console registration macros live in console/Console.h.
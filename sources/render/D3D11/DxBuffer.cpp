@@ -166,5 +166,22 @@ namespace render
 		dxDevice().immediateContext()->Unmap(m_bufferResource, 0);
 	}	
 
+	//------------------------------------------
+	void DXBuffer::doUpdate(const void* data, uint offset, uint size)
+	{
+		//-- Note: constant buffers can't be updated partially.
+		assert(m_usage == USAGE_DEFAULT && m_type != TYPE_UNIFORM && "Buffer can't be updated partially.");
+
+		D3D11_BOX box;
+		box.left   = offset;
+		box.right  = offset + size;
+		box.top	   = 0;
+		box.bottom = 1;
+		box.front  = 0;
+		box.back   = 1;
+
+		dxDevice().immediateContext()->UpdateSubresource(m_bufferResource, 0, &box, data, 0, 0);
+	}
+
 } // render
 } // brUGE
\ No newline at end of file
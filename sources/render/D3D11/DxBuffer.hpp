@@ -18,6 +18,7 @@ namespace render
 		//-- ToDo: take into account pitch and padding
 		virtual void* doMap(EAccess flag);
 		virtual void  doUnmap();
+		virtual void  doUpdate(const void* data, uint offset, uint size);
 		
 		bool init(const void* data, uint elemCount, uint elemSize);
 		ID3D11Buffer* getBuffer() const { return m_buffer.get(); }
@@ -1,6 +1,7 @@
 #include "DxRenderDevice.hpp"
 #include "DxBuffer.hpp"
 #include "DxShader.hpp"
+#include <cstring>
 
 using namespace brUGE::utils;
 using namespace brUGE::render;
@@ -85,7 +86,7 @@ namespace render
 	//------------------------------------------
 	DXRenderDevice::DXRenderDevice() : m_dxgiSwapChain(NULL)
 	{
-
+		_resetBoundBuffers();
 	}
 
 	//------------------------------------------
@@ -265,6 +266,17 @@ namespace render
 		// ToDo:
 		DXShader::resetToDefaults();
 		m_dxDevice.immediateContext()->ClearState();
+		_resetBoundBuffers();
+	}
+
+	//------------------------------------------
+	void DXRenderDevice::_resetBoundBuffers()
+	{
+		m_dxBoundIB				= NULL;
+		m_dxBoundIBFormat		= DXGI_FORMAT_UNKNOWN;
+		m_dxBoundVBStreamsCount	= 0;
+		m_dxBoundVBStreams.fill(NULL);
+		m_dxBoundVBStreamsOffsets.fill(0);
 	}
 
 	//------------------------------------------
@@ -361,10 +373,19 @@ namespace render
 			c->IASetInputLayout(m_dxVertLayouts[m_curVertLayout]);
 			c->IASetPrimitiveTopology(dxPrimTopology[topology]);
 
+			//-- Note: geometry of the most meshes lives in the shared heaps of the geometry pool, so the
+			//--	   consecutive draw calls usually use the same buffers.
 			if (indexed)
 			{
-				c->IASetIndexBuffer(static_cast<DXBuffer*>(m_curIB)->getBuffer(),
-					(m_curIB->getElemSize() == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+				ID3D11Buffer* ib	 = static_cast<DXBuffer*>(m_curIB)->getBuffer();
+				DXGI_FORMAT	  format = (m_curIB->getElemSize() == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+				if (ib != m_dxBoundIB || format != m_dxBoundIBFormat)
+				{
+					c->IASetIndexBuffer(ib, format, 0);
+					m_dxBoundIB		  = ib;
+					m_dxBoundIBFormat = format;
+				}
 			}
 
 			for (uint i = 0; i < MAX_VERTEX_STREAMS; ++i)
@@ -377,8 +398,19 @@ namespace render
 					m_dxCurVBStreamsStrides[i] = vbs.buffer->getElemSize();
 				}
 			}
-			c->IASetVertexBuffers(0, m_curVBStreamsCount, &m_dxCurVBStreams[0],
-				&m_dxCurVBStreamsStrides[0], &m_dxCurVBStreamsOffsets[0]);
+
+			if (	m_curVBStreamsCount != m_dxBoundVBStreamsCount
+				||	memcmp(&m_dxCurVBStreams[0], &m_dxBoundVBStreams[0], sizeof(ID3D11Buffer*) * m_curVBStreamsCount) != 0
+				||	memcmp(&m_dxCurVBStreamsOffsets[0], &m_dxBoundVBStreamsOffsets[0], sizeof(UINT) * m_curVBStreamsCount) != 0
+				)
+			{
+				c->IASetVertexBuffers(0, m_curVBStreamsCount, &m_dxCurVBStreams[0],
+					&m_dxCurVBStreamsStrides[0], &m_dxCurVBStreamsOffsets[0]);
+
+				m_dxBoundVBStreamsCount	  = m_curVBStreamsCount;
+				m_dxBoundVBStreams		  = m_dxCurVBStreams;
+				m_dxBoundVBStreamsOffsets = m_dxCurVBStreamsOffsets;
+			}
 		}
 	
 		//-- 4. set shader program.
@@ -55,6 +55,7 @@ namespace render
 
 	private:
 		void _drawCommon(EPrimitiveTopology topology, bool indexed = true);
+		void _resetBoundBuffers();
 
 	private:
 		typedef std::vector<ComPtr<ID3D11DepthStencilState> > DepthStencilStates;
@@ -78,6 +79,13 @@ namespace render
 		std::array<UINT, MAX_VERTEX_STREAMS>		 	m_dxCurVBStreamsStrides;
 		std::array<UINT, MAX_VERTEX_STREAMS>		 	m_dxCurVBStreamsOffsets;
 
+		//-- buffers which are really bound to the input assembler. Used to skip redundant rebinding.
+		ID3D11Buffer*									m_dxBoundIB;
+		DXGI_FORMAT										m_dxBoundIBFormat;
+		uint											m_dxBoundVBStreamsCount;
+		std::array<ID3D11Buffer*, MAX_VERTEX_STREAMS>	m_dxBoundVBStreams;
+		std::array<UINT, MAX_VERTEX_STREAMS>		 	m_dxBoundVBStreamsOffsets;
+
 		std::unique_ptr<DXShaderIncludes>				m_shaderIncludes;
 
 		static DXDevice									m_dxDevice;
@@ -6,8 +6,11 @@
 #include "state_objects.h"
 #include "os/FileSystem.h"
 #include "console/TimingPanel.h"
+#include "console/Console.h"
 #include "loader/ResourcesManager.h"
 #include "gui/imgui/imgui.h"
+#include "engine/Engine.h"
+#include "engine/frame_memory.hpp"
 
 using namespace brUGE::os;
 using namespace brUGE::math;
@@ -108,6 +111,7 @@ namespace render
 	{
 		if (!m_isEnabled) return;
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_vertices.push_back(VertDesc(start, color.toVec4()));
 		m_vertices.push_back(VertDesc(end,	 color.toVec4()));
 	}
@@ -237,6 +241,8 @@ namespace render
 		vec3f v7 = orient.applyToPoint(far_p - up_far + side_far);
 		vec3f v8 = orient.applyToPoint(far_p + up_far + side_far);
 
+		std::lock_guard<std::mutex> lock(m_mutex);
+
 		//  .
 		m_vertices.push_back(VertDesc(v1, color.toVec4()));
 		m_vertices.push_back(VertDesc(v2, color.toVec4()));
@@ -344,6 +350,7 @@ namespace render
 		data.m_text  = text;
 		data.m_color = color;
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_textDataVec.push_back(data);
 	}
 
@@ -355,6 +362,7 @@ namespace render
 		MeshInstance instance(world, color);
 		instance.m_world.preScale(size);
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_meshCaches[MT_BOX][drawType].push_back(instance);
 	}
 
@@ -366,6 +374,7 @@ namespace render
 		MeshInstance instance(world, color);
 		instance.m_world.preScale(radius, halfHeight * 2.0f, radius);
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_meshCaches[MT_CYLINDER][drawType].push_back(instance);
 	}
 
@@ -377,6 +386,7 @@ namespace render
 		MeshInstance instance(world, color);
 		instance.m_world.preScale(radius, radius, radius);
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_meshCaches[MT_SPHERE][drawType].push_back(instance);
 	}
 
@@ -388,6 +398,7 @@ namespace render
 		MeshInstance instance(world, color);
 		instance.m_world.preScale(radius, radius, radius);
 
+		std::lock_guard<std::mutex> lock(m_mutex);
 		m_meshCaches[MT_HEMISPHERE][drawType].push_back(instance);
 	}
 
@@ -413,12 +424,12 @@ namespace render
 	//---------------------------------------------------------------------------------------------
 	void DebugDrawer::_swapBuffers()
 	{
-		if (m_vertices.empty()) return;
+		if (m_drawVertices.empty()) return;
 
 		//-- check has the GPU buffer enough memory to hold all the vertex data.
-		if (m_vertices.size() > m_VB->getElemCount())
+		if (m_drawVertices.size() > m_VB->getElemCount())
 		{
-			m_VB = rd()->createBuffer(IBuffer::TYPE_VERTEX, NULL, m_vertices.size() * 2,
+			m_VB = rd()->createBuffer(IBuffer::TYPE_VERTEX, NULL, m_drawVertices.size() * 2,
 				sizeof(VertDesc), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE);
 
 			ConWarning("[DebugDrawer] Reallocate the GPU vertex buffer to hold all the vertex data."
@@ -427,7 +438,7 @@ namespace render
 
 		if (void* vb = m_VB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
 		{
-			memcpy(vb, &m_vertices[0], sizeof(VertDesc) * m_vertices.size());
+			memcpy(vb, &m_drawVertices[0], sizeof(VertDesc) * m_drawVertices.size());
 			m_VB->unmap();
 		}
 
@@ -435,6 +446,62 @@ namespace render
 		m_wireROPs[0].m_VBs = &m_pVB;
 	}
 
+	//---------------------------------------------------------------------------------------------
+	void DebugDrawer::flush(const RenderCamera& cam)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		//-- 1. hand over the geometry. The containers are swapped to keep theirs memory.
+		m_drawVertices.swap(m_vertices);
+		m_vertices.clear();
+
+		for (uint i = 0; i < MT_COUNT; ++i)
+		{
+			for (uint j = 0; j < DT_COUNT; ++j)
+			{
+				m_drawMeshCaches[i][j].swap(m_meshCaches[i][j]);
+				m_meshCaches[i][j].clear();
+			}
+		}
+
+		//-- ToDo: reconsider.
+		//-- 2. do text drawing. Imgui is accessible only from the main thread, so do it right here.
+		{
+			if (m_isEnabled && !m_textDataVec.empty())
+			{
+				ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0, 0, 0, 0));
+				ImGui::Begin("Debug Drawer", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoInputs);
+				ImGui::GetWindowDrawList()->PushClipRectFullScreen();
+
+				for (const auto& data : m_textDataVec)
+				{
+					vec4f projPos = cam.m_viewProj.applyToPoint(data.m_pos.toVec4());
+					if (!almostZero(projPos.w) && projPos.w > 0)
+					{
+						vec2f clipPos(projPos.x / projPos.w, projPos.y / projPos.w);
+						vec2f curPos(
+							(0.5f * (1.0f + clipPos.x)) * rs().screenRes().width,
+							(0.5f * (1.0f - clipPos.y)) * rs().screenRes().height
+						);
+
+						ImGui::GetWindowDrawList()->AddText(
+							ImVec2(curPos.x, curPos.y),
+							ImGui::ColorConvertFloat4ToU32(ImVec4(data.m_color.r, data.m_color.g, data.m_color.b, data.m_color.a)),
+							data.m_text.c_str()
+							);
+					}
+				}
+
+				ImGui::GetWindowDrawList()->PopClipRect();
+				ImGui::End();
+				ImGui::PopStyleColor();
+			}
+
+			//-- clear text data list.
+			m_textDataVec.clear();
+		}
+	}
+
 	//---------------------------------------------------------------------------------------------
 	void DebugDrawer::draw()
 	{
@@ -443,13 +510,13 @@ namespace render
 		//-- 1. do solid geometry drawing.
 		{
 			//-- gather all render operations for the whole set of render passes.
-			RenderOps rops;
+			RenderOps rops(Engine::instance().frameMemory().frameAllocator<RenderOp>());
 			for (uint pass = 0; pass < DT_COUNT; ++pass)
 			{
 				//-- iterate over the hole set of mesh types.
 				for (uint type = 0; type < MT_COUNT; ++type)
 				{
-					const MeshesCache& cache = m_meshCaches[type][pass];
+					const MeshesCache& cache = m_drawMeshCaches[type][pass];
 
 					//-- check cache capacity.
 					if (!cache.empty())
@@ -483,61 +550,24 @@ namespace render
 			//-- clear caches.
 			for (uint i = 0; i < MT_COUNT; ++i)
 				for (uint j = 0; j < DT_COUNT; ++j)
-					m_meshCaches[i][j].clear();
+					m_drawMeshCaches[i][j].clear();
 		}
 		
 		//-- 2. do wire geometry drawing.
-		if (!m_vertices.empty())
+		if (!m_drawVertices.empty())
 		{
 			//-- load vertices into GPU's VB.
 			_swapBuffers();
 
 			//-- update some rop's information.
-			m_wireROPs[0].m_indicesCount = m_vertices.size();
+			m_wireROPs[0].m_indicesCount = m_drawVertices.size();
 
 			rs().beginPass(RenderSystem::PASS_DEBUG_WIRE);
 			rs().addROPs(m_wireROPs);
 			rs().endPass();
 
 			//-- clear caches.
-			m_vertices.clear();
-		}
-		
-		//-- ToDo: reconsider.
-		//-- 3. do text drawing.
-		{
-			if (!m_textDataVec.empty())
-			{
-				ImGui::PushStyleColor(ImGuiCol_WindowBg, ImVec4(0, 0, 0, 0));
-				ImGui::Begin("Debug Drawer", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoInputs);
-				ImGui::GetWindowDrawList()->PushClipRectFullScreen();
-
-				for (const auto& data : m_textDataVec)
-				{
-					vec4f projPos = rs().camera()->m_viewProj.applyToPoint(data.m_pos.toVec4());
-					if (!almostZero(projPos.w) && projPos.w > 0)
-					{
-						vec2f clipPos(projPos.x / projPos.w, projPos.y / projPos.w);
-						vec2f curPos(
-							(0.5f * (1.0f + clipPos.x)) * rs().screenRes().width,
-							(0.5f * (1.0f - clipPos.y)) * rs().screenRes().height
-						);
-
-						ImGui::GetWindowDrawList()->AddText(
-							ImVec2(curPos.x, curPos.y),
-							ImGui::ColorConvertFloat4ToU32(ImVec4(data.m_color.r, data.m_color.g, data.m_color.b, data.m_color.a)),
-							data.m_text.c_str()
-							);
-					}
-				}
-
-				ImGui::GetWindowDrawList()->PopClipRect();
-				ImGui::End();
-				ImGui::PopStyleColor();
-			}
-
-			//-- clear text data list.
-			m_textDataVec.clear();
+			m_drawVertices.clear();
 		}
 	}
 
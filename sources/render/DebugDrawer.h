@@ -5,6 +5,7 @@
 #include "Color.h"
 #include "render_system.hpp"
 #include <vector>
+#include <mutex>
 
 namespace brUGE
 {
@@ -16,6 +17,8 @@ namespace render
 	//-- Debug information drawer.
 	//-- It gathers drawing information from all its drawing methods and then draw all this
 	//-- information as effective as possible.
+	//-- Drawing methods may be called from any thread. The gathered data is handed over to the render
+	//-- thread by flush() at the frame sync point, so the next frame is gathered during the drawing.
 	//---------------------------------------------------------------------------------------------
 	class DebugDrawer : public utils::Singleton<DebugDrawer>
 	{
@@ -58,6 +61,10 @@ namespace render
 		//-- text drawing.
 		void drawText2D			(const char* text, const vec3f& pos, const Color& color);
 		
+		//-- hand over the gathered data for drawing and emit the text. It's called on the main thread
+		//-- while the render thread is idle.
+		void flush(const RenderCamera& cam);
+
 		//-- this method performs actual drawing.
 		void draw();
 
@@ -66,6 +73,7 @@ namespace render
 
 	private:
 		bool						m_isEnabled;
+		std::mutex					m_mutex;
 
 		//-- wire meshes drawing.
 		struct VertDesc
@@ -77,6 +85,7 @@ namespace render
 		};
 
 		std::vector<VertDesc>		m_vertices;
+		std::vector<VertDesc>		m_drawVertices;
 		std::shared_ptr<IBuffer>	m_VB;
 		IBuffer*					m_pVB;
 		std::shared_ptr<Material>	m_wireMaterial;
@@ -112,6 +121,7 @@ namespace render
 		typedef std::vector<MeshInstance> MeshesCache;
 
 		MeshesCache					m_meshCaches[MT_COUNT][DT_COUNT];
+		MeshesCache					m_drawMeshCaches[MT_COUNT][DT_COUNT];
 		std::shared_ptr<Mesh>		m_meshes[MT_COUNT];
 		std::shared_ptr<Material>	m_solidMaterial;
 		std::shared_ptr<IBuffer>	m_instancingTB;
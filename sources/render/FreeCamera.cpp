@@ -1,5 +1,6 @@
 #include "FreeCamera.h"
 #include "console/WatchersPanel.h"
+#include "console/Console.h"
 #include "SDL/SDL_keyboard.h"
 
 namespace brUGE
@@ -58,6 +58,9 @@ namespace render
 		template<typename T>
 		T* map(EAccess access) { return static_cast<T*>(doMap(access)); }
 		void  unmap() { doUnmap(); }
+
+		//-- update the part of the buffer created with USAGE_DEFAULT. Offset and size are in bytes.
+		void  update(const void* data, uint offset, uint size) { doUpdate(data, offset, size); }
 		
 		uint  getElemCount() const { return m_elemCount; }
 		uint  getElemSize() const { return m_elemSize; }
@@ -71,6 +74,7 @@ namespace render
 
 		virtual void* doMap(EAccess access) = 0;
 		virtual void  doUnmap() = 0;
+		virtual void  doUpdate(const void* data, uint offset, uint size) = 0;
 
 		uint	   m_elemSize; //-- size of one element. e.q. sizeof(elem)
 		uint	   m_elemCount; //-- count of elements in the buffer.
@@ -9,6 +9,9 @@
 //-- http://pugixml.org/
 #include "pugixml/pugixml.hpp"
 
+#include <cfloat>
+#include <cstring>
+
 using namespace brUGE::render;
 using namespace brUGE::math;
 using namespace brUGE::utils;
@@ -22,6 +25,248 @@ namespace
 	//-- ToDo: reconsider.
 	uint g_instancingCounter = 0;
 
+	typedef Mesh::SubMesh::Desc SubMeshDesc;
+
+	//-- take the next size bytes of the data without copying them.
+	//----------------------------------------------------------------------------------------------
+	bool readSpan(const ROData& iData, uint64 size, const byte*& oPtr)
+	{
+		if (size > iData.length() - iData.pos())
+			return false;
+
+		oPtr = static_cast<const byte*>(iData.ptr());
+		iData.seek(static_cast<int>(size));
+		return true;
+	}
+
+	//-- read sub-mesh info. Info of the old format is converted to the current one.
+	//----------------------------------------------------------------------------------------------
+	template<typename Format>
+	bool readSubInfo(const ROData& iData, uint version, typename Format::SubInfo& oSubInfo)
+	{
+		if (version < 3)
+		{
+			typename Format::SubInfoV2 iSubInfo;
+			if (!iData.read(iSubInfo))
+				return false;
+
+			memcpy(&oSubInfo.m_name, &iSubInfo.m_name, sizeof(oSubInfo.m_name));
+			oSubInfo.m_numVertices		= iSubInfo.m_numVertices;
+			oSubInfo.m_numVertexStreams = iSubInfo.m_numVertexStreams;
+			oSubInfo.m_numIndices		= iSubInfo.m_numIndices;
+			oSubInfo.m_indexSize		= sizeof(uint16);
+			return true;
+		}
+
+		return iData.read(oSubInfo);
+	}
+
+	//-- every index has to refer to the vertices of its own sub-mesh, otherwise it would read the
+	//-- vertices of the other meshes in the shared geometry pool. The file data may be unaligned.
+	//----------------------------------------------------------------------------------------------
+	template<typename Index>
+	bool validateIndices(const byte* data, uint32 count, uint32 numVertices)
+	{
+		Index maxIndex = 0;
+		for (uint32 i = 0; i < count; ++i)
+		{
+			Index index;
+			memcpy(&index, data + i * sizeof(Index), sizeof(Index));
+			if (index > maxIndex)
+			{
+				maxIndex = index;
+			}
+		}
+
+		return count == 0 || maxIndex < numVertices;
+	}
+
+	//-- indices are kept in their file width up to the upload.
+	//----------------------------------------------------------------------------------------------
+	bool readIndices(const ROData& iData, uint32 count, uint indexSize, uint32 numVertices, SubMeshDesc::Indices& oIndices)
+	{
+		oIndices.m_count = count;
+		if (!readSpan(iData, static_cast<uint64>(count) * indexSize, oIndices.m_data))
+			return false;
+
+		if (indexSize == sizeof(uint16))
+			return validateIndices<uint16>(oIndices.m_data, count, numVertices);
+		else
+			return validateIndices<uint32>(oIndices.m_data, count, numVertices);
+	}
+
+	//-- read sub-meshes with the LOD 0. The whole layout is validated against the data size before
+	//-- anything is created.
+	//----------------------------------------------------------------------------------------------
+	template<typename Format>
+	bool readSubMeshes(const ROData& iData, uint version, std::vector<SubMeshDesc>& descs)
+	{
+		for (auto& oDesc : descs)
+		{
+			typename Format::SubInfo iSubInfo;
+			if (!readSubInfo<Format>(iData, version, iSubInfo))
+				return false;
+
+			//-- every sub-mesh has at least the common vertex stream and 16 or 32 bit indices.
+			if (	iSubInfo.m_numVertexStreams == 0 || iSubInfo.m_numVertexStreams > Mesh::MAX_VERTEX_STREAMS
+				||	(iSubInfo.m_indexSize != sizeof(uint16) && iSubInfo.m_indexSize != sizeof(uint32))
+				||	(iSubInfo.m_numIndices != 0 && iSubInfo.m_numVertices == 0)
+				)
+			{
+				return false;
+			}
+
+			memcpy(&oDesc.m_name, &iSubInfo.m_name, sizeof(oDesc.m_name));
+			oDesc.m_name.back() = '\0';
+			oDesc.m_numVertices = iSubInfo.m_numVertices;
+			oDesc.m_indexSize	= iSubInfo.m_indexSize;
+			oDesc.m_numStreams	= iSubInfo.m_numVertexStreams;
+
+			//-- each individual vertex stream.
+			for (uint j = 0; j < oDesc.m_numStreams; ++j)
+			{
+				typename Format::VertexStream iStream;
+				if (!iData.read(iStream))
+					return false;
+
+				if (iStream.m_elemSize == 0)
+					return false;
+
+				auto& oStream = oDesc.m_streams[j];
+
+				oStream.m_elemSize = iStream.m_elemSize;
+				if (!readSpan(iData, static_cast<uint64>(iStream.m_elemSize) * oDesc.m_numVertices, oStream.m_vertices))
+					return false;
+			}
+
+			if (!readIndices(iData, iSubInfo.m_numIndices, oDesc.m_indexSize, oDesc.m_numVertices, oDesc.m_lods[0]))
+				return false;
+		}
+
+		return true;
+	}
+
+	//-- read LOD section of the mesh. Meshes of the old format have only the LOD 0.
+	//----------------------------------------------------------------------------------------------
+	template<typename Format>
+	bool readLods(const ROData& iData, uint version, std::vector<SubMeshDesc>& descs, std::vector<float>& screenSizes)
+	{
+		screenSizes.assign(1, FLT_MAX);
+
+		if (version < 2)
+			return true;
+
+		typename Format::LodInfo iLodInfo;
+		if (!iData.read(iLodInfo))
+			return false;
+
+		for (uint i = 0; i < iLodInfo.m_numLods; ++i)
+		{
+			typename Format::Lod iLod;
+			if (!iData.read(iLod))
+				return false;
+
+			//-- levels above the engine limit are skipped.
+			uint lod	 = i + 1;
+			bool skipped = lod >= Mesh::MAX_LODS;
+
+			for (auto& desc : descs)
+			{
+				uint32 numIndices = 0;
+				if (version < 3)
+				{
+					typename Format::LodSubInfoV2 iLodSubInfo;
+					if (!iData.read(iLodSubInfo))
+						return false;
+
+					numIndices = iLodSubInfo.m_numIndices;
+				}
+				else
+				{
+					typename Format::LodSubInfo iLodSubInfo;
+					if (!iData.read(iLodSubInfo))
+						return false;
+
+					numIndices = iLodSubInfo.m_numIndices;
+				}
+
+				SubMeshDesc::Indices skippedIndices;
+				if (!readIndices(iData, numIndices, desc.m_indexSize, desc.m_numVertices, skipped ? skippedIndices : desc.m_lods[lod]))
+					return false;
+			}
+
+			if (!skipped)
+			{
+				screenSizes.push_back(iLod.m_screenSize);
+			}
+		}
+
+		return true;
+	}
+
+	//-- allocate geometry of the sub-mesh in the geometry pool and upload it straight from the file
+	//-- data. Indices of the all LOD levels are stored one after another and refer to the same
+	//-- vertices. Layout is passed from outside to reuse its memory for the all sub-meshes.
+	//----------------------------------------------------------------------------------------------
+	template<typename SubMesh>
+	bool createGeometry(SubMesh& sm, const SubMeshDesc& desc, uint lodsCount, GeometryPool::Layout& layout)
+	{
+		GeometryPool& pool = rs().geometryPool();
+
+		layout.clear();
+		for (uint i = 0; i < desc.m_numStreams; ++i)
+		{
+			layout.push_back(desc.m_streams[i].m_elemSize);
+		}
+
+		uint numIndices = 0;
+		for (uint i = 0; i < lodsCount; ++i)
+		{
+			numIndices += desc.m_lods[i].m_count;
+		}
+
+		if (!pool.allocate(layout, desc.m_indexSize, desc.m_numVertices, numIndices, sm.m_geometry))
+			return false;
+
+		if (desc.m_numVertices)
+		{
+			for (uint i = 0; i < desc.m_numStreams; ++i)
+			{
+				pool.writeVertices(sm.m_geometry, i, desc.m_streams[i].m_vertices);
+			}
+		}
+
+		uint offset = 0;
+		sm.m_lods.resize(lodsCount);
+		for (uint i = 0; i < lodsCount; ++i)
+		{
+			const auto& indices = desc.m_lods[i];
+			Mesh::Lod&	lod		= sm.m_lods[i];
+
+			lod.m_startIndex = sm.m_geometry.m_startIndex + offset;
+			lod.m_numIndices = indices.m_count;
+			if (lod.m_numIndices)
+			{
+				pool.writeIndices(sm.m_geometry, offset, indices.m_data, lod.m_numIndices);
+			}
+			offset += lod.m_numIndices;
+		}
+
+		return true;
+	}
+
+	//-- screen sizes are sorted by descending order, the LOD 0 has the biggest one.
+	//----------------------------------------------------------------------------------------------
+	uint findLod(const std::vector<float>& screenSizes, float screenSize)
+	{
+		uint lod = 0;
+		while (lod + 1 < screenSizes.size() && screenSize < screenSizes[lod + 1])
+		{
+			++lod;
+		}
+		return lod;
+	}
+
 }
 //--------------------------------------------------------------------------------------------------
 // end unnamed namespace.
@@ -41,26 +286,38 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	Mesh::~Mesh()
 	{
-
+		for (auto& sm : m_submeshes)
+		{
+			GeometryPool::free(sm.m_geometry);
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	bool Mesh::load(const ROData& iData, const std::string& name)
 	{
 		//-- check header.
+		StaticMeshFormat::Header iHeader;
 		{
-			StaticMeshFormat::Header iHeader;
-			iData.read(iHeader);
-			if (std::string(iHeader.m_format.data()) != "static_mesh")
+			if (!iData.read(iHeader) || !checkFormatTag(iHeader.m_format.data(), iHeader.m_format.size(), "static_mesh"))
 			{
 				ERROR_MSG("Failed to load mesh. Most likely it's not a *.mesh format.");
 				return false;
 			}
+
+			if (iHeader.m_version == 0 || iHeader.m_version > StaticMeshFormat::VERSION)
+			{
+				ERROR_MSG("Failed to load mesh %s. Unsupported format version %d.", name.c_str(), iHeader.m_version);
+				return false;
+			}
 		}
 
 		//-- load common info.
 		StaticMeshFormat::Info iInfo;
-		iData.read(iInfo);
+		if (!iData.read(iInfo))
+		{
+			ERROR_MSG("Failed to load mesh %s. The file is corrupted.", name.c_str());
+			return false;
+		}
 
 		//-- load mesh bounds.
 		m_aabb = AABB(
@@ -68,42 +325,20 @@ namespace render
 			vec3f(iInfo.m_aabb[3], iInfo.m_aabb[4], iInfo.m_aabb[5])
 			);
 
-		//-- allocate sub-meshes info.
+		//-- read sub-meshes and LOD levels. Only the layout is read here, the geometry itself stays
+		//-- in the file data up to the upload.
 		std::vector<SubMesh::Desc> descs(iInfo.m_numSubMeshes);
-
-		//-- iterate over the whole set of sub-meshes.
-		for (uint i = 0; i < iInfo.m_numSubMeshes; ++i)
+		if (	!readSubMeshes<StaticMeshFormat>(iData, iHeader.m_version, descs)
+			||	!readLods<StaticMeshFormat>(iData, iHeader.m_version, descs, m_lodScreenSizes)
+			)
 		{
-			StaticMeshFormat::SubInfo iSubInfo;
-			iData.read(iSubInfo);
-
-			SubMesh::Desc& oDesc = descs[i];
-
-			oDesc.m_streams.resize(iSubInfo.m_numVertexStreams);
-			oDesc.m_name		= iSubInfo.m_name;
-			oDesc.m_numVertices = iSubInfo.m_numVertices;
-
-			//-- read each individual vertex stream.
-			for (uint j = 0; j < iSubInfo.m_numVertexStreams; ++j)
-			{
-				StaticMeshFormat::VertexStream iStream;
-				iData.read(iStream);
-
-				SubMesh::Desc::Stream& oStream = oDesc.m_streams[j];
-				
-				//-- read data for vertex buffer.
-				oStream.m_elemSize = iStream.m_elemSize;
-				oStream.m_vertices.resize(iStream.m_elemSize * iSubInfo.m_numVertices);
-				iData.readBytes(&oStream.m_vertices[0], iStream.m_elemSize * iSubInfo.m_numVertices);
-			}
-
-			//-- read data for index buffer.
-			oDesc.m_indices.resize(iSubInfo.m_numIndices);
-			iData.readBytes(&oDesc.m_indices[0], sizeof(uint16) * iSubInfo.m_numIndices);
+			ERROR_MSG("Failed to load mesh %s. The file is corrupted.", name.c_str());
+			return false;
 		}
 
 		//-- Now all needed data has been read and we just allocate GPU resources.
 		bool success = true;
+		GeometryPool::Layout layout;
 
 		m_submeshes.resize(descs.size());
 		for (uint i = 0; i < descs.size(); ++i)
@@ -111,24 +346,8 @@ namespace render
 			const SubMesh::Desc& desc = descs[i];
 			SubMesh&			 sm   = m_submeshes[i];
 
-			//-- create index buffer.
-			sm.m_numIndices = desc.m_indices.size();
-			sm.m_IB	= rd()->createBuffer(IBuffer::TYPE_INDEX,  &desc.m_indices[0], desc.m_indices.size(), sizeof(uint16));
-			success &= sm.m_IB.get() != nullptr;
-
-			//-- iterate over the whole set of streams and create of all them appropriate vertex buffers.
-			sm.m_VBs.resize(desc.m_streams.size());
-			sm.m_pVBs.resize(desc.m_streams.size());
-			for (uint j = 0; j < desc.m_streams.size(); ++j)
-			{
-				const SubMesh::Desc::Stream& stream = desc.m_streams[j];
-
-				sm.m_VBs[j] = rd()->createBuffer(
-					IBuffer::TYPE_VERTEX, &stream.m_vertices[0], desc.m_numVertices, stream.m_elemSize
-					);
-				sm.m_pVBs[j] = sm.m_VBs[j].get();
-				success &= sm.m_VBs[j].get() != nullptr;
-			}
+			//-- allocate vertices and indices of the all LODs in the shared heaps.
+			success &= createGeometry(sm, desc, m_lodScreenSizes.size(), layout);
 		}
 
 		//-- now retrieve material for each sub-mesh.
@@ -160,14 +379,38 @@ namespace render
 		return success;
 	}
 	
+	//-- mesh may be instanced only if materials of the all its sub-meshes have the instanced shader.
+	//----------------------------------------------------------------------------------------------
+	bool Mesh::isInstanceable(RenderSystem::EPassType pass) const
+	{
+		for (const auto& sm : m_submeshes)
+		{
+			if (!sm.m_pMaterial || !sm.m_pMaterial->hasInstancedFx(rs().shaderPass(pass)))
+				return false;
+		}
+		return !m_submeshes.empty();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint Mesh::selectLod(float screenSize) const
+	{
+		return findLod(m_lodScreenSizes, screenSize);
+	}
+
 	//----------------------------------------------------------------------------------------------
-	uint Mesh::gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops) const
+	uint Mesh::gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops, uint lod) const
 	{
 		RenderOp op;
+		uint	 count = 0;
 
 		for (uint i = 0; i < m_submeshes.size(); ++i)
 		{
-			const SubMesh& sm = m_submeshes[i];
+			const SubMesh&	 sm	   = m_submeshes[i];
+			const Mesh::Lod& smLod = sm.m_lods[min<uint>(lod, sm.m_lods.size() - 1)];
+
+			//-- sub-mesh may be completely collapsed on the coarse LOD.
+			if (smLod.m_numIndices == 0)
+				continue;
 
 			if (sm.m_pMaterial)
 			{
@@ -179,19 +422,22 @@ namespace render
 			}
 
 			op.m_primTopolpgy	= PRIM_TOPOLOGY_TRIANGLE_LIST;
-			op.m_indicesCount	= sm.m_numIndices;
-			op.m_IB				= sm.m_IB.get();
-			op.m_VBs			= &sm.m_pVBs[0];
+			op.m_indicesCount	= smLod.m_numIndices;
+			op.m_startIndex		= smLod.m_startIndex;
+			op.m_baseVertex		= sm.m_geometry.m_baseVertex;
+			op.m_IB				= sm.m_geometry.m_IB;
+			op.m_VBs			= sm.m_geometry.m_VBs;
 			op.m_VBCount		= (op.m_material->m_bumped) ? 2 : 1;
 
 			ops.push_back(op);
+			++count;
 		}
 
-		return m_submeshes.size();
+		return count;
 	}
 
 	//----------------------------------------------------------------------------------------------
-	SkinnedMesh::SkinnedMesh()
+	SkinnedMesh::SkinnedMesh() : m_instacingID(g_instancingCounter++)
 	{
 
 	}
@@ -199,37 +445,56 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	SkinnedMesh::~SkinnedMesh()
 	{
-
+		for (auto& sm : m_submeshes)
+		{
+			GeometryPool::free(sm.m_geometry);
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	bool SkinnedMesh::load(const utils::ROData& iData, const std::string& name)
 	{
 		//-- check header.
+		SkinnedMeshFormat::Header iHeader;
 		{
-			SkinnedMeshFormat::Header iHeader;
-			iData.read(iHeader);
-			if (std::string(iHeader.m_format) != "skinned_mesh")
+			if (!iData.read(iHeader) || !checkFormatTag(iHeader.m_format, sizeof(iHeader.m_format), "skinned_mesh"))
 			{
 				ERROR_MSG("Failed to load mesh. Most likely it's not a *.skinnedmesh format.");
 				return false;
 			}
+
+			if (iHeader.m_version == 0 || iHeader.m_version > SkinnedMeshFormat::VERSION)
+			{
+				ERROR_MSG("Failed to load skinned mesh %s. Unsupported format version %d.", name.c_str(), iHeader.m_version);
+				return false;
+			}
 		}
 
 		//-- load skeleton info.
 		SkinnedMeshFormat::Skeleton::Info skelInfo;
 		{
-			iData.read(skelInfo);
+			if (!iData.read(skelInfo) || skelInfo.m_numJoints == 0)
+			{
+				ERROR_MSG("Failed to load skinned mesh %s. The file is corrupted.", name.c_str());
+				return false;
+			}
 
-			//-- read skeleton.
+			//-- read skeleton. Parent always precedes its children, the root has no parent.
 			m_skeleton.resize(skelInfo.m_numJoints);
 			for (uint i = 0; i < skelInfo.m_numJoints; ++i)
 			{
 				SkinnedMeshFormat::Skeleton::Joint iJoint;
 
-				iData.read(iJoint);
+				if (	!iData.read(iJoint)
+					||	iJoint.m_parent >= static_cast<int>(i) || iJoint.m_parent < ((i == 0) ? -1 : 0)
+					)
+				{
+					ERROR_MSG("Failed to load skinned mesh %s. The skeleton is corrupted.", name.c_str());
+					return false;
+				}
 
-				strcpy_s(m_skeleton[i].m_name, iJoint.m_name);
+				memcpy(m_skeleton[i].m_name, iJoint.m_name, sizeof(m_skeleton[i].m_name));
+				m_skeleton[i].m_name[sizeof(m_skeleton[i].m_name) - 1] = '\0';
 				m_skeleton[i].m_parent = iJoint.m_parent;
 			}
 		}
@@ -240,14 +505,22 @@ namespace render
 		{
 			SkinnedMeshFormat::InvBindPose iInvBindPose;
 
-			iData.read(iInvBindPose);
+			if (!iData.read(iInvBindPose))
+			{
+				ERROR_MSG("Failed to load skinned mesh %s. The file is corrupted.", name.c_str());
+				return false;
+			}
 
 			m_invBindPose[i].set(iInvBindPose.m_matrix);
 		}
 
 		//-- load common info.
 		SkinnedMeshFormat::Info iInfo;
-		iData.read(iInfo);
+		if (!iData.read(iInfo))
+		{
+			ERROR_MSG("Failed to load skinned mesh %s. The file is corrupted.", name.c_str());
+			return false;
+		}
 
 		//-- load mesh bounds.
 		m_aabb = AABB(
@@ -255,42 +528,20 @@ namespace render
 			vec3f(iInfo.m_aabb[3], iInfo.m_aabb[4], iInfo.m_aabb[5])
 			);
 
-		//-- allocate sub-meshes info.
+		//-- read sub-meshes and LOD levels. Only the layout is read here, the geometry itself stays
+		//-- in the file data up to the upload.
 		std::vector<SubMesh::Desc> descs(iInfo.m_numSubMeshes);
-
-		//-- iterate over the whole set of sub-meshes.
-		for (uint i = 0; i < iInfo.m_numSubMeshes; ++i)
+		if (	!readSubMeshes<SkinnedMeshFormat>(iData, iHeader.m_version, descs)
+			||	!readLods<SkinnedMeshFormat>(iData, iHeader.m_version, descs, m_lodScreenSizes)
+			)
 		{
-			SkinnedMeshFormat::SubInfo iSubInfo;
-			iData.read(iSubInfo);
-
-			SubMesh::Desc& oDesc = descs[i];
-
-			oDesc.m_streams.resize(iSubInfo.m_numVertexStreams);
-			strcpy_s(oDesc.m_name, iSubInfo.m_name);
-			oDesc.m_numVertices = iSubInfo.m_numVertices;
-
-			//-- read each individual vertex stream.
-			for (uint j = 0; j < iSubInfo.m_numVertexStreams; ++j)
-			{
-				SkinnedMeshFormat::VertexStream iStream;
-				iData.read(iStream);
-
-				SubMesh::Desc::Stream& oStream = oDesc.m_streams[j];
-
-				//-- read data for vertex buffer.
-				oStream.m_elemSize = iStream.m_elemSize;
-				oStream.m_vertices.resize(iStream.m_elemSize * iSubInfo.m_numVertices);
-				iData.readBytes(&oStream.m_vertices[0], iStream.m_elemSize * iSubInfo.m_numVertices);
-			}
-
-			//-- read data for index buffer.
-			oDesc.m_indices.resize(iSubInfo.m_numIndices);
-			iData.readBytes(&oDesc.m_indices[0], sizeof(uint16) * iSubInfo.m_numIndices);
+			ERROR_MSG("Failed to load skinned mesh %s. The file is corrupted.", name.c_str());
+			return false;
 		}
 
 		//-- Now all needed data has been read and we just allocate GPU resources.
 		bool success = true;
+		GeometryPool::Layout layout;
 
 		m_submeshes.resize(descs.size());
 		for (uint i = 0; i < descs.size(); ++i)
@@ -298,24 +549,8 @@ namespace render
 			const auto& desc = descs[i];
 			auto&		sm   = m_submeshes[i];
 
-			//-- create index buffer.
-			sm.m_numIndices = desc.m_indices.size();
-			sm.m_IB	= rd()->createBuffer(IBuffer::TYPE_INDEX,  &desc.m_indices[0], desc.m_indices.size(), sizeof(uint16));
-			success &= sm.m_IB.get() != nullptr;
-
-			//-- iterate over the whole set of streams and create of all them appropriate vertex buffers.
-			sm.m_VBs.resize(desc.m_streams.size());
-			sm.m_pVBs.resize(desc.m_streams.size());
-			for (uint j = 0; j < desc.m_streams.size(); ++j)
-			{
-				const auto& stream = desc.m_streams[j];
-
-				sm.m_VBs[j] = rd()->createBuffer(
-					IBuffer::TYPE_VERTEX, &stream.m_vertices[0], desc.m_numVertices, stream.m_elemSize
-					);
-				sm.m_pVBs[j] = sm.m_VBs[j].get();
-				success &= sm.m_VBs[j].get() != nullptr;
-			}
+			//-- allocate vertices and indices of the all LODs in the shared heaps.
+			success &= createGeometry(sm, desc, m_lodScreenSizes.size(), layout);
 		}
 
 		//-- now retrieve material for each sub-mesh.
@@ -348,13 +583,36 @@ namespace render
 	}
 	
 	//----------------------------------------------------------------------------------------------
-	uint SkinnedMesh::gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops) const
+	bool SkinnedMesh::isInstanceable(RenderSystem::EPassType pass) const
+	{
+		for (const auto& sm : m_submeshes)
+		{
+			if (!sm.m_pMaterial || !sm.m_pMaterial->hasInstancedFx(rs().shaderPass(pass)))
+				return false;
+		}
+		return !m_submeshes.empty();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint SkinnedMesh::selectLod(float screenSize) const
+	{
+		return findLod(m_lodScreenSizes, screenSize);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint SkinnedMesh::gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops, uint lod) const
 	{
 		RenderOp op;
+		uint	 count = 0;
 
 		for (uint i = 0; i < m_submeshes.size(); ++i)
 		{
-			const SubMesh& sm = m_submeshes[i];
+			const SubMesh&	 sm	   = m_submeshes[i];
+			const Mesh::Lod& smLod = sm.m_lods[min<uint>(lod, sm.m_lods.size() - 1)];
+
+			//-- sub-mesh may be completely collapsed on the coarse LOD.
+			if (smLod.m_numIndices == 0)
+				continue;
 
 			if (sm.m_pMaterial)
 			{
@@ -366,15 +624,18 @@ namespace render
 			}
 
 			op.m_primTopolpgy	= PRIM_TOPOLOGY_TRIANGLE_LIST;
-			op.m_indicesCount	= sm.m_numIndices;
-			op.m_IB				= sm.m_IB.get();
-			op.m_VBs			= &sm.m_pVBs[0];
+			op.m_indicesCount	= smLod.m_numIndices;
+			op.m_startIndex		= smLod.m_startIndex;
+			op.m_baseVertex		= sm.m_geometry.m_baseVertex;
+			op.m_IB				= sm.m_geometry.m_IB;
+			op.m_VBs			= sm.m_geometry.m_VBs;
 			op.m_VBCount		= (op.m_material->m_bumped) ? 2 : 1;
 
 			ops.push_back(op);
+			++count;
 		}
 
-		return m_submeshes.size();
+		return count;
 	}
 
 } // render
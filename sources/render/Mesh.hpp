@@ -20,32 +20,52 @@ namespace render
 	{
 	public:
 		//------------------------------------------------------------------------------------------
-		struct SubMesh
+		enum { MAX_LODS = 4, MAX_VERTEX_STREAMS = 4 };
+
+		//------------------------------------------------------------------------------------------
+		struct Lod
 		{
-			SubMesh() : m_numIndices(0) { }
+			Lod() : m_startIndex(0), m_numIndices(0) { }
+
+			uint									m_startIndex; //-- inside the index heap.
+			uint32									m_numIndices;
+		};
 
+		//------------------------------------------------------------------------------------------
+		struct SubMesh
+		{
+			//-- Note: vertices and indices aren't copied, they point straight into the loaded file
+			//--	   data, so the desc is valid only while this data is alive.
 			struct Desc
 			{
-				Desc() : m_name{0}, m_numVertices(0) { }
+				Desc() : m_name{0}, m_numVertices(0), m_indexSize(sizeof(uint16)), m_numStreams(0) { }
 
 				struct Stream
 				{
-					Stream() : m_elemSize(0) { }
+					Stream() : m_elemSize(0), m_vertices(nullptr) { }
+
+					uint8		m_elemSize;
+					const byte*	m_vertices;
+				};
+
+				struct Indices
+				{
+					Indices() : m_count(0), m_data(nullptr) { }
 
-					uint8				m_elemSize;
-					std::vector<byte>	m_vertices;
+					uint32		m_count;
+					const byte*	m_data; //-- raw indices of the m_indexSize width.
 				};
 
-				std::array<char, 20>	m_name;
-				uint16					m_numVertices;
-				std::vector<uint16>		m_indices;
-				std::vector<Stream>		m_streams;
+				std::array<char, 20>					m_name;
+				uint32									m_numVertices;
+				uint8									m_indexSize;  //-- 2 or 4 bytes.
+				uint8									m_numStreams;
+				std::array<Stream, MAX_VERTEX_STREAMS>	m_streams;
+				std::array<Indices, MAX_LODS>			m_lods;		  //-- indices of the every LOD level.
 			};
 
-			uint16									m_numIndices;
-			std::shared_ptr<IBuffer>				m_IB;
-			std::vector<std::shared_ptr<IBuffer>>	m_VBs;
-			mutable std::vector<IBuffer*>			m_pVBs;
+			std::vector<Lod>						m_lods;
+			GeometryPool::Allocation				m_geometry; //-- vertices and indices of the all LODs.
 			std::shared_ptr<PipelineMaterial>		m_pMaterial;
 			std::shared_ptr<Material>				m_sMaterial;
 		};
@@ -58,12 +78,18 @@ namespace render
 		bool		load(const utils::ROData& data, const std::string& name);
 		int			instancingID() const { return m_instacingID; }
 		const AABB& bounds() const { return m_aabb; }
-		uint		gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops) const;
+		bool		isInstanceable(RenderSystem::EPassType pass) const;
+
+		//-- LOD selection by projected size of the mesh in the fraction of the screen height.
+		uint		lodsCount() const { return m_lodScreenSizes.size(); }
+		uint		selectLod(float screenSize) const;
+		uint		gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops, uint lod = 0) const;
 
 	private:
-		SubMeshes m_submeshes;
-		AABB	  m_aabb;
-		int		  m_instacingID;
+		SubMeshes			m_submeshes;
+		AABB				m_aabb;
+		int					m_instacingID;
+		std::vector<float>	m_lodScreenSizes;
 	};
 
 
@@ -96,24 +122,10 @@ namespace render
 		//------------------------------------------------------------------------------------------
 		struct SubMesh
 		{
-			struct Desc
-			{
-				struct Stream
-				{
-					uint8				m_elemSize;
-					std::vector<byte>	m_vertices;
-				};
-
-				char					m_name[20];
-				uint16					m_numVertices;
-				std::vector<uint16>		m_indices;
-				std::vector<Stream>		m_streams;
-			};
+			typedef Mesh::SubMesh::Desc Desc;
 
-			uint16									m_numIndices;
-			std::shared_ptr<IBuffer>				m_IB;
-			std::vector<std::shared_ptr<IBuffer>>	m_VBs;
-			mutable std::vector<IBuffer*>			m_pVBs;
+			std::vector<Mesh::Lod>					m_lods;
+			GeometryPool::Allocation				m_geometry; //-- vertices and indices of the all LODs.
 			std::shared_ptr<PipelineMaterial>		m_pMaterial;
 			std::shared_ptr<Material>				m_sMaterial;
 		};
@@ -124,16 +136,22 @@ namespace render
 		~SkinnedMesh();
 
 		bool				 load(const utils::ROData& data, const std::string& name);
+		int					 instancingID() const	{ return m_instacingID; }
 		const AABB&			 bounds() const			{ return m_aabb; }
 		const Skeleton&		 skeleton() const		{ return m_skeleton; }
 		const MatrixPalette& invBindPose() const	{ return m_invBindPose; }
-		uint				 gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops) const;
+		bool				 isInstanceable(RenderSystem::EPassType pass) const;
+		uint				 lodsCount() const		{ return m_lodScreenSizes.size(); }
+		uint				 selectLod(float screenSize) const;
+		uint				 gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& ops, uint lod = 0) const;
 
 	private:
-		SubMeshes	  m_submeshes;	
-		Skeleton	  m_skeleton;
-		MatrixPalette m_invBindPose;
-		AABB		  m_aabb;
+		SubMeshes			m_submeshes;	
+		Skeleton			m_skeleton;
+		MatrixPalette		m_invBindPose;
+		AABB				m_aabb;
+		int					m_instacingID;
+		std::vector<float>	m_lodScreenSizes;
 	};
 
 } // render
@@ -2,6 +2,7 @@
 
 #include "prerequisites.hpp"
 #include "render_common.h"
+#include "utils/linear_allocator.hpp"
 
 namespace brUGE
 {
@@ -9,7 +10,7 @@ namespace render
 {
 	class  Mesh;
 	struct RenderOp;
-	typedef std::vector<RenderOp> RenderOps;
+	typedef utils::ArenaVector<RenderOp> RenderOps;
 
 	//-- Sky box.
 	//-- ToDo: document.
@@ -6,6 +6,9 @@
 #include "mesh_manager.hpp"
 #include "mesh_formats.hpp"
 #include "DebugDrawer.h"
+#include "engine/Engine.h"
+#include "engine/job_system.hpp"
+#include "console/Console.h"
 #include <algorithm>
 
 using namespace brUGE::os;
@@ -18,6 +21,9 @@ namespace
 	bool g_drawSkeletons = false;
 	bool g_drawNodeNames = false;
 	bool g_drawJoints    = false;
+
+	//-- minimum count of the animation controllers processed by one job.
+	const uint g_controllersPerJob = 16;
 }
 
 
@@ -45,106 +51,128 @@ namespace render
 		REGISTER_CONSOLE_VALUE("anim_drawNodeNames", bool, g_drawNodeNames);
 		REGISTER_CONSOLE_VALUE("anim_drawJoints",    bool, g_drawJoints);
 
+		//-- blenders keep intermediate results, so every thread of the job system needs its own one.
+		m_animBlenders.resize(Engine::instance().jobSystem().threadsCount());
+
 		return true;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void AnimationEngine::preAnimate(float dt)
 	{
-		for (auto animCtrl : m_activeAnimCtrls)
+		Engine::instance().jobSystem().parallelFor(m_activeAnimCtrls.size(), g_controllersPerJob, [this, dt](uint first, uint last)
 		{
-			//-- stop ticking and calculating world transforms for physics driven controllers.
-			if (animCtrl->m_physicsDriven)
-				continue;
+			AnimationBlender& blender = m_animBlenders[JobSystem::threadIndex()];
 
-			auto& transform = *animCtrl->m_meshInst->m_transform;
+			for (uint c = first; c < last; ++c)
+			{
+				auto animCtrl = m_activeAnimCtrls[c];
 
-			//-- tick animation.
-			m_animBlender.tick(dt, animCtrl->m_animLayers);
+				//-- stop ticking and calculating world transforms for physics driven controllers.
+				if (animCtrl->m_physicsDriven)
+					continue;
 
-			//-- calculate local bound.
-			m_animBlender.blendBounds(animCtrl->m_animLayers, transform.m_localBounds);
+				auto& transform = *animCtrl->m_meshInst->m_transform;
 
-			//-- calculate world bound.
-			transform.m_worldBounds = transform.m_localBounds.getTranformed(transform.m_worldMat);
-		}
+				//-- tick animation.
+				blender.tick(dt, animCtrl->m_animLayers);
+
+				//-- calculate local bound.
+				blender.blendBounds(animCtrl->m_animLayers, transform.m_localBounds);
+
+				//-- calculate world bound.
+				transform.m_worldBounds = transform.m_localBounds.getTranformed(transform.m_worldMat);
+			}
+		});
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void AnimationEngine::animate()
 	{
-		for (auto animCtrl : m_activeAnimCtrls)
+		Engine::instance().jobSystem().parallelFor(m_activeAnimCtrls.size(), g_controllersPerJob, [this](uint first, uint last)
 		{
-			if (!animCtrl->m_wantsWorldPalette)
-				continue;
+			AnimationBlender& blender = m_animBlenders[JobSystem::threadIndex()];
+
+			for (uint c = first; c < last; ++c)
+			{
+				auto animCtrl = m_activeAnimCtrls[c];
 
-			const auto& world			= animCtrl->m_transform->m_worldMat;
-			const auto& skeleton		= animCtrl->m_meshInst->m_skinnedMesh->skeleton();
-			auto&		worldPalette	= animCtrl->m_meshInst->m_worldPalette;
+				if (!animCtrl->m_wantsWorldPalette)
+					continue;
 
-			//-- calculate local matrix palette.
-			m_animBlender.blendPalette(animCtrl->m_animLayers, skeleton, animCtrl->m_tranformPalette);
+				const auto& world			= animCtrl->m_transform->m_worldMat;
+				const auto& skeleton		= animCtrl->m_meshInst->m_skinnedMesh->skeleton();
+				auto&		worldPalette	= animCtrl->m_meshInst->m_worldPalette;
 
-			//-- transform (quat, pos) -> mat4f and calculate world space palette.
-			for (uint i = 0; i < animCtrl->m_tranformPalette.size(); ++i)
-			{
-				auto&		mat = worldPalette[i];
-				const auto& tp  = animCtrl->m_tranformPalette[i];
+				//-- calculate local matrix palette.
+				blender.blendPalette(animCtrl->m_animLayers, skeleton, animCtrl->m_tranformPalette);
+
+				//-- transform (quat, pos) -> mat4f and calculate world space palette.
+				for (uint i = 0; i < animCtrl->m_tranformPalette.size(); ++i)
+				{
+					auto&		mat = worldPalette[i];
+					const auto& tp  = animCtrl->m_tranformPalette[i];
  
-				mat = combineMatrix(tp.m_orient, tp.m_pos);
-				mat.postMultiply(world);
+					mat = combineMatrix(tp.m_orient, tp.m_pos);
+					mat.postMultiply(world);
+				}
 			}
-		}
+		});
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void AnimationEngine::postAnimate()
 	{
-		for (auto animCtrl : m_activeAnimCtrls)
+		Engine::instance().jobSystem().parallelFor(m_activeAnimCtrls.size(), g_controllersPerJob, [this](uint first, uint last)
 		{
-			if (!animCtrl->m_wantsWorldPalette)
-				continue;
+			for (uint c = first; c < last; ++c)
+			{
+				auto animCtrl = m_activeAnimCtrls[c];
 
-			const auto& invBindPose	= animCtrl->m_meshInst->m_skinnedMesh->invBindPose();
-			const auto& skeleton	= animCtrl->m_meshInst->m_skinnedMesh->skeleton();
-			auto&		palette		= animCtrl->m_meshInst->m_worldPalette;
+				if (!animCtrl->m_wantsWorldPalette)
+					continue;
 
-			//-- draw skeleton.
-			if (g_drawNodeNames || g_drawSkeletons || g_drawJoints)
-			{
-				for (uint k = 0; k < skeleton.size(); ++k)
-				{
-					const vec3f& startPos = palette[k].applyToOrigin();
+				const auto& invBindPose	= animCtrl->m_meshInst->m_skinnedMesh->invBindPose();
+				const auto& skeleton	= animCtrl->m_meshInst->m_skinnedMesh->skeleton();
+				auto&		palette		= animCtrl->m_meshInst->m_worldPalette;
 
-					if (g_drawJoints)
+				//-- draw skeleton.
+				if (g_drawNodeNames || g_drawSkeletons || g_drawJoints)
+				{
+					for (uint k = 0; k < skeleton.size(); ++k)
 					{
-						//DebugDrawer::instance().drawSphere(0.025f, palette[k], Color(1,0,0,1), DebugDrawer::DRAW_OVERRIDE);
-						DebugDrawer::instance().drawCoordAxis(palette[k], 0.01f);
-					}
+						const vec3f& startPos = palette[k].applyToOrigin();
 
-					if (g_drawNodeNames)
-					{
-						DebugDrawer::instance().drawText2D(skeleton[k].m_name, startPos, Color(1, 1, 0, 1));
-					}
+						if (g_drawJoints)
+						{
+							//DebugDrawer::instance().drawSphere(0.025f, palette[k], Color(1,0,0,1), DebugDrawer::DRAW_OVERRIDE);
+							DebugDrawer::instance().drawCoordAxis(palette[k], 0.01f);
+						}
 
-					if (g_drawSkeletons)
-					{
-						if (skeleton[k].m_parent != -1)
+						if (g_drawNodeNames)
+						{
+							DebugDrawer::instance().drawText2D(skeleton[k].m_name, startPos, Color(1, 1, 0, 1));
+						}
+
+						if (g_drawSkeletons)
 						{
-							const vec3f& endPos = palette[skeleton[k].m_parent].applyToOrigin();
+							if (skeleton[k].m_parent != -1)
+							{
+								const vec3f& endPos = palette[skeleton[k].m_parent].applyToOrigin();
 
-							DebugDrawer::instance().drawLine(startPos, endPos, Color(1, 1, 1, 1));
+								DebugDrawer::instance().drawLine(startPos, endPos, Color(1, 1, 1, 1));
+							}
 						}
 					}
 				}
-			}
 
-			//-- calculate world space palette.
-			for (uint j = 0; j < palette.size(); ++j)
-			{
-				palette[j].preMultiply(invBindPose[j]);
+				//-- calculate world space palette.
+				for (uint j = 0; j < palette.size(); ++j)
+				{
+					palette[j].preMultiply(invBindPose[j]);
+				}
 			}
-		}
+		});
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -193,6 +221,12 @@ namespace render
 			WARNING_MSG("Can't load animation '%s'.", name);
 			return;
 		}
+
+		if (anim->numJoints() != animCtrl->m_meshInst->m_skinnedMesh->skeleton().size())
+		{
+			WARNING_MSG("Animation '%s' doesn't match the skeleton of the mesh.", name);
+			return;
+		}
 		
 		AnimLayer layer;
 		layer.m_anim   = anim;
@@ -369,8 +403,7 @@ namespace render
 		//-- check header.
 		{
 			SkinnedMeshAnimationFormat::Header iHeader;
-			iData.read(iHeader);
-			if (std::string(iHeader.m_format) != "animation")
+			if (!iData.read(iHeader) || !checkFormatTag(iHeader.m_format, sizeof(iHeader.m_format), "animation"))
 			{
 				ERROR_MSG("Failed to load mesh. Most likely it's not a *.animation format.");
 				return false;
@@ -380,7 +413,11 @@ namespace render
 		//-- load skeleton info.
 		SkinnedMeshAnimationFormat::Skeleton::Info skelInfo;
 		{
-			iData.read(skelInfo);
+			if (!iData.read(skelInfo))
+			{
+				ERROR_MSG("Failed to load animation. The file is corrupted.");
+				return false;
+			}
 
 			//-- read skeleton.
 			//m_skeleton.resize(skelInfo.m_numJoints);
@@ -388,7 +425,11 @@ namespace render
 			{
 				SkinnedMeshAnimationFormat::Skeleton::Joint iJoint;
 
-				iData.read(iJoint);
+				if (!iData.read(iJoint))
+				{
+					ERROR_MSG("Failed to load animation. The file is corrupted.");
+					return false;
+				}
 
 				//strcpy_s(m_skeleton[i].m_name, iJoint.m_name);
 				//m_skeleton[i].m_parent = iJoint.m_parent;
@@ -397,12 +438,26 @@ namespace render
 
 		//-- load info.
 		SkinnedMeshAnimationFormat::Info info;
-		iData.read(info);
+		if (!iData.read(info))
+		{
+			ERROR_MSG("Failed to load animation. The file is corrupted.");
+			return false;
+		}
 
 		m_numFrames = info.m_numFrames;
 		m_frameRate = info.m_frameRate;
 		m_numJoints = skelInfo.m_numJoints;
 
+		//-- check the declared counts against the data size before allocating anything for them.
+		uint64 frameSize = sizeof(SkinnedMeshAnimationFormat::Bound) + sizeof(SkinnedMeshAnimationFormat::Joint) * m_numJoints;
+		if (	m_numFrames == 0 || m_frameRate == 0 || m_numJoints == 0
+			||	frameSize * m_numFrames > iData.length() - iData.pos()
+			)
+		{
+			ERROR_MSG("Failed to load animation. The file is corrupted.");
+			return false;
+		}
+
 		//-- read bounds.
 		m_bounds.resize(m_numFrames);
 		for (uint i = 0; i < m_numFrames; ++i)
@@ -452,8 +507,8 @@ namespace render
 		//-- calculate total time for desired frame rate and frame count.
 		float totalTime = (m_numFrames - 1) / static_cast<float>(m_frameRate);
 
-		//-- adjust animation time in case the looped animation.
-		if (looped)
+		//-- adjust animation time in case the looped animation. Single frame animation has zero length.
+		if (looped && totalTime > 0.0f)
 		{
 			while (oTime.m_time > totalTime)
 				oTime.m_time -= totalTime;
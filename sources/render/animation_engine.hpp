@@ -136,6 +136,9 @@ namespace render
 
 		bool			init();
 
+		//-- the stages below process the controllers in parallel by the job system. They have to be
+		//-- called from the main thread.
+
 		//-- calculate only bounds for the animated model, but not matrix local palette.
 		void			preAnimate(float dt);
 		//-- calculate matrix world palette only for visible or desired models.
@@ -168,7 +171,7 @@ namespace render
 		std::vector<std::unique_ptr<AnimationController>>				m_animCtrls;
 		std::unordered_map<std::string, std::shared_ptr<Animation>>		m_animations;
 		std::vector<AnimationController*>								m_activeAnimCtrls;
-		AnimationBlender												m_animBlender;
+		std::vector<AnimationBlender>									m_animBlenders; //-- one per job thread.
 	};
 
 } //-- render
@@ -2,11 +2,24 @@
 #include "scene/game_world.hpp"
 #include "os/FileSystem.h"
 #include "loader/ResourcesManager.h"
+#include "console/WatchersPanel.h"
 
 using namespace brUGE::os;
 using namespace brUGE::math;
 using namespace brUGE::utils;
 
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- max number of the static and dynamic decals.
+	const uint g_maxDecals = 1024;
+
+	uint g_decalsUploadBytes = 0;
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
 namespace brUGE
 {
 namespace render
@@ -14,9 +27,8 @@ namespace render
 
 	//----------------------------------------------------------------------------------------------
 	DecalManager::DecalManager()
-		: m_updateStatic(false), m_updateDynamic(false)
 	{
-
+		REGISTER_RO_WATCHER("decals upload bytes", uint, g_decalsUploadBytes);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -30,17 +42,7 @@ namespace render
 	{
 		//-- create geometry instancing buffers.
 		{
-			m_staticTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 1024 * sizeof(GPUDecal) / sizeof(vec4f),
-				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
-				);
-
-			m_dynamicTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 1024 * sizeof(GPUDecal) / sizeof(vec4f),
-				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
-				);
-
-			if (!m_staticTB || !m_dynamicTB)
+			if (!m_staticDecalsGPU.init(g_maxDecals) || !m_dynamicDecalsGPU.init(g_maxDecals))
 			{
 				ERROR_MSG("Can't create texture buffers.");
 				return false;
@@ -98,11 +100,11 @@ namespace render
 				op.m_instanceSize = sizeof(GPUDecal);
 				
 				//-- create ROP for static decals.
-				op.m_instanceTB = m_staticTB.get();
+				op.m_instanceTB = m_staticDecalsGPU.buffer();
 				m_ROPs.push_back(op);
 
 				//-- create ROP for dynamic decals.
-				op.m_instanceTB = m_dynamicTB.get();
+				op.m_instanceTB = m_dynamicDecalsGPU.buffer();
 				m_ROPs.push_back(op);
 			}
 		}
@@ -113,42 +115,21 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void DecalManager::update(float /*dt*/)
 	{
-		//-- 1. update static decals.
-		if (m_updateStatic)
+		//-- 1. update dynamic decals. Only slots of the really moved decals become dirty.
+		for (uint i = 0; i < m_dynamicDecalDescs.size(); ++i)
 		{
-			m_staticDecalsGPU.clear();
-			m_staticDecalsGPU.resize(m_staticDecalDescs.size());
-
-			for (uint i = 0; i < m_staticDecalDescs.size(); ++i)
-			{
-				const DecalDesc& desc = m_staticDecalDescs[i];
-				GPUDecal& gpu		  = m_staticDecalsGPU[i];
+			const DynamicDecalDesc& desc  = m_dynamicDecalDescs[i];
+			const mat4f&			world = desc.second->matrix();
 
-				gpu.m_dir   = desc.m_dir.toVec4();
-				gpu.m_pos   = desc.m_pos.toVec4();
-				gpu.m_up    = desc.m_up.toVec4();
-				gpu.m_scale = desc.m_scale.toVec4();
-			}
+			m_dynamicDecalsGPU.set(i, GPUDecal(
+				world.applyToVector(desc.first.m_dir), world.applyToPoint(desc.first.m_pos),
+				world.applyToVector(desc.first.m_up), desc.first.m_scale
+				));
 		}
 
-		//-- 2. update dynamic decals.
-		if (m_updateDynamic)
-		{
-			m_dynamicDecalsGPU.clear();
-			m_dynamicDecalsGPU.resize(m_dynamicDecalDescs.size());
-
-			for (uint i = 0; i < m_dynamicDecalDescs.size(); ++i)
-			{
-				const DynamicDecalDesc& desc = m_dynamicDecalDescs[i];
-				GPUDecal& gpu				 = m_dynamicDecalsGPU[i];
-				const mat4f& world			 = desc.second->matrix();
-
-				gpu.m_dir   = world.applyToVector(desc.first.m_dir).toVec4();
-				gpu.m_pos   = world.applyToPoint(desc.first.m_pos).toVec4();
-				gpu.m_up    = world.applyToVector(desc.first.m_up).toVec4();
-				gpu.m_scale = desc.first.m_scale.toVec4();
-			}
-		}
+		//-- 2. upload changes. Static decals are written into theirs slots only once on adding.
+		g_decalsUploadBytes  = m_staticDecalsGPU.upload();
+		g_decalsUploadBytes += m_dynamicDecalsGPU.upload();
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -157,21 +138,20 @@ namespace render
 		uint count = 0;
 
 		//-- setup static decals ROP.
-		if (!m_staticDecalsGPU.empty())
+		//-- Note: instance data is already on the GPU, so m_instanceData stays null.
+		if (!m_staticDecalDescs.empty())
 		{
 			ops.push_back(m_ROPs[0]);
-			ops.back().m_instanceCount = m_staticDecalsGPU.size();
-			ops.back().m_instanceData  = &m_staticDecalsGPU.front();
+			ops.back().m_instanceCount = m_staticDecalDescs.size();
 
 			++count;
 		}
 
 		//-- setup dynamic decals ROP.
-		if (!m_dynamicDecalsGPU.empty())
+		if (!m_dynamicDecalDescs.empty())
 		{
 			ops.push_back(m_ROPs[1]);
-			ops.back().m_instanceCount = m_dynamicDecalsGPU.size();
-			ops.back().m_instanceData  = &m_dynamicDecalsGPU.front();
+			ops.back().m_instanceCount = m_dynamicDecalDescs.size();
 
 			++count;
 		}
@@ -182,20 +162,29 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void DecalManager::addStaticDecal(const mat4f& orient, const vec3f& scale)
 	{
-		m_updateStatic = true;
+		if (m_staticDecalDescs.size() >= m_staticDecalsGPU.capacity())
+		{
+			WARNING_MSG("Too many static decals.");
+			return;
+		}
 
 		vec3f dir = orient.applyToUnitAxis(2);
 		vec3f up  = orient.applyToUnitAxis(1);
 		vec3f pos = orient.applyToOrigin();
 
 		DecalDesc decal(dir, pos, up, scale);
+		m_staticDecalsGPU.set(m_staticDecalDescs.size(), GPUDecal(dir, pos, up, scale));
 		m_staticDecalDescs.push_back(decal);
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void DecalManager::addDynamicDecal(const mat4f& orient, const vec3f& scale, const Node* node)
 	{
-		m_updateDynamic = true;
+		if (m_dynamicDecalDescs.size() >= m_dynamicDecalsGPU.capacity())
+		{
+			WARNING_MSG("Too many dynamic decals.");
+			return;
+		}
 
 		vec3f dir = orient.applyToUnitAxis(2);
 		vec3f up  = orient.applyToUnitAxis(1);
@@ -2,6 +2,7 @@
 
 #include "prerequisites.hpp"
 #include "render_system.hpp"
+#include "persistent_buffer.hpp"
 #include "math/Vector3.hpp"
 #include "math/Vector4.hpp"
 #include <vector>
@@ -44,6 +45,10 @@ namespace render
 
 		struct GPUDecal
 		{
+			GPUDecal() { }
+			GPUDecal(const vec3f& dir, const vec3f& pos, const vec3f& up, const vec3f& scale)
+				: m_dir(dir.toVec4()), m_pos(pos.toVec4()), m_up(up.toVec4()), m_scale(scale.toVec4()) { }
+
 			vec4f m_dir;
 			vec4f m_pos;
 			vec4f m_up;
@@ -53,17 +58,14 @@ namespace render
 		typedef std::pair<DecalDesc, const Node*>	DynamicDecalDesc;
 
 
-		bool							m_updateStatic;
-		bool							m_updateDynamic;
-
-		std::vector<GPUDecal>			m_staticDecalsGPU;
-		std::vector<GPUDecal>			m_dynamicDecalsGPU;
+		//-- GPU copies of the decals. Static decals are written once, dynamic ones are uploaded
+		//-- only if theirs node has moved.
+		PersistentBuffer<GPUDecal>		m_staticDecalsGPU;
+		PersistentBuffer<GPUDecal>		m_dynamicDecalsGPU;
 
 		std::vector<DecalDesc>			m_staticDecalDescs;
 		std::vector<DynamicDecalDesc>	m_dynamicDecalDescs;
 
-		std::shared_ptr<IBuffer>		m_staticTB;
-		std::shared_ptr<IBuffer>		m_dynamicTB;
 		std::shared_ptr<Mesh>			m_unitCube;
 		std::shared_ptr<Material>		m_material;
 		RenderOps						m_ROPs;
@@ -0,0 +1,252 @@
+#include "geometry_pool.hpp"
+#include "render_system.hpp"
+
+using namespace brUGE;
+using namespace brUGE::render;
+using namespace brUGE::math;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- watchers.
+	uint g_geometryHeaps	= 0;
+	uint g_pooledVertices	= 0;
+	uint g_pooledIndices	= 0;
+
+	//-- first-fit allocator of the ranges. Free ranges are sorted by offset and the adjacent ones
+	//-- are merged back on release.
+	//----------------------------------------------------------------------------------------------
+	class RangeAllocator
+	{
+	public:
+		//------------------------------------------------------------------------------------------
+		void init(uint size)
+		{
+			m_freeRanges.assign(1, Range{ 0, size });
+		}
+
+		//------------------------------------------------------------------------------------------
+		bool allocate(uint size, uint& oOffset)
+		{
+			for (uint i = 0; i < m_freeRanges.size(); ++i)
+			{
+				Range& range = m_freeRanges[i];
+				if (range.m_size < size)
+					continue;
+
+				oOffset		    = range.m_offset;
+				range.m_offset += size;
+				range.m_size   -= size;
+
+				if (range.m_size == 0)
+				{
+					m_freeRanges.erase(m_freeRanges.begin() + i);
+				}
+				return true;
+			}
+			return false;
+		}
+
+		//------------------------------------------------------------------------------------------
+		void free(uint offset, uint size)
+		{
+			if (size == 0)
+				return;
+
+			uint i = 0;
+			while (i < m_freeRanges.size() && m_freeRanges[i].m_offset < offset)
+			{
+				++i;
+			}
+			m_freeRanges.insert(m_freeRanges.begin() + i, Range{ offset, size });
+
+			//-- merge with the next one.
+			if (i + 1 < m_freeRanges.size() && offset + size == m_freeRanges[i + 1].m_offset)
+			{
+				m_freeRanges[i].m_size += m_freeRanges[i + 1].m_size;
+				m_freeRanges.erase(m_freeRanges.begin() + i + 1);
+			}
+
+			//-- merge with the previous one.
+			if (i > 0 && m_freeRanges[i - 1].m_offset + m_freeRanges[i - 1].m_size == offset)
+			{
+				m_freeRanges[i - 1].m_size += m_freeRanges[i].m_size;
+				m_freeRanges.erase(m_freeRanges.begin() + i);
+			}
+		}
+
+	private:
+		struct Range
+		{
+			uint m_offset;
+			uint m_size;
+		};
+
+		std::vector<Range> m_freeRanges;
+	};
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- vertex and index buffers of the one layout.
+	//----------------------------------------------------------------------------------------------
+	struct GeometryPool::Heap
+	{
+		Layout									m_layout;
+		uint									m_indexSize;
+		std::vector<std::shared_ptr<IBuffer>>	m_VBs;
+		std::vector<IBuffer*>					m_pVBs;
+		std::shared_ptr<IBuffer>				m_IB;
+		RangeAllocator							m_vertices;
+		RangeAllocator							m_indices;
+	};
+
+	//----------------------------------------------------------------------------------------------
+	GeometryPool::GeometryPool()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	GeometryPool::~GeometryPool()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool GeometryPool::init()
+	{
+		REGISTER_RO_WATCHER("geometry heaps", uint, g_geometryHeaps);
+		REGISTER_RO_WATCHER("pooled vertices", uint, g_pooledVertices);
+		REGISTER_RO_WATCHER("pooled indices", uint, g_pooledIndices);
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool GeometryPool::allocate(const Layout& layout, uint indexSize, uint numVertices, uint numIndices, Allocation& oAlloc)
+	{
+		uint baseVertex = 0;
+		uint startIndex = 0;
+
+		//-- 1. try to find place in one of the existing heaps of this layout.
+		std::shared_ptr<Heap> heap;
+		for (const auto& h : m_heaps)
+		{
+			if (h->m_layout != layout || h->m_indexSize != indexSize || !h->m_vertices.allocate(numVertices, baseVertex))
+				continue;
+
+			if (!h->m_indices.allocate(numIndices, startIndex))
+			{
+				h->m_vertices.free(baseVertex, numVertices);
+				continue;
+			}
+
+			heap = h;
+			break;
+		}
+
+		//-- 2. create new one. Geometry bigger than the default heap gets its own heap.
+		if (!heap)
+		{
+			heap = createHeap(layout, indexSize, max<uint>(numVertices, HEAP_VERTICES), max<uint>(numIndices, HEAP_INDICES));
+			if (!heap)
+				return false;
+
+			heap->m_vertices.allocate(numVertices, baseVertex);
+			heap->m_indices.allocate(numIndices, startIndex);
+		}
+
+		oAlloc.m_heap		 = heap;
+		oAlloc.m_VBs		 = &heap->m_pVBs[0];
+		oAlloc.m_IB			 = heap->m_IB.get();
+		oAlloc.m_baseVertex	 = baseVertex;
+		oAlloc.m_numVertices = numVertices;
+		oAlloc.m_startIndex	 = startIndex;
+		oAlloc.m_numIndices	 = numIndices;
+
+		g_pooledVertices += numVertices;
+		g_pooledIndices	 += numIndices;
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPool::free(Allocation& alloc)
+	{
+		if (!alloc.isValid())
+			return;
+
+		alloc.m_heap->m_vertices.free(alloc.m_baseVertex, alloc.m_numVertices);
+		alloc.m_heap->m_indices.free(alloc.m_startIndex, alloc.m_numIndices);
+
+		g_pooledVertices -= alloc.m_numVertices;
+		g_pooledIndices	 -= alloc.m_numIndices;
+
+		alloc = Allocation();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPool::writeVertices(const Allocation& alloc, uint stream, const void* data)
+	{
+		assert(alloc.isValid() && stream < alloc.m_heap->m_layout.size());
+
+		uint elemSize = alloc.m_heap->m_layout[stream];
+		alloc.m_VBs[stream]->update(data, alloc.m_baseVertex * elemSize, alloc.m_numVertices * elemSize);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void GeometryPool::writeIndices(const Allocation& alloc, uint offset, const void* data, uint count)
+	{
+		assert(alloc.isValid() && offset + count <= alloc.m_numIndices);
+
+		uint indexSize = alloc.m_heap->m_indexSize;
+		alloc.m_IB->update(data, (alloc.m_startIndex + offset) * indexSize, count * indexSize);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	std::shared_ptr<GeometryPool::Heap> GeometryPool::createHeap(
+		const Layout& layout, uint indexSize, uint numVertices, uint numIndices)
+	{
+		auto heap = std::make_shared<Heap>();
+
+		heap->m_layout	  = layout;
+		heap->m_indexSize = indexSize;
+		heap->m_vertices.init(numVertices);
+		heap->m_indices.init(numIndices);
+
+		heap->m_VBs.resize(layout.size());
+		heap->m_pVBs.resize(layout.size());
+		for (uint i = 0; i < layout.size(); ++i)
+		{
+			heap->m_VBs[i]  = rd()->createBuffer(IBuffer::TYPE_VERTEX, nullptr, numVertices, layout[i]);
+			heap->m_pVBs[i] = heap->m_VBs[i].get();
+
+			if (!heap->m_VBs[i])
+			{
+				ERROR_MSG("Can't create vertex buffer of the geometry heap.");
+				return nullptr;
+			}
+		}
+
+		heap->m_IB = rd()->createBuffer(IBuffer::TYPE_INDEX, nullptr, numIndices, indexSize);
+		if (!heap->m_IB)
+		{
+			ERROR_MSG("Can't create index buffer of the geometry heap.");
+			return nullptr;
+		}
+
+		m_heaps.push_back(heap);
+		g_geometryHeaps = m_heaps.size();
+
+		return heap;
+	}
+
+} //-- render
+} //-- brUGE
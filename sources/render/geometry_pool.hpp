@@ -0,0 +1,72 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "render_common.h"
+#include "render/IBuffer.h"
+#include <vector>
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- Shared storage of the mesh geometry. Sub-meshes with the same vertex layout are sub-allocated
+	//-- from a few big vertex and index heaps, so the consecutive draw calls mostly use the same
+	//-- buffers and the device doesn't need to rebind them. Sub-mesh inside the heap is addressed by
+	//-- its base vertex and start index. Indices are relative to the base vertex, so 16 bit indices
+	//-- are enough for the most of sub-meshes regardless of the heap size, the bigger ones go to the
+	//-- heaps with 32 bit indices.
+	//----------------------------------------------------------------------------------------------
+	class GeometryPool : public NonCopyable
+	{
+	public:
+		enum
+		{
+			HEAP_VERTICES = 256 * 1024,
+			HEAP_INDICES  = 1024 * 1024
+		};
+
+		//-- element size of the each vertex stream.
+		typedef std::vector<uint8> Layout;
+
+		struct Heap;
+
+		//-- one sub-allocation. The heap stays alive while any of its allocations is alive.
+		//------------------------------------------------------------------------------------------
+		struct Allocation
+		{
+			Allocation() : m_VBs(nullptr), m_IB(nullptr), m_baseVertex(0), m_numVertices(0), m_startIndex(0), m_numIndices(0) { }
+
+			bool					isValid() const { return m_heap != nullptr; }
+
+			std::shared_ptr<Heap>	m_heap;
+			IBuffer**				m_VBs;	//-- vertex buffers of the heap, one per stream.
+			IBuffer*				m_IB;
+			uint					m_baseVertex;
+			uint					m_numVertices;
+			uint					m_startIndex;
+			uint					m_numIndices;
+		};
+
+	public:
+		GeometryPool();
+		~GeometryPool();
+
+		bool			init();
+
+		bool			allocate(const Layout& layout, uint indexSize, uint numVertices, uint numIndices, Allocation& oAlloc);
+		static void		free(Allocation& alloc);
+
+		//-- upload geometry into the allocation. Index offset is relative to the allocation start.
+		void			writeVertices(const Allocation& alloc, uint stream, const void* data);
+		void			writeIndices(const Allocation& alloc, uint offset, const void* data, uint count);
+
+	private:
+		std::shared_ptr<Heap>	createHeap(const Layout& layout, uint indexSize, uint numVertices, uint numIndices);
+
+	private:
+		std::vector<std::shared_ptr<Heap>> m_heaps;
+	};
+
+} //-- render
+} //-- brUGE
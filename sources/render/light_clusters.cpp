@@ -0,0 +1,374 @@
+#include "light_clusters.hpp"
+#include "render_system.hpp"
+#include "math/math_all.hpp"
+#include "engine/Engine.h"
+#include "engine/job_system.hpp"
+#include <cfloat>
+#include <cstring>
+
+using namespace brUGE::math;
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//----------------------------------------------------------------------------------------------
+	inline bool isSphereIntersectAABB(const vec3f& center, float radius, const AABB& aabb)
+	{
+		float distSq = 0.0f;
+		for (uint i = 0; i < 3; ++i)
+		{
+			if		(center[i] < aabb.m_min[i]) distSq += (aabb.m_min[i] - center[i]) * (aabb.m_min[i] - center[i]);
+			else if (center[i] > aabb.m_max[i]) distSq += (center[i] - aabb.m_max[i]) * (center[i] - aabb.m_max[i]);
+		}
+		return distSq <= radius * radius;
+	}
+
+	//-- cone vs sphere test described by Bart Wronski in "Cull that cone!".
+	//----------------------------------------------------------------------------------------------
+	inline bool isConeIntersectSphere(const brUGE::render::ClusterLight& cone, const vec3f& center, float radius)
+	{
+		vec3f v			  = center - cone.m_pos;
+		float lenSq		  = v.dot(v);
+		float v1Len		  = v.dot(cone.m_dir);
+		float distClosest = cone.m_cosAngle * sqrtf(max(0.0f, lenSq - v1Len * v1Len)) - v1Len * cone.m_sinAngle;
+
+		bool angleCull = distClosest > radius;
+		bool frontCull = v1Len > radius + cone.m_radius;
+		bool backCull  = v1Len < -radius;
+
+		return !(angleCull || frontCull || backCull);
+	}
+
+	//-- convert NDC coordinate into the tile index.
+	//----------------------------------------------------------------------------------------------
+	inline uint16 ndcToTile(float ndc, uint tilesCount)
+	{
+		int tile = static_cast<int>(floorf((ndc * 0.5f + 0.5f) * tilesCount));
+		return static_cast<uint16>(clamp<int>(0, tile, tilesCount - 1));
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+
+namespace brUGE
+{
+namespace render
+{
+
+	//----------------------------------------------------------------------------------------------
+	LightClusters::LightClusters()
+		:	m_near(0.0f), m_far(0.0f), m_sliceScale(0.0f), m_overflowed(false), m_lights(nullptr),
+			m_pointsCount(0)
+	{
+		m_proj.setZero();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	LightClusters::~LightClusters()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool LightClusters::init()
+	{
+		m_bounds.resize(CLUSTERS_COUNT);
+		m_clusters.resize(CLUSTERS_COUNT);
+		m_sliceLights.resize(SLICES);
+		m_indices.reserve(MAX_LIGHT_INDICES);
+
+		//-- two clusters per texel.
+		m_clustersTB = rd()->createBuffer(
+			IBuffer::TYPE_TEXTURE, NULL, CLUSTERS_COUNT / 2, sizeof(vec4f),
+			IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+			);
+
+		//-- eight 16 bit indices per texel.
+		m_indicesTB = rd()->createBuffer(
+			IBuffer::TYPE_TEXTURE, NULL, MAX_LIGHT_INDICES / 8, sizeof(vec4f),
+			IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+			);
+
+		if (!m_clustersTB || !m_indicesTB)
+		{
+			ERROR_MSG("Can't create light clusters texture buffers.");
+			return false;
+		}
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::build(
+		const RenderCamera& cam, const ClusterLights& lights, uint pointsCount, uint maxThreads)
+	{
+		m_lights	  = &lights;
+		m_pointsCount = pointsCount;
+		m_overflowed  = false;
+
+		//-- 1. clusters bounds depend only on the projection, so rebuild them only if it has changed.
+		if (memcmp(&m_proj, &cam.m_proj, sizeof(mat4f)) != 0)
+		{
+			updateClustersBounds(cam);
+		}
+
+		//-- 2. find out range of the clusters for each light and distribute lights among slices.
+		m_ranges.resize(lights.size());
+		for (uint s = 0; s < SLICES; ++s)
+		{
+			m_sliceLights[s].clear();
+		}
+
+		for (uint i = 0; i < lights.size(); ++i)
+		{
+			LightRange& range = m_ranges[i];
+			calcLightRange(range, lights[i]);
+
+			for (uint s = range.m_minZ; s <= range.m_maxZ; ++s)
+			{
+				m_sliceLights[s].push_back(static_cast<uint16>(i));
+			}
+		}
+
+		//-- 3. bin lights. Slices are independent so split them between the jobs. For a small
+		//--	lights count the scheduling overhead is bigger than the binning itself.
+		uint workers = (lights.size() < 64) ? 1 : clamp<uint>(1, maxThreads, SLICES);
+		uint slicesPerWorker = (SLICES + workers - 1) / workers;
+
+		m_batches.resize(workers);
+		Engine::instance().jobSystem().parallelFor(workers, 1, [this, slicesPerWorker](uint first, uint last)
+		{
+			for (uint i = first; i < last; ++i)
+			{
+				binSlices(
+					m_batches[i], min<uint>(i * slicesPerWorker, SLICES), min<uint>((i + 1) * slicesPerWorker, SLICES)
+					);
+			}
+		});
+
+		//-- 4. merge batches into the final lists.
+		m_indices.clear();
+		for (const auto& batch : m_batches)
+		{
+			uint base  = m_indices.size();
+			uint first = batch.m_firstSlice * TILES_X * TILES_Y;
+			uint avail = MAX_LIGHT_INDICES - base;
+			uint count = min<uint>(batch.m_indices.size(), avail);
+
+			m_indices.insert(m_indices.end(), batch.m_indices.begin(), batch.m_indices.begin() + count);
+
+			for (uint i = 0; i < batch.m_clusters.size(); ++i)
+			{
+				const vec2ui& src = batch.m_clusters[i];
+				uint offset = src.x;
+				uint points = src.y & 0xffff;
+				uint spots  = src.y >> 16;
+
+				//-- truncate the lists on overflow. The point lights of the cluster go first, so
+				//-- the spot ones are dropped first.
+				if (offset + points + spots > count)
+				{
+					points = min(points, count - min(offset, count));
+					spots  = min(spots,  count - min(offset + points, count));
+					m_overflowed = true;
+				}
+
+				m_clusters[first + i] = vec2ui(base + offset, points | (spots << 16));
+			}
+		}
+
+		//-- 5. shader constants.
+		m_gpuGrid.m_grid   = vec4f(TILES_X, TILES_Y, SLICES, m_sliceScale);
+		m_gpuGrid.m_params = vec4f(m_near, m_far, 0.0f, 0.0f);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::upload()
+	{
+		if (void* data = m_clustersTB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
+		{
+			memcpy(data, &m_clusters[0], m_clusters.size() * sizeof(vec2ui));
+			m_clustersTB->unmap();
+		}
+
+		if (!m_indices.empty())
+		{
+			if (void* data = m_indicesTB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
+			{
+				memcpy(data, &m_indices[0], m_indices.size() * sizeof(uint16));
+				m_indicesTB->unmap();
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::bind(IShader& shader) const
+	{
+		shader.setUniformBlock("cb_clusterGrid", &m_gpuGrid, sizeof(GPUClusterGrid));
+		shader.setTextureBuffer("tb_lightClusters", m_clustersTB.get());
+		shader.setTextureBuffer("tb_lightIndices", m_indicesTB.get());
+	}
+
+	//-- Slices are distributed exponentially between near and far planes, so froxels have
+	//-- approximately cubic shape.
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::updateClustersBounds(const RenderCamera& cam)
+	{
+		m_proj		 = cam.m_proj;
+		m_near		 = cam.m_projInfo.nearDist;
+		m_far		 = cam.m_projInfo.farDist;
+		m_sliceScale = SLICES / logf(m_far / m_near);
+
+		const float invXScale = 1.0f / m_proj(0, 0);
+		const float invYScale = 1.0f / m_proj(1, 1);
+
+		for (uint s = 0; s < SLICES; ++s)
+		{
+			float z[2] =
+			{
+				m_near * powf(m_far / m_near, static_cast<float>(s + 0) / SLICES),
+				m_near * powf(m_far / m_near, static_cast<float>(s + 1) / SLICES)
+			};
+
+			for (uint y = 0; y < TILES_Y; ++y)
+			{
+				//-- tiles go from the top of the screen.
+				float ndcY[2] = { 1.0f - 2.0f * (y + 0) / TILES_Y, 1.0f - 2.0f * (y + 1) / TILES_Y };
+
+				for (uint x = 0; x < TILES_X; ++x)
+				{
+					float ndcX[2] = { -1.0f + 2.0f * (x + 0) / TILES_X, -1.0f + 2.0f * (x + 1) / TILES_X };
+
+					AABB& aabb = m_bounds[(s * TILES_Y + y) * TILES_X + x];
+					aabb.setEmpty();
+
+					for (uint i = 0; i < 8; ++i)
+					{
+						float zi = z[(i >> 2) & 1];
+						aabb.include(vec3f(ndcX[i & 1] * zi * invXScale, ndcY[(i >> 1) & 1] * zi * invYScale, zi));
+					}
+				}
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::calcLightRange(LightRange& range, const ClusterLight& light) const
+	{
+		const vec3f& pos = light.m_pos;
+		const float  r	 = light.m_radius;
+
+		range.m_minZ = static_cast<uint16>(calcSlice(pos.z - r));
+		range.m_maxZ = static_cast<uint16>(calcSlice(pos.z + r));
+
+		//-- light intersects the near plane, so it may affect any tile.
+		if (pos.z - r <= m_near)
+		{
+			range.m_minX = 0;
+			range.m_maxX = TILES_X - 1;
+			range.m_minY = 0;
+			range.m_maxY = TILES_Y - 1;
+			return;
+		}
+
+		//-- project corners of the light's bounding box on the screen.
+		vec2f ndcMin( FLT_MAX,  FLT_MAX);
+		vec2f ndcMax(-FLT_MAX, -FLT_MAX);
+		for (uint i = 0; i < 8; ++i)
+		{
+			vec3f corner(
+				pos.x + ((i & 1) ? r : -r), pos.y + ((i & 2) ? r : -r), pos.z + ((i & 4) ? r : -r)
+				);
+
+			vec2f ndc(corner.x * m_proj(0, 0) / corner.z, corner.y * m_proj(1, 1) / corner.z);
+
+			ndcMin.x = min(ndcMin.x, ndc.x);
+			ndcMin.y = min(ndcMin.y, ndc.y);
+			ndcMax.x = max(ndcMax.x, ndc.x);
+			ndcMax.y = max(ndcMax.y, ndc.y);
+		}
+
+		range.m_minX = ndcToTile(ndcMin.x, TILES_X);
+		range.m_maxX = ndcToTile(ndcMax.x, TILES_X);
+
+		//-- tiles go from the top of the screen, so flip Y axis.
+		range.m_minY = ndcToTile(-ndcMax.y, TILES_Y);
+		range.m_maxY = ndcToTile(-ndcMin.y, TILES_Y);
+	}
+
+	//-- Lights are processed per cluster, so every cluster gets the contiguous list. Slice lists
+	//-- are sorted by the light index, so point lights always go before the spot ones.
+	//----------------------------------------------------------------------------------------------
+	void LightClusters::binSlices(SliceBatch& batch, uint firstSlice, uint lastSlice) const
+	{
+		const ClusterLights& lights = *m_lights;
+
+		batch.m_firstSlice = firstSlice;
+		batch.m_indices.clear();
+		batch.m_clusters.resize((lastSlice - firstSlice) * TILES_X * TILES_Y);
+
+		uint localIdx = 0;
+		for (uint s = firstSlice; s < lastSlice; ++s)
+		{
+			const std::vector<uint16>& sliceLights = m_sliceLights[s];
+
+			for (uint y = 0; y < TILES_Y; ++y)
+			{
+				for (uint x = 0; x < TILES_X; ++x, ++localIdx)
+				{
+					const AABB& aabb   = m_bounds[(s * TILES_Y + y) * TILES_X + x];
+					uint		offset = batch.m_indices.size();
+					uint		points = 0;
+					uint		spots  = 0;
+
+					for (uint i = 0; i < sliceLights.size(); ++i)
+					{
+						uint16			  id	= sliceLights[i];
+						const LightRange& range = m_ranges[id];
+
+						if (x < range.m_minX || x > range.m_maxX || y < range.m_minY || y > range.m_maxY)
+							continue;
+
+						const ClusterLight& light = lights[id];
+						if (!isSphereIntersectAABB(light.m_pos, light.m_radius, aabb))
+							continue;
+
+						if (id < m_pointsCount)
+						{
+							batch.m_indices.push_back(light.m_index);
+							++points;
+						}
+						else
+						{
+							vec3f center = aabb.m_min + aabb.m_max;
+							float radius = (aabb.m_max - aabb.m_min).length() * 0.5f;
+							center *= 0.5f;
+
+							if (!isConeIntersectSphere(light, center, radius))
+								continue;
+
+							batch.m_indices.push_back(light.m_index);
+							++spots;
+						}
+					}
+
+					batch.m_clusters[localIdx] = vec2ui(offset, points | (spots << 16));
+				}
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint LightClusters::calcSlice(float z) const
+	{
+		if (z <= m_near)
+			return 0;
+
+		int slice = static_cast<int>(logf(z / m_near) * m_sliceScale);
+		return clamp<int>(0, slice, SLICES - 1);
+	}
+
+} //-- render
+} //-- brUGE
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "render_common.h"
+#include "math/AABB.hpp"
+#include "math/Vector2.hpp"
+#include "math/Vector3.hpp"
+#include "math/Vector4.hpp"
+#include "utils/linear_allocator.hpp"
+#include <vector>
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- Light prepared for clustering. All values are in the view space.
+	//----------------------------------------------------------------------------------------------
+	struct ClusterLight
+	{
+		vec3f m_pos;
+		float m_radius;
+
+		//-- spot light only.
+		vec3f m_dir;
+		float m_cosAngle;
+		float m_sinAngle;
+
+		//-- index of the light inside the GPU buffer of its type.
+		uint16 m_index;
+	};
+	typedef utils::ArenaVector<ClusterLight> ClusterLights;
+
+
+	//-- Splits the view frustum into the 3D grid of froxels (screen tiles x exponential depth slices)
+	//-- and assigns to every froxel the list of the point and spot lights affecting it. Light lists
+	//-- are packed into the texture buffers, so the whole scene lighting may be resolved in one
+	//-- full-screen pass regardless of the lights count.
+	//-- Binning is done per depth slice and may be split between several jobs, because every slice
+	//-- is processed independently.
+	//----------------------------------------------------------------------------------------------
+	class LightClusters : public NonCopyable
+	{
+	public:
+		enum
+		{
+			TILES_X				= 16,
+			TILES_Y				= 8,
+			SLICES				= 24,
+			CLUSTERS_COUNT		= TILES_X * TILES_Y * SLICES,
+			MAX_LIGHT_INDICES	= 32768	//-- 16 bit indices packed in 4096 texels.
+		};
+
+		//-- constants of the shader to find out the cluster of the pixel.
+		struct GPUClusterGrid
+		{
+			vec4f m_grid;	//-- tiles x, tiles y, slices, slices / log(far / near).
+			vec4f m_params; //-- near, far, padding.
+		};
+
+	public:
+		LightClusters();
+		~LightClusters();
+
+		bool					init();
+
+		//-- lights [0, pointsCount) are point lights, the rest ones are spot lights.
+		void					build(
+									const RenderCamera& cam, const ClusterLights& lights,
+									uint pointsCount, uint maxThreads
+									);
+
+		//-- upload light lists to the GPU and bind them to the shader.
+		void					upload();
+		void					bind(IShader& shader) const;
+
+		uint					lightIndicesCount() const	{ return m_indices.size(); }
+		bool					isOverflowed() const		{ return m_overflowed; }
+
+	private:
+		//-- range of the clusters affected by the light.
+		struct LightRange
+		{
+			uint16 m_minX, m_maxX;
+			uint16 m_minY, m_maxY;
+			uint16 m_minZ, m_maxZ;
+		};
+
+		//-- output of the one worker thread.
+		struct SliceBatch
+		{
+			uint				m_firstSlice;
+			std::vector<uint16>	m_indices;
+			std::vector<vec2ui>	m_clusters; //-- local offset, point count | spot count << 16.
+		};
+
+		void					updateClustersBounds(const RenderCamera& cam);
+		void					calcLightRange(LightRange& range, const ClusterLight& light) const;
+		void					binSlices(SliceBatch& batch, uint firstSlice, uint lastSlice) const;
+		uint					calcSlice(float z) const;
+
+	private:
+		mat4f						m_proj;
+		float						m_near;
+		float						m_far;
+		float						m_sliceScale;
+		bool						m_overflowed;
+
+		//-- per-frame input.
+		const ClusterLights*				m_lights;
+		uint								m_pointsCount;
+		std::vector<LightRange>				m_ranges;
+		std::vector<std::vector<uint16>>	m_sliceLights;
+
+		//-- output.
+		std::vector<AABB>			m_bounds;
+		std::vector<SliceBatch>		m_batches;
+		std::vector<vec2ui>			m_clusters;
+		std::vector<uint16>			m_indices;
+
+		std::shared_ptr<IBuffer>	m_clustersTB;
+		std::shared_ptr<IBuffer>	m_indicesTB;
+		GPUClusterGrid				m_gpuGrid;
+	};
+
+} //-- render
+} //-- brUGE
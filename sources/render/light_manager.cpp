@@ -1,32 +1,87 @@
 #include "light_manager.hpp"
+#include "shadow_manager.hpp"
 #include "Mesh.hpp"
 #include "loader/ResourcesManager.h"
 #include "os/FileSystem.h"
+#include "math/math_all.hpp"
+#include "console/WatchersPanel.h"
+#include "console/Console.h"
+#include "engine/Engine.h"
+#include "engine/frame_memory.hpp"
+#include "SDL/SDL_timer.h"
+#include <cstdlib>
+#include <cstring>
 
 using namespace brUGE::os;
+using namespace brUGE::math;
 
 //-- start unnamed namespace.
 //--------------------------------------------------------------------------------------------------
 namespace
 {
+	//-- max number of the lights slots on the GPU side. Point and spot lights have to match the
+	//-- tbuffers of the clustered_lights_resolve.hlsl.
+	const uint g_maxDirLights	= 16;
+	const uint g_maxPointLights = 1024;
+	const uint g_maxSpotLights	= 1024;
+
+	bool g_enableClusteredLights = true;
+	uint g_clusterThreads		 = 4;
+	uint g_visiblePointLights	 = 0;
+	uint g_visibleSpotLights	 = 0;
+	uint g_clusterLightIndices	 = 0;
+	uint g_lightsUploadBytes	 = 0;
+	uint g_droppedLights		 = 0;
+
+	//----------------------------------------------------------------------------------------------
+	inline float randomFloat(float minVal, float maxVal)
+	{
+		return minVal + (maxVal - minVal) * (rand() / static_cast<float>(RAND_MAX));
+	}
+
 	//-- template version of the add*Light function to minimize overhead of the duplicating code.
+	//-- Released slots are reused first.
 	//----------------------------------------------------------------------------------------------
 	template<typename T>
-	Handle addLight(std::vector<std::pair<bool, T>>& container, const T& light)
+	Handle addLight(std::vector<std::pair<bool, T>>& container, std::vector<Handle>& freeSlots, const T& light)
 	{
-		for (uint i = 0; i != container.size(); ++i)
+		if (!freeSlots.empty())
 		{
-			if (!container[i].first)
-			{
-				container[i] = std::make_pair(true, light);
-				return i;
-			}
+			Handle id = freeSlots.back();
+			freeSlots.pop_back();
+
+			container[id] = std::make_pair(true, light);
+			return id;
 		}
 
 		container.push_back(std::make_pair(true, light));
 		return container.size() - 1;
 	}
 
+	//-- count of the alive lights in the slots [first, size).
+	//----------------------------------------------------------------------------------------------
+	template<typename T>
+	uint countLights(const std::vector<std::pair<bool, T>>& container, uint first)
+	{
+		uint count = 0;
+		for (uint i = first; i < container.size(); ++i)
+		{
+			count += container[i].first ? 1 : 0;
+		}
+		return count;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<typename T>
+	void delLight(std::vector<std::pair<bool, T>>& container, std::vector<Handle>& freeSlots, Handle id)
+	{
+		if (container[id].first)
+		{
+			container[id].first = false;
+			freeSlots.push_back(id);
+		}
+	}
+
 }
 //--------------------------------------------------------------------------------------------------
 //-- end unnamed namespace.
@@ -37,9 +92,17 @@ namespace brUGE
 namespace render
 {
 	//----------------------------------------------------------------------------------------------
-	LightsManager::LightsManager() : m_pVB(nullptr)
+	LightsManager::LightsManager() : m_dirLightsCount(0), m_lightShadowsDirty(true), m_pVB(nullptr)
 	{
-
+		REGISTER_CONSOLE_VALUE("r_lights_clustered", bool, g_enableClusteredLights);
+		REGISTER_CONSOLE_VALUE("r_lights_cluster_threads", uint, g_clusterThreads);
+		REGISTER_CONSOLE_METHOD("r_lights_benchmark", _benchmark, LightsManager);
+
+		REGISTER_RO_WATCHER("visible point lights", uint, g_visiblePointLights);
+		REGISTER_RO_WATCHER("visible spot lights", uint, g_visibleSpotLights);
+		REGISTER_RO_WATCHER("cluster light indices", uint, g_clusterLightIndices);
+		REGISTER_RO_WATCHER("lights upload bytes", uint, g_lightsUploadBytes);
+		REGISTER_RO_WATCHER("dropped lights", uint, g_droppedLights);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -97,35 +160,45 @@ namespace render
 				return false;
 			}
 
-			m_dirLightMaterial	 = mtllib[0];
-			//m_pointLightMaterial = mtllib[1];
-			//m_spotLightMaterial	 = mtllib[2];
+			if (mtllib.size() != 2)
+				return false;
+
+			m_dirLightMaterial		  = mtllib[0];
+			m_clusteredLightsMaterial = mtllib[1];
 		}
 
 		//-- create geometry instancing buffers.
 		{
-			m_dirLightsTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 16 * sizeof(GPUDirLight) / sizeof(vec4f),
-				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
-				);
+			bool success = true;
+			success &= m_gpuDirLights.init(g_maxDirLights);
+			success &= m_gpuPointLights.init(g_maxPointLights);
+			success &= m_gpuSpotLights.init(g_maxSpotLights);
 
-			m_pointLightsTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 128 * sizeof(GPUPointLight) / sizeof(vec4f),
-				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
-				);
+			if (!success)
+			{
+				ERROR_MSG("Can't create texture buffers.");
+				return false;
+			}
+		}
 
-			m_spotLightsTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 32 * sizeof(GPUSpotLight) / sizeof(vec4f),
-				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+		//-- shadows of the clustered lights. Four indices per texel.
+		{
+			m_lightShadows.resize(g_maxPointLights + g_maxSpotLights, -1);
+			m_lightShadowsTB = rd()->createBuffer(
+				IBuffer::TYPE_TEXTURE, NULL, m_lightShadows.size() / 4, sizeof(vec4f),
+				IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
 				);
 
-			if (!m_dirLightsTB || !m_pointLightsTB || !m_spotLightsTB)
+			if (!m_lightShadowsTB)
 			{
-				ERROR_MSG("Can't create texture buffers.");
+				ERROR_MSG("Can't create light shadows texture buffer.");
 				return false;
 			}
 		}
 
+		if (!m_clusters.init())
+			return false;
+
 
 		//-- create rops for drawing.
 		{
@@ -134,14 +207,18 @@ namespace render
 			op.m_primTopolpgy = PRIM_TOPOLOGY_TRIANGLE_STRIP;
 			op.m_VBs		  = &m_pVB;
 			op.m_VBCount	  = 1;
-			op.m_instanceTB	  = m_dirLightsTB.get();
+			op.m_instanceTB	  = m_gpuDirLights.buffer();
 			op.m_material	  = m_dirLightMaterial->renderFx();
 			op.m_instanceSize = sizeof(GPUDirLight);
 
 			m_ROPs.push_back(op);
 
-			//RenderOps rops;
-			//m_unitCube->gatherRenderOps(rops);
+			//-- clustered lights don't use instancing.
+			op.m_instanceTB	  = nullptr;
+			op.m_instanceSize = 0;
+			op.m_material	  = m_clusteredLightsMaterial->renderFx();
+
+			m_ROPs.push_back(op);
 		}
 
 		return true;
@@ -150,7 +227,7 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	Handle LightsManager::addDirLight(const DirectionLight& light)
 	{
-		return addLight(m_dirLights, light);
+		return addLight(m_dirLights, m_freeDirLights, light);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -162,7 +239,7 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::delDirLight(Handle id)
 	{
-		m_dirLights[id].first = false;
+		delLight(m_dirLights, m_freeDirLights, id);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -174,19 +251,28 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	Handle LightsManager::addPointLight(const PointLight& light)
 	{
-		return addLight(m_pointLights, light);
+		Handle id = addLight(m_pointLights, m_freePointLights, light);
+		if (static_cast<uint>(id) < m_gpuPointLights.capacity())
+		{
+			m_gpuPointLights.set(id, GPUPointLight(light));
+		}
+		return id;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::updatePointLight(Handle id, const PointLight& light)
 	{
 		m_pointLights[id].second = light;
+		if (static_cast<uint>(id) < m_gpuPointLights.capacity())
+		{
+			m_gpuPointLights.set(id, GPUPointLight(light));
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::delPointLight(Handle id)
 	{
-		m_pointLights[id].first = false;
+		delLight(m_pointLights, m_freePointLights, id);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -198,19 +284,28 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	Handle LightsManager::addSpotLight(const SpotLight& light)
 	{
-		return addLight(m_spotLights, light);
+		Handle id = addLight(m_spotLights, m_freeSpotLights, light);
+		if (static_cast<uint>(id) < m_gpuSpotLights.capacity())
+		{
+			m_gpuSpotLights.set(id, GPUSpotLight(light));
+		}
+		return id;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::updateSpotLight(Handle id, const SpotLight& light)
 	{
 		m_spotLights[id].second = light;
+		if (static_cast<uint>(id) < m_gpuSpotLights.capacity())
+		{
+			m_gpuSpotLights.set(id, GPUSpotLight(light));
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::delSpotLight(Handle id)
 	{
-		m_spotLights[id].first = false;
+		delLight(m_spotLights, m_freeSpotLights, id);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -222,18 +317,232 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void LightsManager::update(float /*dt*/)
 	{
-		//-- update direction lights.
-		m_gpuDirLights.clear();
-
-		for (auto i = m_dirLights.begin(); i != m_dirLights.end(); ++i)
+		//-- pack direction lights tightly, they are drawn by one instanced draw call. Only really
+		//-- changed slots will be uploaded.
+		m_dirLightsCount = 0;
+		for (auto i = m_dirLights.begin(); i != m_dirLights.end() && m_dirLightsCount < g_maxDirLights; ++i)
 		{
 			if (i->first)
 			{
-				m_gpuDirLights.push_back(GPUDirLight(i->second));
+				m_gpuDirLights.set(m_dirLightsCount++, GPUDirLight(i->second));
 			}
 		}
 
-		//-- ToDo: update another light's types.
+		//-- lights which don't have the GPU slot are never drawn. Warn only when theirs count changes.
+		uint droppedLights =
+			countLights(m_pointLights, m_gpuPointLights.capacity()) + countLights(m_spotLights, m_gpuSpotLights.capacity());
+
+		if (droppedLights != g_droppedLights && droppedLights != 0)
+		{
+			WARNING_MSG("%d point and spot lights exceed the GPU limit (%d point and %d spot lights) and won't be drawn.",
+				droppedLights, m_gpuPointLights.capacity(), m_gpuSpotLights.capacity()
+				);
+		}
+		g_droppedLights = droppedLights;
+
+		//-- update the snapshot of the render thread. Vectors keep theirs capacity, so after the
+		//-- first frames it's just a copy.
+		m_renderPointLights = m_pointLights;
+		m_renderSpotLights	= m_spotLights;
+
+		//-- upload changes.
+		g_lightsUploadBytes  = m_gpuDirLights.upload();
+		g_lightsUploadBytes += m_gpuPointLights.upload();
+		g_lightsUploadBytes += m_gpuSpotLights.upload();
+	}
+
+	//-- Called by the render thread, so it works with the snapshot of the lights taken by update().
+	//-- Point and spot lights are culled against the view frustum and then assigned to the
+	//-- clusters. Binning works in the view space. Local shadows have to be already cast this
+	//-- frame, the visible lights pick up theirs atlas tiles from the shadow manager.
+	//----------------------------------------------------------------------------------------------
+	void LightsManager::cull(const RenderCamera& cam, const ShadowManager& shadows)
+	{
+		//-- visible lights are needed only till the end of the frame.
+		m_clusterLights = ClusterLights(Engine::instance().frameMemory().frameAllocator<ClusterLight>());
+		m_clusterLights.reserve(m_renderPointLights.size() + m_renderSpotLights.size());
+
+		g_visiblePointLights  = 0;
+		g_visibleSpotLights	  = 0;
+		g_clusterLightIndices = 0;
+
+		if (!g_enableClusteredLights)
+			return;
+
+		//-- 1. point lights. Only lights having the GPU slot may be drawn.
+		for (uint i = 0; i < m_renderPointLights.size() && i < m_gpuPointLights.capacity(); ++i)
+		{
+			if (!m_renderPointLights[i].first)
+				continue;
+
+			const PointLight& light = m_renderPointLights[i].second;
+			const float		  r		= light.m_intoutRadius.y;
+
+			if (AABB(light.m_pos - vec3f(r, r, r), light.m_pos + vec3f(r, r, r)).calculateOutcode(cam.m_viewProj) != 0)
+				continue;
+
+			ClusterLight cl;
+			cl.m_pos	  = cam.m_view.applyToPoint(light.m_pos);
+			cl.m_radius	  = r;
+			cl.m_cosAngle = 0.0f;
+			cl.m_sinAngle = 0.0f;
+			cl.m_index	  = static_cast<uint16>(i);
+
+			m_clusterLights.push_back(cl);
+			setLightShadow(i, shadows.pointLightShadow(i));
+		}
+
+		uint pointsCount = m_clusterLights.size();
+
+		//-- 2. spot lights.
+		for (uint i = 0; i < m_renderSpotLights.size() && i < m_gpuSpotLights.capacity(); ++i)
+		{
+			if (!m_renderSpotLights[i].first)
+				continue;
+
+			const SpotLight& light = m_renderSpotLights[i].second;
+			const float		 r	   = light.m_startEndFading.y;
+
+			if (AABB(light.m_pos - vec3f(r, r, r), light.m_pos + vec3f(r, r, r)).calculateOutcode(cam.m_viewProj) != 0)
+				continue;
+
+			ClusterLight cl;
+			cl.m_pos	  = cam.m_view.applyToPoint(light.m_pos);
+			cl.m_radius	  = r;
+			cl.m_dir	  = cam.m_view.applyToVector(light.m_dir).getNormalized();
+			cl.m_cosAngle = clamp(-1.0f, light.m_inoutCosAngle.y, 1.0f);
+			cl.m_sinAngle = sqrtf(1.0f - cl.m_cosAngle * cl.m_cosAngle);
+			cl.m_index	  = static_cast<uint16>(i);
+
+			m_clusterLights.push_back(cl);
+			setLightShadow(g_maxPointLights + i, shadows.spotLightShadow(i));
+		}
+
+		g_visiblePointLights = pointsCount;
+		g_visibleSpotLights	 = m_clusterLights.size() - pointsCount;
+
+		if (m_clusterLights.empty())
+			return;
+
+		//-- 3. assign lights to the clusters. Light data is already on the GPU.
+		m_clusters.build(cam, m_clusterLights, pointsCount, g_clusterThreads);
+		m_clusters.upload();
+
+		g_clusterLightIndices = m_clusters.lightIndicesCount();
+
+		if (m_clusters.isOverflowed())
+		{
+			WARNING_MSG("Light clusters overflow. Some lights will be skipped.");
+		}
+
+		//-- 4. upload shadows of the lights only if any of them has changed.
+		if (m_lightShadowsDirty)
+		{
+			if (void* data = m_lightShadowsTB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
+			{
+				memcpy(data, &m_lightShadows[0], m_lightShadows.size() * sizeof(int));
+				m_lightShadowsTB->unmap();
+				m_lightShadowsDirty = false;
+			}
+		}
+
+		//-- 5. bind data to the shader.
+		IShader* shader = rs().shaderContext().shader(m_ROPs[1].m_material->m_shader);
+		{
+			m_clusters.bind(*shader);
+			shadows.bindLocalShadows(*shader);
+			shader->setTextureBuffer("tb_pointLights", m_gpuPointLights.buffer());
+			shader->setTextureBuffer("tb_spotLights", m_gpuSpotLights.buffer());
+			shader->setTextureBuffer("tb_lightShadows", m_lightShadowsTB.get());
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void LightsManager::setLightShadow(uint slot, int shadow)
+	{
+		if (m_lightShadows[slot] != shadow)
+		{
+			m_lightShadows[slot] = shadow;
+			m_lightShadowsDirty	 = true;
+		}
+	}
+
+	//-- Measures binning time of the given count of the random lights placed in the view frustum of
+	//-- the synthetic camera, so it doesn't depend on the scene and works right after init.
+	//-- Compares single and multi threaded binning. Lights are binned into the local clusters, the
+	//-- ones of the render thread aren't touched.
+	//-- Usage: +r_lights_benchmark 1000 or +r_lights_benchmark 10000 in the command line.
+	//----------------------------------------------------------------------------------------------
+	int LightsManager::_benchmark(int lightsCount)
+	{
+		const uint iterations = 16;
+
+		RenderCamera cam;
+		{
+			Projection& projInfo = cam.m_projInfo;
+			projInfo.isOrtho	 = false;
+			projInfo.isOrthoSpec = false;
+			projInfo.fov		 = 75.0f;
+			projInfo.nearDist	 = 0.5f;
+			projInfo.farDist	 = 250.0f;
+
+			cam.m_view.setIdentity();
+			cam.m_proj.setPerspectiveProj(projInfo.fov, 16.0f / 9.0f, projInfo.nearDist, projInfo.farDist);
+			cam.m_invView	= cam.m_view;
+			cam.m_viewProj	= cam.m_proj;
+		}
+
+		LightClusters clusters;
+		if (!clusters.init())
+		{
+			ERROR_MSG("Light clusters benchmark: can't create light clusters.");
+			return 0;
+		}
+
+		const float farDist = cam.m_projInfo.farDist;
+		const float tanY	= 1.0f / cam.m_proj(1, 1);
+		const float tanX	= 1.0f / cam.m_proj(0, 0);
+
+		//-- generate lights. 3/4 of the lights are point lights. Clusters use 16 bit light indices.
+		ClusterLights lights(clamp(0, lightsCount, 0xffff));
+		uint pointsCount = lights.size() * 3 / 4;
+
+		srand(0);
+		for (uint i = 0; i < lights.size(); ++i)
+		{
+			ClusterLight& cl = lights[i];
+
+			float z = randomFloat(cam.m_projInfo.nearDist, farDist);
+			cl.m_pos	= vec3f(randomFloat(-tanX, tanX) * z, randomFloat(-tanY, tanY) * z, z);
+			cl.m_radius = randomFloat(1.0f, 10.0f);
+			cl.m_dir	= vec3f(randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f), randomFloat(-1.0f, 1.0f)).getNormalized();
+
+			float cosAngle = (i < pointsCount) ? 0.0f : randomFloat(0.5f, 0.95f);
+			cl.m_cosAngle = cosAngle;
+			cl.m_sinAngle = sqrtf(1.0f - cosAngle * cosAngle);
+			cl.m_index	  = static_cast<uint16>((i < pointsCount) ? i : i - pointsCount);
+		}
+
+		//-- measure.
+		uint threads[2] = { 1, max<uint>(g_clusterThreads, 1) };
+		for (uint t = 0; t < 2; ++t)
+		{
+			uint64 startTime = SDL_GetPerformanceCounter();
+
+			for (uint i = 0; i < iterations; ++i)
+			{
+				clusters.build(cam, lights, pointsCount, threads[t]);
+			}
+
+			float time = ((SDL_GetPerformanceCounter() - startTime) * 1000.0f) / (SDL_GetPerformanceFrequency() * iterations);
+
+			INFO_MSG("Light clusters: %d lights, %d threads, %.3f ms, %d indices%s.",
+				static_cast<uint>(lights.size()), threads[t], time, clusters.lightIndicesCount(),
+				clusters.isOverflowed() ? " (overflowed)" : ""
+				);
+		}
+
+		return 0;
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -242,16 +551,22 @@ namespace render
 		uint count = 0;
 
 		//-- setup direction lights ROP.
-		if (!m_gpuDirLights.empty())
+		//-- Note: instance data is already on the GPU, so m_instanceData stays null.
+		if (m_dirLightsCount != 0)
 		{
 			ops.push_back(m_ROPs[0]);
-			ops.back().m_instanceCount = m_gpuDirLights.size();
-			ops.back().m_instanceData  = &m_gpuDirLights.front();
+			ops.back().m_instanceCount = m_dirLightsCount;
 
 			++count;
 		}
 
-		//-- ToDo: setup another light's types.
+		//-- setup clustered point and spot lights ROP.
+		if (!m_clusterLights.empty())
+		{
+			ops.push_back(m_ROPs[1]);
+
+			++count;
+		}
 
 		return count;
 	}
@@ -5,6 +5,8 @@
 #include "Color.h"
 #include "materials.hpp"
 #include "vertex_format.hpp"
+#include "light_clusters.hpp"
+#include "persistent_buffer.hpp"
 #include "math/Vector2.hpp"
 #include "math/Vector3.hpp"
 #include "math/Vector4.hpp"
@@ -15,6 +17,7 @@ namespace render
 {
 
 	class Mesh;
+	class ShadowManager;
 
 	//----------------------------------------------------------------------------------------------
 	struct DirectionLight
@@ -26,26 +29,33 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	struct PointLight
 	{
+		PointLight() : m_castShadows(false) { }
+
 		vec3f m_pos;
 		vec2f m_intoutRadius;
 		Color m_color;
+		bool  m_castShadows;
 	};
 
 	//----------------------------------------------------------------------------------------------
 	struct SpotLight
 	{
+		SpotLight() : m_castShadows(false) { }
+
 		vec3f m_pos;
 		vec3f m_dir;
 		vec2f m_inoutCosAngle;
 		vec2f m_startEndFading;
 		Color m_color;
+		bool  m_castShadows;
 	};
 
 
 	//-- Controls life time of the all light at the scene. Provides simple interface to access,
 	//-- modify, add and delete any light at the scene by its descriptor.
 	//-- Does culling lights against view frustum and performs account of the impact every light
-	//-- in the final rendered picture.
+	//-- in the final rendered picture. Direction lights are drawn as full-screen quads, point and
+	//-- spot lights are assigned to the view frustum clusters and resolved in one full-screen pass.
 	//----------------------------------------------------------------------------------------------
 	class LightsManager
 	{
@@ -55,6 +65,7 @@ namespace render
 
 		bool					init();
 		void					update(float dt);
+		void					cull(const RenderCamera& cam, const ShadowManager& shadows);
 		uint					gatherROPs(RenderOps& ops) const;
 
 		Handle					addDirLight		(const DirectionLight& light);
@@ -72,14 +83,40 @@ namespace render
 		void					delSpotLight	(Handle id);
 		const SpotLight&		getSpotLight	(Handle id);
 
+		//-- render thread iteration over the snapshot of the light slots taken by update().
+		//-- Note: some of the slots may be unused.
+		uint					pointLightSlots	() const			{ return m_renderPointLights.size(); }
+		bool					hasPointLight	(Handle id) const	{ return m_renderPointLights[id].first; }
+		const PointLight&		renderPointLight(Handle id) const	{ return m_renderPointLights[id].second; }
+		uint					spotLightSlots	() const			{ return m_renderSpotLights.size(); }
+		bool					hasSpotLight	(Handle id) const	{ return m_renderSpotLights[id].first; }
+		const SpotLight&		renderSpotLight	(Handle id) const	{ return m_renderSpotLights[id].second; }
+
+		//-- console functions.
+		int						_benchmark		(int lightsCount);
+
+	private:
+		void					setLightShadow	(uint slot, int shadow);
+
 	private:
 		std::vector<std::pair<bool, DirectionLight>>	m_dirLights;
 		std::vector<std::pair<bool, PointLight>>		m_pointLights;
 		std::vector<std::pair<bool, SpotLight>>			m_spotLights;
 
+		//-- copies of the point and spot lights read by the render thread. The game thread keeps
+		//-- changing the lights above while the render thread draws the previous frame.
+		std::vector<std::pair<bool, PointLight>>		m_renderPointLights;
+		std::vector<std::pair<bool, SpotLight>>			m_renderSpotLights;
+
+		//-- released slots ready for reuse.
+		std::vector<Handle>								m_freeDirLights;
+		std::vector<Handle>								m_freePointLights;
+		std::vector<Handle>								m_freeSpotLights;
+
 		//------------------------------------------------------------------------------------------
 		struct GPUDirLight
 		{
+			GPUDirLight() { }
 			GPUDirLight(const DirectionLight& light)
 			{
 				m_dir	= light.m_dir.toVec4();
@@ -93,6 +130,7 @@ namespace render
 		//------------------------------------------------------------------------------------------
 		struct GPUPointLight
 		{
+			GPUPointLight() { }
 			GPUPointLight(const PointLight& light)
 			{
 				m_pos			= light.m_pos.toVec4();
@@ -108,6 +146,7 @@ namespace render
 		//------------------------------------------------------------------------------------------
 		struct GPUSpotLight
 		{
+			GPUSpotLight() { }
 			GPUSpotLight(const SpotLight& light)
 			{
 				m_pos	   = light.m_pos.toVec4();
@@ -125,20 +164,29 @@ namespace render
 			vec4f m_color;
 		};
 
-		std::vector<GPUDirLight>	m_gpuDirLights;
-		std::vector<GPUPointLight>	m_gpuPointLights;
-		std::vector<GPUSpotLight>	m_gpuSpotLights;
+		//-- GPU copies of the lights. Direction lights are packed tightly, point and spot lights
+		//-- live in the same slots as on the CPU side.
+		PersistentBuffer<GPUDirLight>	m_gpuDirLights;
+		PersistentBuffer<GPUPointLight>	m_gpuPointLights;
+		PersistentBuffer<GPUSpotLight>	m_gpuSpotLights;
+		uint							m_dirLightsCount;
+
+		//-- index of the first local shadow of the light or -1, point lights go first. Only the
+		//-- slots of the visible lights are up to date, the others are never read by the shader.
+		std::vector<int>			m_lightShadows;
+		std::shared_ptr<IBuffer>	m_lightShadowsTB;
+		bool						m_lightShadowsDirty;
 
-		std::shared_ptr<IBuffer>	m_dirLightsTB;
-		std::shared_ptr<IBuffer>	m_pointLightsTB;
-		std::shared_ptr<IBuffer>	m_spotLightsTB;
 		std::shared_ptr<Mesh>		m_unitCube;
 		std::shared_ptr<IBuffer>	m_fsQuadVB;
 		IBuffer*					m_pVB;
 		std::shared_ptr<Material>	m_dirLightMaterial;
-		std::shared_ptr<Material>	m_spotLightMaterial;
-		std::shared_ptr<Material>	m_pointLightMaterial;
+		std::shared_ptr<Material>	m_clusteredLightsMaterial;
 		RenderOps					m_ROPs;
+
+		//-- clustered point and spot lights.
+		ClusterLights				m_clusterLights;
+		LightClusters				m_clusters;
 	};
 
 } //-- render
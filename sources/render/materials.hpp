@@ -123,6 +123,7 @@ namespace render
 		void			addProperty	(const char* name, IProperty* prop);
 		IProperty*		getProperty (const char* name);
 		const RenderFx* renderFx    (ShaderContext::EPassType pass, bool instanced = false);
+		bool			hasInstancedFx(ShaderContext::EPassType pass) const { return m_passes[pass].m_instanced; }
 
 		//-- ToDo:
 		RenderStateProperties& rsProps() { return m_rsProps; }
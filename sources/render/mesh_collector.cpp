@@ -1,6 +1,18 @@
 #include "mesh_collector.hpp"
 #include "mesh_manager.hpp"
 #include "scene/game_world.hpp"
+#include "engine/frame_memory.hpp"
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- watchers.
+	uint g_instancedBatches   = 0;
+	uint g_instancedInstances = 0;
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
 
 namespace brUGE
 {
@@ -8,9 +20,9 @@ namespace render
 {
 
 	//----------------------------------------------------------------------------------------------
-	MeshCollector::MeshCollector()
+	MeshCollector::MeshCollector() : m_scratchMarker(0), m_pass(RenderSystem::PASS_Z_ONLY)
 	{
-		m_instances.reserve(25);
+		m_batches.reserve(25);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -25,7 +37,7 @@ namespace render
 		//-- create geometry instancing buffer.
 		{
 			m_instanceTB = rd()->createBuffer(
-				IBuffer::TYPE_TEXTURE, NULL, 128 * sizeof(mat4f) / sizeof(vec4f),
+				IBuffer::TYPE_TEXTURE, NULL, MAX_INSTANCES * sizeof(GPUInstance) / sizeof(vec4f),
 				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
 				);
 
@@ -36,6 +48,9 @@ namespace render
 			}
 		}
 
+		REGISTER_RO_WATCHER("instanced batches", uint, g_instancedBatches);
+		REGISTER_RO_WATCHER("instanced instances", uint, g_instancedInstances);
+
 		return true;
 	}
 
@@ -44,31 +59,62 @@ namespace render
 	{
 		m_pass = pass;
 
-		for (auto iter = m_instances.begin(); iter != m_instances.end(); ++iter)
-			iter->m_buffer.clear();
+		for (uint id : m_activeBatches)
+		{
+			m_batches[id].m_first = nullptr;
+			m_batches[id].m_count = 0;
+		}
+		m_activeBatches.clear();
+
+		//-- the stream never exceeds its maximum size, so reserve it at once.
+		utils::LinearAllocator& scratch = FrameMemory::scratchArena();
+
+		m_scratchMarker = scratch.marker();
+		m_entries		= utils::ArenaVector<Entry>(utils::ArenaAllocator<Entry>(scratch));
+		m_entries.reserve(MAX_INSTANCES);
 	}
 
+	//-- Note: if the stream is full the instance is rejected and the caller draws it as usual, so
+	//--	   nothing is lost silently.
 	//----------------------------------------------------------------------------------------------
-	bool MeshCollector::addMeshInstance(const MeshInstance& instance)
+	bool MeshCollector::addMeshInstance(const MeshInstance& instance, uint lod, float lodFade)
 	{
-		//-- ToDo: reconsider.
+		if (m_entries.size() >= MAX_INSTANCES)
+			return false;
+
+		int id = -1;
+		if		(instance.m_mesh && instance.m_mesh->isInstanceable(m_pass))					id = instance.m_mesh->instancingID();
+		else if (instance.m_skinnedMesh && instance.m_skinnedMesh->isInstanceable(m_pass))	id = instance.m_skinnedMesh->instancingID();
 
-		if (!instance.m_mesh || instance.m_mesh->instancingID() == -1)
+		if (id == -1)
 			return false;
 
-		int id = instance.m_mesh->instancingID();
+		//-- every LOD of the mesh has its own batch.
+		lod = min<uint>(lod, Mesh::MAX_LODS - 1);
+		id	= id * Mesh::MAX_LODS + lod;
+
+		if (id >= static_cast<int>(m_batches.size()))
+		{
+			m_batches.resize(id + 1, Batch{ nullptr, 0, 0, 0 });
+		}
+
+		Batch& batch = m_batches[id];
 
-		if (id >= static_cast<int>(m_instances.size()))
+		if (!batch.m_first)
 		{
-			m_instances.resize(id + 1);
+			batch.m_first = &instance;
+			batch.m_lod	  = lod;
+			m_activeBatches.push_back(id);
 		}
-	
-		Instance& inst = m_instances[id];
 
-		if (!inst.m_mesh)
-			inst.m_mesh = instance.m_mesh;
+		Entry entry;
+		entry.m_instance.m_worldMat = instance.m_worldMat;
+		entry.m_instance.m_tint		= instance.m_tint;
+		entry.m_instance.m_params	= vec4f(lodFade, static_cast<float>(instance.m_paletteOffset), 0.0f, 0.0f);
+		entry.m_batch				= id;
 
-		inst.m_buffer.push_back(instance.m_transform->m_worldMat);
+		m_entries.push_back(entry);
+		++batch.m_count;
 
 		return true;
 	}
@@ -76,7 +122,9 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void MeshCollector::end()
 	{
-		//-- pass
+		//-- give the scratch memory back. The container is left without any memory.
+		m_entries = utils::ArenaVector<Entry>();
+		FrameMemory::scratchArena().rewind(m_scratchMarker);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -84,26 +132,51 @@ namespace render
 	{
 		uint totalCount = 0;
 
-		for (const auto& instance : m_instances)
+		if (m_activeBatches.empty())
+			return 0;
+
+		//-- 1. place batches one after another in the stream and make render operations.
+		uint offset = 0;
+		for (uint id : m_activeBatches)
+		{
+			Batch&				batch = m_batches[id];
+			const MeshInstance& first = *batch.m_first;
+
+			batch.m_offset = offset;
+
+			uint count = first.m_mesh
+				? first.m_mesh->gatherROPs(m_pass, true, rops, batch.m_lod)
+				: first.m_skinnedMesh->gatherROPs(m_pass, true, rops, batch.m_lod);
+
+			for (uint i = rops.size() - count; i < rops.size(); ++i)
+			{
+				RenderOp& rop = rops[i];
+				rop.m_worldMat		 = nullptr;
+				rop.m_instanceTB	 = m_instanceTB.get();
+				rop.m_instanceData	 = nullptr; //-- stream is already uploaded.
+				rop.m_instanceSize	 = sizeof(GPUInstance);
+				rop.m_instanceCount	 = batch.m_count;
+				rop.m_instanceOffset = offset;
+			}
+
+			offset	   += batch.m_count;
+			totalCount += count;
+		}
+
+		//-- 2. scatter instances right into theirs places in the instance buffer, so the whole
+		//--	stream is uploaded at once without the intermediate copy.
+		if (GPUInstance* mp = m_instanceTB->map<GPUInstance>(IBuffer::ACCESS_WRITE_DISCARD))
 		{
-			if (!instance.m_buffer.empty())
+			for (const Entry& entry : m_entries)
 			{
-				uint count = instance.m_mesh->gatherROPs(m_pass, true, rops);
-
-				for (uint i = rops.size() - count; i < rops.size(); ++i)
-				{
-					RenderOp& rop = rops[i];
-					rop.m_worldMat		= nullptr;
-					rop.m_instanceTB    = m_instanceTB.get();
-					rop.m_instanceData	= &instance.m_buffer[0];
-					rop.m_instanceSize  = sizeof(mat4f);
-					rop.m_instanceCount = instance.m_buffer.size();
-				}
-
-				totalCount += count;
+				mp[m_batches[entry.m_batch].m_offset++] = entry.m_instance;
 			}
+			m_instanceTB->unmap();
 		}
 
+		g_instancedBatches	 = m_activeBatches.size();
+		g_instancedInstances = m_entries.size();
+
 		return totalCount;
 	}
 
@@ -12,32 +12,60 @@ namespace render
 	struct MeshInstance;
 	class  Mesh;
 	struct RenderOp;
-	typedef std::vector<RenderOp> RenderOps;
+	typedef utils::ArenaVector<RenderOp> RenderOps;
 
-	//-- It's responsible for mesh instancing.
+	//-- It's responsible for mesh instancing. Instances of the same static or skinned mesh are
+	//-- gathered into batches (one per mesh LOD) and all batches of the pass are written into one
+	//-- instance stream, which is uploaded to the GPU only once. Every instanced render operation
+	//-- refers to its batch by offset inside the stream.
+	//-- Instances of the pass live in the scratch memory of the calling thread from begin() till
+	//-- end(), so both have to be called by the same thread.
 	//----------------------------------------------------------------------------------------------
 	class MeshCollector : public NonCopyable
 	{
+	public:
+		enum { MAX_INSTANCES = 4096 };
+
+		//-- per-instance payload. Has to match the Instance struct in the common.hlsl.
+		struct GPUInstance
+		{
+			mat4f m_worldMat;
+			vec4f m_tint;
+			vec4f m_params; //-- x - LOD fade, y - offset of the matrix palette.
+		};
+
 	public:
 		MeshCollector();
 		~MeshCollector();
 
 		bool init();
 		void begin(RenderSystem::EPassType pass);
-		bool addMeshInstance(const MeshInstance& instance);
+		bool addMeshInstance(const MeshInstance& instance, uint lod, float lodFade);
 		void end();
 		uint gatherROPs(RenderOps& rops);
 
 	private:
 
 		//------------------------------------------------------------------------------------------
-		struct Instance
+		struct Batch
+		{
+			const MeshInstance*	m_first; //-- the mesh of the batch is taken from it.
+			uint				m_lod;
+			uint				m_count;
+			uint				m_offset; //-- offset of the batch in the stream.
+		};
+
+		//------------------------------------------------------------------------------------------
+		struct Entry
 		{
-			std::shared_ptr<Mesh>	m_mesh;
-			std::vector<mat4f>		m_buffer;
+			GPUInstance	m_instance;
+			uint		m_batch;
 		};
 
-		std::vector<Instance>		m_instances;
+		std::vector<Batch>			m_batches;
+		std::vector<uint>			m_activeBatches;
+		utils::ArenaVector<Entry>	m_entries;
+		size_t						m_scratchMarker;
 		RenderSystem::EPassType		m_pass;
 		std::shared_ptr<IBuffer>	m_instanceTB;
 	};
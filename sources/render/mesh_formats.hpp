@@ -2,15 +2,24 @@
 
 #include "prerequisites.hpp"
 #include <array>
+#include <cstring>
 
 namespace brUGE
 {
 	//-- Note: to guaranty compact one byte aligned packing.
 #pragma pack(push, 1)
 
+	//-- Format history:
+	//-- 1 - initial format.
+	//-- 2 - LOD section is appended after the sub-meshes. Every LOD level stores only indices, which
+	//--	 refer to the vertices of the LOD 0, so all the levels share the same vertex buffers.
+	//-- 3 - 32 bit vertices and indices counts. Every sub-mesh chooses its own index width, 16 bit
+	//--	 indices are used while the sub-mesh has no more than 65536 vertices.
 	//----------------------------------------------------------------------------------------------
 	struct StaticMeshFormat
 	{
+		enum { VERSION = 3 };
+
 		struct Header
 		{
 			Header() : m_format{0}, m_version(0) { }
@@ -31,7 +40,19 @@ namespace brUGE
 
 		struct SubInfo
 		{
-			SubInfo() : m_name{0}, m_numVertices(0), m_numVertexStreams(0), m_numIndices(0) { }
+			SubInfo() : m_name{0}, m_numVertices(0), m_numVertexStreams(0), m_numIndices(0), m_indexSize(0) { }
+
+			std::array<char, 20>	m_name;
+			uint32					m_numVertices;
+			uint8					m_numVertexStreams;
+			uint32					m_numIndices;
+			uint8					m_indexSize; //-- 2 or 4 bytes. Used for the all LODs of the sub-mesh.
+		};
+
+		//-- sub-mesh info of the versions 1 and 2.
+		struct SubInfoV2
+		{
+			SubInfoV2() : m_name{0}, m_numVertices(0), m_numVertexStreams(0), m_numIndices(0) { }
 
 			std::array<char, 20>	m_name;
 			uint16					m_numVertices;
@@ -45,12 +66,44 @@ namespace brUGE
 
 			uint8					m_elemSize;
 		};
+
+		//-- count of the LOD levels besides the LOD 0.
+		struct LodInfo
+		{
+			LodInfo() : m_numLods(0) { }
+
+			uint8					m_numLods;
+		};
+
+		//-- followed by the LodSubInfo and indices for each sub-mesh.
+		struct Lod
+		{
+			Lod() : m_screenSize(0.0f) { }
+
+			float					m_screenSize; //-- used when projected size is smaller than it.
+		};
+
+		struct LodSubInfo
+		{
+			LodSubInfo() : m_numIndices(0) { }
+
+			uint32					m_numIndices;
+		};
+
+		struct LodSubInfoV2
+		{
+			LodSubInfoV2() : m_numIndices(0) { }
+
+			uint16					m_numIndices;
+		};
 	};
 
 
 	//----------------------------------------------------------------------------------------------
 	struct SkinnedMeshFormat
 	{
+		enum { VERSION = 3 };
+
 		struct Header
 		{
 			char   m_format[20];
@@ -85,6 +138,15 @@ namespace brUGE
 		};
 
 		struct SubInfo
+		{
+			char   m_name[20];
+			uint32 m_numVertices;
+			uint8  m_numVertexStreams;
+			uint32 m_numIndices;
+			uint8  m_indexSize;
+		};
+
+		struct SubInfoV2
 		{
 			char   m_name[20];
 			uint16 m_numVertices;
@@ -96,6 +158,26 @@ namespace brUGE
 		{
 			uint8 m_elemSize;
 		};
+
+		struct LodInfo
+		{
+			uint8 m_numLods;
+		};
+
+		struct Lod
+		{
+			float m_screenSize;
+		};
+
+		struct LodSubInfo
+		{
+			uint32 m_numIndices;
+		};
+
+		struct LodSubInfoV2
+		{
+			uint16 m_numIndices;
+		};
 	};
 
 	//----------------------------------------------------------------------------------------------
@@ -141,4 +223,11 @@ namespace brUGE
 
 #pragma pack(pop)
 
+	//-- format tag of the corrupted file may be not null-terminated.
+	//----------------------------------------------------------------------------------------------
+	inline bool checkFormatTag(const char* tag, size_t size, const char* expected)
+	{
+		return strnlen(tag, size) < size && strcmp(tag, expected) == 0;
+	}
+
 } //-- brUGE
@@ -1,9 +1,15 @@
 #include "mesh_manager.hpp"
 #include "mesh_collector.hpp"
+#include "shadow_manager.hpp"
 #include "scene/game_world.hpp"
+#include "engine/Engine.h"
+#include "render_thread.hpp"
 #include "DebugDrawer.h"
 #include "utils/string_utils.h"
 #include "loader/ResourcesManager.h"
+#include "console/Console.h"
+#include <cstring>
+#include <cfloat>
 
 using namespace brUGE::utils;
 using namespace brUGE::math;
@@ -16,6 +22,9 @@ namespace
 	bool g_enableCulling = true;
 	bool g_showVisibilityBoxes = false;
 	bool g_enableInstancing = true;
+	bool g_enableLods = true;
+	float g_lodFadeTime = 0.25f;	//-- in seconds.
+	float g_shadowLodBias = 0.5f;	//-- shadow casters use coarser LOD than the main view.
 }
 //--------------------------------------------------------------------------------------------------
 //-- end unnamed namespace.
@@ -43,6 +52,9 @@ namespace render
 		REGISTER_CONSOLE_VALUE("r_showVisibilityBoxes",		bool, g_showVisibilityBoxes);
 		REGISTER_CONSOLE_VALUE("r_enableVisibilityCulling",	bool, g_enableCulling);
 		REGISTER_CONSOLE_VALUE("r_enableInstancing",		bool, g_enableInstancing);
+		REGISTER_CONSOLE_VALUE("r_enableLods",				bool, g_enableLods);
+		REGISTER_CONSOLE_VALUE("r_lodFadeTime",				float, g_lodFadeTime);
+		REGISTER_CONSOLE_VALUE("r_shadowLodBias",			float, g_shadowLodBias);
 
 		return m_meshCollector->init();
 	}
@@ -50,13 +62,125 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void MeshManager::update(float /*dt*/)
 	{
+		for (const auto& inst : m_meshInstances)
+		{
+			if (!inst)
+				continue;
+
+			//-- take the render snapshot of the transform.
+			const Transform& transform = *inst->m_transform;
+			inst->m_worldMat	= transform.m_worldMat;
+			inst->m_worldBounds = transform.m_worldBounds;
+
+			//-- detect movement of the static instances.
+			if (inst->m_static && memcmp(&inst->m_cachedWorldMat, &transform.m_worldMat, sizeof(mat4f)) != 0)
+			{
+				m_staticChanges.push_back(inst->m_cachedWorldBounds);
+				m_staticChanges.push_back(transform.m_worldBounds);
+
+				inst->m_cachedWorldMat	  = transform.m_worldMat;
+				inst->m_cachedWorldBounds = transform.m_worldBounds;
+			}
+		}
+
+		//-- write the palettes of the all skinned instances into the frame arena. It's done once
+		//-- per frame right after the animation, so every pass only refers to them.
+		uint paletteMatrices = 0;
+		for (const auto& inst : m_meshInstances)
+		{
+			if (inst && inst->m_skinnedMesh)
+			{
+				paletteMatrices += inst->m_worldPalette.size();
+			}
+		}
+
+		ShaderContext& sc = rs().shaderContext();
+		sc.beginMatrixPalettes(paletteMatrices);
+		for (const auto& inst : m_meshInstances)
+		{
+			if (!inst || !inst->m_skinnedMesh || inst->m_worldPalette.empty())
+				continue;
+
+			inst->m_paletteOffset = sc.addMatrixPalette(&inst->m_worldPalette[0], inst->m_worldPalette.size());
+		}
+		sc.endMatrixPalettes();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void MeshManager::updateLods(const RenderCamera& cam, float dt)
+	{
+		const vec3f camPos = cam.m_invView.applyToOrigin();
+		const float yScale = cam.m_proj(1, 1);
+		const float fadeStep = (g_lodFadeTime > 0.0f) ? dt / g_lodFadeTime : 1.0f;
+
+		for (const auto& inst : m_meshInstances)
+		{
+			if (!inst)
+				continue;
+
+			//-- 1. projected size of the bounding sphere relative to the screen height.
+			const AABB& bounds = inst->m_worldBounds;
+			float radius = (bounds.m_max - bounds.m_min).length() * 0.5f;
+			float dist	 = (bounds.getCenter() - camPos).length();
+
+			inst->m_screenSize = radius * yScale / max(dist, radius);
+
+			//-- 2. continue the current transition or start the new one. The new transition starts
+			//--	only after the previous one has been finished to avoid popping.
+			if (inst->m_lodFade < 1.0f)
+			{
+				inst->m_lodFade = min(inst->m_lodFade + fadeStep, 1.0f);
+				continue;
+			}
+
+			uint lod = selectLod(*inst, inst->m_screenSize);
+			if (lod != inst->m_lod)
+			{
+				inst->m_prevLod = inst->m_lod;
+				inst->m_lod		= static_cast<uint8>(lod);
+				inst->m_lodFade = (g_lodFadeTime > 0.0f) ? 0.0f : 1.0f;
+			}
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint MeshManager::selectLod(const MeshInstance& inst, float screenSize) const
+	{
+		if (!g_enableLods)
+			return 0;
 
+		return inst.m_mesh ? inst.m_mesh->selectLod(screenSize) : inst.m_skinnedMesh->selectLod(screenSize);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void MeshManager::gatherInstanceROPs(
+		const MeshInstance& inst, RenderSystem::EPassType pass, bool instanced,
+		RenderOps& rops, uint lod, float lodFade)
+	{
+		//-- if mesh collector doesn't want to get this instance then process it as usual. Skinned
+		//-- instances of the same mesh are instanced too, every one reads its own palette from the
+		//-- frame arena.
+		if (g_enableInstancing && m_meshCollector->addMeshInstance(inst, lod, lodFade))
+			return;
+
+		uint count = inst.m_mesh
+			? inst.m_mesh->gatherROPs(pass, instanced, rops, lod)
+			: inst.m_skinnedMesh->gatherROPs(pass, instanced, rops, lod);
+
+		for (uint i = rops.size() - count; i < rops.size(); ++i)
+		{
+			RenderOp& rop = rops[i];
+
+			rop.m_worldMat			  = &inst.m_worldMat;
+			rop.m_matrixPaletteOffset = inst.m_paletteOffset;
+			rop.m_lodFade			  = lodFade;
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
 	uint MeshManager::gatherROPs(
 		RenderSystem::EPassType pass, bool instanced, RenderOps& rops,
-		const mat4f& viewPort, AABB* aabb)
+		const mat4f& viewPort, AABB* aabb, const ShadowCasterVolume* casterVolume, EFilter filter)
 	{
 		m_meshCollector->begin(pass);
 
@@ -65,45 +189,55 @@ namespace render
 			if (!inst)
 				continue;
 
+			if (	(filter == FILTER_STATIC && !inst->m_static)
+				||	(filter == FILTER_DYNAMIC && inst->m_static)
+				)
+			{
+				continue;
+			}
+
 			//-- 1. cull frustum against AABB.
-			if (g_enableCulling && inst->m_transform->m_worldBounds.calculateOutcode(viewPort) != 0)
+			if (g_enableCulling && inst->m_worldBounds.calculateOutcode(viewPort) != 0)
+			{
+				continue;
+			}
+			//-- 1.1. cull shadow casters which can't cast shadow on any visible receiver.
+			else if (casterVolume && !casterVolume->isVisible(inst->m_worldBounds))
 			{
 				continue;
 			}
 			else if (g_showVisibilityBoxes)
 			{
-				DebugDrawer::instance().drawAABB(inst->m_transform->m_worldBounds, Color(1,0,0,0));
+				DebugDrawer::instance().drawAABB(inst->m_worldBounds, Color(1,0,0,0));
 			}
 			
 			if (aabb)
 			{
-				aabb->combine(inst->m_transform->m_worldBounds);
+				aabb->combine(inst->m_worldBounds);
 			}
 
-			//-- 2. gather render operations.
-			if (inst->m_mesh)
+			//-- 2. gather render operations. Skinned instance without the palette can't be drawn.
+			if (!inst->m_mesh && !inst->m_skinnedMesh)
+				continue;
+
+			if (inst->m_skinnedMesh && inst->m_paletteOffset == ShaderContext::INVALID_PALETTE_OFFSET)
+				continue;
+
+			//-- 2.1. shadow casters use the coarser LOD and never cross-fade.
+			if (pass == RenderSystem::PASS_SHADOW_CAST)
 			{
-				//-- if mesh collector doesn't want to get this instance then process it as usual.
-				if (!g_enableInstancing || (g_enableInstancing && !m_meshCollector->addMeshInstance(*inst.get())))
-				{
-					uint count = inst->m_mesh->gatherROPs(pass, instanced, rops);
-					for (uint i = rops.size() - count; i < rops.size(); ++i)
-					{
-						RenderOp& rop = rops[i];
-						rop.m_worldMat = &inst->m_transform->m_worldMat;
-					}
-				}
+				uint lod = selectLod(*inst, inst->m_screenSize * g_shadowLodBias);
+				gatherInstanceROPs(*inst, pass, instanced, rops, lod, 1.0f);
 			}
-			else if (inst->m_skinnedMesh)
+			//-- 2.2. during the transition both LODs are drawn with the complementary dither patterns.
+			//--	  Negative fade value means the inverted pattern.
+			else
 			{
-				uint count = inst->m_skinnedMesh->gatherROPs(pass, instanced, rops);
-				for (uint i = rops.size() - count; i < rops.size(); ++i)
-				{
-					RenderOp& rop = rops[i];
+				gatherInstanceROPs(*inst, pass, instanced, rops, inst->m_lod, inst->m_lodFade);
 
-					rop.m_worldMat			 = &inst->m_transform->m_worldMat;
-					rop.m_matrixPalette		 = &inst->m_worldPalette[0];
-					rop.m_matrixPaletteCount = inst->m_worldPalette.size();
+				if (inst->m_lodFade < 1.0f)
+				{
+					gatherInstanceROPs(*inst, pass, instanced, rops, inst->m_prevLod, inst->m_lodFade - 1.0f);
 				}
 			}
 		}
@@ -114,9 +248,28 @@ namespace render
 		return rops.size();
 	}
 
+	//----------------------------------------------------------------------------------------------
+	void MeshManager::calcVisibleBounds(const mat4f& viewPort, const mat4f& space, AABB& bounds) const
+	{
+		for (const auto& inst : m_meshInstances)
+		{
+			if (!inst)
+				continue;
+
+			const AABB& worldBounds = inst->m_worldBounds;
+			if (worldBounds.calculateOutcode(viewPort) != 0)
+				continue;
+
+			bounds.combine(worldBounds.getTranformed(space));
+		}
+	}
+
 	//----------------------------------------------------------------------------------------------
 	Handle MeshManager::createMeshInstance(const MeshInstance::Desc& desc, Transform* transform)
 	{
+		//-- the render thread may iterate over the instances right now.
+		Engine::instance().renderThread().sync();
+
 		ResourcesManager& rm = ResourcesManager::instance();
 		auto mInst = std::make_unique<MeshInstance>();
 
@@ -151,13 +304,31 @@ namespace render
 			transform->m_worldBounds = mesh->bounds().getTranformed(transform->m_worldMat);
 		}
 
-		//-- 3. setup nodes bucket in case if mesh is skinned.
+		//-- 3. skinned mesh is always animated, so it can't be static.
+		mInst->m_static			   = desc.isStatic && !mInst->m_skinnedMesh;
+		mInst->m_paletteOffset	   = 0;
+		mInst->m_tint			   = vec4f(1.0f, 1.0f, 1.0f, 1.0f);
+		mInst->m_lod			   = 0;
+		mInst->m_prevLod		   = 0;
+		mInst->m_lodFade		   = 1.0f;
+		mInst->m_screenSize		   = FLT_MAX;
+		mInst->m_worldMat		   = transform->m_worldMat;
+		mInst->m_worldBounds	   = transform->m_worldBounds;
+		mInst->m_cachedWorldMat	   = transform->m_worldMat;
+		mInst->m_cachedWorldBounds = transform->m_worldBounds;
+
+		if (mInst->m_static)
+		{
+			m_staticChanges.push_back(mInst->m_cachedWorldBounds);
+		}
+
+		//-- 4. setup nodes bucket in case if mesh is skinned.
 		if (SkinnedMesh* skMesh = mInst->m_skinnedMesh.get())
 		{
-			//-- 3.1. resize mesh world palette to match the bones count in the skinned mesh.
+			//-- 4.1. resize mesh world palette to match the bones count in the skinned mesh.
 			mInst->m_worldPalette.resize(skMesh->skeleton().size());
 
-			//-- 3.2. initialize nodes. 
+			//-- 4.2. initialize nodes. 
 			for (uint i = 0; i < mInst->m_worldPalette.size(); ++i)
 			{
 				const Joint& joint   = skMesh->skeleton()[i];
@@ -176,6 +347,13 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void MeshManager::removeMeshInstance(Handle handle)
 	{
+		Engine::instance().renderThread().sync();
+
+		if (m_meshInstances[handle]->m_static)
+		{
+			m_staticChanges.push_back(m_meshInstances[handle]->m_cachedWorldBounds);
+		}
+
 		m_meshInstances[handle].reset();
 	}
 
@@ -13,21 +13,41 @@ namespace render
 {
 
 	class MeshCollector;
+	struct ShadowCasterVolume;
 
 	//----------------------------------------------------------------------------------------------
 	struct MeshInstance
 	{
 		struct Desc
 		{
-			Desc() : fileName(nullptr) { }
+			Desc() : fileName(nullptr), isStatic(false) { }
 
 			const char* fileName;
+			bool		isStatic; //-- hint that instance is rarely moved. Skinned meshes are never static.
 		};
 
 		std::shared_ptr<Mesh>			m_mesh;
 		std::shared_ptr<SkinnedMesh>	m_skinnedMesh;
 		MatrixPalette					m_worldPalette;
+		uint16							m_paletteOffset; //-- offset of the palette in the frame arena.
+		vec4f							m_tint;
+
+		//-- LOD state. While m_lodFade is less than 1 the instance cross-fades from m_prevLod to m_lod.
+		uint8							m_lod;
+		uint8							m_prevLod;
+		float							m_lodFade;
+		float							m_screenSize;	 //-- projected bounding sphere size.
 		Transform*						m_transform;
+
+		//-- snapshot of the transform taken at the frame sync point. The render thread reads only it,
+		//-- because m_transform is changed by the game during the drawing.
+		mat4f							m_worldMat;
+		AABB							m_worldBounds;
+
+		//-- last known world state of the static instance. Used to detect static geometry changes.
+		bool							m_static;
+		mat4f							m_cachedWorldMat;
+		AABB							m_cachedWorldBounds;
 	};
 
 
@@ -40,16 +60,48 @@ namespace render
 
 		bool				init();
 		void				update(float dt);
-		uint				gatherROPs(RenderSystem::EPassType pass, bool instanced, RenderOps& rops, const mat4f& viewPort, AABB* aabb = nullptr);
 
-		//-- models.
+		//-- select LOD of the every instance based on its screen size as seen from the camera.
+		void				updateLods(const RenderCamera& cam, float dt);
+
+		//-- which kind of instances to gather.
+		enum EFilter
+		{
+			FILTER_ALL,
+			FILTER_STATIC,
+			FILTER_DYNAMIC
+		};
+
+		uint				gatherROPs(
+								RenderSystem::EPassType pass, bool instanced, RenderOps& rops, const mat4f& viewPort,
+								AABB* aabb = nullptr, const ShadowCasterVolume* casterVolume = nullptr,
+								EFilter filter = FILTER_ALL
+								);
+
+		//-- calculate bounds of the all visible instances in the desired space.
+		void				calcVisibleBounds(const mat4f& viewPort, const mat4f& space, AABB& bounds) const;
+
+		//-- models. Adding and removing of the instances waits for the render thread.
 		Handle				createMeshInstance(const MeshInstance::Desc& desc, Transform* transform);
 		void				removeMeshInstance(Handle handle);
 		MeshInstance&		getMeshInstance(Handle handle);
 
+		//-- world bounds of the static instances which were added, removed or moved since the last
+		//-- call of clearStaticChanges(). For every moved instance both old and new bounds are stored.
+		const std::vector<AABB>& staticChanges() const { return m_staticChanges; }
+		void					 clearStaticChanges()  { m_staticChanges.clear(); }
+
+	private:
+		uint				selectLod(const MeshInstance& inst, float screenSize) const;
+		void				gatherInstanceROPs(
+								const MeshInstance& inst, RenderSystem::EPassType pass, bool instanced,
+								RenderOps& rops, uint lod, float lodFade
+								);
+
 	private:
 		std::vector<std::unique_ptr<MeshInstance>>	m_meshInstances;
 		std::unique_ptr<MeshCollector>				m_meshCollector;
+		std::vector<AABB>							m_staticChanges;
 	};
 
 } //-- render
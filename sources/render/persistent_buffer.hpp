@@ -0,0 +1,111 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "render_system.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- CPU copy of the GPU texture buffer with per-slot dirty tracking. Elements live in the
+	//-- persistent slots and only changed slots are sent to the GPU. Adjacent changed slots are
+	//-- merged into one ranged update, so the upload bandwidth is proportional to the changes.
+	//----------------------------------------------------------------------------------------------
+	template<typename T>
+	class PersistentBuffer : public NonCopyable
+	{
+	public:
+		PersistentBuffer() : m_uploadedBytes(0) { }
+		~PersistentBuffer() { }
+
+		//------------------------------------------------------------------------------------------
+		bool init(uint capacity)
+		{
+			static_assert(sizeof(T) % sizeof(vec4f) == 0, "Element size must be multiple of the texel size.");
+
+			m_data.resize(capacity);
+			m_dirty.resize(capacity, false);
+			m_dirtySlots.reserve(capacity);
+
+			//-- GPU copy starts with the same content as the CPU one.
+			m_buffer = rd()->createBuffer(
+				IBuffer::TYPE_TEXTURE, &m_data[0], capacity * sizeof(T) / sizeof(vec4f), sizeof(vec4f),
+				IBuffer::USAGE_DEFAULT, IBuffer::CPU_ACCESS_NONE
+				);
+
+			return m_buffer != nullptr;
+		}
+
+		//-- write the slot. Slot becomes dirty only if its value really has changed.
+		//------------------------------------------------------------------------------------------
+		void set(uint slot, const T& value)
+		{
+			assert(slot < m_data.size());
+
+			if (memcmp(&m_data[slot], &value, sizeof(T)) == 0)
+				return;
+
+			m_data[slot] = value;
+
+			if (!m_dirty[slot])
+			{
+				m_dirty[slot] = true;
+				m_dirtySlots.push_back(slot);
+			}
+		}
+
+		//-- send all the dirty slots to the GPU. Returns the count of the uploaded bytes.
+		//------------------------------------------------------------------------------------------
+		uint upload()
+		{
+			m_uploadedBytes = 0;
+
+			if (m_dirtySlots.empty())
+				return 0;
+
+			std::sort(m_dirtySlots.begin(), m_dirtySlots.end());
+
+			for (uint i = 0; i < m_dirtySlots.size(); )
+			{
+				uint first = m_dirtySlots[i];
+				uint last  = first;
+
+				//-- merge adjacent slots into one range.
+				for (++i; i < m_dirtySlots.size() && m_dirtySlots[i] == last + 1; ++i)
+				{
+					++last;
+				}
+
+				for (uint j = first; j <= last; ++j)
+				{
+					m_dirty[j] = false;
+				}
+
+				uint size = (last - first + 1) * sizeof(T);
+				m_buffer->update(&m_data[first], first * sizeof(T), size);
+				m_uploadedBytes += size;
+			}
+
+			m_dirtySlots.clear();
+			return m_uploadedBytes;
+		}
+
+		const T&	operator[]	(uint slot) const	{ return m_data[slot]; }
+		uint		capacity	() const			{ return m_data.size(); }
+		uint		uploadedBytes() const			{ return m_uploadedBytes; }
+		IBuffer*	buffer		() const			{ return m_buffer.get(); }
+
+	private:
+		std::vector<T>				m_data;
+		std::vector<bool>			m_dirty;
+		std::vector<uint>			m_dirtySlots;
+		uint						m_uploadedBytes;
+		std::shared_ptr<IBuffer>	m_buffer;
+	};
+
+} //-- render
+} //-- brUGE
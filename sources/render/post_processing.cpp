@@ -2,6 +2,7 @@
 #include "os/FileSystem.h"
 #include "render_system.hpp"
 #include "materials.hpp"
+#include "console/Console.h"
 
 using namespace brUGE;
 using namespace brUGE::render;
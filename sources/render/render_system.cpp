@@ -5,9 +5,11 @@
 #include "IRenderDevice.h"
 #include "render_dll_Interface.h"
 #include "materials.hpp"
+#include "engine/frame_memory.hpp"
 #include "SDL/SDL_loadso.h"
 
 #include "console/WatchersPanel.h"
+#include "console/Console.h"
 #include "console/TimingPanel.h"
 
 #include "math/math_all.hpp"
@@ -72,6 +74,7 @@ namespace render
 		:	m_renderAPI(RENDER_API_D3D11),
 			m_shaderContext(new ShaderContext),
 			m_materials(new Materials),
+			m_geometryPool(new GeometryPool),
 			m_renderModuleDLL(nullptr)
 
 	{
@@ -128,6 +131,11 @@ namespace render
 			return false;
 		}
 
+		if (!m_geometryPool->init())
+		{
+			return false;
+		}
+
 		return _initPasses();
 	}
 	
@@ -138,6 +146,7 @@ namespace render
 		{
 			_finiPasses();
 
+			m_geometryPool.reset();
 			m_materials.reset();
 			m_shaderContext.reset();
 
@@ -665,13 +674,19 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	void RenderSystem::addImmediateROPs(const RenderOps& ops)
 	{
-		RenderOps rOps = ops;
+		//-- the copy lives only during the drawing, so keep it in the scratch memory.
+		ScratchScope scratch;
+		RenderOps	 rOps(ops.begin(), ops.end(), FrameMemory::scratchAllocator<RenderOp>());
+
 		_doDraw(rOps);
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void RenderSystem::_doDraw(RenderOps& ops)
 	{
+		//-- calculate per-instance constants of the whole pass at once.
+		m_shaderContext->prepareInstanceConstants(ops);
+
 		for (uint i = 0; i < ops.size(); ++i)
 		{
 			RenderOp&		ro   = ops[i];
@@ -709,7 +724,7 @@ namespace render
 			}
 
 			//-- apply shader for current pass.
-			m_shaderContext->applyFor(&ro);
+			m_shaderContext->applyFor(&ro, i);
 
 			if (ro.m_instanceCount != 0)
 			{
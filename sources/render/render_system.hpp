@@ -7,6 +7,7 @@
 #include "render/IRenderDevice.h"
 #include "render/state_objects.h"
 #include "render/shader_context.hpp"
+#include "render/geometry_pool.hpp"
 
 #include <vector>
 #include <map>
@@ -27,23 +28,23 @@ namespace render
 	{
 		RenderOp()
 			:	m_primTopolpgy(PRIM_TOPOLOGY_TRIANGLE_LIST), m_VBs(nullptr), m_VBCount(0), m_IB(nullptr),
-				m_matrixPaletteCount(0), m_matrixPalette(nullptr), m_startIndex(0), m_baseVertex(0), m_indicesCount(0),
-				m_instanceTB(nullptr), m_instanceCount(0), m_worldMat(nullptr), m_material(nullptr),
-				m_instanceData(nullptr), m_instanceSize(0), m_userData(nullptr)
+				m_matrixPaletteOffset(0), m_startIndex(0), m_baseVertex(0), m_indicesCount(0),
+				m_instanceTB(nullptr), m_instanceCount(0), m_instanceOffset(0), m_worldMat(nullptr), m_material(nullptr),
+				m_instanceData(nullptr), m_instanceSize(0), m_lodFade(1.0f), m_userData(nullptr)
 		{ }
 
-		//-- primitive topology of geometry.
-		uint16				m_startIndex;
-		uint16				m_baseVertex;
-		uint16				m_indicesCount;
+		//-- primitive topology of geometry. Start index and base vertex address the geometry inside
+		//-- the shared buffers of the geometry pool.
+		uint				m_startIndex;
+		uint				m_baseVertex;
+		uint				m_indicesCount;
 		EPrimitiveTopology	m_primTopolpgy;
 		//-- main data of static mesh and terrain.
 		IBuffer*			m_IB;
 		IBuffer**			m_VBs;
 		uint8				m_VBCount;
-		//-- addition data in case if mesh is animated.
-		const mat4f*		m_matrixPalette;
-		uint16				m_matrixPaletteCount;
+		//-- addition data in case if mesh is animated. Offset of the palette in the frame arena.
+		uint16				m_matrixPaletteOffset;
 		//-- material of given sub-mesh.
 		const RenderFx*		m_material;
 		//-- world transformation.
@@ -53,10 +54,13 @@ namespace render
 		const void*			m_instanceData;
 		uint16				m_instanceSize;
 		uint16				m_instanceCount;
+		uint16				m_instanceOffset; //-- offset of the first instance in the instance buffer.
+		//-- LOD cross-fade factor of the non-instanced geometry. Negative value means inverted dithering.
+		float				m_lodFade;
 		//-- user data.
 		const void*			m_userData;
 	};
-	typedef std::vector<RenderOp> RenderOps;
+	typedef utils::ArenaVector<RenderOp> RenderOps;
 
 
 	//-- The main class of the render system.
@@ -117,6 +121,7 @@ namespace render
 		IRenderDevice*				device()		const	 { return m_device; }
 		ShaderContext&				shaderContext()			 { return *m_shaderContext.get(); }
 		Materials&					materials()				 { return *m_materials.get(); }
+		GeometryPool&				geometryPool()			 { return *m_geometryPool.get(); }
 
 		//-- ToDo:
 		ShaderContext::EPassType	shaderPass(EPassType type) const;
@@ -149,6 +154,7 @@ namespace render
 		void*								m_renderModuleDLL;
 		std::unique_ptr<ShaderContext>		m_shaderContext;
 		std::unique_ptr<Materials>			m_materials;
+		std::unique_ptr<GeometryPool>		m_geometryPool;
 
 		const RenderCamera*					m_camera;
 		EPassType							m_pass;
@@ -0,0 +1,125 @@
+#include "render_thread.hpp"
+#include "console/WatchersPanel.h"
+#include "console/Console.h"
+#include "SDL/SDL_timer.h"
+
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- console variables.
+	bool  g_pipelined	 = true;
+
+	//-- watchers.
+	float g_syncWaitTime = 0.0f; //-- time the main thread waited for the render thread during the frame, in ms.
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
+namespace brUGE
+{
+namespace render
+{
+
+	//----------------------------------------------------------------------------------------------
+	RenderThread::RenderThread() : m_busy(false), m_quit(false), m_waitTime(0.0f)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	RenderThread::~RenderThread()
+	{
+		shutdown();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool RenderThread::init()
+	{
+		REGISTER_CONSOLE_VALUE("r_pipelined", bool, g_pipelined);
+		REGISTER_RO_WATCHER("render sync wait ms", float, g_syncWaitTime);
+
+		m_thread = std::thread([this]() { run(); });
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderThread::shutdown()
+	{
+		if (!m_thread.joinable())
+			return;
+
+		sync();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_quit = true;
+		}
+		m_kickCondition.notify_one();
+		m_thread.join();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderThread::kick(const std::function<void()>& job)
+	{
+		sync();
+
+		//-- the frame sync and all the flushes done by the structural changes since the last kick.
+		g_syncWaitTime = m_waitTime;
+		m_waitTime	   = 0.0f;
+
+		if (!g_pipelined || !m_thread.joinable())
+		{
+			job();
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_job  = job;
+			m_busy = true;
+		}
+		m_kickCondition.notify_one();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderThread::sync()
+	{
+		if (isRenderThread())
+			return;
+
+		uint64 start = SDL_GetPerformanceCounter();
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_doneCondition.wait(lock, [this]() { return !m_busy; });
+			m_waitTime += (SDL_GetPerformanceCounter() - start) * 1000.0f / SDL_GetPerformanceFrequency();
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void RenderThread::run()
+	{
+		for (;;)
+		{
+			std::function<void()> job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_kickCondition.wait(lock, [this]() { return m_busy || m_quit; });
+
+				if (m_quit)
+					return;
+
+				job.swap(m_job);
+			}
+
+			job();
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_busy = false;
+			}
+			m_doneCondition.notify_all();
+		}
+	}
+
+} //-- render
+} //-- brUGE
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- Dedicated thread for the render submission. At the sync point the main thread waits for
+	//-- the previous frame, copies the render snapshot (transforms, palettes, lights, decals, camera,
+	//-- ui and debug data) and kicks the submission of the frame N. Then it goes on with the update
+	//-- of the frame N + 1 while the render thread draws the frame N, so only one frame is in flight.
+	//-- The render thread reads only the snapshot, so everything else may be freely changed by the
+	//-- game. Structural changes of the render data (adding or removing instances) and tools which
+	//-- need the device have to call sync() first.
+	//----------------------------------------------------------------------------------------------
+	class RenderThread : public NonCopyable
+	{
+	public:
+		RenderThread();
+		~RenderThread();
+
+		bool init();
+		void shutdown();
+
+		//-- start submission of the frame. If pipelining is disabled the job is executed in place.
+		//-- Called once per frame, so it also publishes the sync wait time of the finished frame.
+		void kick(const std::function<void()>& job);
+
+		//-- wait until the render thread has finished the previous frame. It's safe to call it from
+		//-- the render thread itself, i.e. from the job, in this case it does nothing.
+		void sync();
+
+		bool isRenderThread() const { return std::this_thread::get_id() == m_thread.get_id(); }
+
+	private:
+		void run();
+
+	private:
+		std::thread				m_thread;
+		std::mutex				m_mutex;
+		std::condition_variable	m_kickCondition;
+		std::condition_variable	m_doneCondition;
+		std::function<void()>	m_job;
+		bool					m_busy;
+		bool					m_quit;
+		float					m_waitTime; //-- accumulated by sync() during the frame, in ms.
+	};
+
+} //-- render
+} //-- brUGE
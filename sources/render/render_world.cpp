@@ -12,11 +12,22 @@
 #include "shadow_manager.hpp"
 #include "post_processing.hpp"
 #include "terrain_system.hpp"
+#include "engine/Engine.h"
+#include "engine/frame_memory.hpp"
 
 using namespace brUGE;
 using namespace brUGE::utils;
 using namespace brUGE::math;
 
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- watchers.
+	uint g_drawHeapAllocs = 0; //-- general heap allocations made by the draw, zero in the steady-state.
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
 
 namespace brUGE
 {
@@ -54,17 +65,32 @@ namespace render
 		//-- ToDo: for now shadow manager initialization depends of post-processing framework. Fix this.
 		success &= m_postProcessing->init();
 		success &= m_shadowManager->init();
+
+#if defined(_DEBUG) || USE_FORCE_HEAP_ALLOCS_COUNTING
+		REGISTER_RO_WATCHER("draw heap allocs", uint, g_drawHeapAllocs);
+#endif
+
 		return success;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	void RenderWorld::update(float dt)
 	{
+		if (m_camera)
+		{
+			m_renderCam = m_camera->renderCam();
+		}
+
 		m_meshManager->update(dt);
+		if (m_camera)
+		{
+			m_meshManager->updateLods(m_renderCam, dt);
+		}
 		m_lightsManager->update(dt);
 		m_decalManager->update(dt);
 		m_shadowManager->update(dt);
 		m_postProcessing->update(dt);
+		m_debugDrawer->flush(m_renderCam);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -73,34 +99,38 @@ namespace render
 		m_camera = cam;
 	}
 
+	//-- Note: render operations of the passes live in the frame arena.
 	//----------------------------------------------------------------------------------------------
 	void RenderWorld::draw()
 	{
+		FrameMemory& frameMemory = Engine::instance().frameMemory();
+		uint64		 heapAllocs	 = FrameMemory::threadHeapAllocs();
+
 		//-- 1. z-only pass.
 		{
 			SCOPED_TIME_MEASURER_EX("z-pass")
 
 			//-- gather all ROPs.
-			RenderOps ops;
+			RenderOps ops(frameMemory.frameAllocator<RenderOp>());
 			{
 				SCOPED_TIME_MEASURER_EX("resolve visibility")
 				{
 					SCOPED_TIME_MEASURER_EX("meshes")
 					m_meshManager->gatherROPs(
-						RenderSystem::PASS_Z_ONLY, false, ops, m_camera->renderCam().m_viewProj
+						RenderSystem::PASS_Z_ONLY, false, ops, m_renderCam.m_viewProj
 						);
 				}
 				{
 					SCOPED_TIME_MEASURER_EX("terrain")
 					m_terrainSystem->gatherROPs(
-						RenderSystem::PASS_Z_ONLY, ops, m_camera->renderCam().m_viewProj,
-						m_camera->renderCam().m_invView.applyToOrigin()
+						RenderSystem::PASS_Z_ONLY, ops, m_renderCam.m_viewProj,
+						m_renderCam.m_invView.applyToOrigin()
 						);
 				}
 			}
 			
 			rs().beginPass(RenderSystem::PASS_Z_ONLY);
-			rs().setCamera(&m_camera->renderCam());
+			rs().setCamera(&m_renderCam);
 			rs().shaderContext().updatePerFrameViewConstants();
 			rs().addROPs(ops);
 			rs().endPass();
@@ -110,43 +140,54 @@ namespace render
 		{
 			SCOPED_TIME_MEASURER_EX("decal-pass")
 
-			RenderOps ops;
+			RenderOps ops(frameMemory.frameAllocator<RenderOp>());
 			m_decalManager->gatherRenderOps(ops);
 
 			rs().beginPass(RenderSystem::PASS_DECAL);
-			rs().setCamera(&m_camera->renderCam());
+			rs().setCamera(&m_renderCam);
 			rs().shaderContext().updatePerFrameViewConstants();
 			rs().addROPs(ops);
 			rs().endPass();
 		}
 
-		//-- 3. light pass
+		//-- 3. cast shadows. Goes before the light pass, because clustered lights sample the
+		//--	shadow atlas of the local lights.
+		{
+			SCOPED_TIME_MEASURER_EX("cast shadows")
+
+			m_shadowManager->castShadows(
+				m_renderCam, *m_lightsManager.get(), *m_meshManager.get(), *m_terrainSystem.get()
+				);
+
+			//-- all the static changes have been already consumed by the shadow manager.
+			m_meshManager->clearStaticChanges();
+		}
+
+		//-- 4. light pass
 		{
 			SCOPED_TIME_MEASURER_EX("light-pass")
 
-			RenderOps ops;
+			{
+				SCOPED_TIME_MEASURER_EX("clustering")
+				m_lightsManager->cull(m_renderCam, *m_shadowManager.get());
+			}
+
+			RenderOps ops(frameMemory.frameAllocator<RenderOp>());
 			m_lightsManager->gatherROPs(ops);
 
 			rs().beginPass(RenderSystem::PASS_LIGHT);
-			rs().setCamera(&m_camera->renderCam());
+			rs().setCamera(&m_renderCam);
 			rs().shaderContext().updatePerFrameViewConstants();
 			rs().addROPs(ops);
 			rs().endPass();
 		}
 
-		//-- 4. cast shadows
-		{
-			SCOPED_TIME_MEASURER_EX("cast shadows")
-
-			m_shadowManager->castShadows(m_camera->renderCam(), *m_lightsManager.get(), *m_meshManager.get());
-		}
-
 		//-- 5. resolve shadows.
 		{
 			SCOPED_TIME_MEASURER_EX("resolve shadows")
 
 
-			m_shadowManager->receiveShadows(&m_camera->renderCam());
+			m_shadowManager->receiveShadows(&m_renderCam);
 		}
 		
 		//-- 6. main pass.
@@ -154,26 +195,26 @@ namespace render
 			SCOPED_TIME_MEASURER_EX("main-pass")
 
 			//-- gather all ROPs.
-			RenderOps ops;
+			RenderOps ops(frameMemory.frameAllocator<RenderOp>());
 			{
 				SCOPED_TIME_MEASURER_EX("resolve visibility")
 				{
 					SCOPED_TIME_MEASURER_EX("meshes")
 						m_meshManager->gatherROPs(
-						RenderSystem::PASS_MAIN_COLOR, false, ops, m_camera->renderCam().m_viewProj
+						RenderSystem::PASS_MAIN_COLOR, false, ops, m_renderCam.m_viewProj
 						);
 				}
 				{
 					SCOPED_TIME_MEASURER_EX("terrain")
 						m_terrainSystem->gatherROPs(
-						RenderSystem::PASS_MAIN_COLOR, ops, m_camera->renderCam().m_viewProj,
-						m_camera->renderCam().m_invView.applyToOrigin()
+						RenderSystem::PASS_MAIN_COLOR, ops, m_renderCam.m_viewProj,
+						m_renderCam.m_invView.applyToOrigin()
 						);
 				}
 			}
 
 			rs().beginPass(RenderSystem::PASS_MAIN_COLOR);
-			rs().setCamera(&m_camera->renderCam());
+			rs().setCamera(&m_renderCam);
 			rs().shaderContext().updatePerFrameViewConstants();
 			rs().addROPs(ops);
 			rs().endPass();
@@ -185,7 +226,7 @@ namespace render
 
 			rs().beginPass(RenderSystem::PASS_POST_PROCESSING);
 			rs().addROPs(RenderOps());
-			rs().setCamera(&m_camera->renderCam());
+			rs().setCamera(&m_renderCam);
 			rs().shaderContext().updatePerFrameViewConstants();
 			m_postProcessing->draw();
 			rs().endPass();
@@ -200,13 +241,7 @@ namespace render
 			m_debugDrawer->draw();
 		}
 
-		//-- 10. draw imgui.
-		{
-			SCOPED_TIME_MEASURER_EX("imgui")
-
-			TimingPanel::instance().visualize();
-			WatchersPanel::instance().visualize();
-		}
+		g_drawHeapAllocs = FrameMemory::threadHeapAllocs() - heapAllocs;
 	}
 
 } //-- render
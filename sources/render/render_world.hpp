@@ -33,9 +33,13 @@ namespace render
 
 		bool			init();
 
-		//-- resolve visibility.
+		//-- take the render snapshot of the frame. It's called at the frame sync point while the
+		//-- render thread is idle.
 		void			update(float dt);
 		void			setCamera(const std::shared_ptr<Camera>& cam);
+		const Camera*	camera() const	 { return m_camera.get(); }
+
+		//-- draw the snapshot. It's executed on the render thread and mustn't touch the game state.
 		void			draw();
 
 		DecalManager&	decalManager()   { return *m_decalManager.get(); }
@@ -46,6 +50,7 @@ namespace render
 	
 	private:
 		std::shared_ptr<Camera>			m_camera;
+		RenderCamera					m_renderCam; //-- snapshot of the camera.
 		std::unique_ptr<DebugDrawer>	m_debugDrawer;
 		std::unique_ptr<DecalManager>   m_decalManager;
 		std::unique_ptr<LightsManager>  m_lightsManager;
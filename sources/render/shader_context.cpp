@@ -6,6 +6,10 @@
 #include "utils/string_utils.h"
 #include "vertex_declarations.hpp"
 #include "SDL/SDL_timer.h"
+#include "engine/Engine.h"
+#include "engine/job_system.hpp"
+#include "console/Console.h"
+#include <cstring>
 
 
 using namespace brUGE;
@@ -33,6 +37,24 @@ namespace
 		return code;
 	}
 
+	//-- the per-instance constants are calculated by several jobs only for the big passes.
+	uint g_instanceConstantsThreads	= 4;
+	uint g_instanceConstantsPerThread	= 512;
+
+	//-- watchers.
+	uint g_paletteMatrices = 0;
+
+	//-- layout of the cb_auto_PerInstance.
+	//----------------------------------------------------------------------------------------------
+	struct PerInstanceCB
+	{
+		uint  m_instance;
+		float m_alphaRef;
+		float m_padding[2];
+	};
+
+	//-- Note: the uniform block only selects the record inside the tb_auto_PerInstance, so here we
+	//--	   just switch between immutable buffers without any map/unmap.
 	//----------------------------------------------------------------------------------------------
 	class PerInstanceProperty : public IProperty
 	{
@@ -42,12 +64,7 @@ namespace
 
 		virtual bool operator() (Handle handle, IShader& shader) const
 		{
-			m_value.m_worldMat = m_sc.renderOp().m_worldMat ? *m_sc.renderOp().m_worldMat : mat4f();
-			m_value.m_MVPMat   = mult(m_value.m_worldMat, m_sc.camera()->m_viewProj);
-			m_value.m_MVMat	   = mult(m_value.m_worldMat, m_sc.camera()->m_view);
-			m_value.m_alphaRef = 0;
-
-			return shader.setUniformBlock(handle, &m_value, sizeof(PerInstanceCB));
+			return shader.changeUniformBuffer(handle, m_sc.instanceSlotCB());
 		}
 
 		virtual Handle handle(const char* name, const IShader& shader) const
@@ -56,40 +73,44 @@ namespace
 		}
 
 	private:
-		struct PerInstanceCB
-		{
-			mat4f m_worldMat;
-			mat4f m_MVPMat;
-			mat4f m_MVMat;
-			float m_alphaRef;
-			float m_padding[3];
-		};
-		mutable PerInstanceCB m_value;
-		ShaderContext&		  m_sc;
+		ShaderContext& m_sc;
 	};
 
 
 	//----------------------------------------------------------------------------------------------
-	class MatrixPaletteProperty : public IProperty
+	class PerInstanceTBProperty : public IProperty
 	{
 	public:
-		MatrixPaletteProperty(ShaderContext& sc) : m_sc(sc)
+		PerInstanceTBProperty(ShaderContext& sc) : m_sc(sc) { }
+		virtual ~PerInstanceTBProperty() { }
+
+		virtual bool operator() (Handle handle, IShader& shader) const
 		{
-			m_matrixPaletteTB = rd()->createBuffer(IBuffer::TYPE_TEXTURE, 0,
-				128 * 4, sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
-				);
+			return shader.setTextureBuffer(handle, m_sc.instanceConstantsTB());
+		}
+
+		virtual Handle handle(const char* name, const IShader& shader) const
+		{
+			return shader.getHandleTextureBuffer(name);
 		}
+
+	private:
+		ShaderContext& m_sc;
+	};
+
+
+	//-- Note: palettes are already uploaded into the frame arena, the render operation only carries
+	//--	   the offset of its palette inside the per-instance constants.
+	//----------------------------------------------------------------------------------------------
+	class MatrixPaletteProperty : public IProperty
+	{
+	public:
+		MatrixPaletteProperty(ShaderContext& sc) : m_sc(sc) { }
 		virtual ~MatrixPaletteProperty() { }
 
 		virtual bool operator () (Handle handle, IShader& shader) const
 		{
-			const RenderOp& ro = m_sc.renderOp();
-			if (mat4f* mp = m_matrixPaletteTB->map<mat4f>(IBuffer::ACCESS_WRITE_DISCARD))
-			{
-				memcpy(mp, ro.m_matrixPalette, sizeof(mat4f) * ro.m_matrixPaletteCount);
-				m_matrixPaletteTB->unmap();
-			}
-			return shader.setTextureBuffer(handle, m_matrixPaletteTB.get());
+			return shader.setTextureBuffer(handle, m_sc.matrixPalettesTB());
 		}
 
 		virtual Handle handle(const char* name, const IShader& shader) const
@@ -98,8 +119,7 @@ namespace
 		}
 
 	private:
-		std::shared_ptr<IBuffer>	m_matrixPaletteTB;
-		ShaderContext&				m_sc;
+		ShaderContext& m_sc;
 	};
 
 
@@ -113,10 +133,15 @@ namespace
 		virtual bool operator () (Handle handle, IShader& shader) const
 		{
 			const RenderOp& ro = m_sc.renderOp();
-			if (void* mp = ro.m_instanceTB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
+
+			//-- Note: null instance data means that the buffer is persistent and already updated.
+			if (ro.m_instanceData)
 			{
-				memcpy(mp, ro.m_instanceData, ro.m_instanceSize * ro.m_instanceCount);
-				ro.m_instanceTB->unmap();
+				if (void* mp = ro.m_instanceTB->map<void>(IBuffer::ACCESS_WRITE_DISCARD))
+				{
+					memcpy(mp, ro.m_instanceData, ro.m_instanceSize * ro.m_instanceCount);
+					ro.m_instanceTB->unmap();
+				}
 			}
 			return shader.setTextureBuffer(handle, m_sc.renderOp().m_instanceTB);
 		}
@@ -269,7 +294,8 @@ namespace render
 {
 	//----------------------------------------------------------------------------------------------
 	ShaderContext::ShaderContext()
-		:	m_renderOp(NULL)
+		:	m_renderOp(NULL), m_camera(nullptr), m_instance(0), m_uploadedChunk(0),
+			m_matrixPalettesCapacity(0), m_matrixPalettesOverflowed(false)
 	{
 
 	}
@@ -294,6 +320,7 @@ namespace render
 
 		//-- register auto-constants.
 		m_autoProperties["cb_auto_PerInstance"]		= new PerInstanceProperty(*this);
+		m_autoProperties["tb_auto_PerInstance"]		= new PerInstanceTBProperty(*this);
 		m_autoProperties["tb_auto_MatrixPalette"]	= new MatrixPaletteProperty(*this);
 		m_autoProperties["tb_auto_Instancing"]		= new InstancingProperty(*this);
 		m_autoProperties["t_auto_depthMap"]			= new DepthMapAutoProperty(*this);
@@ -307,6 +334,35 @@ namespace render
 			IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
 			);
 
+		//-- init per-instance constants buffers.
+		m_instanceConstantsTB = rd()->createBuffer(
+			IBuffer::TYPE_TEXTURE, nullptr, INSTANCE_CHUNK_SIZE * sizeof(InstanceConstants) / sizeof(vec4f),
+			sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+			);
+
+		if (!m_instanceConstantsTB)
+			return false;
+
+		m_instanceSlotCBs.resize(INSTANCE_CHUNK_SIZE);
+		for (uint i = 0; i < INSTANCE_CHUNK_SIZE; ++i)
+		{
+			PerInstanceCB cb = { i, 0.0f, { 0.0f, 0.0f } };
+
+			m_instanceSlotCBs[i] = rd()->createBuffer(
+				IBuffer::TYPE_UNIFORM, &cb, 1, sizeof(PerInstanceCB), IBuffer::USAGE_IMMUTABLE, IBuffer::CPU_ACCESS_NONE
+				);
+
+			if (!m_instanceSlotCBs[i])
+				return false;
+		}
+
+		//-- init matrix palettes arena.
+		if (!growMatrixPalettes(MIN_PALETTE_MATRICES))
+			return false;
+
+		REGISTER_CONSOLE_VALUE("r_instance_constants_threads", uint, g_instanceConstantsThreads);
+		REGISTER_RO_WATCHER("palette matrices", uint, g_paletteMatrices);
+
 		return true;
 	}
 
@@ -486,10 +542,160 @@ namespace render
 		m_camera = cam;
 	}
 
+	//-- Note: matrices of the every render operation are calculated here in one tight loop over
+	//--	   the linear array instead of calculating them inside the draw loop one by one.
 	//----------------------------------------------------------------------------------------------
-	void ShaderContext::applyFor(RenderOp* op)
+	void ShaderContext::prepareInstanceConstants(const RenderOps& ops)
 	{
+		m_instanceConstants.resize(ops.size());
+		m_instance		= 0;
+		m_uploadedChunk = 0;
+
+		if (ops.empty())
+			return;
+
+		assert(m_camera);
+
+		uint workers = clamp<uint>(1, ops.size() / g_instanceConstantsPerThread, g_instanceConstantsThreads);
+		uint opsPerWorker = (ops.size() + workers - 1) / workers;
+
+		//-- Note: the job system neither spawns threads nor allocates memory, so it's cheap enough
+		//--	   to be used for every pass.
+		Engine::instance().jobSystem().parallelFor(workers, 1, [this, &ops, opsPerWorker](uint first, uint last)
+		{
+			calcInstanceConstants(
+				ops, min<uint>(first * opsPerWorker, ops.size()), min<uint>(last * opsPerWorker, ops.size())
+				);
+		});
+
+		uploadInstanceChunk(0);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShaderContext::calcInstanceConstants(const RenderOps& ops, uint first, uint last)
+	{
+		const mat4f& view	  = m_camera->m_view;
+		const mat4f& viewProj = m_camera->m_viewProj;
+
+		for (uint i = first; i < last; ++i)
+		{
+			InstanceConstants& ic = m_instanceConstants[i];
+
+			ic.m_worldMat = ops[i].m_worldMat ? *ops[i].m_worldMat : mat4f();
+			ic.m_MVPMat	  = mult(ic.m_worldMat, viewProj);
+			ic.m_MVMat	  = mult(ic.m_worldMat, view);
+			ic.m_params	  = vec4ui(ops[i].m_matrixPaletteOffset, ops[i].m_instanceOffset, 0, 0);
+
+			//-- LOD fade goes to the shader as raw float bits.
+			memcpy(&ic.m_params.z, &ops[i].m_lodFade, sizeof(float));
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool ShaderContext::growMatrixPalettes(uint capacity)
+	{
+		std::shared_ptr<IBuffer> buffer = rd()->createBuffer(
+			IBuffer::TYPE_TEXTURE, nullptr, capacity * sizeof(mat4f) / sizeof(vec4f),
+			sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+			);
+
+		if (!buffer)
+		{
+			ERROR_MSG("Can't create matrix palettes arena of %d matrices.", capacity);
+			return false;
+		}
+
+		m_matrixPalettesTB		 = buffer;
+		m_matrixPalettesCapacity = capacity;
+		m_matrixPalettes.reserve(capacity);
+
+		return true;
+	}
+
+	//-- Note: it's called at the sync point, so the render thread doesn't use the arena now.
+	//----------------------------------------------------------------------------------------------
+	void ShaderContext::beginMatrixPalettes(uint matricesCount)
+	{
+		m_matrixPalettes.clear();
+
+		if (matricesCount > m_matrixPalettesCapacity && m_matrixPalettesCapacity < MAX_PALETTE_MATRICES)
+		{
+			uint capacity = m_matrixPalettesCapacity;
+			while (capacity < matricesCount && capacity < MAX_PALETTE_MATRICES)
+			{
+				capacity <<= 1;
+			}
+
+			growMatrixPalettes(min<uint>(capacity, MAX_PALETTE_MATRICES));
+		}
+
+		//-- warn only once per overflow.
+		bool overflowed = matricesCount > m_matrixPalettesCapacity;
+		if (overflowed && !m_matrixPalettesOverflowed)
+		{
+			WARNING_MSG("Matrix palettes arena is overflowed: %d of %d matrices. Some skinned instances won't be drawn.",
+				matricesCount, m_matrixPalettesCapacity
+				);
+		}
+		m_matrixPalettesOverflowed = overflowed;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	uint16 ShaderContext::addMatrixPalette(const mat4f* palette, uint count)
+	{
+		if (m_matrixPalettes.size() + count > m_matrixPalettesCapacity)
+			return INVALID_PALETTE_OFFSET;
+
+		uint16 offset = static_cast<uint16>(m_matrixPalettes.size());
+		m_matrixPalettes.insert(m_matrixPalettes.end(), palette, palette + count);
+
+		return offset;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShaderContext::endMatrixPalettes()
+	{
+		g_paletteMatrices = m_matrixPalettes.size();
+
+		if (m_matrixPalettes.empty())
+			return;
+
+		if (mat4f* mp = m_matrixPalettesTB->map<mat4f>(IBuffer::ACCESS_WRITE_DISCARD))
+		{
+			memcpy(mp, &m_matrixPalettes[0], sizeof(mat4f) * m_matrixPalettes.size());
+			m_matrixPalettesTB->unmap();
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShaderContext::uploadInstanceChunk(uint chunk)
+	{
+		uint first = chunk * INSTANCE_CHUNK_SIZE;
+		uint count = min<uint>(INSTANCE_CHUNK_SIZE, m_instanceConstants.size() - first);
+
+		if (InstanceConstants* mp = m_instanceConstantsTB->map<InstanceConstants>(IBuffer::ACCESS_WRITE_DISCARD))
+		{
+			memcpy(mp, &m_instanceConstants[first], sizeof(InstanceConstants) * count);
+			m_instanceConstantsTB->unmap();
+		}
+
+		m_uploadedChunk = chunk;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShaderContext::applyFor(RenderOp* op, uint instance)
+	{
+		assert(instance < m_instanceConstants.size());
+
 		m_renderOp = op;
+		m_instance = instance;
+
+		//-- the previous draw calls still see their chunk, because discard gives us a new memory.
+		uint chunk = instance / INSTANCE_CHUNK_SIZE;
+		if (chunk != m_uploadedChunk)
+		{
+			uploadInstanceChunk(chunk);
+		}
 
 		assert(op->m_material);
 
@@ -4,6 +4,7 @@
 #include "render/IShader.h"
 #include "render/IRenderDevice.h"
 #include "render/state_objects.h"
+#include "utils/linear_allocator.hpp"
 
 #include <vector>
 #include <map>
@@ -16,7 +17,7 @@ namespace render
 	//-- forward declaration.
 	class  VertexDeclarations;
 	struct RenderOp;
-	typedef std::vector<RenderOp> RenderOps;
+	typedef utils::ArenaVector<RenderOp> RenderOps;
 
 
 	//----------------------------------------------------------------------------------------------
@@ -193,10 +194,32 @@ namespace render
 		const RenderCamera* camera() const   { return m_camera; }
 
 		void				setCamera(const RenderCamera* cam);
-		void				applyFor(RenderOp* op);
+
+		//-- calculate per-instance constants of the all render operations of the pass at once.
+		//-- Must be called before the first applyFor() of the pass.
+		void				prepareInstanceConstants(const RenderOps& ops);
+		void				applyFor(RenderOp* op, uint instance);
+
+		//-- Frame-scoped arena of the skinning matrix palettes. Every palette is uploaded once per
+		//-- frame and then render operations of the all passes refer to it by offset. The arena
+		//-- grows at the beginning of the frame to fit the given count of matrices. Palettes which
+		//-- still don't fit get INVALID_PALETTE_OFFSET and theirs instances mustn't be drawn.
+		enum { INVALID_PALETTE_OFFSET = 0xffff };
+
+		void				beginMatrixPalettes(uint matricesCount);
+		uint16				addMatrixPalette(const mat4f* palette, uint count);
+		void				endMatrixPalettes();
+		IBuffer*			matrixPalettesTB() const { return m_matrixPalettesTB.get(); }
+
+		//-- per-instance constants of the current render operation.
+		IBuffer*						instanceConstantsTB() const { return m_instanceConstantsTB.get(); }
+		const std::shared_ptr<IBuffer>&	instanceSlotCB() const		{ return m_instanceSlotCBs[m_instance % INSTANCE_CHUNK_SIZE]; }
 
 	private:
 		Handle loadShader(const char* name, const std::vector<std::string>* pins);
+		void   calcInstanceConstants(const RenderOps& ops, uint first, uint last);
+		void   uploadInstanceChunk(uint chunk);
+		bool   growMatrixPalettes(uint capacity);
 
 	private:
 		typedef std::pair<std::shared_ptr<IShader>, Properties>	ShaderPair;
@@ -243,6 +266,33 @@ namespace render
 		std::shared_ptr<IBuffer>	m_perframeCB;
 		GlobalConstants				m_globalConstants;
 		PerFrameConstants			m_perframeConstants;
+
+		//-- Per-instance constants of the pass. They are uploaded by chunks, so one map/discard
+		//-- serves INSTANCE_CHUNK_SIZE draw calls. Every draw call selects its record in the chunk
+		//-- by binding the immutable uniform buffer holding the index of this record.
+		enum { INSTANCE_CHUNK_SIZE = 256 };
+
+		struct InstanceConstants
+		{
+			mat4f m_worldMat;
+			mat4f m_MVPMat;
+			mat4f m_MVMat;
+			vec4ui m_params; //-- x - offset of the matrix palette, y - offset of the instances batch.
+		};
+
+		std::vector<InstanceConstants>			m_instanceConstants;
+		std::shared_ptr<IBuffer>				m_instanceConstantsTB;
+		std::vector<std::shared_ptr<IBuffer>>	m_instanceSlotCBs;
+		uint									m_instance;
+		uint									m_uploadedChunk;
+
+		//-- max size has to match the tb_auto_MatrixPalette of the common.hlsl.
+		enum { MIN_PALETTE_MATRICES = 4096, MAX_PALETTE_MATRICES = 16384 };
+
+		std::vector<mat4f>						m_matrixPalettes;
+		std::shared_ptr<IBuffer>				m_matrixPalettesTB;
+		uint									m_matrixPalettesCapacity;
+		bool									m_matrixPalettesOverflowed;
 	};
 
 } // render
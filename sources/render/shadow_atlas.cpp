@@ -0,0 +1,200 @@
+#include "shadow_atlas.hpp"
+#include "render_system.hpp"
+#include "math/math_all.hpp"
+
+using namespace brUGE::math;
+
+namespace brUGE
+{
+namespace render
+{
+
+	//----------------------------------------------------------------------------------------------
+	ShadowAtlas::ShadowAtlas()
+		:	m_size(0), m_minTileSize(0), m_levels(0), m_usedTiles(0), m_usedTexels(0)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	ShadowAtlas::~ShadowAtlas()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool ShadowAtlas::init(uint size, uint minTileSize)
+	{
+		if (size == 0 || minTileSize == 0 || minTileSize > size)
+		{
+			ERROR_MSG("Invalid shadow atlas parameters: size %d, min tile size %d.", size, minTileSize);
+			return false;
+		}
+
+		m_size		  = size;
+		m_minTileSize = minTileSize;
+
+		//-- calculate levels count of the quadtree.
+		m_levels = 1;
+		for (uint tile = size; tile > minTileSize; tile >>= 1)
+		{
+			++m_levels;
+		}
+
+		//-- nodes count of the full quadtree is (4^levels - 1) / 3.
+		uint nodesCount = ((1 << (2 * m_levels)) - 1) / 3;
+
+		m_states.resize(nodesCount, NODE_FREE);
+		m_rects.resize(nodesCount);
+
+		//-- precalculate rects of the all nodes.
+		m_rects[0] = vec4ui(0, 0, size, size);
+		for (uint i = 0; i < nodesCount; ++i)
+		{
+			uint firstChild = 4 * i + 1;
+			if (firstChild >= nodesCount)
+				break;
+
+			const vec4ui& rect = m_rects[i];
+			uint half = rect.z / 2;
+
+			m_rects[firstChild + 0] = vec4ui(rect.x,		rect.y,		   half, half);
+			m_rects[firstChild + 1] = vec4ui(rect.x + half, rect.y,		   half, half);
+			m_rects[firstChild + 2] = vec4ui(rect.x,		rect.y + half, half, half);
+			m_rects[firstChild + 3] = vec4ui(rect.x + half, rect.y + half, half, half);
+		}
+
+		//-- create atlas texture.
+		{
+			ITexture::Desc desc;
+			desc.width		= size;
+			desc.height		= size;
+			desc.bindFalgs	= ITexture::BIND_DEPTH_STENCIL | ITexture::BIND_SHADER_RESOURCE;
+			desc.format		= ITexture::FORMAT_D32F;
+			desc.texType	= ITexture::TYPE_2D;
+
+			m_texture = rd()->createTexture(desc, NULL, 0);
+			if (!m_texture)
+				return false;
+		}
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Handle ShadowAtlas::allocate(uint tileSize)
+	{
+		tileSize = clamp(m_minTileSize, tileSize, m_size);
+
+		//-- find the target level. Level 0 is the whole atlas.
+		uint targetLevel = 0;
+		for (uint size = m_size; size / 2 >= tileSize && targetLevel + 1 < m_levels; size >>= 1)
+		{
+			++targetLevel;
+		}
+
+		Handle tile = allocate(0, 0, targetLevel);
+		if (tile != CONST_INVALID_HANDLE)
+		{
+			++m_usedTiles;
+			m_usedTexels += m_rects[tile].z * m_rects[tile].z;
+		}
+
+		return tile;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Handle ShadowAtlas::allocate(uint node, uint level, uint targetLevel)
+	{
+		uint8& state = m_states[node];
+
+		if (state == NODE_USED)
+		{
+			return CONST_INVALID_HANDLE;
+		}
+
+		if (level == targetLevel)
+		{
+			if (state != NODE_FREE)
+				return CONST_INVALID_HANDLE;
+
+			state = NODE_USED;
+			return node;
+		}
+
+		//-- divide free node and try to allocate tile in one of its children.
+		if (state == NODE_FREE)
+		{
+			state = NODE_SPLIT;
+			for (uint i = 1; i <= 4; ++i)
+			{
+				m_states[4 * node + i] = NODE_FREE;
+			}
+		}
+
+		for (uint i = 1; i <= 4; ++i)
+		{
+			Handle tile = allocate(4 * node + i, level + 1, targetLevel);
+			if (tile != CONST_INVALID_HANDLE)
+			{
+				return tile;
+			}
+		}
+
+		//-- collapse node back if nothing was allocated inside it.
+		merge(node);
+
+		return CONST_INVALID_HANDLE;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowAtlas::free(Handle tile)
+	{
+		if (tile == CONST_INVALID_HANDLE || m_states[tile] != NODE_USED)
+		{
+			assert(!"invalid shadow atlas tile.");
+			return;
+		}
+
+		--m_usedTiles;
+		m_usedTexels -= m_rects[tile].z * m_rects[tile].z;
+
+		m_states[tile] = NODE_FREE;
+
+		//-- walk up to the root and merge all completely free parents.
+		for (uint node = tile; node != 0; )
+		{
+			node = (node - 1) / 4;
+			merge(node);
+
+			if (m_states[node] != NODE_FREE)
+				break;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowAtlas::freeAll()
+	{
+		m_states[0]	 = NODE_FREE;
+		m_usedTiles	 = 0;
+		m_usedTexels = 0;
+	}
+
+	//-- Note: children of the free node are never read, so we don't need to reset their states.
+	//----------------------------------------------------------------------------------------------
+	void ShadowAtlas::merge(uint node)
+	{
+		if (m_states[node] != NODE_SPLIT)
+			return;
+
+		for (uint i = 1; i <= 4; ++i)
+		{
+			if (m_states[4 * node + i] != NODE_FREE)
+				return;
+		}
+
+		m_states[node] = NODE_FREE;
+	}
+
+} //-- render
+} //-- brUGE
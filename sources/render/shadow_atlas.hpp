@@ -0,0 +1,64 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "render_common.h"
+#include "math/Vector4.hpp"
+#include <vector>
+
+namespace brUGE
+{
+namespace render
+{
+
+	//-- Shadow atlas is a one large depth texture divided into the square power of two tiles. Tiles
+	//-- are managed by the implicit full quadtree, i.e. the root node covers the whole atlas and
+	//-- every node has exactly 4 children placed at indices [4 * n + 1, 4 * n + 4]. So allocation
+	//-- and releasing of the tiles don't need any dynamic memory.
+	//----------------------------------------------------------------------------------------------
+	class ShadowAtlas : public NonCopyable
+	{
+	public:
+		ShadowAtlas();
+		~ShadowAtlas();
+
+		bool			init(uint size, uint minTileSize);
+
+		//-- allocate tile with the desired size. Size will be rounded up to the nearest power of two
+		//-- in range [minTileSize, size]. Returns CONST_INVALID_HANDLE if there is no enough space.
+		Handle			allocate(uint tileSize);
+		void			free(Handle tile);
+		void			freeAll();
+
+		//-- returns tile rect in texels (x, y, width, height).
+		const vec4ui&	tileRect(Handle tile) const	{ return m_rects[tile]; }
+		uint			tileSize(Handle tile) const	{ return m_rects[tile].z; }
+		uint			size() const				{ return m_size; }
+		uint			minTileSize() const			{ return m_minTileSize; }
+		uint			usedTiles() const			{ return m_usedTiles; }
+		uint			usedTexels() const			{ return m_usedTexels; }
+		ITexture*		texture() const				{ return m_texture.get(); }
+
+	private:
+		enum ENodeState
+		{
+			NODE_FREE = 0,	//-- leaf node available for allocation.
+			NODE_USED,		//-- leaf node allocated as a tile.
+			NODE_SPLIT		//-- node is divided into 4 children.
+		};
+
+		Handle			allocate(uint node, uint level, uint targetLevel);
+		void			merge(uint node);
+
+	private:
+		uint						m_size;
+		uint						m_minTileSize;
+		uint						m_levels;
+		uint						m_usedTiles;
+		uint						m_usedTexels;
+		std::vector<uint8>			m_states;
+		std::vector<vec4ui>			m_rects;
+		std::shared_ptr<ITexture>	m_texture;
+	};
+
+} //-- render
+} //-- brUGE
@@ -1,12 +1,16 @@
 #include "shadow_manager.hpp"
 #include "light_manager.hpp"
 #include "mesh_manager.hpp"
+#include "terrain_system.hpp"
 #include "post_processing.hpp"
 #include "loader/ResourcesManager.h"
 #include "os/FileSystem.h"
 #include "math/math_all.hpp"
 #include "Camera.h"
 #include "console/WatchersPanel.h"
+#include "console/Console.h"
+#include <cstring>
+#include <algorithm>
 
 //-- ToDo:
 #include "Engine/Engine.h"
@@ -32,18 +36,60 @@ namespace
 	bool  g_useCullingMatrix = true;
 	bool  g_fitLightToTexels = true;
 	bool  g_blurShadows = false;
-	uint  g_ROPs = 0;
+	bool  g_cullCasters = true;
+	bool  g_cacheStaticShadows = true;
+	vec4f g_ROPs;
+	uint  g_cachedCascades = 0;
 	vec4f g_farDistances;
 	vec4f g_nearDistances;
 
+	//-- the stable cascade window moves by the 1/g_cascadeStepFraction of its size.
+	const uint g_cascadeStepFraction = 8;
+
+	//-- local lights shadows.
+	bool  g_enableLocalShadows = true;
+	uint  g_maxShadowedLights = 16;
+	uint  g_maxLocalShadowUpdates = 8;
+	uint  g_localShadowTiles = 0;
+	uint  g_localShadowUpdates = 0;
+	float g_shadowAtlasUsage = 0.0f;
+
+	//-- shadow atlas parameters.
+	const uint g_shadowAtlasSize	 = 4096;
+	const uint g_shadowAtlasMinTile = 64;
+	const uint g_shadowAtlasMaxTile = 1024;
+
+	//-- relative widening of the coverage range of the current tile size.
+	const float g_tileSizeHysteresis = 0.25f;
+
+	//-- max number of the faces of all the shadowed local lights.
+	const uint g_maxLocalShadowFaces = 32 * 6;
+
+	//-- cube map faces directions and up vectors.
+	const vec3f g_cubeFaceDirs[6] =
+	{
+		vec3f(+1, 0, 0), vec3f(-1, 0, 0), vec3f(0, +1, 0), vec3f(0, -1, 0), vec3f(0, 0, +1), vec3f(0, 0, -1)
+	};
+	const vec3f g_cubeFaceUps[6] =
+	{
+		vec3f(0, 1, 0), vec3f(0, 1, 0), vec3f(0, 0, -1), vec3f(0, 0, 1), vec3f(0, 1, 0), vec3f(0, 1, 0)
+	};
+
+	//-- shadow_resolve.hlsl has exactly this number of the split shadow maps.
+	const uint g_maxSplitCount = 4;
+	const char* g_shadowMapNames[g_maxSplitCount] =
+	{
+		"g_shadowMap0", "g_shadowMap1", "g_shadowMap2", "g_shadowMap3"
+	};
+
 	//-- Represents shadow mapping c-buffer constants.
 	//----------------------------------------------------------------------------------------------
 	struct ShadowConstants
 	{
 		vec2f m_shadowMapRes;
 		vec2f m_invShadowMapRes;
-		float m_splitPlanes[4];
-		mat4f m_shadowMatrices[4];
+		float m_splitPlanes[g_maxSplitCount];
+		mat4f m_shadowMatrices[g_maxSplitCount];
 	};
 
 	//-- Practical split scheme:
@@ -79,42 +125,118 @@ namespace
 		}
 	}
 
+	//-- Frustum corners are indexed by the bit mask: bit 0 - right(1) or left(0), bit 1 - top(1) or
+	//-- bottom(0) and bit 2 - far(1) or near(0).
 	//----------------------------------------------------------------------------------------------
-	void calcFrustrumAABB(AABB& aabb, const mat4f& invVPMat)
+	void calcFrustumCorners(vec3f corners[8], const mat4f& invVPMat)
 	{
-		vec4f points[8];
-
-		//-- calculate frustum corners.
-		points[0] = invVPMat.applyToPoint(vec4f(-1.f, 1.f, 1.f, 1.0f));
-		points[1] = invVPMat.applyToPoint(vec4f(-1.f, 1.f, 0.f, 1.0f));
-		points[2] = invVPMat.applyToPoint(vec4f( 1.f, 1.f, 0.f, 1.0f));
-		points[3] = invVPMat.applyToPoint(vec4f( 1.f, 1.f, 1.f, 1.0f));
+		for (uint i = 0; i < 8; ++i)
+		{
+			vec4f point = invVPMat.applyToPoint(vec4f(
+				(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : 0.0f, 1.0f
+				));
 
-		points[4] = invVPMat.applyToPoint(vec4f(-1.f,-1.f, 1.f, 1.0f));
-		points[5] = invVPMat.applyToPoint(vec4f(-1.f,-1.f, 0.f, 1.0f));
-		points[6] = invVPMat.applyToPoint(vec4f( 1.f,-1.f, 0.f, 1.0f));
-		points[7] = invVPMat.applyToPoint(vec4f( 1.f,-1.f, 1.f, 1.0f));
+			corners[i] = point.toVec3().scale(1.0f / point.w);
+		}
+	}
 
-		//-- calculate AABB for current camera frustum.
+	//----------------------------------------------------------------------------------------------
+	void calcFrustrumAABB(AABB& aabb, const vec3f corners[8])
+	{
 		for (uint i = 0; i < 8; ++i)
 		{
-			vec3f point = points[i].toVec3().scale(1.0f / points[i].w);
-			aabb.include(point);
+			aabb.include(corners[i]);
 		}
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void calcFrustrumAABB(AABB& aabb, const mat4f& viewMat, const Projection& proj)
+	void calcSplitViewProjMat(mat4f& vpMat, const mat4f& viewMat, const Projection& proj)
 	{
 		mat4f projMat;
 		float aspectRatio = rs().screenRes().width / rs().screenRes().height;
 		projMat.setPerspectiveProj(proj.fov, aspectRatio, proj.nearDist, proj.farDist);
 
-		mat4f invVPMat(viewMat);
-		invVPMat.postMultiply(projMat);
-		invVPMat.invert();
+		vpMat = viewMat;
+		vpMat.postMultiply(projMat);
+	}
+
+	//-- make plane facing to the desired point.
+	//----------------------------------------------------------------------------------------------
+	void facePlaneTo(Plane& plane, const vec3f& point)
+	{
+		if (plane.signedDistanceTo(point) < 0.0f)
+		{
+			plane.m_normal = plane.m_normal.scale(-1.0f);
+			plane.m_dist   = -plane.m_dist;
+		}
+	}
+
+	//-- Build convex hull of the frustum extruded toward the light. Frustum planes which are
+	//-- facing to the light are removed, and instead of them we add planes passing through the
+	//-- silhouette edges of the frustum (i.e. edges shared by the removed and the remaining planes)
+	//-- and parallel to the light direction.
+	//----------------------------------------------------------------------------------------------
+	void calcCasterVolumePlanes(ShadowCasterVolume& volume, const vec3f corners[8], const vec3f& lightDir)
+	{
+		enum { FACE_NEAR = 0, FACE_FAR, FACE_LEFT, FACE_RIGHT, FACE_BOTTOM, FACE_TOP };
+
+		//-- first 3 corners of the each frustum face. See calcFrustumCorners.
+		const uint8 faces[6][3] =
+		{
+			{0, 1, 2}, {4, 5, 6}, {0, 2, 4}, {1, 3, 5}, {0, 1, 4}, {2, 3, 6}
+		};
+
+		//-- frustum edges with their adjacent faces.
+		const uint8 edges[12][4] =
+		{
+			{0, 1, FACE_NEAR, FACE_BOTTOM}, {2, 3, FACE_NEAR, FACE_TOP  },
+			{4, 5, FACE_FAR,  FACE_BOTTOM}, {6, 7, FACE_FAR,  FACE_TOP  },
+			{0, 2, FACE_NEAR, FACE_LEFT  }, {1, 3, FACE_NEAR, FACE_RIGHT},
+			{4, 6, FACE_FAR,  FACE_LEFT  }, {5, 7, FACE_FAR,  FACE_RIGHT},
+			{0, 4, FACE_LEFT, FACE_BOTTOM}, {1, 5, FACE_RIGHT, FACE_BOTTOM},
+			{2, 6, FACE_LEFT, FACE_TOP   }, {3, 7, FACE_RIGHT, FACE_TOP   }
+		};
+
+		vec3f center(0,0,0);
+		for (uint i = 0; i < 8; ++i)
+		{
+			center += corners[i];
+		}
+		center = center.scale(1.0f / 8.0f);
+
+		//-- 1. keep only planes which are not crossed by the extrusion toward the light.
+		bool keep[6];
+		volume.m_planesCount = 0;
+		for (uint i = 0; i < 6; ++i)
+		{
+			Plane plane(corners[faces[i][0]], corners[faces[i][1]], corners[faces[i][2]]);
+			facePlaneTo(plane, center);
+
+			keep[i] = plane.m_normal.dot(lightDir) <= 0.0f;
+			if (keep[i])
+			{
+				volume.m_planes[volume.m_planesCount++] = plane;
+			}
+		}
+
+		//-- 2. add silhouette planes.
+		for (uint i = 0; i < 12; ++i)
+		{
+			if (keep[edges[i][2]] == keep[edges[i][3]])
+				continue;
+
+			const vec3f& p0 = corners[edges[i][0]];
+			const vec3f& p1 = corners[edges[i][1]];
 
-		calcFrustrumAABB(aabb, invVPMat);
+			vec3f normal = vec3f(p1 - p0).cross(lightDir);
+			if (normal.length() < EPSILON)
+				continue;
+
+			Plane plane(normal, p0);
+			facePlaneTo(plane, center);
+
+			volume.m_planes[volume.m_planesCount++] = plane;
+		}
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -216,6 +338,152 @@ namespace
 		rCam.m_viewProj.postMultiply(lightProjMat);
 	}
 
+	//-- Light camera of the constant size fitted to the bounding sphere of the split. The radius of
+	//-- the sphere depends only on the split distances and the camera's fov, so the texel size
+	//-- stays the same while the camera moves or rotates. The window and the depth range of the
+	//-- projection are snapped to the grid of the step (g_cascadeStepFraction of the shadow map),
+	//-- so the light projection changes only when the split's center crosses the grid cell. This
+	//-- removes shimmering of the shadow edges and keeps the cached static shadow map valid.
+	//----------------------------------------------------------------------------------------------
+	void calcStableLightCamera(
+		RenderCamera& rCam, const vec3f corners[8], const Projection& split, const DirectionLight& dirLight,
+		uint shadowMapRes)
+	{
+		//-- the view matrix depends only on the light direction.
+		mat4f lightViewMat;
+		lightViewMat.setLookAt(dirLight.m_dir.scale(-250.0f), dirLight.m_dir, vec3f(0,1,0));
+
+		//-- radius of the sphere centered at the middle of the split on the view axis.
+		float aspectRatio = rs().screenRes().width / rs().screenRes().height;
+		float tanY		  = tanf(degToRad(split.fov * 0.5f));
+		float tanX		  = tanY * aspectRatio;
+		float halfDepth	  = (split.farDist - split.nearDist) * 0.5f;
+		float radius	  = sqrtf((tanX * tanX + tanY * tanY) * split.farDist * split.farDist + halfDepth * halfDepth);
+
+		vec3f center(0,0,0);
+		for (uint i = 0; i < 8; ++i)
+		{
+			center += corners[i];
+		}
+		center = lightViewMat.applyToPoint(center.scale(1.0f / 8.0f));
+
+		//-- the window is one step larger than the sphere, so the sphere is inside the window for
+		//-- any position of the center inside the grid cell.
+		uint  stepTexels = shadowMapRes / g_cascadeStepFraction;
+		float texelSize  = (2.0f * radius) / (shadowMapRes - stepTexels);
+		float step		 = texelSize * stepTexels;
+		float size		 = texelSize * shadowMapRes;
+
+		Projection projInfo;
+		projInfo.isOrtho	 = true;
+		projInfo.isOrthoSpec = true;
+		projInfo.l			 = floorf(center.x / step) * step - radius;
+		projInfo.r			 = projInfo.l + size;
+		projInfo.b			 = floorf(center.y / step) * step - radius;
+		projInfo.t			 = projInfo.b + size;
+		projInfo.nearDist	 = floorf((center.z - radius) / step) * step;
+		projInfo.farDist	 = ceilf ((center.z + radius) / step) * step;
+		projInfo.width		 = size;
+		projInfo.height		 = size;
+
+		g_width  = projInfo.width;
+		g_height = projInfo.height;
+
+		mat4f lightProjMat;
+		lightProjMat.setOrthoOffCenterProj(
+			projInfo.l, projInfo.r, projInfo.b, projInfo.t, projInfo.nearDist, projInfo.farDist
+			);
+
+		rCam.m_projInfo = projInfo;
+		rCam.m_view	    = lightViewMat;
+		rCam.m_proj	    = lightProjMat;
+		rCam.m_invView  = lightViewMat.getInverted();
+		rCam.m_viewProj = lightViewMat;
+		rCam.m_viewProj.postMultiply(lightProjMat);
+	}
+
+	//-- key of the local light's face in the tiles cache.
+	//----------------------------------------------------------------------------------------------
+	inline uint localShadowKey(Handle light, bool isSpot, uint face)
+	{
+		return (static_cast<uint>(light) << 4) | (isSpot ? 8 : 0) | face;
+	}
+
+	//-- rough estimation of the part of the screen height covered by the sphere.
+	//----------------------------------------------------------------------------------------------
+	float calcScreenCoverage(const RenderCamera& cam, const vec3f& center, float radius)
+	{
+		float dist = cam.m_view.applyToPoint(center).length();
+		if (dist <= radius)
+		{
+			return 1.0f;
+		}
+
+		float projRadius = radius * cam.m_proj(1, 1) / sqrtf(dist * dist - radius * radius);
+		return min(projRadius, 1.0f);
+	}
+
+	//-- power of two tile size proportional to the screen coverage.
+	//----------------------------------------------------------------------------------------------
+	uint calcTileSize(float coverage)
+	{
+		uint tileSize = g_shadowAtlasMinTile;
+		while (tileSize < g_shadowAtlasMaxTile && tileSize < coverage * g_shadowAtlasMaxTile)
+		{
+			tileSize <<= 1;
+		}
+		return tileSize;
+	}
+
+	//-- The current size is kept while the coverage stays inside its range widened by the
+	//-- hysteresis, so the tile doesn't jump between two sizes while the camera moves around the
+	//-- threshold. Zero current size means that the tile doesn't have the size yet.
+	//----------------------------------------------------------------------------------------------
+	uint calcTileSize(float coverage, uint curSize)
+	{
+		if (curSize != 0)
+		{
+			float lower = 0.5f * curSize / g_shadowAtlasMaxTile;
+			float upper = 1.0f * curSize / g_shadowAtlasMaxTile;
+
+			if (coverage > lower * (1.0f - g_tileSizeHysteresis) && coverage <= upper * (1.0f + g_tileSizeHysteresis))
+				return curSize;
+		}
+
+		return calcTileSize(coverage);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void calcLocalLightCamera(
+		RenderCamera& rCam, const vec3f& pos, const vec3f& dir, const vec3f& up, float fov, float range)
+	{
+		Projection& projInfo = rCam.m_projInfo;
+		projInfo.isOrtho	 = false;
+		projInfo.isOrthoSpec = false;
+		projInfo.fov		 = fov;
+		projInfo.nearDist	 = max(0.05f, range * 0.01f);
+		projInfo.farDist	 = range;
+
+		rCam.m_view.setLookAt(pos, dir, up);
+		rCam.m_proj.setPerspectiveProj(projInfo.fov, 1.0f, projInfo.nearDist, projInfo.farDist);
+		rCam.m_invView	= rCam.m_view.getInverted();
+		rCam.m_viewProj = rCam.m_view;
+		rCam.m_viewProj.postMultiply(rCam.m_proj);
+	}
+
+	//-- test if the local light's frustum intersects the camera frustum.
+	//----------------------------------------------------------------------------------------------
+	bool isLocalLightFaceVisible(const RenderCamera& lightCam, const RenderCamera& cam)
+	{
+		vec3f corners[8];
+		calcFrustumCorners(corners, lightCam.m_viewProj.getInverted());
+
+		AABB aabb;
+		calcFrustrumAABB(aabb, corners);
+
+		return aabb.calculateOutcode(cam.m_viewProj) == 0;
+	}
+
 }
 //--------------------------------------------------------------------------------------------------
 //-- end unnamed namespace.
@@ -226,16 +494,54 @@ namespace brUGE
 namespace render
 {
 
+	//----------------------------------------------------------------------------------------------
+	bool ShadowCasterVolume::isVisible(const AABB& worldBounds) const
+	{
+		//-- 1. test against the extruded cascade frustum.
+		for (uint i = 0; i < m_planesCount; ++i)
+		{
+			const Plane& plane = m_planes[i];
+
+			//-- find the most positive vertex of the AABB relative to the plane normal.
+			vec3f pVertex(
+				plane.m_normal.x >= 0.0f ? worldBounds.m_max.x : worldBounds.m_min.x,
+				plane.m_normal.y >= 0.0f ? worldBounds.m_max.y : worldBounds.m_min.y,
+				plane.m_normal.z >= 0.0f ? worldBounds.m_max.z : worldBounds.m_min.z
+				);
+
+			if (plane.signedDistanceTo(pVertex) < 0.0f)
+				return false;
+		}
+
+		//-- 2. shadow of the caster is a projection of its bounds along the light direction, so
+		//--	in light space it has to overlap receivers on the XY plane and has to be in front of
+		//--	the farthest receiver.
+		AABB lightBounds = worldBounds.getTranformed(m_lightViewMat);
+
+		if (	lightBounds.m_max.x < m_receiversBounds.m_min.x || lightBounds.m_min.x > m_receiversBounds.m_max.x
+			||	lightBounds.m_max.y < m_receiversBounds.m_min.y || lightBounds.m_min.y > m_receiversBounds.m_max.y
+			||	lightBounds.m_min.z > m_receiversBounds.m_max.z
+			)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
 	//----------------------------------------------------------------------------------------------
 	ShadowManager::ShadowManager()
 		:	m_shadowMapRes(2048), m_splitShemeLambda(0.85f), m_splitCount(4), m_uiEnabled(false),
-			m_autoSplitSheme(true), m_bias(1.0f), m_slopeScaleBias(4.0f), m_pVB(nullptr)
+			m_autoSplitSheme(true), m_bias(1.0f), m_slopeScaleBias(4.0f), m_pVB(nullptr),
+			m_clearTileDS(CONST_INVALID_HANDLE), m_frame(0)
 	{
 		REGISTER_CONSOLE_VALUE("r_shadow_adjust_volume",		bool,  g_adjustShadowVolume);
 		REGISTER_CONSOLE_VALUE("r_shadow_use_culling_mat",		bool,  g_useCullingMatrix);
 		REGISTER_CONSOLE_VALUE("r_shadow_fit_light_to_texels",	bool,  g_fitLightToTexels);
 		REGISTER_CONSOLE_VALUE("r_shadow_enable_blur",			bool,  g_blurShadows);
 		REGISTER_CONSOLE_VALUE("r_shadow_enable",				bool,  g_enableShadows);
+		REGISTER_CONSOLE_VALUE("r_shadow_cull_casters",			bool,  g_cullCasters);
+		REGISTER_CONSOLE_VALUE("r_shadow_cache_static",			bool,  g_cacheStaticShadows);
 		REGISTER_CONSOLE_MEMBER_VALUE("r_shadow_enable_ui",		bool, m_uiEnabled, ShadowManager);
 
 		REGISTER_RO_WATCHER("shadow light far distances",  vec4f, g_farDistances);
@@ -247,7 +553,16 @@ namespace render
 		REGISTER_RO_WATCHER("shadow camera height",	float, g_height);
 		REGISTER_RO_WATCHER("shadow camera z-near", float, g_nearZ);
 		REGISTER_RO_WATCHER("shadow camera z-far",	float, g_farZ);
-		REGISTER_RO_WATCHER("shadow ROPs count",	uint,  g_ROPs);
+		REGISTER_RO_WATCHER("shadow ROPs count",	vec4f, g_ROPs);
+		REGISTER_RO_WATCHER("shadow cached cascades", uint, g_cachedCascades);
+
+		REGISTER_CONSOLE_VALUE("r_shadow_local_enable",			bool,  g_enableLocalShadows);
+		REGISTER_CONSOLE_VALUE("r_shadow_local_max_lights",		uint,  g_maxShadowedLights);
+		REGISTER_CONSOLE_VALUE("r_shadow_local_max_updates",	uint,  g_maxLocalShadowUpdates);
+
+		REGISTER_RO_WATCHER("shadow local tiles",	uint,  g_localShadowTiles);
+		REGISTER_RO_WATCHER("shadow local updates", uint,  g_localShadowUpdates);
+		REGISTER_RO_WATCHER("shadow atlas usage",	float, g_shadowAtlasUsage);
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -259,6 +574,8 @@ namespace render
 	//----------------------------------------------------------------------------------------------
 	bool ShadowManager::init()
 	{
+		assert(m_splitCount == g_maxSplitCount && "shadow_resolve.hlsl expects exactly 4 splits.");
+
 		//-- setup full-screen quad.
 		{
 			VertexXYZUV vertices[4];
@@ -294,11 +611,13 @@ namespace render
 				return false;
 			}
 
-			if (mtllib.size() != 2)
+			if (mtllib.size() != 4)
 				return false;
 
 			m_shadowResolveMaterial	= mtllib[0];
 			m_shadowBlurMaterial	= mtllib[1];
+			m_clearTileMaterial		= mtllib[2];
+			m_copyTileMaterial		= mtllib[3];
 		}
 
 		//-- load noise texture.
@@ -331,6 +650,12 @@ namespace render
 
 			op.m_material = m_shadowBlurMaterial->renderFx();
 			m_blurROPs.push_back(op);
+
+			op.m_material = m_clearTileMaterial->renderFx();
+			m_clearTileROPs.push_back(op);
+
+			op.m_material = m_copyTileMaterial->renderFx();
+			m_copyTileROPs.push_back(op);
 		}
 
 		//-- create blur map.
@@ -351,24 +676,26 @@ namespace render
 				return false;
 		}
 
-		//-- create shadow map.
+		//-- create shadow maps and static shadow maps for every split.
 		{
 			ITexture::Desc desc;
-			desc.width		= m_shadowMapRes * m_splitCount;
+			desc.width		= m_shadowMapRes;
 			desc.height		= m_shadowMapRes;
 			desc.bindFalgs	= ITexture::BIND_DEPTH_STENCIL | ITexture::BIND_SHADER_RESOURCE;
 			desc.format		= ITexture::FORMAT_D32F;
 			desc.texType	= ITexture::TYPE_2D;
 
-			m_shadowMaps = rd()->createTexture(desc, NULL, 0);
-			if (!m_shadowMaps)
-				return false;
-
-			//-- create view port for the each individual shadow map.
-			m_shadowViewPorts.resize(m_splitCount);
+			m_shadowMaps.resize(m_splitCount);
+			m_staticCascades.resize(m_splitCount);
 			for (uint i = 0; i < m_splitCount; ++i)
 			{
-				m_shadowViewPorts[i] = vec4ui(m_shadowMapRes * i, 0, m_shadowMapRes, m_shadowMapRes);
+				m_shadowMaps[i] = rd()->createTexture(desc, NULL, 0);
+				if (!m_shadowMaps[i])
+					return false;
+
+				m_staticCascades[i].m_shadowMap = rd()->createTexture(desc, NULL, 0);
+				if (!m_staticCascades[i].m_shadowMap)
+					return false;
 			}
 
 			SamplerStateDesc sDesc;
@@ -382,9 +709,45 @@ namespace render
 				return false;
 		}
 
+		//-- create shadow atlas for the local lights.
+		{
+			if (!m_shadowAtlas.init(g_shadowAtlasSize, g_shadowAtlasMinTile))
+				return false;
+
+			ITexture::Desc desc;
+			desc.width		= g_shadowAtlasSize;
+			desc.height		= g_shadowAtlasSize;
+			desc.bindFalgs	= ITexture::BIND_DEPTH_STENCIL | ITexture::BIND_SHADER_RESOURCE;
+			desc.format		= ITexture::FORMAT_D32F;
+			desc.texType	= ITexture::TYPE_2D;
+
+			m_staticAtlas = rd()->createTexture(desc, NULL, 0);
+			if (!m_staticAtlas)
+				return false;
+
+			m_localShadowsTB = rd()->createBuffer(
+				IBuffer::TYPE_TEXTURE, NULL, g_maxLocalShadowFaces * sizeof(GPULocalShadow) / sizeof(vec4f),
+				sizeof(vec4f), IBuffer::USAGE_DYNAMIC, IBuffer::CPU_ACCESS_WRITE
+				);
+
+			if (!m_localShadowsTB)
+				return false;
+
+			//-- depth state to clear and copy the part of the atlas.
+			DepthStencilStateDesc dsDesc;
+			dsDesc.depthWriteMask = true;
+			dsDesc.depthEnable	  = true;
+			dsDesc.depthFunc	  = DepthStencilStateDesc::COMPARE_FUNC_ALWAYS;
+
+			m_clearTileDS = rd()->createDepthStencilState(dsDesc);
+			if (m_clearTileDS == CONST_INVALID_HANDLE)
+				return false;
+		}
+
 		//-- ToDo:
 		m_shadowCameras.resize(m_splitCount);
-		m_splitPlanes.resize(m_splitCount, 0);
+		m_splitPlanes.resize(m_splitCount + 1, 0);
+		m_casterVolumes.resize(m_splitCount);
 
 		//-- create UI.
 		m_ui.reset(new UI(*this));
@@ -399,9 +762,18 @@ namespace render
 	}
 
 	//----------------------------------------------------------------------------------------------
-	void ShadowManager::castShadows(const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager)
+	void ShadowManager::castShadows(
+		const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager,
+		TerrainSystem& terrainSystem)
 	{
-		if (!g_enableShadows) return;
+		if (!g_enableShadows)
+		{
+			//-- we don't track static changes while shadows are disabled.
+			invalidateStaticShadows();
+			m_pointLightShadows.clear();
+			m_spotLightShadows.clear();
+			return;
+		}
 
 		//-- ToDo: gather all light casted shadows.
 		const DirectionLight& dirLight = lightManager.getDirLight(0);
@@ -427,20 +799,55 @@ namespace render
 			proj.farDist  = m_splitPlanes[i + 1];
 			proj.fov      = cam.m_projInfo.fov;
 			
-			calcFrustrumAABB(aabb, cam.m_view, proj);
-			calcLightCamera(m_shadowCameras[i], aabb, dirLight);
-		}
+			mat4f splitVPMat;
+			calcSplitViewProjMat(splitVPMat, cam.m_view, proj);
 
-		//-- 3. gather ROPs for each particular split.
+			vec3f corners[8];
+			calcFrustumCorners(corners, splitVPMat.getInverted());
+			calcFrustrumAABB(aabb, corners);
 
-		//-- 4. clear shadow map.
-		rd()->clearDepthStencilRT(CLEAR_DEPTH, m_shadowMaps.get(), 1.0f, 0);
+			if (g_fitLightToTexels)
+				calcStableLightCamera(m_shadowCameras[i], corners, proj, dirLight, m_shadowMapRes);
+			else
+				calcLightCamera(m_shadowCameras[i], aabb, dirLight);
 
-		g_ROPs = 0;
+			//-- 3. calculate caster culling volume for the current split.
+			ShadowCasterVolume& volume = m_casterVolumes[i];
+			{
+				calcCasterVolumePlanes(volume, corners, dirLight.m_dir);
+				volume.m_lightViewMat = m_shadowCameras[i].m_view;
+
+				//-- find out light space bounds of the visible receivers clipped by split bounds.
+				AABB receivers;
+				meshManager.calcVisibleBounds(splitVPMat, volume.m_lightViewMat, receivers);
+				terrainSystem.calcVisibleBounds(splitVPMat, volume.m_lightViewMat, receivers);
+
+				AABB splitBounds = aabb.getTranformed(volume.m_lightViewMat);
+				volume.m_receiversBounds.set(
+					vec3f(
+						max(receivers.m_min.x, splitBounds.m_min.x),
+						max(receivers.m_min.y, splitBounds.m_min.y),
+						receivers.m_min.z
+						),
+					vec3f(
+						min(receivers.m_max.x, splitBounds.m_max.x),
+						min(receivers.m_max.y, splitBounds.m_max.y),
+						receivers.m_max.z
+						)
+					);
+			}
+		}
+
+		//-- 4. draw casters for each particular split.
+		const std::vector<AABB>& staticChanges = meshManager.staticChanges();
+		const vec4ui			 fullViewPort(0, 0, m_shadowMapRes, m_shadowMapRes);
+
+		g_cachedCascades = 0;
 		for (uint i = 0; i < m_splitCount; ++i)
 		{
 			RenderCamera& curCam	  = m_shadowCameras[i];
 			Projection&   curProjInfo = curCam.m_projInfo;
+			const ShadowCasterVolume* casterVolume = g_cullCasters ? &m_casterVolumes[i] : nullptr;
 
 			m_castROPs.clear();
 
@@ -461,13 +868,15 @@ namespace render
 			cullingVPMat.preMultiply(curCam.m_view);
 
 			//-- Try to make far near distance difference as small as possible.
-			if (g_adjustShadowVolume)
+			//-- Note: the adjusted depth range follows the casters, which breaks the static cache.
+			if (g_adjustShadowVolume && !g_cacheStaticShadows)
 			{
 				AABB aabb;
 				meshManager.gatherROPs(
 					RenderSystem::PASS_SHADOW_CAST, false,
-					m_castROPs, g_useCullingMatrix ? cullingVPMat : curCam.m_viewProj, &aabb
+					m_castROPs, g_useCullingMatrix ? cullingVPMat : curCam.m_viewProj, &aabb, casterVolume
 					);
+				m_castROPs.clear();
 
 				Projection projInfo;
 				calcLightProjInfo(projInfo, curCam.m_view, aabb);
@@ -495,31 +904,469 @@ namespace render
 				}
 				curCam.m_viewProj.preMultiply(curCam.m_view);
 			}
-			else
+
+			//-- update watchers.
+			g_ROPs[i]			= 0;
+			g_nearDistances[i]	= curProjInfo.nearDist;
+			g_farDistances[i]	= curProjInfo.farDist;
+
+			ITexture* shadowMap = m_shadowMaps[i].get();
+
+			if (!g_cacheStaticShadows)
 			{
 				meshManager.gatherROPs(
 					RenderSystem::PASS_SHADOW_CAST, false,
-					m_castROPs, g_useCullingMatrix ? cullingVPMat : curCam.m_viewProj
+					m_castROPs, g_useCullingMatrix ? cullingVPMat : curCam.m_viewProj, nullptr, casterVolume
 					);
+
+				g_ROPs[i] = m_castROPs.size();
+
+				rd()->clearDepthStencilRT(CLEAR_DEPTH, shadowMap, 1.0f, 0);
+				drawCasters(curCam, shadowMap, fullViewPort);
+
+				//-- we don't track static changes while caching is disabled.
+				m_staticCascades[i].m_valid = false;
+				continue;
 			}
 
-			//-- update watchers.
-			g_ROPs			   += m_castROPs.size();
-			g_nearDistances[i]  = curProjInfo.nearDist;
-			g_farDistances[i]   = curProjInfo.farDist;
+			//-- 5. update static shadow map only if projection of the split has changed or any static
+			//--	object inside the split has been added, removed or moved. The projection is built
+			//--	from the snapped bounds (see calcStableLightCamera), so the matrix is bit-exact
+			//--	while the camera stays inside the grid cell of the split.
+			//--	Note: caster volume depends on the visible receivers, which may change every frame,
+			//--		  so static casters are culled only against light projection, which is
+			//--		  the key of the cached shadow map.
+			StaticCascade& cascade = m_staticCascades[i];
+			{
+				bool isValid = cascade.m_valid;
+				isValid &= memcmp(&cascade.m_viewProj, &curCam.m_viewProj, sizeof(mat4f)) == 0;
+
+				for (uint j = 0; isValid && j < staticChanges.size(); ++j)
+				{
+					isValid &= staticChanges[j].calculateOutcode(cullingVPMat) != 0;
+				}
+
+				if (isValid)
+				{
+					++g_cachedCascades;
+				}
+				else
+				{
+					meshManager.gatherROPs(
+						RenderSystem::PASS_SHADOW_CAST, false,
+						m_castROPs, cullingVPMat, nullptr, nullptr, MeshManager::FILTER_STATIC
+						);
 
-			//-- draw ROPs into the particular shadow map.
+					g_ROPs[i] += m_castROPs.size();
+
+					rd()->clearDepthStencilRT(CLEAR_DEPTH, cascade.m_shadowMap.get(), 1.0f, 0);
+					drawCasters(curCam, cascade.m_shadowMap.get(), fullViewPort);
+					m_castROPs.clear();
+
+					cascade.m_viewProj = curCam.m_viewProj;
+					cascade.m_valid	   = true;
+				}
+			}
+
+			//-- 6. draw dynamic casters on top of the static shadow map.
+			{
+				meshManager.gatherROPs(
+					RenderSystem::PASS_SHADOW_CAST, false,
+					m_castROPs, g_useCullingMatrix ? cullingVPMat : curCam.m_viewProj, nullptr, casterVolume,
+					MeshManager::FILTER_DYNAMIC
+					);
+
+				g_ROPs[i] += m_castROPs.size();
+
+				rd()->copyTexture(cascade.m_shadowMap.get(), shadowMap);
+				drawCasters(curCam, shadowMap, fullViewPort);
+			}
+		}
+
+		//-- 7. cast shadows from the point and spot lights.
+		castLocalShadows(cam, lightManager, meshManager);
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::drawCasters(const RenderCamera& cam, ITexture* shadowMap, const vec4ui& viewPort)
+	{
+		rs().beginPass(RenderSystem::PASS_SHADOW_CAST);
+		rd()->setRenderTarget(nullptr, shadowMap);
+		rd()->setViewPort(viewPort.x, viewPort.y, viewPort.z, viewPort.w);
+		rs().setCamera(&cam);
+		rs().shaderContext().updatePerFrameViewConstants();
+		rs().addROPs(m_castROPs);
+		rs().endPass();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::invalidateStaticShadows()
+	{
+		for (auto& cascade : m_staticCascades)
+		{
+			cascade.m_valid = false;
+		}
+
+		for (auto& tile : m_localTiles)
+		{
+			tile.second.m_valid = false;
+		}
+	}
+
+	//----------------------------------------------------------------------------------------------
+	int ShadowManager::pointLightShadow(Handle light) const
+	{
+		return (static_cast<uint>(light) < m_pointLightShadows.size()) ? m_pointLightShadows[light] : -1;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	int ShadowManager::spotLightShadow(Handle light) const
+	{
+		return (static_cast<uint>(light) < m_spotLightShadows.size()) ? m_spotLightShadows[light] : -1;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::bindLocalShadows(IShader& shader) const
+	{
+		shader.setTexture("g_shadowAtlas", m_shadowAtlas.texture(), m_shadowMapSml);
+		shader.setTextureBuffer("tb_localShadows", m_localShadowsTB.get());
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::clearAtlasTile(ITexture* atlas, Handle tile)
+	{
+		const vec4ui& rect = m_shadowAtlas.tileRect(tile);
+
+		rs().beginPass(RenderSystem::PASS_SHADOW_CAST);
+		rd()->setRenderTarget(nullptr, atlas);
+		rd()->setViewPort(rect.x, rect.y, rect.z, rect.w);
+		rd()->setDepthStencilState(m_clearTileDS, 0);
+		rs().addImmediateROPs(m_clearTileROPs);
+		rs().endPass();
+	}
+
+	//-- copy the tile of the static atlas into the same tile of the shadow atlas.
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::copyAtlasTile(Handle tile)
+	{
+		const vec4ui& rect = m_shadowAtlas.tileRect(tile);
+
+		IShader* shader = rs().shaderContext().shader(m_copyTileROPs[0].m_material->m_shader);
+		shader->setTexture("g_staticAtlas", m_staticAtlas.get(), m_shadowMapSml);
+
+		rs().beginPass(RenderSystem::PASS_SHADOW_CAST);
+		rd()->setRenderTarget(nullptr, m_shadowAtlas.texture());
+		rd()->setViewPort(rect.x, rect.y, rect.z, rect.w);
+		rd()->setDepthStencilState(m_clearTileDS, 0);
+		rs().addImmediateROPs(m_copyTileROPs);
+		rs().endPass();
+	}
+
+	//-- Every frame the most important shadow casting point and spot lights get tiles in the shadow
+	//-- atlas. Tile size depends on the light's screen coverage. Static casters of the tile are
+	//-- cached in the static atlas while the light and the static casters inside its frustum don't
+	//-- change, and re-rendering of them is limited by the budget, so the cost is bounded even with
+	//-- dozens of shadowed lights. Dynamic casters are drawn over the copy of the cached tile in the
+	//-- same way as the cascades of the direction light do it.
+	//----------------------------------------------------------------------------------------------
+	void ShadowManager::castLocalShadows(
+		const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager)
+	{
+		++m_frame;
+
+		m_localLights.clear();
+		m_localRequests.clear();
+		m_gpuLocalShadows.clear();
+		m_pointLightShadows.assign(lightManager.pointLightSlots(), -1);
+		m_spotLightShadows.assign(lightManager.spotLightSlots(), -1);
+
+		g_localShadowTiles	 = 0;
+		g_localShadowUpdates = 0;
+
+		if (!g_enableLocalShadows)
+		{
+			m_shadowAtlas.freeAll();
+			m_localTiles.clear();
+			g_shadowAtlasUsage = 0.0f;
+			return;
+		}
+
+		//-- 1. find visible shadow casting lights and estimate theirs importance.
+		for (uint i = 0; i < lightManager.pointLightSlots(); ++i)
+		{
+			if (!lightManager.hasPointLight(i))
+				continue;
+
+			const PointLight& light = lightManager.renderPointLight(i);
+			if (!light.m_castShadows)
+				continue;
+
+			float radius = light.m_intoutRadius.y;
+			AABB  bounds(light.m_pos - vec3f(radius, radius, radius), light.m_pos + vec3f(radius, radius, radius));
+
+			if (bounds.calculateOutcode(cam.m_viewProj) != 0)
+				continue;
+
+			LocalLightInfo info = { calcScreenCoverage(cam, light.m_pos, radius), static_cast<Handle>(i), false };
+			m_localLights.push_back(info);
+		}
+
+		for (uint i = 0; i < lightManager.spotLightSlots(); ++i)
+		{
+			if (!lightManager.hasSpotLight(i))
+				continue;
+
+			const SpotLight& light = lightManager.renderSpotLight(i);
+			if (!light.m_castShadows)
+				continue;
+
+			float range = light.m_startEndFading.y;
+			AABB  bounds(light.m_pos - vec3f(range, range, range), light.m_pos + vec3f(range, range, range));
+
+			if (bounds.calculateOutcode(cam.m_viewProj) != 0)
+				continue;
+
+			LocalLightInfo info = { calcScreenCoverage(cam, light.m_pos, range), static_cast<Handle>(i), true };
+			m_localLights.push_back(info);
+		}
+
+		//-- 2. select the most important lights.
+		std::sort(m_localLights.begin(), m_localLights.end(),
+			[](const LocalLightInfo& lt, const LocalLightInfo& rt) { return lt.m_coverage > rt.m_coverage; }
+			);
+
+		if (m_localLights.size() > min(g_maxShadowedLights, g_maxLocalShadowFaces / 6))
+		{
+			m_localLights.resize(min(g_maxShadowedLights, g_maxLocalShadowFaces / 6));
+		}
+
+		//-- 3. request tiles for the visible faces of the selected lights.
+		for (const auto& info : m_localLights)
+		{
+			LocalShadowRequest request;
+
+			if (info.m_isSpot)
+			{
+				const SpotLight& light = lightManager.renderSpotLight(info.m_light);
+
+				float fov = radToDeg(2.0f * acosf(clamp(-1.0f, light.m_inoutCosAngle.y, 1.0f)));
+				vec3f up  = (fabs(light.m_dir.y) > 0.99f) ? vec3f(1, 0, 0) : vec3f(0, 1, 0);
+
+				calcLocalLightCamera(
+					request.m_camera, light.m_pos, light.m_dir, up, clamp(1.0f, fov, 170.0f),
+					light.m_startEndFading.y
+					);
+
+				if (isLocalLightFaceVisible(request.m_camera, cam))
+				{
+					request.m_key	   = localShadowKey(info.m_light, true, 0);
+					request.m_coverage = info.m_coverage;
+					m_localRequests.push_back(request);
+				}
+			}
+			else
+			{
+				const PointLight& light = lightManager.renderPointLight(info.m_light);
+
+				//-- every face covers only part of the light's influence, so use twice smaller tiles.
+				for (uint face = 0; face < 6; ++face)
+				{
+					calcLocalLightCamera(
+						request.m_camera, light.m_pos, g_cubeFaceDirs[face], g_cubeFaceUps[face], 90.0f,
+						light.m_intoutRadius.y
+						);
+
+					//-- cube face culling.
+					if (!isLocalLightFaceVisible(request.m_camera, cam))
+						continue;
+
+					request.m_key	   = localShadowKey(info.m_light, false, face);
+					request.m_coverage = info.m_coverage * 0.5f;
+					m_localRequests.push_back(request);
+				}
+			}
+		}
+
+		//-- 4. release tiles which are not requested anymore.
+		for (const auto& request : m_localRequests)
+		{
+			auto iter = m_localTiles.find(request.m_key);
+			if (iter != m_localTiles.end())
+			{
+				iter->second.m_frame = m_frame;
+			}
+		}
+
+		for (auto iter = m_localTiles.begin(); iter != m_localTiles.end(); )
+		{
+			if (iter->second.m_frame != m_frame)
+			{
+				if (iter->second.m_tile != CONST_INVALID_HANDLE)
+				{
+					m_shadowAtlas.free(iter->second.m_tile);
+				}
+				iter = m_localTiles.erase(iter);
+			}
+			else
 			{
-				const vec4ui& curViewPort = m_shadowViewPorts[i];
-				rs().beginPass(RenderSystem::PASS_SHADOW_CAST);
-				rd()->setRenderTarget(nullptr, m_shadowMaps.get());
-				rd()->setViewPort(curViewPort.x, curViewPort.y, curViewPort.z, curViewPort.w);
-				rs().setCamera(&curCam);
-				rs().shaderContext().updatePerFrameViewConstants();
-				rs().addROPs(m_castROPs);
-				rs().endPass();
+				++iter;
 			}
 		}
+
+		//-- 5. allocate tiles and update content of the changed ones. Requests are sorted by the
+		//--	importance, so the most important lights get space and updates first.
+		const std::vector<AABB>& staticChanges = meshManager.staticChanges();
+
+		for (const auto& request : m_localRequests)
+		{
+			LocalShadowTile& tile = m_localTiles[request.m_key];
+			tile.m_frame = m_frame;
+			tile.m_size	 = calcTileSize(request.m_coverage, tile.m_size);
+
+			//-- 5.1. desired tile size has changed. Smaller tile always fits into the place of the
+			//--	  current one. Larger tile replaces the current one only if there is enough space,
+			//--	  otherwise we keep the current tile and try again on the next frame.
+			if (tile.m_tile != CONST_INVALID_HANDLE && m_shadowAtlas.tileSize(tile.m_tile) != tile.m_size)
+			{
+				if (m_shadowAtlas.tileSize(tile.m_tile) > tile.m_size)
+				{
+					m_shadowAtlas.free(tile.m_tile);
+					tile.m_tile	 = m_shadowAtlas.allocate(tile.m_size);
+					tile.m_valid = false;
+				}
+				else
+				{
+					Handle larger = m_shadowAtlas.allocate(tile.m_size);
+					if (larger != CONST_INVALID_HANDLE)
+					{
+						m_shadowAtlas.free(tile.m_tile);
+						tile.m_tile	 = larger;
+						tile.m_valid = false;
+					}
+				}
+			}
+
+			//-- 5.2. try to allocate tile, and if there is no enough space try the smaller one.
+			if (tile.m_tile == CONST_INVALID_HANDLE)
+			{
+				for (uint size = tile.m_size; size >= g_shadowAtlasMinTile; size >>= 1)
+				{
+					if ((tile.m_tile = m_shadowAtlas.allocate(size)) != CONST_INVALID_HANDLE)
+						break;
+				}
+
+				tile.m_valid = false;
+
+				if (tile.m_tile == CONST_INVALID_HANDLE)
+					continue;
+			}
+
+			//-- 5.3. find out if the static content of the tile is still valid.
+			const mat4f&  viewProj = request.m_camera.m_viewProj;
+			const vec4ui& rect	   = m_shadowAtlas.tileRect(tile.m_tile);
+			bool isValid = tile.m_valid;
+			isValid &= memcmp(&tile.m_camera.m_viewProj, &viewProj, sizeof(mat4f)) == 0;
+
+			for (uint j = 0; isValid && j < staticChanges.size(); ++j)
+			{
+				isValid &= staticChanges[j].calculateOutcode(viewProj) != 0;
+			}
+
+			//-- 5.4. re-render static casters if we still have budget. Otherwise keep outdated
+			//--	  content together with its camera.
+			bool isUpdated = false;
+			if (!isValid && g_localShadowUpdates < g_maxLocalShadowUpdates)
+			{
+				m_castROPs.clear();
+				meshManager.gatherROPs(
+					RenderSystem::PASS_SHADOW_CAST, false, m_castROPs, viewProj, nullptr, nullptr,
+					MeshManager::FILTER_STATIC
+					);
+
+				tile.m_camera = request.m_camera;
+				tile.m_valid  = true;
+
+				clearAtlasTile(m_staticAtlas.get(), tile.m_tile);
+				drawCasters(tile.m_camera, m_staticAtlas.get(), rect);
+
+				isUpdated = true;
+				++g_localShadowUpdates;
+			}
+
+			//-- tile has never been rendered.
+			if (!tile.m_valid)
+				continue;
+
+			//-- 5.5. draw dynamic casters over the static content. Tile is refreshed only if the
+			//--	  static content has changed or there are dynamic casters now or the last time.
+			m_castROPs.clear();
+			meshManager.gatherROPs(
+				RenderSystem::PASS_SHADOW_CAST, false, m_castROPs, tile.m_camera.m_viewProj, nullptr, nullptr,
+				MeshManager::FILTER_DYNAMIC
+				);
+
+			if (isUpdated || tile.m_hasDynamic || !m_castROPs.empty())
+			{
+				copyAtlasTile(tile.m_tile);
+				if (!m_castROPs.empty())
+				{
+					drawCasters(tile.m_camera, m_shadowAtlas.texture(), rect);
+				}
+
+				tile.m_hasDynamic = !m_castROPs.empty();
+			}
+		}
+
+		//-- 6. fill GPU shadows. Faces of the point light are placed consecutively.
+		for (const auto& info : m_localLights)
+		{
+			uint first = m_gpuLocalShadows.size();
+			uint faces = info.m_isSpot ? 1 : 6;
+			bool found = false;
+
+			for (uint face = 0; face < faces; ++face)
+			{
+				GPULocalShadow shadow;
+				shadow.m_viewProj.setIdentity();
+				shadow.m_tileRect.setZero();
+
+				auto iter = m_localTiles.find(localShadowKey(info.m_light, info.m_isSpot, face));
+				if (iter != m_localTiles.end() && iter->second.m_valid && iter->second.m_tile != CONST_INVALID_HANDLE)
+				{
+					const vec4ui& rect = m_shadowAtlas.tileRect(iter->second.m_tile);
+					float invSize = 1.0f / m_shadowAtlas.size();
+
+					shadow.m_viewProj = iter->second.m_camera.m_viewProj;
+					shadow.m_tileRect = vec4f(rect.x * invSize, rect.y * invSize, rect.z * invSize, rect.w * invSize);
+
+					found = true;
+					++g_localShadowTiles;
+				}
+
+				m_gpuLocalShadows.push_back(shadow);
+			}
+
+			if (found)
+			{
+				(info.m_isSpot ? m_spotLightShadows : m_pointLightShadows)[info.m_light] = first;
+			}
+			else
+			{
+				m_gpuLocalShadows.resize(first);
+			}
+		}
+
+		//-- 7. upload shadows to the GPU.
+		if (!m_gpuLocalShadows.empty())
+		{
+			if (GPULocalShadow* data = m_localShadowsTB->map<GPULocalShadow>(IBuffer::ACCESS_WRITE_DISCARD))
+			{
+				memcpy(data, &m_gpuLocalShadows[0], m_gpuLocalShadows.size() * sizeof(GPULocalShadow));
+				m_localShadowsTB->unmap();
+			}
+		}
+
+		g_shadowAtlasUsage = m_shadowAtlas.usedTexels() / static_cast<float>(m_shadowAtlas.size() * m_shadowAtlas.size());
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -544,7 +1391,10 @@ namespace render
 			}
 
 			shader->setUniformBlock("g_shadowConstants", &constants, sizeof(ShadowConstants));
-			shader->setTexture("g_shadowMap", m_shadowMaps.get(), m_shadowMapSml);
+			for (uint i = 0; i < m_splitCount; ++i)
+			{
+				shader->setTexture(g_shadowMapNames[i], m_shadowMaps[i].get(), m_shadowMapSml);
+			}
 			shader->setTexture("g_noiseMap", m_noiseMap.get(), m_noiseMapSml);
 		}
 
@@ -4,7 +4,10 @@
 #include "render_common.h"
 #include "materials.hpp"
 #include "vertex_format.hpp"
+#include "math/Plane.hpp"
+#include "shadow_atlas.hpp"
 #include <memory>
+#include <unordered_map>
 
 namespace brUGE
 {
@@ -14,11 +17,31 @@ namespace render
 {
 	class  LightsManager;
 	class  MeshManager;
+	class  TerrainSystem;
 	struct DirectionLight;
 
+	//-- Culling volume of the shadow casters for the one particular shadow cascade. It consists of
+	//-- the convex hull of the cascade frustum extruded toward the light and light space bounds of
+	//-- the visible shadow receivers inside this cascade.
+	//----------------------------------------------------------------------------------------------
+	struct ShadowCasterVolume
+	{
+		ShadowCasterVolume() : m_planesCount(0) { }
+
+		//-- returns true if object with the desired world space bounds may cast shadow on any of
+		//-- the visible receivers.
+		bool isVisible(const AABB& worldBounds) const;
+
+		//-- 6 planes of the cascade frustum plus up to 6 silhouette planes.
+		Plane m_planes[12];
+		uint  m_planesCount;
+		mat4f m_lightViewMat;
+		AABB  m_receiversBounds; //-- in light view space.
+	};
+
 	//-- Class is responsible for calculating different kinds of shadows and displaying it on the
-	//-- screen. For now it uses only direction light shadows, but in the near future it will be able
-	//-- to cast shadows from the point light and spot light.
+	//-- screen. Direction light uses cascaded shadow maps, point and spot lights share one shadow
+	//-- atlas, where the most important lights get their tiles every frame.
 	//-- ToDo:
 	//----------------------------------------------------------------------------------------------
 	class ShadowManager : public NonCopyable
@@ -30,10 +53,81 @@ namespace render
 		bool init();
 		void update(float dt);
 		
-		void castShadows(const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager);
+		void castShadows(
+			const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager,
+			TerrainSystem& terrainSystem
+			);
 		void receiveShadows(const RenderCamera* rCam);
 
+		//-- force to re-render static shadow maps on the next frame.
+		void invalidateStaticShadows();
+
+		//-- Shadow of the local light's face. Point light has 6 consecutive faces, spot light has
+		//-- only one. Empty tile rect means that face doesn't have shadow this frame.
+		struct GPULocalShadow
+		{
+			mat4f m_viewProj;
+			vec4f m_tileRect; //-- atlas uv offset (xy) and scale (zw).
+		};
+
+		//-- returns index of the first GPULocalShadow of the light or -1 if light doesn't have
+		//-- shadow this frame.
+		int			pointLightShadow(Handle light) const;
+		int			spotLightShadow(Handle light) const;
+
+		//-- bind the shadow atlas and the GPULocalShadow records of this frame.
+		void		bindLocalShadows(IShader& shader) const;
+
 	private:
+		void drawCasters(const RenderCamera& cam, ITexture* shadowMap, const vec4ui& viewPort);
+		void castLocalShadows(const RenderCamera& cam, LightsManager& lightManager, MeshManager& meshManager);
+		void clearAtlasTile(ITexture* atlas, Handle tile);
+		void copyAtlasTile(Handle tile);
+
+	private:
+		//-- Cached shadow map of the static casters for the particular split. It's reused until
+		//-- the snapped light projection or any static object inside the split changes.
+		struct StaticCascade
+		{
+			StaticCascade() : m_valid(false) { }
+
+			std::shared_ptr<ITexture>	m_shadowMap;
+			mat4f						m_viewProj;
+			bool						m_valid;
+		};
+
+		//-- Atlas tile of the one face of the local light. Static casters are cached in the same
+		//-- tile of the static atlas and reused while the light and the static casters inside the
+		//-- face frustum don't change. Dynamic casters are drawn over the copy of the static tile.
+		struct LocalShadowTile
+		{
+			LocalShadowTile()
+				:	m_tile(CONST_INVALID_HANDLE), m_size(0), m_valid(false), m_hasDynamic(false), m_frame(0) { }
+
+			Handle			m_tile;
+			uint			m_size;		  //-- desired size, allocated tile may be smaller.
+			RenderCamera	m_camera;
+			bool			m_valid;	  //-- static content is up to date.
+			bool			m_hasDynamic; //-- dynamic casters are drawn over the static content.
+			uint			m_frame;	  //-- last frame when the tile was requested.
+		};
+
+		//-- Candidate face for the local shadow selected this frame.
+		struct LocalShadowRequest
+		{
+			uint			m_key;
+			float			m_coverage;	//-- screen coverage of the face.
+			RenderCamera	m_camera;
+		};
+
+		//-- Importance of the local light.
+		struct LocalLightInfo
+		{
+			float	m_coverage;
+			Handle	m_light;
+			bool	m_isSpot;
+		};
+
 		uint						m_shadowMapRes;
 		std::shared_ptr<IBuffer>	m_fsQuadVB;
 		IBuffer*					m_pVB;
@@ -57,10 +151,28 @@ namespace render
 		float						m_splitShemeLambda;
 		vec2f						m_cameraFarNearDist;
 		uint						m_splitCount;
-		std::shared_ptr<ITexture>	m_shadowMaps;
+		std::vector<std::shared_ptr<ITexture>>	m_shadowMaps;
+		std::vector<StaticCascade>	m_staticCascades;
 		std::vector<RenderCamera>	m_shadowCameras;
-		std::vector<vec4ui>			m_shadowViewPorts;
 		std::vector<float>			m_splitPlanes;
+		std::vector<ShadowCasterVolume>	m_casterVolumes;
+
+		//-- local lights shadows.
+		ShadowAtlas									m_shadowAtlas;
+		std::shared_ptr<ITexture>					m_staticAtlas; //-- the same layout as m_shadowAtlas.
+		std::unordered_map<uint, LocalShadowTile>	m_localTiles;
+		std::vector<LocalLightInfo>					m_localLights;
+		std::vector<LocalShadowRequest>				m_localRequests;
+		std::vector<GPULocalShadow>					m_gpuLocalShadows;
+		std::vector<int>							m_pointLightShadows;
+		std::vector<int>							m_spotLightShadows;
+		std::shared_ptr<IBuffer>					m_localShadowsTB;
+		std::shared_ptr<Material>					m_clearTileMaterial;
+		DepthStencilStateID							m_clearTileDS;
+		RenderOps									m_clearTileROPs;
+		std::shared_ptr<Material>					m_copyTileMaterial;
+		RenderOps									m_copyTileROPs;
+		uint										m_frame;
 
 	private:
 
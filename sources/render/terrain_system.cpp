@@ -7,6 +7,7 @@
 //-- ToDo: reconsider.
 #include "engine/Engine.h"
 #include "physics/physic_world.hpp"
+#include "console/Console.h"
 
 
 using namespace brUGE;
@@ -442,8 +443,15 @@ namespace render
 			return false;
 
 		//-- ToDo: reconsider much more generalized form of terrain<->physics comunication.
+		//-- Physics tiles match the terrain sectors. The first sector starts at the far left corner.
+		float sectorUnitsSize = m_sectorSize * m_unitsPerCell;
+		vec2f farLeftWorldCorner(
+			-1.0f * (m_sectorsCount / 2) * sectorUnitsSize,
+			-1.0f * (m_sectorsCount / 2) * sectorUnitsSize
+			);
+
 		bool success = Engine::instance().physicsWorld().createTerrainPhysicsObject(
-			m_tableSize, m_unitsPerCell, &m_heightTable[0], 1.0f,
+			m_tableSize, m_sectorSize, m_unitsPerCell, &m_heightTable[0], farLeftWorldCorner,
 			m_aabb.m_min.y, m_aabb.m_max.y
 			);
 
@@ -550,6 +558,23 @@ namespace render
 		return rops.size();
 	}
 
+	//----------------------------------------------------------------------------------------------
+	void TerrainSystem::calcVisibleBounds(const mat4f& viewPort, const mat4f& space, AABB& bounds) const
+	{
+		if (!m_loaded)
+		{
+			return;
+		}
+
+		for (auto iter = m_sectors.cbegin(); iter != m_sectors.cend(); ++iter)
+		{
+			if (iter->m_aabb.calculateOutcode(viewPort) != 0)
+				continue;
+
+			bounds.combine(iter->m_aabb.getTranformed(space));
+		}
+	}
+
 	//-- Generate bridge mask by comparing our LOD value with all four neighbours.
 	//----------------------------------------------------------------------------------------------
 	uint8 TerrainSystem::generateBridgeMask(const vec2us& chunkPos, uint8 LOD)
@@ -48,6 +48,9 @@ namespace render
 		//bool load(const pugi::xml_node& section);
 		uint gatherROPs(RenderSystem::EPassType pass, RenderOps& rops, const mat4f& viewPort, const vec3f& camPos);
 
+		//-- calculate bounds of the all visible sectors in the desired space.
+		void calcVisibleBounds(const mat4f& viewPort, const mat4f& space, AABB& bounds) const;
+
 		//-- ToDo: reconsider interface to physics intercommunications.
 
 	private:
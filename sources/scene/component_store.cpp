@@ -0,0 +1,128 @@
+#include "component_store.hpp"
+
+using namespace brUGE::math;
+
+namespace brUGE
+{
+
+	//----------------------------------------------------------------------------------------------
+	Transform::Transform()
+		:	m_storage(new Storage()),
+			m_localBounds(m_storage->m_localBounds), m_worldBounds(m_storage->m_worldBounds),
+			m_worldMat(m_storage->m_worldMat), m_nodes(m_storage->m_nodes)
+	{
+		m_worldMat.setIdentity();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Transform::Transform(AABB& localBounds, AABB& worldBounds, mat4f& worldMat, Nodes& nodes)
+		:	m_localBounds(localBounds), m_worldBounds(worldBounds), m_worldMat(worldMat), m_nodes(nodes)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Transform::~Transform()
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	ComponentStore::ComponentStore() : m_range(0), m_size(0)
+	{
+
+	}
+
+	//----------------------------------------------------------------------------------------------
+	ComponentStore::~ComponentStore()
+	{
+		assert(m_size == 0 && "Not all the game objects have been destroyed.");
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool ComponentStore::init(uint capacity)
+	{
+		m_worldMats.resize(capacity);
+		m_localBounds.resize(capacity);
+		m_worldBounds.resize(capacity);
+		m_meshInsts.resize(capacity, CONST_INVALID_HANDLE);
+		m_animCtrls.resize(capacity, CONST_INVALID_HANDLE);
+		m_physObjs.resize(capacity, CONST_INVALID_HANDLE);
+		m_alive.resize(capacity, 0);
+		m_nodes.resize(capacity);
+		m_transforms.resize(capacity);
+		m_objects.resize(capacity, nullptr);
+		m_freeSlots.reserve(capacity);
+
+		return true;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Handle ComponentStore::create()
+	{
+		Handle handle = CONST_INVALID_HANDLE;
+
+		if (!m_freeSlots.empty())
+		{
+			handle = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else if (m_range < capacity())
+		{
+			handle = m_range++;
+		}
+		else
+		{
+			return CONST_INVALID_HANDLE;
+		}
+
+		m_worldMats[handle].setIdentity();
+		m_localBounds[handle].setEmpty();
+		m_worldBounds[handle].setEmpty();
+		m_alive[handle] = 1;
+
+		//-- the view refers to the slot, so it's created once and then reused with the slot.
+		if (!m_transforms[handle])
+		{
+			m_transforms[handle].reset(new Transform(
+				m_localBounds[handle], m_worldBounds[handle], m_worldMats[handle], m_nodes[handle]
+				));
+		}
+
+		++m_size;
+		return handle;
+	}
+
+	//-- Note: components referring to the other subsystems have to be released by the owner.
+	//----------------------------------------------------------------------------------------------
+	void ComponentStore::destroy(Handle handle)
+	{
+		assert(isAlive(handle));
+
+		m_nodes[handle].clear();
+		m_meshInsts[handle] = CONST_INVALID_HANDLE;
+		m_animCtrls[handle] = CONST_INVALID_HANDLE;
+		m_physObjs[handle]	= CONST_INVALID_HANDLE;
+		m_objects[handle]	= nullptr;
+		m_alive[handle]		= 0;
+
+		m_freeSlots.push_back(handle);
+		--m_size;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	void ComponentStore::updateBounds(uint first, uint last)
+	{
+		for (uint i = first; i < last; ++i)
+		{
+			if (!m_alive[i] || m_localBounds[i].isEmpty())
+				continue;
+
+			if (m_physObjs[i] != CONST_INVALID_HANDLE || m_animCtrls[i] != CONST_INVALID_HANDLE)
+				continue;
+
+			m_worldBounds[i] = m_localBounds[i].getTranformed(m_worldMats[i]);
+		}
+	}
+
+} //-- brUGE
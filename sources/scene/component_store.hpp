@@ -0,0 +1,121 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include "math/AABB.hpp"
+#include "math/Matrix4x4.hpp"
+#include <vector>
+#include <memory>
+
+namespace brUGE
+{
+	class IGameObj;
+
+	//-- Exists for every node of every model.
+	//----------------------------------------------------------------------------------------------
+	class Node : public NonCopyable
+	{
+	public:
+		Node(const char* name, mat4f& matrix) : m_name(name), m_matrix(matrix) { }
+		~Node() { }
+
+		void		 matrix	(const mat4f& mat)	{ m_matrix = mat; }
+		const mat4f& matrix	() const			{ return m_matrix; }
+		const char*  name	() const			{ return m_name; }
+
+	private:
+		const char* m_name;
+		mat4f&		m_matrix;
+	};
+	typedef std::vector<std::unique_ptr<Node>> Nodes;
+
+
+	//-- View of the transform components of the game object. The components themselves live in
+	//-- the dense arrays of the ComponentStore, so the subsystems keep working with Transform* as
+	//-- before. Default constructed transform owns its components, e.g. for the benchmarks.
+	//----------------------------------------------------------------------------------------------
+	struct Transform : public NonCopyable
+	{
+		Transform();
+		Transform(AABB& localBounds, AABB& worldBounds, mat4f& worldMat, Nodes& nodes);
+		~Transform();
+
+	private:
+		struct Storage
+		{
+			AABB  m_localBounds;
+			AABB  m_worldBounds;
+			mat4f m_worldMat;
+			Nodes m_nodes;
+		};
+		std::unique_ptr<Storage> m_storage;
+
+	public:
+		AABB&  m_localBounds;
+		AABB&  m_worldBounds;
+		mat4f& m_worldMat;
+		Nodes& m_nodes;
+	};
+
+
+	//-- Components of all the game objects stored as structure of arrays. Slot index is the handle
+	//-- of the game object. All the arrays are allocated once in init() and never grow, so the
+	//-- addresses of the components are stable and the subsystems may keep pointers to them.
+	//-- Released slots are reused, so the systems iterate over [0, range()) skipping dead slots.
+	//----------------------------------------------------------------------------------------------
+	class ComponentStore : public NonCopyable
+	{
+	public:
+		ComponentStore();
+		~ComponentStore();
+
+		bool		init(uint capacity);
+
+		//-- returns CONST_INVALID_HANDLE if the store is full.
+		Handle		create();
+		void		destroy(Handle handle);
+
+		bool		isAlive	(Handle handle) const	{ return m_alive[handle] != 0; }
+		uint		size	() const				{ return m_size; }
+		uint		range	() const				{ return m_range; }
+		uint		capacity() const				{ return m_alive.size(); }
+
+		//-- per-object access.
+		Transform&		transform(Handle handle)	{ return *m_transforms[handle]; }
+		const mat4f&	worldMat (Handle handle)	{ return m_worldMats[handle]; }
+		Handle&			meshInst (Handle handle)	{ return m_meshInsts[handle]; }
+		Handle&			animCtrl (Handle handle)	{ return m_animCtrls[handle]; }
+		Handle&			physObj	 (Handle handle)	{ return m_physObjs[handle]; }
+		IGameObj*&		object	 (Handle handle)	{ return m_objects[handle]; }
+
+		//-- raw arrays for the systems living outside of the store.
+		mat4f*			worldMats()					{ return m_worldMats.data(); }
+
+		//-- systems. Every one works on the contiguous range of slots [first, last), so disjoint
+		//-- ranges may be processed in parallel.
+
+		//-- world bounds of the objects driven neither by physics nor by animation follow theirs
+		//-- world matrices. The others get theirs bounds from the corresponding subsystem. Objects
+		//-- without a mesh have empty bounds and are skipped.
+		void		updateBounds(uint first, uint last);
+
+	private:
+		//-- hot data touched by the systems every frame.
+		std::vector<mat4f>			m_worldMats;
+		std::vector<AABB>			m_localBounds;
+		std::vector<AABB>			m_worldBounds;
+		std::vector<Handle>			m_meshInsts;
+		std::vector<Handle>			m_animCtrls;
+		std::vector<Handle>			m_physObjs;
+		std::vector<byte>			m_alive;
+
+		//-- cold data.
+		std::vector<Nodes>						m_nodes;
+		std::vector<std::unique_ptr<Transform>>	m_transforms;
+		std::vector<IGameObj*>					m_objects;
+
+		std::vector<Handle>			m_freeSlots;
+		uint						m_range;
+		uint						m_size;
+	};
+
+} //-- brUGE
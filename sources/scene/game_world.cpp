@@ -1,21 +1,72 @@
 #include "game_world.hpp"
 
 #include "engine/Engine.h"
+#include "engine/job_system.hpp"
 #include "os/FileSystem.h"
 #include "render/animation_engine.hpp"
 #include "render/render_system.hpp"
 #include "render/render_world.hpp"
 #include "render/mesh_manager.hpp"
 #include "physics/physic_world.hpp"
+#include "console/Console.h"
+
+#include "SDL/SDL_timer.h"
+#include <algorithm>
+#include <random>
 
 //-- http://pugixml.org/
 #include "pugixml/pugixml.hpp"
 
+using namespace brUGE;
 using namespace brUGE::math;
 using namespace brUGE::utils;
 using namespace brUGE::os;
 using namespace brUGE::render;
 
+//-- start unnamed namespace.
+//--------------------------------------------------------------------------------------------------
+namespace
+{
+	//-- max count of the game objects in the world. Read once in init(), so it's set in the command
+	//-- line, e.g. "+game_objects_capacity 65536".
+	uint g_gameObjectsCapacity = 16 * 1024;
+
+	//-- minimal count of the objects processed by one job of the systems.
+	const uint g_objectsPerJob = 1024;
+
+	//-- game object of the old layout, i.e. the heap allocated object with the virtual update and
+	//-- all the components inside. It's used only by the benchmark as the reference.
+	//----------------------------------------------------------------------------------------------
+	class LegacyGameObj : public NonCopyable
+	{
+	public:
+		LegacyGameObj() : m_meshInst(0), m_animCtrl(CONST_INVALID_HANDLE), m_physObj(CONST_INVALID_HANDLE) { }
+		virtual ~LegacyGameObj() { }
+
+		virtual void update(float dt)
+		{
+			m_worldMat.preRotateY(dt);
+			m_worldBounds = m_localBounds.getTranformed(m_worldMat);
+		}
+
+		Handle	m_meshInst;
+		Handle	m_animCtrl;
+		Handle	m_physObj;
+		AABB	m_localBounds;
+		AABB	m_worldBounds;
+		mat4f	m_worldMat;
+		Nodes	m_nodes;
+	};
+
+	//----------------------------------------------------------------------------------------------
+	inline float elapsedMs(uint64 startTime)
+	{
+		return ((SDL_GetPerformanceCounter() - startTime) * 1000.0f) / SDL_GetPerformanceFrequency();
+	}
+}
+//--------------------------------------------------------------------------------------------------
+//-- end unnamed namespace.
+
 namespace brUGE
 {
 	//----------------------------------------------------------------------------------------------
@@ -27,16 +78,37 @@ namespace brUGE
 	//----------------------------------------------------------------------------------------------
 	GameWorld::~GameWorld()
 	{
-		for (uint i = 0; i < m_objs.size(); ++i)
+		for (auto* obj : m_behaviours)
 		{
-			delete m_objs[i];
+			releaseGameObj(obj);
+		}
+		m_behaviours.clear();
+
+		//-- the rest are the plain objects owned by the world.
+		for (uint i = 0; i < m_store.range(); ++i)
+		{
+			if (m_store.isAlive(i) && m_store.object(i) != m_playerObj.get())
+			{
+				releaseGameObj(m_store.object(i));
+			}
+		}
+
+		if (m_playerObj)
+		{
+			releaseGameObj(m_playerObj.release());
 		}
-		m_objs.clear();
 	}
 	
 	//----------------------------------------------------------------------------------------------
 	bool GameWorld::init()
 	{
+		REGISTER_CONSOLE_VALUE("game_objects_capacity", uint, g_gameObjectsCapacity);
+		REGISTER_CONSOLE_METHOD("game_objects_benchmark", _benchmark, GameWorld);
+
+		if (!m_store.init(std::max<uint>(g_gameObjectsCapacity, 1)))
+			return false;
+
+		INFO_MSG("Game world: capacity of %d game objects.", m_store.capacity());
 		return true;
 	}
 
@@ -93,59 +165,128 @@ namespace brUGE
 	//----------------------------------------------------------------------------------------------
 	bool GameWorld::addPlayer(IPlayerObj* player, const char* desc, const mat4f* orient)
 	{
-		m_playerObj.reset(player);
-
-		RODataPtr data = os::FileSystem::instance().readFile(desc);
-		if (!data)
-			return false;
+		if (m_playerObj)
+		{
+			releaseGameObj(m_playerObj.release());
+		}
 
-		if (!m_playerObj->load(*data.get(), m_objs.size(), orient))
+		if (!loadGameObj(player, desc, orient))
 		{
 			return false;
 		}
 
+		m_playerObj.reset(player);
 		return true;
 	}
 
 	//----------------------------------------------------------------------------------------------
 	Handle GameWorld::addGameObj(const char* desc, const mat4f* orient/* = NULL*/)
 	{
-		std::unique_ptr<IGameObj> obj(new IGameObj());
+		IGameObj* obj = new IGameObj();
+
+		if (!loadGameObj(obj, desc, orient))
+		{
+			return CONST_INVALID_HANDLE;
+		}
+
+		return obj->handle();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	Handle GameWorld::addGameObj(IGameObj* obj, const char* desc, const mat4f* orient)
+	{
+		if (!loadGameObj(obj, desc, orient))
+		{
+			return CONST_INVALID_HANDLE;
+		}
+
+		m_behaviours.push_back(obj);
+		return obj->handle();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	bool GameWorld::delGameObj(Handle handle)
+	{
+		if (handle == CONST_INVALID_HANDLE || static_cast<uint>(handle) >= m_store.range())
+			return false;
+
+		if (!m_store.isAlive(handle) || m_store.object(handle) == m_playerObj.get())
+			return false;
+
+		IGameObj* obj = m_store.object(handle);
+
+		auto iter = std::find(m_behaviours.begin(), m_behaviours.end(), obj);
+		if (iter != m_behaviours.end())
+		{
+			*iter = m_behaviours.back();
+			m_behaviours.pop_back();
+		}
 
-		return addGameObj(obj.release(), desc, orient);
+		releaseGameObj(obj);
+		return true;
 	}
 
+	//-- Takes ownership of the object. It's deleted if loading has failed.
 	//----------------------------------------------------------------------------------------------
-	Handle GameWorld::addGameObj(IGameObj* inObj, const char* desc, const mat4f* orient)
+	bool GameWorld::loadGameObj(IGameObj* inObj, const char* desc, const mat4f* orient)
 	{
 		std::unique_ptr<IGameObj> obj(inObj);
 
 		RODataPtr data = os::FileSystem::instance().readFile(desc);
 		if (!data)
-			return CONST_INVALID_HANDLE;
+			return false;
 
-		if (!obj->load(*data.get(), m_objs.size(), orient))
+		Handle handle = m_store.create();
+		if (handle == CONST_INVALID_HANDLE)
 		{
-			return CONST_INVALID_HANDLE;
+			ERROR_MSG("Can't add game object '%s', the limit of %d objects has been reached.",
+				desc, m_store.capacity()
+				);
+			return false;
 		}
-		else
+
+		obj->m_store = &m_store;
+		obj->m_self	 = handle;
+		m_store.object(handle) = obj.get();
+
+		if (!obj->load(*data.get(), handle, orient))
 		{
-			m_objs.push_back(obj.release());
-			return m_objs.size() - 1;
+			releaseGameObj(obj.release());
+			return false;
 		}
+
+		obj.release();
+		return true;
 	}
 
 	//----------------------------------------------------------------------------------------------
-	bool GameWorld::delGameObj(Handle handle)
+	void GameWorld::releaseGameObj(IGameObj* obj)
 	{
-		if (handle == CONST_INVALID_HANDLE || static_cast<size_t>(handle) >= m_objs.size())
-			return false;
+		const Handle handle = obj->m_self;
 
-		delete m_objs[handle];
-		m_objs[handle] = m_objs.back();
-		m_objs.pop_back();
+		Handle& meshInst = m_store.meshInst(handle);
+		if (meshInst != CONST_INVALID_HANDLE)
+		{
+			Engine::instance().renderWorld().meshManager().removeMeshInstance(meshInst);
+			meshInst = CONST_INVALID_HANDLE;
+		}
 
-		return true;
+		Handle& animCtrl = m_store.animCtrl(handle);
+		if (animCtrl != CONST_INVALID_HANDLE)
+		{
+			Engine::instance().animationEngine().removeAnimationController(animCtrl);
+			animCtrl = CONST_INVALID_HANDLE;
+		}
+
+		Handle& physObj = m_store.physObj(handle);
+		if (physObj != CONST_INVALID_HANDLE)
+		{
+			Engine::instance().physicsWorld().removePhysicsObject(physObj);
+			physObj = CONST_INVALID_HANDLE;
+		}
+
+		m_store.destroy(handle);
+		delete obj;
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -154,9 +295,9 @@ namespace brUGE
 		if (m_playerObj)
 			m_playerObj->beginUpdate(dt);
 
-		for (uint i = 0; i < m_objs.size(); ++i)
+		for (auto* obj : m_behaviours)
 		{
-			m_objs[i]->beginUpdate(dt);
+			obj->beginUpdate(dt);
 		}
 	}
 
@@ -175,37 +316,114 @@ namespace brUGE
 	//----------------------------------------------------------------------------------------------
 	void GameWorld::endUpdate()
 	{
-
+		Engine::instance().jobSystem().parallelFor(m_store.range(), g_objectsPerJob, [this](uint first, uint last)
+		{
+			m_store.updateBounds(first, last);
+		});
 	}
 
+	//-- Compares the update of the objects in the old layout, i.e. heap allocated objects with the
+	//-- virtual update visited in the shuffled order as after a while of allocations, against the
+	//-- same work done by the systems over the component arrays.
+	//-- Usage: +game_objects_benchmark 100000 in the command line.
 	//----------------------------------------------------------------------------------------------
-	IGameObj::IGameObj()
-		:	m_self(CONST_INVALID_HANDLE), m_animCtrl(CONST_INVALID_HANDLE),
-			m_meshInst(CONST_INVALID_HANDLE), m_physObj(CONST_INVALID_HANDLE)
+	int GameWorld::_benchmark(int objectsCount)
 	{
+		const uint  iterations = 16;
+		const uint  count	   = clamp(1, objectsCount, 1024 * 1024);
+		const float dt		   = 1.0f / 60.0f;
+		const AABB  bounds(vec3f(-0.5f, 0.0f, -0.5f), vec3f(0.5f, 2.0f, 0.5f));
 
-	}
+		std::mt19937 generator(0);
 
-	//----------------------------------------------------------------------------------------------
-	IGameObj::~IGameObj()
-	{
-		if (m_meshInst != CONST_INVALID_HANDLE)
+		//-- 1. old layout.
+		float legacyTime = 0.0f;
 		{
-			Engine::instance().renderWorld().meshManager().removeMeshInstance(m_meshInst);
-			m_meshInst = CONST_INVALID_HANDLE;
-		}
+			std::vector<std::unique_ptr<LegacyGameObj>> objs(count);
+			for (auto& obj : objs)
+			{
+				obj.reset(new LegacyGameObj());
+				obj->m_localBounds = bounds;
+				obj->m_worldMat.setTranslation(vec3f(float(generator() % 1000), 0.0f, float(generator() % 1000)));
+			}
+			std::shuffle(objs.begin(), objs.end(), generator);
 
-		if (m_animCtrl != CONST_INVALID_HANDLE)
-		{
-			Engine::instance().animationEngine().removeAnimationController(m_animCtrl);
-			m_animCtrl = CONST_INVALID_HANDLE;
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < iterations; ++i)
+			{
+				for (auto& obj : objs)
+				{
+					obj->update(dt);
+				}
+			}
+			legacyTime = elapsedMs(startTime) / iterations;
 		}
 
-		if (m_physObj != CONST_INVALID_HANDLE)
+		//-- 2. component arrays.
+		float soaTime	   = 0.0f;
+		float parallelTime = 0.0f;
 		{
-			Engine::instance().physicsWorld().removePhysicsObject(m_physObj);
-			m_physObj = CONST_INVALID_HANDLE;
+			ComponentStore store;
+			store.init(count);
+
+			for (uint i = 0; i < count; ++i)
+			{
+				Transform& transform = store.transform(store.create());
+				transform.m_localBounds = bounds;
+				transform.m_worldMat.setTranslation(vec3f(float(generator() % 1000), 0.0f, float(generator() % 1000)));
+			}
+
+			auto update = [&store, dt](uint first, uint last)
+			{
+				mat4f* worldMats = store.worldMats();
+				for (uint i = first; i < last; ++i)
+				{
+					worldMats[i].preRotateY(dt);
+				}
+				store.updateBounds(first, last);
+			};
+
+			uint64 startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < iterations; ++i)
+			{
+				update(0, store.range());
+			}
+			soaTime = elapsedMs(startTime) / iterations;
+
+			JobSystem& jobSystem = Engine::instance().jobSystem();
+			startTime = SDL_GetPerformanceCounter();
+			for (uint i = 0; i < iterations; ++i)
+			{
+				jobSystem.parallelFor(store.range(), g_objectsPerJob, update);
+			}
+			parallelTime = elapsedMs(startTime) / iterations;
+
+			for (uint i = 0; i < count; ++i)
+			{
+				store.destroy(i);
+			}
 		}
+
+		INFO_MSG("Game objects: %d objects, old layout %.3f ms, components %.3f ms (speedup %.2f), "
+			"components on %d threads %.3f ms (speedup %.2f).",
+			count, legacyTime, soaTime, legacyTime / soaTime,
+			Engine::instance().jobSystem().threadsCount(), parallelTime, legacyTime / parallelTime
+			);
+
+		return 0;
+	}
+
+	//----------------------------------------------------------------------------------------------
+	IGameObj::IGameObj() : m_store(nullptr), m_self(CONST_INVALID_HANDLE)
+	{
+
+	}
+
+	//-- Note: components are released by the game world.
+	//----------------------------------------------------------------------------------------------
+	IGameObj::~IGameObj()
+	{
+
 	}
 
 	//----------------------------------------------------------------------------------------------
@@ -219,14 +437,20 @@ namespace brUGE
 
 		pugi::xml_node objectDesc = doc.document_element();
 
+		assert(m_store && m_self == objID && "The game object has to be loaded by the game world.");
+
 		MeshManager& meshManager = Engine::instance().renderWorld().meshManager();
+		Transform&	 transform	 = m_store->transform(m_self);
+		Handle&		 meshInst	 = m_store->meshInst(m_self);
+		Handle&		 physObj	 = m_store->physObj(m_self);
+		Handle&		 animCtrl	 = m_store->animCtrl(m_self);
 
 		//-- 1. setup root matrix.
 		{
-			if (orient)	m_transform.m_worldMat = *orient;
-			else		m_transform.m_worldMat.setIdentity();
+			if (orient)	transform.m_worldMat = *orient;
+			else		transform.m_worldMat.setIdentity();
 
-			m_transform.m_nodes.emplace_back(std::make_unique<Node>("root", m_transform.m_worldMat));
+			transform.m_nodes.emplace_back(std::make_unique<Node>("root", transform.m_worldMat));
 		}
 
 		//-- 2. load render part of the game object.
@@ -234,14 +458,17 @@ namespace brUGE
 			pugi::xml_node renderNode = objectDesc.child("render");
 			if (renderNode.empty())
 			{
-				m_meshInst = CONST_INVALID_HANDLE;
+				meshInst = CONST_INVALID_HANDLE;
 			}
 			else
 			{
+				//-- objects without physics are considered static by default. It's only a hint, moving
+				//-- of the static object is still allowed, but it's more expensive.
 				MeshInstance::Desc desc;
 				desc.fileName = renderNode.attribute("file").value();
+				desc.isStatic = renderNode.attribute("static").as_bool(objectDesc.child("physics").empty());
 
-				m_meshInst = meshManager.createMeshInstance(desc, &m_transform);
+				meshInst = meshManager.createMeshInstance(desc, &transform);
 			}
 		}
 
@@ -250,14 +477,14 @@ namespace brUGE
 			pugi::xml_node physicsNode = objectDesc.child("physics");
 			if (physicsNode.empty())
 			{
-				m_physObj = CONST_INVALID_HANDLE;
+				physObj = CONST_INVALID_HANDLE;
 			}
 			else
 			{
 				if (auto desc = physicsNode.attribute("file"))
 				{
-					m_physObj = Engine::instance().physicsWorld().createPhysicsObject(
-						desc.value(), &m_transform, objID
+					physObj = Engine::instance().physicsWorld().createPhysicsObject(
+						desc.value(), &transform, objID
 						);
 				}
 			}
@@ -265,25 +492,22 @@ namespace brUGE
 
 		//-- 4. setup animation part.
 		{
-			MeshInstance& meshInst = meshManager.getMeshInstance(m_meshInst);
+			MeshInstance& mesh = meshManager.getMeshInstance(meshInst);
 
-			if (meshInst.m_skinnedMesh)
+			if (mesh.m_skinnedMesh)
 			{
 				AnimationController::Desc desc;
-				desc.m_meshInst  = &meshInst;
-				desc.m_transform = &m_transform;
+				desc.m_meshInst  = &mesh;
+				desc.m_transform = &transform;
 
-				m_animCtrl = Engine::instance().animationEngine().createAnimationController(desc);
+				animCtrl = Engine::instance().animationEngine().createAnimationController(desc);
 			}
 			else
 			{
-				m_animCtrl = CONST_INVALID_HANDLE;
+				animCtrl = CONST_INVALID_HANDLE;
 			}
 		}
 
-		//-- store its own unique handle in the world after complete successfully initialization.
-		m_self = objID;
-
 		return true;
 	}
 
@@ -294,16 +518,4 @@ namespace brUGE
 		return false;
 	}
 
-	//----------------------------------------------------------------------------------------------
-	Transform::Transform()
-	{
-
-	}
-
-	//----------------------------------------------------------------------------------------------
-	Transform::~Transform()
-	{
-
-	}
-
 } //-- brUGE
\ No newline at end of file
@@ -2,8 +2,7 @@
 
 #include "prerequisites.hpp"
 #include "utils/Data.hpp"
-#include "math/AABB.hpp"
-#include "math/Matrix4x4.hpp"
+#include "component_store.hpp"
 #include "SDL/SDL_events.h"
 #include <vector>
 #include <memory>
@@ -11,38 +10,6 @@
 namespace brUGE
 {
 
-	//-- Exists for every node of every model.
-	//----------------------------------------------------------------------------------------------
-	class Node : public NonCopyable
-	{
-	public:
-		Node(const char* name, mat4f& matrix) : m_name(name), m_matrix(matrix) { }
-		~Node() { }
-
-		void		 matrix	(const mat4f& mat)	{ m_matrix = mat; }
-		const mat4f& matrix	() const			{ return m_matrix; }
-		const char*  name	() const			{ return m_name; }
-
-	private:
-		const char* m_name;
-		mat4f&		m_matrix;
-	};
-	typedef std::vector<std::unique_ptr<Node>> Nodes;
-
-
-	//----------------------------------------------------------------------------------------------
-	struct Transform : public NonCopyable
-	{
-		Transform();
-		~Transform();
-
-		AABB  m_localBounds;
-		AABB  m_worldBounds;
-		mat4f m_worldMat;
-		Nodes m_nodes;
-	};
-
-
 	//-- Simple event system implementation.
 	//-- ToDo: Rework it.
 	//----------------------------------------------------------------------------------------------
@@ -55,6 +22,10 @@ namespace brUGE
 
 
 	//-- The minimal point of the engines game objects subsystem.
+	//-- Game object is only a handle to its components in the ComponentStore of the game world. The
+	//-- virtual functions are the compatibility layer for the objects having theirs own behaviour,
+	//-- only such objects are visited by the update functions. The plain objects loaded by
+	//-- GameWorld::addGameObj(desc) are handled entirely by the systems.
 	//----------------------------------------------------------------------------------------------
 	class IGameObj : public NonCopyable
 	{
@@ -73,20 +44,19 @@ namespace brUGE
 		virtual void postAnimUpdate() { }
 		virtual void endUpdate() { }
 
-		//-- ToDo: remove.
-		Handle			animCtrl() { return m_animCtrl; }
-		Handle			physObj()  { return m_physObj; }
-		const mat4f&	worldPos() { return m_transform.m_worldMat; }
+		//-- access to the components. Valid only after the object has been added to the world.
+		Handle			handle()	const { return m_self; }
+		Handle			meshInst()	const { return m_store->meshInst(m_self); }
+		Handle			animCtrl()	const { return m_store->animCtrl(m_self); }
+		Handle			physObj()	const { return m_store->physObj(m_self); }
+		Transform&		transform()	const { return m_store->transform(m_self); }
+		const mat4f&	worldPos()	const { return m_store->worldMat(m_self); }
 
-	protected:
+	private:
+		friend class GameWorld;
+
+		ComponentStore*	m_store;
 		Handle			m_self;
-		Handle			m_meshInst;
-		Handle			m_animCtrl;
-		Handle			m_physObj;
-		//SoundData*	m_soundData;
-		//ScriptData*	m_scriptData;
-		//AIData*		m_aiData;
-		Transform		m_transform;
 	};
 
 
@@ -133,7 +103,10 @@ namespace brUGE
 		Handle			addGameObj(IGameObj* obj, const char* desc, const mat4f* orient = NULL);
 		Handle			addGameObj(const char* desc, const mat4f* orient = NULL);
 		bool			delGameObj(Handle handle);
-		IGameObj*		getGameObj(Handle handle) { return m_objs[handle]; }
+		IGameObj*		getGameObj(Handle handle) { return m_store.object(handle); }
+
+		//-- components of all the game objects.
+		ComponentStore&	components() { return m_store; }
 
 		//-- update functions bucket.
 		void			beginUpdate(float /*dt*/);
@@ -141,10 +114,17 @@ namespace brUGE
 		void			postAnimUpdate();
 		void			endUpdate();
 
+		//-- console functions.
+		int				_benchmark(int objectsCount);
+
+	private:
+		bool			loadGameObj(IGameObj* obj, const char* desc, const mat4f* orient);
+		void			releaseGameObj(IGameObj* obj);
+
 	private:
-		typedef std::vector<IGameObj*> GameObjs;
-		GameObjs m_objs;
-		std::unique_ptr<IPlayerObj> m_playerObj;
+		ComponentStore				m_store;
+		std::vector<IGameObj*>		m_behaviours; //-- objects with own update functions.
+		std::unique_ptr<IPlayerObj>	m_playerObj;
 	};
 
 } //-- brUGE
\ No newline at end of file
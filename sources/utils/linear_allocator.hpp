@@ -0,0 +1,191 @@
+#pragma once
+
+#include "prerequisites.hpp"
+#include <atomic>
+#include <malloc.h>
+#include <memory>
+#include <new>
+#include <vector>
+#include <cassert>
+
+namespace brUGE
+{
+namespace utils
+{
+
+	//-- Bump allocator over the fixed memory block. Allocation just moves the offset, memory is
+	//-- released only all at once by reset() or by rewind() to the previously taken marker.
+	//-- Allocation is lock-free, so one allocator may be shared between several threads. If the
+	//-- block is exhausted the general heap is used and the overflow is counted, so the block size
+	//-- may be tuned by the watchers. Heap allocations keep the requested alignment too.
+	//----------------------------------------------------------------------------------------------
+	class LinearAllocator : public NonCopyable
+	{
+	public:
+		LinearAllocator() : m_capacity(0), m_offset(0), m_peak(0), m_overflows(0) { }
+
+		//------------------------------------------------------------------------------------------
+		void init(size_t capacity)
+		{
+			m_memory.reset(new byte[capacity]);
+			m_capacity = capacity;
+			m_offset   = 0;
+		}
+
+		//------------------------------------------------------------------------------------------
+		void* allocate(size_t size, size_t alignment)
+		{
+			size_t offset = m_offset.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				size_t base = reinterpret_cast<size_t>(m_memory.get());
+				size_t from = ((base + offset + alignment - 1) & ~(alignment - 1)) - base;
+				size_t to	= from + size;
+
+				if (to > m_capacity)
+				{
+					++m_overflows;
+					if (void* ptr = _aligned_malloc(size ? size : 1, alignment))
+						return ptr;
+
+					throw std::bad_alloc();
+				}
+
+				if (m_offset.compare_exchange_weak(offset, to, std::memory_order_relaxed))
+				{
+					return m_memory.get() + from;
+				}
+			}
+		}
+
+		//-- Note: memory of the block is released only by reset() or rewind().
+		//------------------------------------------------------------------------------------------
+		void deallocate(void* ptr)
+		{
+			if (!owns(ptr))
+			{
+				_aligned_free(ptr);
+			}
+		}
+
+		//------------------------------------------------------------------------------------------
+		void reset()
+		{
+			rewind(0);
+		}
+
+		//-- marker and rewind are intended for the single threaded scoped usage.
+		//------------------------------------------------------------------------------------------
+		size_t marker() const
+		{
+			return m_offset.load(std::memory_order_relaxed);
+		}
+
+		//------------------------------------------------------------------------------------------
+		void rewind(size_t marker)
+		{
+			assert(marker <= m_offset);
+
+			size_t used = m_offset.load(std::memory_order_relaxed);
+			if (used > m_peak)
+			{
+				m_peak = used;
+			}
+			m_offset = marker;
+		}
+
+		//------------------------------------------------------------------------------------------
+		bool owns(const void* ptr) const
+		{
+			const byte* p = static_cast<const byte*>(ptr);
+			return p >= m_memory.get() && p < m_memory.get() + m_capacity;
+		}
+
+		size_t	used()		const { return m_offset.load(std::memory_order_relaxed); }
+		size_t	peak()		const { return m_peak; }
+		size_t	capacity()	const { return m_capacity; }
+		uint	overflows() const { return m_overflows.load(std::memory_order_relaxed); }
+
+	private:
+		std::unique_ptr<byte[]>	m_memory;
+		size_t					m_capacity;
+		std::atomic<size_t>		m_offset;
+		size_t					m_peak;
+		std::atomic<uint>		m_overflows;
+	};
+
+
+	//-- STL compatible allocator working on top of the LinearAllocator. Default constructed
+	//-- allocator uses the general heap, so containers which live longer than one frame just keep
+	//-- working as before. Copy assignment doesn't propagate the arena, so copying of the transient
+	//-- container into the persistent one keeps the persistent memory. Move assignment and swap do
+	//-- propagate it, so a persistent container may be rebound to the new arena every frame:
+	//--	m_items = ArenaVector<Item>(frameMemory.frameAllocator<Item>());
+	//----------------------------------------------------------------------------------------------
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		typedef T			value_type;
+		typedef std::false_type	propagate_on_container_copy_assignment;
+		typedef std::true_type	propagate_on_container_move_assignment;
+		typedef std::true_type	propagate_on_container_swap;
+
+		template<typename U>
+		struct rebind { typedef ArenaAllocator<U> other; };
+
+	public:
+		ArenaAllocator() : m_arena(nullptr) { }
+		explicit ArenaAllocator(LinearAllocator& arena) : m_arena(&arena) { }
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) { }
+
+		//------------------------------------------------------------------------------------------
+		T* allocate(size_t count)
+		{
+			if (m_arena)
+			{
+				return static_cast<T*>(m_arena->allocate(count * sizeof(T), __alignof(T)));
+			}
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+
+		//------------------------------------------------------------------------------------------
+		void deallocate(T* ptr, size_t /*count*/)
+		{
+			if (m_arena)
+			{
+				m_arena->deallocate(ptr);
+			}
+			else
+			{
+				::operator delete(ptr);
+			}
+		}
+
+		LinearAllocator* arena() const { return m_arena; }
+
+	private:
+		LinearAllocator* m_arena;
+	};
+
+	//----------------------------------------------------------------------------------------------
+	template<typename T, typename U>
+	inline bool operator == (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+	{
+		return a.arena() == b.arena();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<typename T, typename U>
+	inline bool operator != (const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+	{
+		return a.arena() != b.arena();
+	}
+
+	//----------------------------------------------------------------------------------------------
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} //-- utils
+} //-- brUGE